@@ -9,9 +9,12 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <stddef.h>
 
 namespace can{
 
+static_assert(offsetof(cyclic_tx_buffer, cyclic_frames) == offsetof(bcm_msg_head, frames), "cyclic_tx_buffer must match the bcm_msg_head layout");
+
 bus::bus(){
   receive_frame_filters = 0x0;
   bus_socket            = 0x0;
@@ -22,7 +25,7 @@ bus::bus(){
   memset(&read_frame, 0x0, sizeof(read_frame));
   memset(&receive_frame_filter, 0x0, sizeof(receive_frame_filter));
   memset(busname, 0x0, MAX_BUSNAME_SIZE);
-  memset(&tx_buffer, 0x0, MAX_CYCLIC_TX_FRAMES*sizeof(can_frame)+sizeof(bcm_msg_head));
+  memset(&tx_buffer, 0x0, sizeof(tx_buffer));
 }/*bus::bus*/
 
 bus::~bus(){
@@ -84,6 +87,7 @@ int bus::open(void){
     return -2;
   }/*if*/
 
+  return 1;
 }/*bus::open*/
 
 int bus::open_all(void){
@@ -127,6 +131,7 @@ int bus::open_cyclic(void){
     return -2;
   }/*if*/
 
+  return 1;
 }/*bus::open_cyclic*/
 
 int bus::close(void){
@@ -190,7 +195,8 @@ void bus::configure_cyclic_deaf_datapump(struct timeval cyclic_rate){
   tx_buffer.cyclic_header.count = 0x0;
   tx_buffer.cyclic_header.ival1.tv_sec = 0x0;
   tx_buffer.cyclic_header.ival1.tv_usec = 0x0;
-  tx_buffer.cyclic_header.ival2 = cyclic_rate;
+  tx_buffer.cyclic_header.ival2.tv_sec = cyclic_rate.tv_sec;
+  tx_buffer.cyclic_header.ival2.tv_usec = cyclic_rate.tv_usec;
 }/*bus::configure_cyclic_deaf_datapump*/
 
 void bus::configure_cyclic_datapump_frames(unsigned int frames, frame_list_node first_frame_list_node){
@@ -208,8 +214,33 @@ void bus::configure_cyclic_datapump_frames(unsigned int frames, frame_list_node
 
 }/*bus::configure_cyclic_datapump_frames*/
 
-void bus::start_pumping_cyclic_data(void){
-  write(bus_socket, &tx_buffer, sizeof(bcm_msg_head) + tx_buffer.cyclic_header.nframes*sizeof(can_frame));
+int bus::configure_cyclic_datapump_frames(unsigned int frames, const can_frame* frame_array){
+  if( (frame_array == 0) || (frames < 1) || (frames > MAX_CYCLIC_TX_FRAMES) ){
+    perror("Invalid number of cyclic frames");
+    return 0;
+  }/*if*/
+
+  /*
+   * The frames carry their own CAN IDs (TX_CP_CAN_ID is not set),
+   * the header ID only identifies the transmission task.
+   */
+  tx_buffer.cyclic_header.can_id  = frame_array[0].can_id;
+  tx_buffer.cyclic_header.nframes = frames;
+
+  memcpy(tx_buffer.cyclic_frames, frame_array, frames*sizeof(can_frame));
+
+  return 1;
+}/*bus::configure_cyclic_datapump_frames*/
+
+int bus::start_pumping_cyclic_data(void){
+  unsigned int message_size = sizeof(cyclic_tx_header) + tx_buffer.cyclic_header.nframes*sizeof(can_frame);
+
+  if(write(bus_socket, &tx_buffer, message_size) < (int)message_size){
+    perror("Could not set up cyclic transmission");
+    return 0;
+  }/*if*/
+
+  return 1;
 }/*bus::start_pumping_cyclic_data*/
 
 void bus::stop_pumping_cyclic_data(void){
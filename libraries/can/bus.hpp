@@ -39,9 +39,23 @@ struct frame_list_node{
   frame_list_node* next_frame_list_node;
 };
 
+/*
+ * Same layout as struct bcm_msg_head, but without its flexible frame array,
+ * which C++ does not allow to be followed by another member.
+ */
+struct cyclic_tx_header{
+  __u32               opcode;
+  __u32               flags;
+  __u32               count;
+  struct bcm_timeval  ival1;
+  struct bcm_timeval  ival2;
+  canid_t             can_id;
+  __u32               nframes;
+};
+
 struct cyclic_tx_buffer{
-  struct bcm_msg_head cyclic_header;
-  struct can_frame cyclic_frames[MAX_CYCLIC_TX_FRAMES];
+  struct cyclic_tx_header cyclic_header;
+  struct can_frame        cyclic_frames[MAX_CYCLIC_TX_FRAMES];
 };
 
 class bus{
@@ -134,10 +148,18 @@ class bus{
     void configure_cyclic_deaf_datapump(struct timeval cyclic_rate);
     void configure_cyclic_datapump_frames(unsigned int frames, frame_list_node first_frame_list_node);
 
+    /*
+     * Hands a sequence of frames to the broadcast manager.
+     * The kernel transmits one frame of the sequence per cyclic_rate interval, in order,
+     * and starts over from the first frame once the sequence has been sent.
+     * Returns 0 on failure.
+     */
+    int configure_cyclic_datapump_frames(unsigned int frames, const can_frame* frame_array);
+
     /*
      * These calls should be used to start and stop the transmission of cyclic frames.
      */
-    void start_pumping_cyclic_data(void);
+    int start_pumping_cyclic_data(void);
     void stop_pumping_cyclic_data(void);
 
     /*
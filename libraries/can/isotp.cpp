@@ -0,0 +1,491 @@
+/*
+ * Description:
+ *   Implementation file for the ISO-TP transport.
+ */
+
+#include "isotp.hpp"
+#include "timing/clock.h"
+
+#include <fcntl.h>
+#include <errno.h>
+
+namespace can{
+
+#define ISOTP_SINGLE_FRAME        0x0
+#define ISOTP_FIRST_FRAME         0x1
+#define ISOTP_CONSECUTIVE_FRAME   0x2
+#define ISOTP_FLOW_CONTROL        0x3
+
+#define ISOTP_CONTINUE_TO_SEND    0x0
+#define ISOTP_WAIT                0x1
+#define ISOTP_OVERFLOW            0x2
+
+/*
+ * The separation time of a flow control frame in microseconds.
+ * Reserved values mean the longest separation time there is.
+ */
+static unsigned long long decode_st_min(const unsigned char st_min){
+  if(st_min <= 0x7F){
+    return st_min*1000ULL;
+  }/*if*/
+
+  if( (st_min >= 0xF1) && (st_min <= 0xF9) ){
+    return (st_min-0xF0)*100ULL;
+  }/*if*/
+
+  return 0x7F*1000ULL;
+}/*decode_st_min*/
+
+isotp_channel::isotp_channel(){
+  mode          = Isotp_Closed;
+  isotp_socket  = -1;
+  canbus        = 0;
+  tx_id         = 0x0;
+  rx_id         = 0x0;
+  block_size    = ISOTP_DEFAULT_BLOCK_SIZE;
+  st_min        = ISOTP_DEFAULT_ST_MIN;
+  padding       = ISOTP_DEFAULT_PADDING;
+  timeouts      = 0;
+  errors        = 0;
+  overruns      = 0;
+
+  tx_length           = 0;
+  tx_offset           = 0;
+  tx_sequence         = 0;
+  tx_block_remaining  = 0;
+  tx_separation       = 0;
+  tx_time             = 0;
+  tx_wait_frames      = 0;
+  tx_state            = Isotp_Idle;
+
+  rx_length           = 0;
+  rx_offset           = 0;
+  rx_sequence         = 0;
+  rx_block_remaining  = 0;
+  rx_time             = 0;
+  rx_active           = false;
+
+  message_head        = 0;
+  queued_messages     = 0;
+}/*isotp_channel::isotp_channel*/
+
+isotp_channel::~isotp_channel(){
+  close();
+}/*isotp_channel::~isotp_channel*/
+
+void isotp_channel::set_flow_control(const unsigned char given_block_size, const unsigned char given_st_min){
+  block_size  = given_block_size;
+  st_min      = given_st_min;
+}/*isotp_channel::set_flow_control*/
+
+void isotp_channel::set_padding(const int given_padding){
+  padding = (given_padding < 0) ? -1 : (given_padding & 0xFF);
+}/*isotp_channel::set_padding*/
+
+int isotp_channel::open(const char* interface_name, const unsigned int given_tx_id, const unsigned int given_rx_id, bus* fallback_bus){
+  close();
+
+  tx_id = given_tx_id;
+  rx_id = given_rx_id;
+
+  if( (interface_name != 0) && open_kernel(interface_name) ){
+    mode = Isotp_Kernel;
+    return 1;
+  }/*if*/
+
+  if(fallback_bus == 0){
+    return 0;
+  }/*if*/
+
+  return open_userspace(fallback_bus, given_tx_id, given_rx_id);
+}/*isotp_channel::open*/
+
+int isotp_channel::open_kernel(const char* interface_name){
+  unsigned int interface_index = if_nametoindex(interface_name);
+
+  if(interface_index == 0){
+    return 0;
+  }/*if*/
+
+  /* Fails with EPROTONOSUPPORT on kernels without ISO-TP, which is no error here. */
+  if( (isotp_socket = socket(PF_CAN, SOCK_DGRAM, CAN_ISOTP)) < 0 ){
+    return 0;
+  }/*if*/
+
+  can_isotp_options     options;
+  can_isotp_fc_options  flow_control;
+  sockaddr_can          isotp_addr;
+
+  memset(&options, 0x0, sizeof(options));
+  memset(&flow_control, 0x0, sizeof(flow_control));
+  memset(&isotp_addr, 0x0, sizeof(isotp_addr));
+
+  if(padding >= 0){
+    options.flags         = CAN_ISOTP_TX_PADDING;
+    options.txpad_content = padding;
+  }/*if*/
+
+  flow_control.bs     = block_size;
+  flow_control.stmin  = st_min;
+  flow_control.wftmax = 0;
+
+  isotp_addr.can_family         = AF_CAN;
+  isotp_addr.can_ifindex        = interface_index;
+  isotp_addr.can_addr.tp.tx_id  = tx_id;
+  isotp_addr.can_addr.tp.rx_id  = rx_id;
+
+  if( (setsockopt(isotp_socket, SOL_CAN_ISOTP, CAN_ISOTP_OPTS, &options, sizeof(options)) < 0) ||
+      (setsockopt(isotp_socket, SOL_CAN_ISOTP, CAN_ISOTP_RECV_FC, &flow_control, sizeof(flow_control)) < 0) ||
+      (bind(isotp_socket, (sockaddr*)&isotp_addr, sizeof(isotp_addr)) < 0) ){
+    perror("Could not set up ISO-TP socket");
+    ::close(isotp_socket);
+    isotp_socket = -1;
+    return 0;
+  }/*if*/
+
+  fcntl(isotp_socket, F_SETFL, O_NONBLOCK);
+
+  return 1;
+}/*isotp_channel::open_kernel*/
+
+int isotp_channel::open_userspace(bus* given_canbus, const unsigned int given_tx_id, const unsigned int given_rx_id){
+  close();
+
+  if(given_canbus == 0){
+    return 0;
+  }/*if*/
+
+  canbus  = given_canbus;
+  tx_id   = given_tx_id;
+  rx_id   = given_rx_id;
+  mode    = Isotp_Userspace;
+
+  return 1;
+}/*isotp_channel::open_userspace*/
+
+void isotp_channel::close(void){
+  if(isotp_socket >= 0){
+    ::close(isotp_socket);
+    isotp_socket = -1;
+  }/*if*/
+
+  mode            = Isotp_Closed;
+  canbus          = 0;
+  tx_state        = Isotp_Idle;
+  rx_active       = false;
+  message_head    = 0;
+  queued_messages = 0;
+}/*isotp_channel::close*/
+
+int isotp_channel::send_frame(const unsigned char* data, const unsigned size){
+  can_frame frame;
+
+  memset(&frame, (padding >= 0) ? padding : 0x0, sizeof(frame));
+  memcpy(frame.data, data, size);
+
+  frame.can_id  = tx_id;
+  frame.can_dlc = (padding >= 0) ? 8 : size;
+
+  return canbus->send(&frame) == (int)sizeof(can_frame);
+}/*isotp_channel::send_frame*/
+
+int isotp_channel::send_flow_control(void){
+  unsigned char data[3] = {(ISOTP_FLOW_CONTROL << 4) | ISOTP_CONTINUE_TO_SEND, block_size, st_min};
+
+  return send_frame(data, sizeof(data));
+}/*isotp_channel::send_flow_control*/
+
+int isotp_channel::send(const unsigned char* payload, const unsigned int length){
+  if( (payload == 0) || (length == 0) || (length > ISOTP_MAX_PAYLOAD) ){
+    return 0;
+  }/*if*/
+
+  if(mode == Isotp_Kernel){
+    int written_bytes = write(isotp_socket, payload, length);
+
+    if( (written_bytes < 0) && (errno != EAGAIN) ){
+      perror("Could not send ISO-TP message");
+    }/*if*/
+
+    return written_bytes == (int)length;
+  }/*if*/
+
+  if( (mode != Isotp_Userspace) || (tx_state != Isotp_Idle) ){
+    return 0;
+  }/*if*/
+
+  unsigned char data[8];
+
+  if(length <= ISOTP_SINGLE_FRAME_PAYLOAD){
+    data[0] = (ISOTP_SINGLE_FRAME << 4) | length;
+    memcpy(data+1, payload, length);
+
+    return send_frame(data, length+1);
+  }/*if*/
+
+  data[0] = (ISOTP_FIRST_FRAME << 4) | (length >> 8);
+  data[1] = length & 0xFF;
+  memcpy(data+2, payload, ISOTP_FIRST_FRAME_PAYLOAD);
+
+  if(!send_frame(data, sizeof(data))){
+    return 0;
+  }/*if*/
+
+  memcpy(tx_buffer, payload, length);
+  tx_length       = length;
+  tx_offset       = ISOTP_FIRST_FRAME_PAYLOAD;
+  tx_sequence     = 1;
+  tx_wait_frames  = 0;
+  tx_time         = monotonic_microseconds();
+  tx_state        = Isotp_Wait_Flow_Control;
+
+  return 1;
+}/*isotp_channel::send*/
+
+bool isotp_channel::handle_frame(const unsigned int can_id, const unsigned size, const unsigned char* data){
+  if( (mode == Isotp_Closed) || (can_id != rx_id) ){
+    return false;
+  }/*if*/
+
+  if( (mode == Isotp_Kernel) || (size < 1) ){
+    return true;
+  }/*if*/
+
+  switch(data[0] >> 4){
+    case ISOTP_SINGLE_FRAME:
+      handle_single_frame(size, data);
+      break;
+    case ISOTP_FIRST_FRAME:
+      handle_first_frame(size, data);
+      break;
+    case ISOTP_CONSECUTIVE_FRAME:
+      handle_consecutive_frame(size, data);
+      break;
+    case ISOTP_FLOW_CONTROL:
+      handle_flow_control(size, data);
+      break;
+    default:
+      errors += 1;
+      break;
+  }/*switch*/
+
+  return true;
+}/*isotp_channel::handle_frame*/
+
+void isotp_channel::handle_single_frame(const unsigned size, const unsigned char* data){
+  unsigned int length = data[0] & 0x0F;
+
+  if( (length == 0) || (length > size-1) ){
+    errors += 1;
+    return;
+  }/*if*/
+
+  /* A new message from the peer ends whatever it was sending before. */
+  rx_active = false;
+  complete_message(data+1, length);
+}/*isotp_channel::handle_single_frame*/
+
+void isotp_channel::handle_first_frame(const unsigned size, const unsigned char* data){
+  unsigned int length = ((data[0] & 0x0F) << 8) | data[1];
+
+  if( (size < 8) || (length <= ISOTP_SINGLE_FRAME_PAYLOAD) ){
+    errors += 1;
+    return;
+  }/*if*/
+
+  memcpy(rx_buffer, data+2, ISOTP_FIRST_FRAME_PAYLOAD);
+  rx_length           = length;
+  rx_offset           = ISOTP_FIRST_FRAME_PAYLOAD;
+  rx_sequence         = 1;
+  rx_block_remaining  = block_size;
+  rx_time             = monotonic_microseconds();
+  rx_active           = true;
+
+  send_flow_control();
+}/*isotp_channel::handle_first_frame*/
+
+void isotp_channel::handle_consecutive_frame(const unsigned size, const unsigned char* data){
+  if(!rx_active){
+    return;
+  }/*if*/
+
+  if((data[0] & 0x0F) != rx_sequence){
+    /* A frame went missing, the message cannot be put together any more. */
+    errors    += 1;
+    rx_active = false;
+    return;
+  }/*if*/
+
+  unsigned int remaining  = rx_length-rx_offset;
+  unsigned int bytes      = (remaining < ISOTP_CONSECUTIVE_PAYLOAD) ? remaining : ISOTP_CONSECUTIVE_PAYLOAD;
+
+  if(bytes > size-1){
+    errors    += 1;
+    rx_active = false;
+    return;
+  }/*if*/
+
+  memcpy(rx_buffer+rx_offset, data+1, bytes);
+  rx_offset   += bytes;
+  rx_sequence = (rx_sequence+1) & 0x0F;
+  rx_time     = monotonic_microseconds();
+
+  if(rx_offset >= rx_length){
+    rx_active = false;
+    complete_message(rx_buffer, rx_length);
+    return;
+  }/*if*/
+
+  if( (block_size > 0) && (--rx_block_remaining == 0) ){
+    rx_block_remaining = block_size;
+    send_flow_control();
+  }/*if*/
+}/*isotp_channel::handle_consecutive_frame*/
+
+void isotp_channel::handle_flow_control(const unsigned size, const unsigned char* data){
+  if( (tx_state != Isotp_Wait_Flow_Control) || (size < 3) ){
+    return;
+  }/*if*/
+
+  unsigned long long now = monotonic_microseconds();
+
+  switch(data[0] & 0x0F){
+    case ISOTP_CONTINUE_TO_SEND:
+      tx_block_remaining  = data[1];
+      tx_separation       = decode_st_min(data[2]);
+      tx_time             = now;
+      tx_state            = Isotp_Sending;
+      transmit_consecutive_frames(now);
+      break;
+    case ISOTP_WAIT:
+      if(++tx_wait_frames > ISOTP_MAX_WAIT_FRAMES){
+        errors    += 1;
+        tx_state  = Isotp_Idle;
+      }/*if*/
+      else{
+        tx_time = now;
+      }/*else*/
+      break;
+    default:
+      /* Overflow, or an invalid flow status: the peer will not take the message. */
+      errors    += 1;
+      tx_state  = Isotp_Idle;
+      break;
+  }/*switch*/
+}/*isotp_channel::handle_flow_control*/
+
+void isotp_channel::transmit_consecutive_frames(const unsigned long long now){
+  while( (tx_state == Isotp_Sending) && (now >= tx_time) ){
+    unsigned char data[8];
+    unsigned int  remaining = tx_length-tx_offset;
+    unsigned int  bytes     = (remaining < ISOTP_CONSECUTIVE_PAYLOAD) ? remaining : ISOTP_CONSECUTIVE_PAYLOAD;
+
+    data[0] = (ISOTP_CONSECUTIVE_FRAME << 4) | tx_sequence;
+    memcpy(data+1, tx_buffer+tx_offset, bytes);
+
+    if(!send_frame(data, bytes+1)){
+      /* The socket buffer is full - try again on the next poll. */
+      break;
+    }/*if*/
+
+    tx_offset   += bytes;
+    tx_sequence = (tx_sequence+1) & 0x0F;
+
+    if(tx_offset >= tx_length){
+      tx_state = Isotp_Idle;
+    }/*if*/
+    else if( (tx_block_remaining > 0) && (--tx_block_remaining == 0) ){
+      tx_wait_frames  = 0;
+      tx_time         = now;
+      tx_state        = Isotp_Wait_Flow_Control;
+    }/*else if*/
+    else{
+      tx_time = now+tx_separation;
+    }/*else*/
+  }/*while*/
+}/*isotp_channel::transmit_consecutive_frames*/
+
+void isotp_channel::complete_message(const unsigned char* payload, const unsigned int length){
+  if(queued_messages == ISOTP_MESSAGE_QUEUE_SIZE){
+    overruns        += 1;
+    message_head    = (message_head+1) % ISOTP_MESSAGE_QUEUE_SIZE;
+    queued_messages -= 1;
+  }/*if*/
+
+  unsigned int slot = (message_head+queued_messages) % ISOTP_MESSAGE_QUEUE_SIZE;
+
+  memcpy(messages[slot], payload, length);
+  message_lengths[slot] = length;
+  queued_messages       += 1;
+}/*isotp_channel::complete_message*/
+
+void isotp_channel::poll(void){
+  if(mode != Isotp_Userspace){
+    return;
+  }/*if*/
+
+  unsigned long long now = monotonic_microseconds();
+
+  if( rx_active && (now-rx_time > ISOTP_TIMEOUT) ){
+    timeouts  += 1;
+    rx_active = false;
+  }/*if*/
+
+  if( (tx_state == Isotp_Wait_Flow_Control) && (now-tx_time > ISOTP_TIMEOUT) ){
+    timeouts  += 1;
+    tx_state  = Isotp_Idle;
+  }/*if*/
+
+  transmit_consecutive_frames(now);
+}/*isotp_channel::poll*/
+
+int isotp_channel::receive(unsigned char* payload, const unsigned int max_length){
+  if(mode == Isotp_Kernel){
+    int read_bytes = read(isotp_socket, payload, max_length);
+
+    if(read_bytes < 0){
+      if(errno != EAGAIN){
+        /* The kernel reports broken transfers here, e.g. ECOMM for a timeout. */
+        errors += 1;
+      }/*if*/
+
+      return -1;
+    }/*if*/
+
+    return read_bytes;
+  }/*if*/
+
+  if(queued_messages == 0){
+    return -1;
+  }/*if*/
+
+  unsigned int length = (message_lengths[message_head] < max_length) ? message_lengths[message_head] : max_length;
+
+  memcpy(payload, messages[message_head], length);
+  message_head    = (message_head+1) % ISOTP_MESSAGE_QUEUE_SIZE;
+  queued_messages -= 1;
+
+  return length;
+}/*isotp_channel::receive*/
+
+Isotp_Mode isotp_channel::get_mode(void) const{
+  return mode;
+}/*isotp_channel::get_mode*/
+
+bool isotp_channel::is_sending(void) const{
+  return tx_state != Isotp_Idle;
+}/*isotp_channel::is_sending*/
+
+unsigned long long isotp_channel::get_timeouts(void) const{
+  return timeouts;
+}/*isotp_channel::get_timeouts*/
+
+unsigned long long isotp_channel::get_errors(void) const{
+  return errors;
+}/*isotp_channel::get_errors*/
+
+unsigned long long isotp_channel::get_overruns(void) const{
+  return overruns;
+}/*isotp_channel::get_overruns*/
+
+}
@@ -0,0 +1,188 @@
+/*
+ * Description:
+ *  ISO-TP (ISO 15765-2) transport for diagnostic messages of up to 4095 bytes.
+ *
+ *  A channel connects to one peer: it transmits on tx_id and receives on rx_id.
+ *  Where the kernel has CAN_ISOTP sockets, the channel hands the whole protocol
+ *  to the kernel. Otherwise it falls back to a userspace engine on top of a
+ *  can::bus, which segments into first and consecutive frames and reassembles
+ *  them, answering with flow control of its own.
+ *
+ *  The flow control a channel sends asks the peer for a block size of its
+ *  choosing and a separation time (STmin) of zero, so a large answer arrives as
+ *  fast as the peer can send it. A block size of zero lets the peer send the
+ *  whole message without waiting for another flow control frame. When
+ *  transmitting, the channel keeps to the block size and STmin of the peer.
+ *
+ *  The userspace engine never blocks, and does not read the bus itself, since
+ *  the bus is usually shared: feed it every received frame with handle_frame()
+ *  and call poll() from the main loop to pace consecutive frames and expire
+ *  stalled transfers. Both are no-ops on a kernel channel, so callers use one
+ *  code path for either.
+ */
+
+#ifndef _isotp_hpp_
+#define _isotp_hpp_
+
+#include "bus.hpp"
+
+#include <linux/can/isotp.h>
+
+namespace can{
+
+#define ISOTP_MAX_PAYLOAD           4095
+#define ISOTP_SINGLE_FRAME_PAYLOAD  7
+#define ISOTP_FIRST_FRAME_PAYLOAD   6
+#define ISOTP_CONSECUTIVE_PAYLOAD   7
+
+#define ISOTP_DEFAULT_BLOCK_SIZE    0
+#define ISOTP_DEFAULT_ST_MIN        0
+#define ISOTP_DEFAULT_PADDING       0x55
+
+/*
+ * How many completed messages a userspace channel holds until they are received.
+ * Keep it at least the number of requests outstanding on a channel at once, since
+ * their answers may all complete between two calls to receive(). Beyond it, the
+ * oldest message is dropped and counted as an overrun.
+ */
+#define ISOTP_MESSAGE_QUEUE_SIZE    8
+
+/*
+ * How long to wait for flow control (N_Bs) and for the next consecutive frame (N_Cr), in microseconds.
+ */
+#define ISOTP_TIMEOUT               1000000ULL
+
+/*
+ * How many wait frames a peer may send before the transfer is given up.
+ */
+#define ISOTP_MAX_WAIT_FRAMES       16
+
+typedef enum{
+  Isotp_Closed,
+  Isotp_Kernel,
+  Isotp_Userspace
+}Isotp_Mode;
+
+typedef enum{
+  Isotp_Idle,
+  Isotp_Wait_Flow_Control,
+  Isotp_Sending
+}Isotp_Transmit_State;
+
+class isotp_channel{
+  private:
+    Isotp_Mode            mode;
+    int                   isotp_socket;
+    bus*                  canbus;
+    unsigned int          tx_id;
+    unsigned int          rx_id;
+
+    unsigned char         block_size;
+    unsigned char         st_min;
+    int                   padding;
+
+    /* Transmission. */
+    unsigned char         tx_buffer[ISOTP_MAX_PAYLOAD];
+    unsigned int          tx_length;
+    unsigned int          tx_offset;
+    unsigned char         tx_sequence;
+    unsigned int          tx_block_remaining;
+    unsigned long long    tx_separation;
+    unsigned long long    tx_time;        /* When flow control was last waited for, or when the next consecutive frame is due. */
+    unsigned int          tx_wait_frames;
+    Isotp_Transmit_State  tx_state;
+
+    /* Reception. */
+    unsigned char         rx_buffer[ISOTP_MAX_PAYLOAD];
+    unsigned int          rx_length;
+    unsigned int          rx_offset;
+    unsigned char         rx_sequence;
+    unsigned int          rx_block_remaining;
+    unsigned long long    rx_time;
+    bool                  rx_active;
+
+    /* Completed messages, oldest first, until they are received. */
+    unsigned char         messages[ISOTP_MESSAGE_QUEUE_SIZE][ISOTP_MAX_PAYLOAD];
+    unsigned int          message_lengths[ISOTP_MESSAGE_QUEUE_SIZE];
+    unsigned int          message_head;
+    unsigned int          queued_messages;
+
+    unsigned long long    timeouts;
+    unsigned long long    errors;
+    unsigned long long    overruns;
+
+    int   open_kernel(const char* interface_name);
+    int   send_frame(const unsigned char* data, const unsigned size);
+    int   send_flow_control(void);
+    void  handle_single_frame(const unsigned size, const unsigned char* data);
+    void  handle_first_frame(const unsigned size, const unsigned char* data);
+    void  handle_consecutive_frame(const unsigned size, const unsigned char* data);
+    void  handle_flow_control(const unsigned size, const unsigned char* data);
+    void  complete_message(const unsigned char* payload, const unsigned int length);
+    void  transmit_consecutive_frames(const unsigned long long now);
+
+  public:
+    isotp_channel();
+    ~isotp_channel();
+
+    /*
+     * Sets the flow control sent to the peer: the number of consecutive frames it may send
+     * before waiting for the next flow control frame (0 for all of them), and the separation
+     * time it has to keep between them, encoded as in ISO 15765-2.
+     * Takes effect on the next open().
+     */
+    void set_flow_control(const unsigned char block_size, const unsigned char st_min);
+
+    /*
+     * Sets the byte frames are padded to eight bytes with, or -1 to send frames no longer than needed.
+     * Takes effect on the next open().
+     */
+    void set_padding(const int padding);
+
+    /*
+     * Opens a CAN_ISOTP socket on the interface when the kernel supports it, and otherwise
+     * runs the userspace engine on fallback_bus, which has to be open on the same interface.
+     * Returns 0 if neither is possible.
+     */
+    int open(const char* interface_name, const unsigned int tx_id, const unsigned int rx_id, bus* fallback_bus);
+
+    /*
+     * Runs the userspace engine on canbus regardless of kernel support.
+     */
+    int open_userspace(bus* canbus, const unsigned int tx_id, const unsigned int rx_id);
+
+    void close(void);
+
+    /*
+     * Starts sending a message. Returns 0 if it is too long, or a message is still being sent.
+     */
+    int send(const unsigned char* payload, const unsigned int length);
+
+    /*
+     * Feeds a received frame into the userspace engine.
+     * Returns true if the frame belongs to this channel and needs no further handling,
+     * which on a kernel channel means the kernel has already seen to it.
+     */
+    bool handle_frame(const unsigned int can_id, const unsigned size, const unsigned char* data);
+
+    /*
+     * Sends due consecutive frames and gives up on stalled transfers.
+     */
+    void poll(void);
+
+    /*
+     * Copies the oldest complete message into payload.
+     * Returns its length, or -1 if there is none.
+     */
+    int receive(unsigned char* payload, const unsigned int max_length);
+
+    Isotp_Mode          get_mode(void) const;
+    bool                is_sending(void) const;
+    unsigned long long  get_timeouts(void) const;
+    unsigned long long  get_errors(void) const;
+    unsigned long long  get_overruns(void) const;
+};
+
+}
+
+#endif
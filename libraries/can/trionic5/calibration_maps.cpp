@@ -0,0 +1,362 @@
+/*
+ * Description:
+ *   Implementation file for the calibration map views.
+ */
+
+#include "calibration_maps.hpp"
+#include "symbol_metadata.hpp"
+
+#include <string.h>
+
+namespace trionic5net{
+
+int read_calibration_value(const unsigned char* data, const data_encapsulation encapsulation){
+  switch(encapsulation){
+    case Int8_Type:
+      return (signed char)data[0];
+    case UInt8_Type:
+      return data[0];
+    case Int16_Type:
+      return (short)((data[0] << 8) | data[1]);
+    case UInt16_Type:
+      return (data[0] << 8) | data[1];
+    case Int32_Type:
+    case UInt32_Type:
+      return (int)(((unsigned int)data[0] << 24) | (data[1] << 16) | (data[2] << 8) | data[3]);
+    default:
+      return 0;
+  }/*switch*/
+}/*read_calibration_value*/
+
+int get_axis_value(const calibration_axis* axis, const unsigned int index){
+  if( (axis->data == 0) || (index >= axis->count) ){
+    return 0;
+  }/*if*/
+
+  return read_calibration_value(axis->data+index*encapsulation_size(axis->encapsulation), axis->encapsulation);
+}/*get_axis_value*/
+
+int get_cell_value(const calibration_map* map, const unsigned int column, const unsigned int row){
+  if( (column >= map->x_axis.count) || (row >= map->y_axis.count) ){
+    return 0;
+  }/*if*/
+
+  unsigned int cell = row*map->x_axis.count+column;
+
+  return read_calibration_value(map->cells+cell*encapsulation_size(map->cell_encapsulation), map->cell_encapsulation);
+}/*get_cell_value*/
+
+calibration_maps::calibration_maps(){
+  table             = 0;
+  image             = 0;
+  image_size        = 0;
+  calibration_start = 0;
+  calibration_size  = 0;
+  number_of_maps    = 0;
+
+  memset(flash_offsets, 0xFF, sizeof(flash_offsets));
+  memset(maps, 0x0, sizeof(maps));
+}/*calibration_maps::calibration_maps*/
+
+calibration_maps::~calibration_maps(){
+
+}/*calibration_maps::~calibration_maps*/
+
+bool calibration_maps::axis_increases(const unsigned int relative_offset, const symbol* sym, const data_encapsulation encapsulation, const unsigned int start) const{
+  unsigned int size   = encapsulation_size(encapsulation);
+  unsigned int count  = sym->length/size;
+
+  const unsigned char* data = image+start+relative_offset;
+
+  int previous = read_calibration_value(data, encapsulation);
+
+  for(unsigned int i = 1; i < count; i++){
+    int value = read_calibration_value(data+i*size, encapsulation);
+
+    if(value <= previous){
+      return false;
+    }/*if*/
+
+    previous = value;
+  }/*for*/
+
+  return true;
+}/*calibration_maps::axis_increases*/
+
+int calibration_maps::locate_calibration(void){
+  unsigned int number_of_symbols  = table->get_number_of_symbols();
+  unsigned int cursor             = 0;
+
+  /* Pack the calibration symbols the way they are flashed, relative to the start of the block. */
+  for(unsigned int i = 0; i < number_of_symbols; i++){
+    const symbol* sym = table->get_symbol(i);
+
+    if(sym->address < TRIONIC5_CALIBRATION_SRAM_START){
+      flash_offsets[i] = -1;
+      continue;
+    }/*if*/
+
+    if( ((sym->length % 2) == 0) && ((cursor % 2) != 0) ){
+      cursor += 1;
+    }/*if*/
+
+    flash_offsets[i]  = cursor;
+    cursor            += sym->length;
+  }/*for*/
+
+  if( (cursor == 0) || (cursor > image_size) ){
+    return 0;
+  }/*if*/
+
+  calibration_size = cursor;
+
+  /* Gather the axes of the known maps which the firmware has. */
+  const symbol*       axes[2*NUMBER_OF_CALIBRATION_MAP_DESCRIPTORS];
+  data_encapsulation  axis_encapsulations[2*NUMBER_OF_CALIBRATION_MAP_DESCRIPTORS];
+  unsigned int        number_of_axes  = 0;
+  unsigned int        anchor          = 0;
+
+  for(unsigned int i = 0; i < 2*NUMBER_OF_CALIBRATION_MAP_DESCRIPTORS; i++){
+    const calibration_map_descriptor* descriptor = &trionic5_calibration_maps[i/2];
+
+    const char*         name          = (i % 2) ? descriptor->y_axis : descriptor->x_axis;
+    data_encapsulation  encapsulation = (i % 2) ? descriptor->y_encapsulation : descriptor->x_encapsulation;
+    const symbol*       sym           = table->find(name);
+
+    if( (sym == 0) || (flash_offsets[sym-table->get_symbol(0)] < 0) || (sym->length/encapsulation_size(encapsulation) < 2) ){
+      continue;
+    }/*if*/
+
+    bool duplicate = false;
+    for(unsigned int j = 0; j < number_of_axes; j++){
+      duplicate = duplicate || (axes[j] == sym);
+    }/*for*/
+
+    if(duplicate){
+      continue;
+    }/*if*/
+
+    axes[number_of_axes]                = sym;
+    axis_encapsulations[number_of_axes] = encapsulation;
+
+    if(sym->length/encapsulation_size(encapsulation) > axes[anchor]->length/encapsulation_size(axis_encapsulations[anchor])){
+      anchor = number_of_axes;
+    }/*if*/
+
+    number_of_axes += 1;
+  }/*for*/
+
+  if(number_of_axes == 0){
+    return 0;
+  }/*if*/
+
+  /*
+   * Only offsets at which the longest axis increases are scored at all,
+   * which rules out nearly every candidate after a compare or two.
+   */
+  unsigned int  anchor_offset = flash_offsets[axes[anchor]-table->get_symbol(0)];
+  unsigned int  best_score    = 0;
+  unsigned int  best_start    = 0;
+
+  for(unsigned int start = 0; start+calibration_size <= image_size; start++){
+    if(!axis_increases(anchor_offset, axes[anchor], axis_encapsulations[anchor], start)){
+      continue;
+    }/*if*/
+
+    unsigned int score = 0;
+    for(unsigned int i = 0; i < number_of_axes; i++){
+      if(axis_increases(flash_offsets[axes[i]-table->get_symbol(0)], axes[i], axis_encapsulations[i], start)){
+        score += 1;
+      }/*if*/
+    }/*for*/
+
+    if(score > best_score){
+      best_score = score;
+      best_start = start;
+    }/*if*/
+  }/*for*/
+
+  if(2*best_score <= number_of_axes){
+    return 0;
+  }/*if*/
+
+  calibration_start = best_start;
+
+  for(unsigned int i = 0; i < number_of_symbols; i++){
+    if(flash_offsets[i] >= 0){
+      flash_offsets[i] += calibration_start;
+    }/*if*/
+  }/*for*/
+
+  return 1;
+}/*calibration_maps::locate_calibration*/
+
+int calibration_maps::extract_axis(calibration_axis* axis, const char* name, const data_encapsulation encapsulation) const{
+  const symbol* sym = table->find(name);
+  unsigned int  size = encapsulation_size(encapsulation);
+
+  if( (sym == 0) || (get_flash_data(sym) == 0) || (size == 0) || ((sym->length % size) != 0) ){
+    return 0;
+  }/*if*/
+
+  axis->sym           = sym;
+  axis->data          = get_flash_data(sym);
+  axis->count         = sym->length/size;
+  axis->encapsulation = encapsulation;
+
+  return 1;
+}/*calibration_maps::extract_axis*/
+
+int calibration_maps::load(const symbol_table* given_table){
+  table           = given_table;
+  image           = table->get_image();
+  image_size      = table->get_image_size();
+  number_of_maps  = 0;
+
+  if( (image == 0) || !locate_calibration() ){
+    return 0;
+  }/*if*/
+
+  for(unsigned int i = 0; i < NUMBER_OF_CALIBRATION_MAP_DESCRIPTORS; i++){
+    const calibration_map_descriptor* descriptor  = &trionic5_calibration_maps[i];
+    calibration_map*                  map         = &maps[number_of_maps];
+
+    memset(map, 0x0, sizeof(calibration_map));
+
+    map->sym                = table->find(descriptor->name);
+    map->cell_encapsulation = descriptor->cell_encapsulation;
+    map->y_axis.count       = 1;
+
+    if( (map->sym == 0) || (get_flash_data(map->sym) == 0) ){
+      continue;
+    }/*if*/
+
+    if(!extract_axis(&map->x_axis, descriptor->x_axis, descriptor->x_encapsulation)){
+      continue;
+    }/*if*/
+
+    if( (descriptor->y_axis != 0) && !extract_axis(&map->y_axis, descriptor->y_axis, descriptor->y_encapsulation) ){
+      continue;
+    }/*if*/
+
+    if(map->sym->length != map->x_axis.count*map->y_axis.count*encapsulation_size(descriptor->cell_encapsulation)){
+      continue;
+    }/*if*/
+
+    map->cells      = get_flash_data(map->sym);
+    number_of_maps  += 1;
+  }/*for*/
+
+  return 1;
+}/*calibration_maps::load*/
+
+int calibration_maps::get_flash_offset(const symbol* sym) const{
+  if( (table == 0) || (sym == 0) ){
+    return -1;
+  }/*if*/
+
+  unsigned int index = sym-table->get_symbol(0);
+
+  if(index >= table->get_number_of_symbols()){
+    return -1;
+  }/*if*/
+
+  return flash_offsets[index];
+}/*calibration_maps::get_flash_offset*/
+
+const unsigned char* calibration_maps::get_flash_data(const symbol* sym) const{
+  int offset = get_flash_offset(sym);
+
+  if(offset < 0){
+    return 0;
+  }/*if*/
+
+  return image+offset;
+}/*calibration_maps::get_flash_data*/
+
+unsigned int calibration_maps::get_calibration_start(void) const{
+  return calibration_start;
+}/*calibration_maps::get_calibration_start*/
+
+unsigned int calibration_maps::get_calibration_size(void) const{
+  return calibration_size;
+}/*calibration_maps::get_calibration_size*/
+
+unsigned int calibration_maps::get_number_of_maps(void) const{
+  return number_of_maps;
+}/*calibration_maps::get_number_of_maps*/
+
+const calibration_map* calibration_maps::get_map(const unsigned int index) const{
+  if(index >= number_of_maps){
+    return 0;
+  }/*if*/
+
+  return &maps[index];
+}/*calibration_maps::get_map*/
+
+const calibration_map* calibration_maps::find(const char* name) const{
+  if(name == 0){
+    return 0;
+  }/*if*/
+
+  unsigned int name_length = strlen(name);
+
+  for(unsigned int i = 0; i < number_of_maps; i++){
+    if( (maps[i].sym->name_length == name_length) && (memcmp(maps[i].sym->name, name, name_length) == 0) ){
+      return &maps[i];
+    }/*if*/
+  }/*for*/
+
+  return 0;
+}/*calibration_maps::find*/
+
+int export_map(FILE* fp, const calibration_map* map){
+  for(unsigned int column = 0; column < map->x_axis.count; column++){
+    fprintf(fp, ";%d", get_axis_value(&map->x_axis, column));
+  }/*for*/
+  fprintf(fp, "\n");
+
+  for(unsigned int row = 0; row < map->y_axis.count; row++){
+    if(map->y_axis.data != 0){
+      fprintf(fp, "%d", get_axis_value(&map->y_axis, row));
+    }/*if*/
+
+    for(unsigned int column = 0; column < map->x_axis.count; column++){
+      fprintf(fp, ";%d", get_cell_value(map, column, row));
+    }/*for*/
+
+    fprintf(fp, "\n");
+  }/*for*/
+
+  return !ferror(fp);
+}/*export_map*/
+
+int export_maps(const char* path, const calibration_maps* maps){
+  FILE* fp = fopen(path, "w");
+  if(fp == NULL){
+    perror(path);
+    return 0;
+  }/*if*/
+
+  int success = 1;
+
+  for(unsigned int i = 0; (i < maps->get_number_of_maps()) && success; i++){
+    const calibration_map* map = maps->get_map(i);
+
+    fprintf(fp, "%.*s\n", map->sym->name_length, map->sym->name);
+    success = export_map(fp, map);
+    fprintf(fp, "\n");
+  }/*for*/
+
+  if(fclose(fp) != 0){
+    success = 0;
+  }/*if*/
+
+  if(!success){
+    perror("Failed to export maps");
+  }/*if*/
+
+  return success;
+}/*export_maps*/
+
+}
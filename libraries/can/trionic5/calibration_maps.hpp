@@ -0,0 +1,161 @@
+/*
+ * Description:
+ *  Access to the calibration maps stored in a Trionic 5 flash binary.
+ *
+ *  At start-up, Trionic copies its calibration from flash into SRAM, where the
+ *  symbol table says each table lives. The flash image carries no addresses
+ *  of its own for these tables. In flash, the calibration symbols - those at
+ *  or above TRIONIC5_CALIBRATION_SRAM_START - are packed back to back in
+ *  symbol table order, with symbols of even length aligned to even offsets.
+ *  That fixes every table relative to the start of the block, and only the
+ *  start itself has to be found.
+ *
+ *  The start is found by trying every offset at which the longest known axis
+ *  reads as strictly increasing, and keeping the one at which most of the
+ *  known axes do. Axes are break points, so they always increase; calibration
+ *  data and code rarely do for long.
+ *
+ *  Every known map is then exposed as a calibration_map: a typed view of its
+ *  axes and cells straight into the image, nothing is copied. A map with two
+ *  axes is stored row by row, one row per y axis break point.
+ */
+
+#ifndef _calibration_maps_hpp_
+#define _calibration_maps_hpp_
+
+#include <stdio.h>
+
+#include "symbol_table.hpp"
+#include "data_distribution/distribution_areas.h"
+
+namespace trionic5net{
+
+#define TRIONIC5_CALIBRATION_SRAM_START 0x4000
+#define MAX_CALIBRATION_MAPS            64
+
+struct calibration_map_descriptor{
+  const char*         name;
+  const char*         x_axis;
+  const char*         y_axis;           /* 0 for tables with a single axis. */
+  data_encapsulation  x_encapsulation;
+  data_encapsulation  y_encapsulation;
+  data_encapsulation  cell_encapsulation;
+};
+
+/*
+ * The maps known to be laid out this way in Trionic 5.5 firmware.
+ * Maps whose symbols are missing or whose sizes do not agree with their axes are skipped.
+ */
+constexpr calibration_map_descriptor trionic5_calibration_maps[] = {
+  {"Insp_mat",          "Fuel_map_xaxis",     "Fuel_map_yaxis",     UInt8_Type,   UInt16_Type,  UInt8_Type},
+  {"Fuel_knock_mat",    "Fuel_knock_xaxis",   "Fuel_map_yaxis",     UInt8_Type,   UInt16_Type,  UInt8_Type},
+  {"Purge_tab",         "Purge_map_xaxis",    "Purge_map_yaxis",    UInt8_Type,   UInt16_Type,  UInt8_Type},
+  {"Dash_tab",          "Dash_trot_axis",     "Dash_rpm_axis",      UInt16_Type,  UInt16_Type,  UInt16_Type},
+  {"Ign_map_0",         "Ign_map_0_x_axis",   "Ign_map_0_y_axis",   UInt16_Type,  UInt16_Type,  Int16_Type},
+  {"Ign_map_1",         "Ign_map_1_x_axis",   "Ign_map_1_y_axis",   UInt16_Type,  Int16_Type,   Int16_Type},
+  {"Ign_map_2",         "Ign_map_2_x_axis",   "Ign_map_2_y_axis",   UInt16_Type,  UInt16_Type,  Int16_Type},
+  {"Ign_map_3",         "Ign_map_3_x_axis",   "Ign_map_3_y_axis",   UInt16_Type,  UInt16_Type,  Int16_Type},
+  {"Ign_map_4",         "Ign_map_0_x_axis",   "Ign_map_0_y_axis",   UInt16_Type,  UInt16_Type,  Int16_Type},
+  {"Ign_map_5",         "Ign_map_5_x_axis",   "Ign_map_5_y_axis",   UInt16_Type,  UInt16_Type,  Int16_Type},
+  {"Ign_map_6",         "Ign_map_6_x_axis",   "Ign_map_6_y_axis",   UInt16_Type,  UInt16_Type,  Int16_Type},
+  {"Ign_map_7",         "Ign_map_7_x_axis",   "Ign_map_7_y_axis",   UInt16_Type,  UInt16_Type,  Int16_Type},
+  {"Ign_map_8",         "Ign_map_8_x_axis",   "Ign_map_8_y_axis",   UInt16_Type,  Int16_Type,   Int16_Type},
+  {"Knock_ref_matrix",  "Ign_map_0_x_axis",   "Ign_map_0_y_axis",   UInt16_Type,  UInt16_Type,  UInt16_Type},
+  {"Detect_map",        "Detect_map_x_axis",  "Detect_map_y_axis",  UInt16_Type,  UInt16_Type,  UInt16_Type},
+  {"Mis200_map",        "Misfire_map_x_axis", "Misfire_map_y_axis", UInt16_Type,  UInt16_Type,  UInt16_Type},
+  {"Mis1000_map",       "Misfire_map_x_axis", "Misfire_map_y_axis", UInt16_Type,  UInt16_Type,  UInt16_Type},
+  {"Tryck_mat",         "Trans_x_st",         "Pwm_ind_rpm",        UInt8_Type,   UInt16_Type,  UInt8_Type},
+  {"Tryck_mat_a",       "Trans_x_st",         "Pwm_ind_rpm",        UInt8_Type,   UInt16_Type,  UInt8_Type},
+  {"Overs_tab",         "Overs_tab_xaxis",    "Pwm_ind_rpm",        UInt8_Type,   UInt16_Type,  UInt8_Type},
+  {"Temp_reduce_mat",   "Temp_reduce_x_st",   "Temp_reduce_y_st",   UInt8_Type,   UInt16_Type,  UInt8_Type},
+  {"P_man_korr_tab",    "P_man_korr_axis",    0,                    UInt16_Type,  UInt8_Type,   UInt8_Type}
+};
+
+constexpr unsigned int NUMBER_OF_CALIBRATION_MAP_DESCRIPTORS = sizeof(trionic5_calibration_maps)/sizeof(calibration_map_descriptor);
+
+static_assert(NUMBER_OF_CALIBRATION_MAP_DESCRIPTORS <= MAX_CALIBRATION_MAPS, "MAX_CALIBRATION_MAPS is too small");
+
+struct calibration_axis{
+  const symbol*         sym;
+  const unsigned char*  data;
+  unsigned int          count;
+  data_encapsulation    encapsulation;
+};
+
+struct calibration_map{
+  const symbol*         sym;
+  calibration_axis      x_axis;
+  calibration_axis      y_axis;         /* count is 1 and data is 0 for tables with a single axis. */
+  const unsigned char*  cells;
+  data_encapsulation    cell_encapsulation;
+};
+
+/*
+ * Reads a big-endian integer of the given encapsulation.
+ */
+int read_calibration_value(const unsigned char* data, const data_encapsulation encapsulation);
+
+int get_axis_value(const calibration_axis* axis, const unsigned int index);
+int get_cell_value(const calibration_map* map, const unsigned int column, const unsigned int row);
+
+class calibration_maps{
+  private:
+    const symbol_table*   table;
+    const unsigned char*  image;
+    size_t                image_size;
+
+    /* File offset of every symbol, indexed like the symbol table. -1 for symbols outside the calibration. */
+    int                   flash_offsets[MAX_SYMBOLS];
+    unsigned int          calibration_start;
+    unsigned int          calibration_size;
+
+    calibration_map       maps[MAX_CALIBRATION_MAPS];
+    unsigned int          number_of_maps;
+
+    int   locate_calibration(void);
+    int   extract_axis(calibration_axis* axis, const char* name, const data_encapsulation encapsulation) const;
+    bool  axis_increases(const unsigned int relative_offset, const symbol* sym, const data_encapsulation encapsulation, const unsigned int start) const;
+
+  public:
+    calibration_maps();
+    ~calibration_maps();
+
+    /*
+     * Locates the calibration in the image of a loaded symbol table and extracts every known map.
+     * The table and its image must outlive this object.
+     * Returns 0 if the calibration could not be located.
+     */
+    int load(const symbol_table* table);
+
+    /*
+     * The bytes a calibration symbol was flashed with.
+     * Returns 0 for symbols outside the calibration.
+     */
+    const unsigned char*  get_flash_data(const symbol* sym) const;
+    int                   get_flash_offset(const symbol* sym) const;
+
+    unsigned int          get_calibration_start(void) const;
+    unsigned int          get_calibration_size(void) const;
+
+    unsigned int            get_number_of_maps(void) const;
+    const calibration_map*  get_map(const unsigned int index) const;
+    const calibration_map*  find(const char* name) const;
+};
+
+/*
+ * Writes a map as semicolon separated text: the x axis on the first line,
+ * then one line per row, starting with its y axis value. A map with a single
+ * axis has its row start with an empty field instead.
+ * Returns 0 on failure.
+ */
+int export_map(FILE* fp, const calibration_map* map);
+
+/*
+ * Writes every map to a single file, each one preceded by a line holding its name.
+ * Returns 0 on failure.
+ */
+int export_maps(const char* path, const calibration_maps* maps);
+
+}
+
+#endif
@@ -0,0 +1,330 @@
+/*
+ * Description:
+ *   Implementation file for the knock and misfire statistics.
+ */
+
+#include "combustion_monitor.hpp"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+namespace trionic5net{
+
+#define CELL_READ_ATTEMPTS    1000
+
+#define DEFAULT_RPM_BINS      16
+#define DEFAULT_RPM_START     500.0f
+#define DEFAULT_RPM_STEP      400.0f
+#define DEFAULT_LOAD_BINS     16
+#define DEFAULT_LOAD_START    0.0f
+#define DEFAULT_LOAD_STEP     16.0f
+
+int read_combustion_cell(const combustion_statistics* statistics, const unsigned int rpm_bin, const unsigned int load_bin, combustion_cell* copy){
+  if( (rpm_bin >= statistics->rpm_bins) || (load_bin >= statistics->load_bins) ){
+    return 0;
+  }/*if*/
+
+  const combustion_cell* cell = &statistics->cells[rpm_bin*statistics->load_bins+load_bin];
+
+  for(unsigned int attempt = 0; attempt < CELL_READ_ATTEMPTS; attempt++){
+    uint32_t sequence = cell->sequence;
+
+    if(sequence & 1){
+      continue;
+    }/*if*/
+
+    __sync_synchronize();
+    memcpy(copy, (const void*)cell, sizeof(combustion_cell));
+    __sync_synchronize();
+
+    if(cell->sequence == sequence){
+      return 1;
+    }/*if*/
+  }/*for*/
+
+  return 0;
+}/*read_combustion_cell*/
+
+/*
+ * The break point closest to a value is the number of midpoints between break points at or below it.
+ */
+static unsigned int find_bin(const float* axis, const unsigned int bins, const float value){
+  unsigned int bin = 0;
+
+  for(unsigned int i = 1; i < bins; i++){
+    bin += (2.0f*value >= axis[i-1]+axis[i]);
+  }/*for*/
+
+  return bin;
+}/*find_bin*/
+
+combustion_monitor::combustion_monitor(){
+  first_symbol      = 0;
+  statistics        = &private_statistics;
+  port_area         = 0;
+  port_handle       = -1;
+  port_name         = 0;
+  alpha             = 1.0f/COMBUSTION_MONITOR_DEFAULT_WINDOW;
+  rpm               = 0.0f;
+  load              = 0.0f;
+  rpm_bin           = 0;
+  load_bin          = 0;
+  total_revolutions = 0.0;
+  rpm_time          = 0;
+
+  memset(roles, Combustion_Role_None, sizeof(roles));
+  memset(&private_statistics, 0x0, sizeof(private_statistics));
+  memset(counter_revolutions, 0x0, sizeof(counter_revolutions));
+  memset(counter_values, 0x0, sizeof(counter_values));
+  memset(counter_seen, 0x0, sizeof(counter_seen));
+
+  float rpm_axis[DEFAULT_RPM_BINS];
+  float load_axis[DEFAULT_LOAD_BINS];
+
+  for(unsigned int i = 0; i < DEFAULT_RPM_BINS; i++){
+    rpm_axis[i] = DEFAULT_RPM_START+i*DEFAULT_RPM_STEP;
+  }/*for*/
+
+  for(unsigned int i = 0; i < DEFAULT_LOAD_BINS; i++){
+    load_axis[i] = DEFAULT_LOAD_START+i*DEFAULT_LOAD_STEP;
+  }/*for*/
+
+  set_bins(rpm_axis, DEFAULT_RPM_BINS, load_axis, DEFAULT_LOAD_BINS);
+}/*combustion_monitor::combustion_monitor*/
+
+combustion_monitor::~combustion_monitor(){
+  unpublish();
+}/*combustion_monitor::~combustion_monitor*/
+
+int combustion_monitor::bind(const symbol_table* table, const char* load_name){
+  memset(roles, Combustion_Role_None, sizeof(roles));
+  first_symbol = table->get_symbol(0);
+
+  if(first_symbol == 0){
+    return 0;
+  }/*if*/
+
+  const char* role_names[Combustion_Role_End];
+  char        numbered_names[Combustion_Role_End][MAX_SYMBOL_NAME_SIZE];
+
+  memset(role_names, 0x0, sizeof(role_names));
+  role_names[Combustion_Role_Rpm]           = "Rpm";
+  role_names[Combustion_Role_Load]          = load_name;
+  role_names[Combustion_Role_Knock_Status]  = "Knock_status";
+
+  for(unsigned int cylinder = 0; cylinder < COMBUSTION_MONITOR_CYLINDERS; cylinder++){
+    snprintf(numbered_names[Combustion_Role_Knock_Offset+cylinder], MAX_SYMBOL_NAME_SIZE, "Knock_offset%u", cylinder+1);
+    snprintf(numbered_names[Combustion_Role_Misfire_200+cylinder], MAX_SYMBOL_NAME_SIZE, "Mis200_%u", cylinder+1);
+    snprintf(numbered_names[Combustion_Role_Misfire_1000+cylinder], MAX_SYMBOL_NAME_SIZE, "Mis1000_%u", cylinder+1);
+
+    role_names[Combustion_Role_Knock_Offset+cylinder] = numbered_names[Combustion_Role_Knock_Offset+cylinder];
+    role_names[Combustion_Role_Misfire_200+cylinder]  = numbered_names[Combustion_Role_Misfire_200+cylinder];
+    role_names[Combustion_Role_Misfire_1000+cylinder] = numbered_names[Combustion_Role_Misfire_1000+cylinder];
+  }/*for*/
+
+  bool has_rpm  = false;
+  bool has_load = false;
+
+  for(unsigned int role = Combustion_Role_Rpm; role < Combustion_Role_End; role++){
+    const symbol* sym = (role_names[role] != 0) ? table->find(role_names[role]) : 0;
+
+    if(sym == 0){
+      continue;
+    }/*if*/
+
+    roles[sym-first_symbol] = role;
+
+    has_rpm   = has_rpm || (role == Combustion_Role_Rpm);
+    has_load  = has_load || (role == Combustion_Role_Load);
+  }/*for*/
+
+  return has_rpm && has_load;
+}/*combustion_monitor::bind*/
+
+int combustion_monitor::set_bins(const float* rpm_axis, const unsigned int rpm_bins, const float* load_axis, const unsigned int load_bins){
+  if( (rpm_bins == 0) || (rpm_bins > MAX_COMBUSTION_MONITOR_BINS) || (load_bins == 0) || (load_bins > MAX_COMBUSTION_MONITOR_BINS) ){
+    return 0;
+  }/*if*/
+
+  memset(statistics->cells, 0x0, sizeof(statistics->cells));
+  memcpy(statistics->rpm_axis, rpm_axis, rpm_bins*sizeof(float));
+  memcpy(statistics->load_axis, load_axis, load_bins*sizeof(float));
+
+  statistics->rpm_bins  = rpm_bins;
+  statistics->load_bins = load_bins;
+  statistics->updates   = 0;
+
+  rpm_bin   = find_bin(statistics->rpm_axis, rpm_bins, rpm);
+  load_bin  = find_bin(statistics->load_axis, load_bins, load);
+
+  return 1;
+}/*combustion_monitor::set_bins*/
+
+int combustion_monitor::set_bins(const calibration_map* map, const float load_scale, const float rpm_scale){
+  if( (map == 0) || (map->y_axis.data == 0) || (map->x_axis.count > MAX_COMBUSTION_MONITOR_BINS) || (map->y_axis.count > MAX_COMBUSTION_MONITOR_BINS) ){
+    return 0;
+  }/*if*/
+
+  float rpm_axis[MAX_COMBUSTION_MONITOR_BINS];
+  float load_axis[MAX_COMBUSTION_MONITOR_BINS];
+
+  for(unsigned int i = 0; i < map->y_axis.count; i++){
+    rpm_axis[i] = get_axis_value(&map->y_axis, i)*rpm_scale;
+  }/*for*/
+
+  for(unsigned int i = 0; i < map->x_axis.count; i++){
+    load_axis[i] = get_axis_value(&map->x_axis, i)*load_scale;
+  }/*for*/
+
+  return set_bins(rpm_axis, map->y_axis.count, load_axis, map->x_axis.count);
+}/*combustion_monitor::set_bins*/
+
+void combustion_monitor::set_window(const unsigned int samples){
+  alpha = 1.0f/(samples > 0 ? samples : 1);
+}/*combustion_monitor::set_window*/
+
+int combustion_monitor::publish(const char* given_port_name){
+  unpublish();
+
+  void* area = setup_port(given_port_name, &port_handle, COMBUSTION_STATISTICS_PORT_SIZE);
+  if(area == 0){
+    return 0;
+  }/*if*/
+
+  data_item_header header;
+  memset(&header, 0x0, sizeof(header));
+  strncpy(header.name, "Combustion statistics", DATA_ITEM_NAME_SIZE-1);
+  header.encapsulation  = Real32_Type;
+  header.unit           = Fraction;
+
+  memcpy(area, &header, sizeof(header));
+  memcpy((unsigned char*)area+sizeof(data_item_header), &private_statistics, sizeof(combustion_statistics));
+
+  port_area   = area;
+  port_name   = given_port_name;
+  statistics  = (combustion_statistics*)((unsigned char*)area+sizeof(data_item_header));
+
+  return 1;
+}/*combustion_monitor::publish*/
+
+void combustion_monitor::unpublish(void){
+  if(port_area == 0){
+    return;
+  }/*if*/
+
+  memcpy(&private_statistics, statistics, sizeof(combustion_statistics));
+  statistics = &private_statistics;
+
+  close_port(port_name, port_area, COMBUSTION_STATISTICS_PORT_SIZE);
+  close(port_handle);
+
+  port_area   = 0;
+  port_handle = -1;
+  port_name   = 0;
+}/*combustion_monitor::unpublish*/
+
+void combustion_monitor::begin_write(combustion_cell* cell){
+  cell->sequence += 1;
+  __sync_synchronize();
+}/*combustion_monitor::begin_write*/
+
+void combustion_monitor::end_write(combustion_cell* cell){
+  __sync_synchronize();
+  cell->sequence += 1;
+}/*combustion_monitor::end_write*/
+
+void combustion_monitor::update_misfires(combustion_cell* cell, const unsigned int counter, const unsigned int cylinder, const float value){
+  double revolutions    = total_revolutions-counter_revolutions[counter][cylinder];
+  float  previous       = counter_values[counter][cylinder];
+  bool   seen           = counter_seen[counter][cylinder];
+
+  counter_revolutions[counter][cylinder]  = total_revolutions;
+  counter_values[counter][cylinder]       = value;
+  counter_seen[counter][cylinder]         = true;
+
+  if(!seen){
+    return;
+  }/*if*/
+
+  /* The counters start over with every window of 200 or 1000 revolutions. */
+  float misfires  = (value >= previous) ? value-previous : value;
+  float decay     = 1.0f-(float)revolutions/COMBUSTION_MONITOR_MISFIRE_WINDOW;
+
+  if(decay < 0.0f){
+    decay = 0.0f;
+  }/*if*/
+
+  cell->misfires[counter][cylinder]     = cell->misfires[counter][cylinder]*decay+misfires;
+  cell->revolutions[counter][cylinder]  = cell->revolutions[counter][cylinder]*decay+revolutions;
+
+  float rate = (cell->revolutions[counter][cylinder] > 0.0f) ? 1000.0f*cell->misfires[counter][cylinder]/cell->revolutions[counter][cylinder] : 0.0f;
+
+  if(counter == 0){
+    cell->misfire_rate[cylinder] = rate;
+  }/*if*/
+  else{
+    cell->misfire_rate_1000[cylinder] = rate;
+  }/*else*/
+}/*combustion_monitor::update_misfires*/
+
+void combustion_monitor::update(const symbol* sym, const float value, const unsigned long long timestamp){
+  if( (first_symbol == 0) || (sym < first_symbol) || (sym >= first_symbol+MAX_SYMBOLS) ){
+    return;
+  }/*if*/
+
+  unsigned int role = roles[sym-first_symbol];
+
+  if(role == Combustion_Role_None){
+    return;
+  }/*if*/
+
+  if(role == Combustion_Role_Rpm){
+    if( (rpm_time != 0) && (timestamp > rpm_time) ){
+      total_revolutions += (rpm+value)/2.0*(timestamp-rpm_time)/60000000.0;
+    }/*if*/
+
+    rpm       = value;
+    rpm_time  = timestamp;
+    rpm_bin   = find_bin(statistics->rpm_axis, statistics->rpm_bins, rpm);
+    return;
+  }/*if*/
+
+  if(role == Combustion_Role_Load){
+    load      = value;
+    load_bin  = find_bin(statistics->load_axis, statistics->load_bins, load);
+    return;
+  }/*if*/
+
+  combustion_cell* cell = &statistics->cells[rpm_bin*statistics->load_bins+load_bin];
+
+  begin_write(cell);
+
+  cell->samples += 1;
+
+  if(role == Combustion_Role_Knock_Status){
+    cell->knock_activity += alpha*((value != 0.0f ? 1.0f : 0.0f)-cell->knock_activity);
+  }/*if*/
+  else if(role < Combustion_Role_Misfire_200){
+    unsigned int cylinder = role-Combustion_Role_Knock_Offset;
+
+    cell->knock_rate[cylinder]    += alpha*((value > 0.0f ? 1.0f : 0.0f)-cell->knock_rate[cylinder]);
+    cell->knock_retard[cylinder]  += alpha*(value-cell->knock_retard[cylinder]);
+  }/*else if*/
+  else if(role < Combustion_Role_Misfire_1000){
+    update_misfires(cell, 0, role-Combustion_Role_Misfire_200, value);
+  }/*else if*/
+  else{
+    update_misfires(cell, 1, role-Combustion_Role_Misfire_1000, value);
+  }/*else*/
+
+  end_write(cell);
+
+  statistics->updates += 1;
+}/*combustion_monitor::update*/
+
+const combustion_statistics* combustion_monitor::get_statistics(void) const{
+  return statistics;
+}/*combustion_monitor::get_statistics*/
+
+}
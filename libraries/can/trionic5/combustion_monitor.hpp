@@ -0,0 +1,164 @@
+/*
+ * Description:
+ *  Live knock and misfire statistics of a Trionic 5, per cylinder and operating point.
+ *
+ *  The monitor consumes decoded symbol updates - a symbol, its engineering value
+ *  and when it was read - and keeps rolling statistics for every cell of an
+ *  rpm/load grid, the cell being the break point pair closest to the latest
+ *  Rpm and load seen:
+ *
+ *    knock_rate       share of Knock_offset1..4 samples with the ignition retarded
+ *    knock_retard     average Knock_offset1..4 retard in degrees
+ *    knock_activity   share of Knock_status samples which are non-zero
+ *    misfire_rate     misfires per 1000 revolutions, from Mis200_1..4
+ *    misfire_rate_1000  the same, from Mis1000_1..4
+ *
+ *  The averages are exponentially weighted over a window of samples. The misfire
+ *  counters are turned into rates by weighting the counted misfires with the
+ *  revolutions the engine turned in between, both decaying over a window of
+ *  revolutions, so idling and full load cells are comparable.
+ *
+ *  Every update touches one cell in O(1). The statistics live in a port of the
+ *  data distribution areas once published, so any other process may watch them
+ *  while they are written. Each cell carries a sequence number which is odd
+ *  while the cell is being written; read_combustion_cell() uses it to take a
+ *  consistent copy.
+ */
+
+#ifndef _combustion_monitor_hpp_
+#define _combustion_monitor_hpp_
+
+#include <stdint.h>
+
+#include "symbol_table.hpp"
+#include "calibration_maps.hpp"
+#include "data_distribution/distribution_areas.h"
+
+namespace trionic5net{
+
+#define COMBUSTION_MONITOR_CYLINDERS          4
+#define MAX_COMBUSTION_MONITOR_BINS           32
+#define COMBUSTION_MONITOR_DEFAULT_WINDOW     64
+#define COMBUSTION_MONITOR_MISFIRE_WINDOW     2000.0f
+
+typedef enum{
+  Combustion_Role_None          = 0,
+  Combustion_Role_Rpm           = 1,
+  Combustion_Role_Load          = 2,
+  Combustion_Role_Knock_Status  = 3,
+  Combustion_Role_Knock_Offset  = 4,    /* Followed by one role per cylinder. */
+  Combustion_Role_Misfire_200   = Combustion_Role_Knock_Offset+COMBUSTION_MONITOR_CYLINDERS,
+  Combustion_Role_Misfire_1000  = Combustion_Role_Misfire_200+COMBUSTION_MONITOR_CYLINDERS,
+  Combustion_Role_End           = Combustion_Role_Misfire_1000+COMBUSTION_MONITOR_CYLINDERS
+}Combustion_Role;
+
+struct combustion_cell{
+  volatile uint32_t sequence;
+  uint32_t          samples;
+  float             knock_activity;
+  float             knock_rate[COMBUSTION_MONITOR_CYLINDERS];
+  float             knock_retard[COMBUSTION_MONITOR_CYLINDERS];
+  float             misfire_rate[COMBUSTION_MONITOR_CYLINDERS];
+  float             misfire_rate_1000[COMBUSTION_MONITOR_CYLINDERS];
+
+  /* Decayed misfire counts and revolutions the rates are made of. */
+  float             misfires[2][COMBUSTION_MONITOR_CYLINDERS];
+  float             revolutions[2][COMBUSTION_MONITOR_CYLINDERS];
+};
+
+/*
+ * The layout published after the data_item_header of the port.
+ * Cells are stored row by row, one row per rpm break point.
+ */
+struct combustion_statistics{
+  uint32_t          rpm_bins;
+  uint32_t          load_bins;
+  float             rpm_axis[MAX_COMBUSTION_MONITOR_BINS];
+  float             load_axis[MAX_COMBUSTION_MONITOR_BINS];
+  uint64_t          updates;
+  combustion_cell   cells[MAX_COMBUSTION_MONITOR_BINS*MAX_COMBUSTION_MONITOR_BINS];
+};
+
+#define COMBUSTION_STATISTICS_PORT_SIZE (sizeof(data_item_header)+sizeof(combustion_statistics))
+
+/*
+ * Takes a consistent copy of a cell which may be written to by another process.
+ * Returns 0 if the cell kept changing.
+ */
+int read_combustion_cell(const combustion_statistics* statistics, const unsigned int rpm_bin, const unsigned int load_bin, combustion_cell* copy);
+
+class combustion_monitor{
+  private:
+    unsigned char           roles[MAX_SYMBOLS];
+    const symbol*           first_symbol;
+
+    combustion_statistics   private_statistics;
+    combustion_statistics*  statistics;
+    void*                   port_area;
+    int                     port_handle;
+    const char*             port_name;
+
+    float                   alpha;
+    float                   rpm;
+    float                   load;
+    unsigned int            rpm_bin;
+    unsigned int            load_bin;
+
+    /* Revolutions turned in total, and at the last update of every misfire counter. */
+    double                  total_revolutions;
+    unsigned long long      rpm_time;
+    double                  counter_revolutions[2][COMBUSTION_MONITOR_CYLINDERS];
+    float                   counter_values[2][COMBUSTION_MONITOR_CYLINDERS];
+    bool                    counter_seen[2][COMBUSTION_MONITOR_CYLINDERS];
+
+    void  update_misfires(combustion_cell* cell, const unsigned int counter, const unsigned int cylinder, const float value);
+    void  begin_write(combustion_cell* cell);
+    void  end_write(combustion_cell* cell);
+
+  public:
+    combustion_monitor();
+    ~combustion_monitor();
+
+    /*
+     * Resolves the symbols the monitor consumes in a symbol table. The load is taken
+     * from the named symbol, e.g. P_Manifold.
+     * Returns 0 if Rpm or the load symbol is missing.
+     */
+    int bind(const symbol_table* table, const char* load_name);
+
+    /*
+     * Sets the break points of the grid, clearing the statistics.
+     * Returns 0 if there are too many of them.
+     */
+    int set_bins(const float* rpm_axis, const unsigned int rpm_bins, const float* load_axis, const unsigned int load_bins);
+
+    /*
+     * Takes the grid from a calibration map with load on the x axis and rpm on the y axis,
+     * e.g. Ign_map_0, with the axes multiplied by the given scales.
+     * Returns 0 on failure.
+     */
+    int set_bins(const calibration_map* map, const float load_scale, const float rpm_scale);
+
+    /*
+     * Sets the number of samples the averages are taken over.
+     */
+    void set_window(const unsigned int samples);
+
+    /*
+     * Moves the statistics into a data distribution port, where they are updated from then on.
+     * Returns 0 on failure.
+     */
+    int publish(const char* port_name);
+    void unpublish(void);
+
+    /*
+     * Feeds a decoded symbol value. Symbols the monitor does not consume are ignored.
+     */
+    void update(const symbol* sym, const float value, const unsigned long long timestamp);
+
+    const combustion_statistics* get_statistics(void) const;
+};
+
+}
+
+#endif
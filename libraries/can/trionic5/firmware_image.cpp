@@ -0,0 +1,199 @@
+/*
+ * Description:
+ *   Implementation file for firmware image analysis.
+ */
+
+#include "firmware_image.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace trionic5net{
+
+#define FOOTER_END_OF_FIELDS 0xFF
+
+unsigned int parse_firmware_footer(const unsigned char* image, const size_t image_size, firmware_footer_field* fields, const unsigned int max_fields){
+  unsigned int number_of_fields = 0;
+
+  if( (image == 0) || (image_size <= FIRMWARE_CHECKSUM_SIZE) ){
+    return 0;
+  }/*if*/
+
+  /* Position just past the length byte of the next field, counting backwards. */
+  size_t position = image_size-FIRMWARE_CHECKSUM_SIZE;
+
+  while( (position >= 2) && (number_of_fields < max_fields) ){
+    unsigned char length  = image[position-1];
+    unsigned char id      = image[position-2];
+
+    if( (length == FOOTER_END_OF_FIELDS) || (length == 0) || (position < (size_t)length+2) ){
+      break;
+    }/*if*/
+
+    firmware_footer_field* field = &fields[number_of_fields];
+
+    field->id     = id;
+    field->length = length;
+
+    for(unsigned int i = 0; i < length; i++){
+      field->value[i] = image[position-3-i];
+    }/*for*/
+
+    field->value[length] = '\0';
+
+    number_of_fields  += 1;
+    position          -= length+2;
+  }/*while*/
+
+  return number_of_fields;
+}/*parse_firmware_footer*/
+
+uint32_t firmware_byte_sum(const unsigned char* data, const size_t size){
+  uint32_t  sum     = 0;
+  size_t    offset  = 0;
+
+#ifdef __SSE2__
+  /*
+   * Summing the absolute differences to zero adds up eight bytes into each half
+   * of the register. The 64 bit lanes cannot overflow for any image that fits in memory.
+   */
+  __m128i zero  = _mm_setzero_si128();
+  __m128i sums  = _mm_setzero_si128();
+
+  for(; offset+16 <= size; offset += 16){
+    sums = _mm_add_epi64(sums, _mm_sad_epu8(_mm_loadu_si128((const __m128i*)(data+offset)), zero));
+  }/*for*/
+
+  sum = (uint32_t)(_mm_cvtsi128_si32(sums)+_mm_cvtsi128_si32(_mm_unpackhi_epi64(sums, sums)));
+#endif
+
+  for(; offset < size; offset++){
+    sum += data[offset];
+  }/*for*/
+
+  return sum;
+}/*firmware_byte_sum*/
+
+/*
+ * Parses a footer field holding an address as ASCII hex.
+ * Returns 0 if there is no such field or it is not a hex number.
+ */
+static int read_address_field(const firmware_info* info, const unsigned char id, unsigned int* address){
+  const firmware_footer_field* field = find_footer_field(info, id);
+
+  if(field == 0){
+    return 0;
+  }/*if*/
+
+  char* end;
+  unsigned long value = strtoul(field->value, &end, 16);
+
+  if( (end == field->value) || (*end != '\0') ){
+    return 0;
+  }/*if*/
+
+  *address = value;
+
+  return 1;
+}/*read_address_field*/
+
+int analyse_firmware(const unsigned char* image, const size_t image_size, firmware_info* info){
+  memset(info, 0x0, sizeof(firmware_info));
+
+  info->number_of_fields = parse_firmware_footer(image, image_size, info->fields, MAX_FIRMWARE_FOOTER_FIELDS);
+
+  if( !read_address_field(info, Footer_Rom_Start, &info->rom_start) ||
+      !read_address_field(info, Footer_Rom_End, &info->rom_end) ||
+      !read_address_field(info, Footer_Checksum_End, &info->checksum_end) ){
+    return 0;
+  }/*if*/
+
+  if( (info->rom_end < info->rom_start) || (info->rom_end-info->rom_start+1 != image_size) ||
+      (info->checksum_end < info->rom_start) || (info->checksum_end > info->rom_end) ){
+    return 0;
+  }/*if*/
+
+  switch(image_size){
+    case TRIONIC52_FLASH_SIZE:
+      info->variant = Trionic52;
+      break;
+    case TRIONIC55_FLASH_SIZE:
+      info->variant = Trionic55;
+      break;
+    default:
+      info->variant = Trionic5_Unknown;
+      break;
+  }/*switch*/
+
+  const unsigned char* checksum = image+image_size-FIRMWARE_CHECKSUM_SIZE;
+
+  info->stored_checksum     = ((uint32_t)checksum[0] << 24) | (checksum[1] << 16) | (checksum[2] << 8) | checksum[3];
+  info->calculated_checksum = firmware_byte_sum(image, info->checksum_end-info->rom_start+1);
+  info->checksum_valid      = info->stored_checksum == info->calculated_checksum;
+
+  return 1;
+}/*analyse_firmware*/
+
+int analyse_firmware(const char* path, firmware_info* info){
+  int image_descriptor = open(path, O_RDONLY);
+  if(image_descriptor == -1){
+    perror(path);
+    return 0;
+  }/*if*/
+
+  struct stat image_status;
+  if( (fstat(image_descriptor, &image_status) == -1) || (image_status.st_size == 0) ){
+    perror("Could not determine firmware image size");
+    close(image_descriptor);
+    return 0;
+  }/*if*/
+
+  void* mapped_image = mmap(0, image_status.st_size, PROT_READ, MAP_PRIVATE, image_descriptor, 0);
+
+  close(image_descriptor);
+
+  if(mapped_image == MAP_FAILED){
+    perror("Could not map firmware image");
+    return 0;
+  }/*if*/
+
+  madvise(mapped_image, image_status.st_size, MADV_SEQUENTIAL);
+
+  int success = analyse_firmware((const unsigned char*)mapped_image, image_status.st_size, info);
+
+  munmap(mapped_image, image_status.st_size);
+
+  return success;
+}/*analyse_firmware*/
+
+const firmware_footer_field* find_footer_field(const firmware_info* info, const unsigned char id){
+  for(unsigned int i = 0; i < info->number_of_fields; i++){
+    if(info->fields[i].id == id){
+      return &info->fields[i];
+    }/*if*/
+  }/*for*/
+
+  return 0;
+}/*find_footer_field*/
+
+const char* get_variant_name(const Trionic5_Variant variant){
+  switch(variant){
+    case Trionic52:
+      return "Trionic 5.2";
+    case Trionic55:
+      return "Trionic 5.5";
+    default:
+      return "Unknown";
+  }/*switch*/
+}/*get_variant_name*/
+
+}
@@ -0,0 +1,108 @@
+/*
+ * Description:
+ *  Identification and checksum verification of Trionic 5 flash images.
+ *
+ *  The last bytes of an image hold a footer, read from the end backwards:
+ *  the final four bytes are the checksum, and before them is a chain of
+ *  fields, each one stored as
+ *
+ *    value (reversed) | id | length
+ *
+ *  with the length byte last. The chain ends at a length of 0xFF, i.e. at
+ *  erased flash. Besides part number, software version and engine type, the
+ *  footer holds the ROM start and end address and the address of the last
+ *  byte covered by the checksum, all as ASCII hex.
+ *
+ *  The checksum is the 32 bit sum of every byte from the start of the ROM up
+ *  to and including that last address, stored big-endian. Summing runs sixteen
+ *  bytes at a time with SSE2 when it is available, so the time to verify an
+ *  image is dominated by reading it.
+ *
+ *  The variant follows from the size of the ROM: Trionic 5.2 has 128 KiB of
+ *  flash, Trionic 5.5 has 256 KiB.
+ */
+
+#ifndef _firmware_image_hpp_
+#define _firmware_image_hpp_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace trionic5net{
+
+#define MAX_FIRMWARE_FOOTER_FIELDS  32
+#define FIRMWARE_CHECKSUM_SIZE      4
+#define TRIONIC52_FLASH_SIZE        0x20000
+#define TRIONIC55_FLASH_SIZE        0x40000
+
+typedef enum{
+  Trionic5_Unknown  = 0,
+  Trionic52         = 1,
+  Trionic55         = 2
+}Trionic5_Variant;
+
+typedef enum{
+  Footer_Partnumber       = 0x01,
+  Footer_Software_Id      = 0x02,
+  Footer_Software_Version = 0x03,
+  Footer_Engine_Type      = 0x04,
+  Footer_Immobilizer_Code = 0x05,
+  Footer_Rom_End          = 0xFC,
+  Footer_Rom_Start        = 0xFD,
+  Footer_Checksum_End     = 0xFE
+}Firmware_Footer_Field;
+
+struct firmware_footer_field{
+  unsigned char id;
+  unsigned char length;
+  char          value[256];     /* In reading order and null-terminated. */
+};
+
+struct firmware_info{
+  Trionic5_Variant      variant;
+  unsigned int          rom_start;
+  unsigned int          rom_end;
+  unsigned int          checksum_end;
+  uint32_t              stored_checksum;
+  uint32_t              calculated_checksum;
+  bool                  checksum_valid;
+
+  unsigned int          number_of_fields;
+  firmware_footer_field fields[MAX_FIRMWARE_FOOTER_FIELDS];
+};
+
+/*
+ * Parses the footer fields of an image, storing at most max_fields of them.
+ * Returns the number of fields stored.
+ */
+unsigned int parse_firmware_footer(const unsigned char* image, const size_t image_size, firmware_footer_field* fields, const unsigned int max_fields);
+
+/*
+ * The 32 bit sum of all bytes in data, wrapping around on overflow.
+ */
+uint32_t firmware_byte_sum(const unsigned char* data, const size_t size);
+
+/*
+ * Identifies an image and verifies its checksum.
+ * Returns 0 if the image is not recognised as Trionic 5 firmware, that is if its footer or
+ * the addresses in it are missing or do not fit the image. A bad checksum is not a failure,
+ * see checksum_valid.
+ */
+int analyse_firmware(const unsigned char* image, const size_t image_size, firmware_info* info);
+
+/*
+ * Maps the image found at path and analyses it.
+ * Returns 0 on failure.
+ */
+int analyse_firmware(const char* path, firmware_info* info);
+
+/*
+ * Returns 0 if the image has no such field.
+ */
+const firmware_footer_field* find_footer_field(const firmware_info* info, const unsigned char id);
+
+const char* get_variant_name(const Trionic5_Variant variant);
+
+}
+
+#endif
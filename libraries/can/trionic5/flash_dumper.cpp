@@ -0,0 +1,546 @@
+/*
+ * Description:
+ *   Implementation file for the bootloader flash dump engine.
+ */
+
+#include "flash_dumper.hpp"
+#include "timing/clock.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+namespace trionic5net{
+
+flash_dumper::flash_dumper(can::bus* given_canbus){
+  canbus              = given_canbus;
+  state               = Flash_Dump_Idle;
+  bootloader_size     = 0;
+  load_address        = 0;
+  upload_offset       = 0;
+  output_descriptor   = -1;
+  buffered_bytes      = 0;
+  flash_start         = 0;
+  flash_end           = 0;
+  resume_address      = 0;
+  completed_address   = 0;
+  next_address        = 0;
+  in_flight_reads     = 0;
+  window              = FLASH_DUMPER_DEFAULT_WINDOW;
+  block_end           = 0;
+  block_bytes         = 0;
+  head_time           = 0;
+  settling            = false;
+  retries             = 0;
+  max_retries         = FLASH_DUMPER_DEFAULT_RETRIES;
+  start_time          = 0;
+  end_time            = 0;
+  timeouts            = 0;
+  retransmitted_reads = 0;
+
+  memset(bootloader, 0x0, sizeof(bootloader));
+  memset(block_buffer, 0x0, sizeof(block_buffer));
+  memset(transmission_times, 0x0, sizeof(transmission_times));
+  init_rtt_estimator(&rtt, FLASH_DUMPER_INITIAL_TIMEOUT, FLASH_DUMPER_MIN_TIMEOUT, FLASH_DUMPER_MAX_TIMEOUT);
+}/*flash_dumper::flash_dumper*/
+
+flash_dumper::~flash_dumper(){
+  stop();
+}/*flash_dumper::~flash_dumper*/
+
+int flash_dumper::load_bootloader(const char* path, const unsigned int given_load_address){
+  FILE* bootloader_file = fopen(path, "rb");
+  if(bootloader_file == NULL){
+    perror(path);
+    return 0;
+  }/*if*/
+
+  size_t size = fread(bootloader, 1, sizeof(bootloader), bootloader_file);
+  int    more = fgetc(bootloader_file);
+
+  fclose(bootloader_file);
+
+  if( (size == 0) || (more != EOF) ){
+    printf("The bootloader %s must hold between 1 and %u bytes.\n", path, MAX_BOOTLOADER_SIZE);
+    bootloader_size = 0;
+    return 0;
+  }/*if*/
+
+  if(given_load_address+size > SRAM_ADDRESS_SPACE_SIZE){
+    printf("The bootloader %s does not fit in SRAM at 0x%04x.\n", path, given_load_address);
+    bootloader_size = 0;
+    return 0;
+  }/*if*/
+
+  bootloader_size = size;
+  load_address    = given_load_address;
+
+  return 1;
+}/*flash_dumper::load_bootloader*/
+
+void flash_dumper::set_window(const unsigned int reads){
+  if(reads < 1){
+    window = 1;
+  }/*if*/
+  else if(reads > FLASH_DUMPER_MAX_WINDOW){
+    window = FLASH_DUMPER_MAX_WINDOW;
+  }/*else if*/
+  else{
+    window = reads;
+  }/*else*/
+}/*flash_dumper::set_window*/
+
+void flash_dumper::set_max_retries(const unsigned int given_retries){
+  max_retries = given_retries;
+}/*flash_dumper::set_max_retries*/
+
+int flash_dumper::send_command(const unsigned char opcode, const unsigned int address, const unsigned int length){
+  can_frame command;
+
+  memset(&command, 0x0, sizeof(can_frame));
+  command.can_id  = TRIONIC5_REQUEST_FRAME_ID;
+  command.can_dlc = 8;
+  command.data[0] = opcode;
+  command.data[1] = (address >> 24) & 0xFF;
+  command.data[2] = (address >> 16) & 0xFF;
+  command.data[3] = (address >> 8) & 0xFF;
+  command.data[4] = address & 0xFF;
+  command.data[5] = length & 0xFF;
+
+  return canbus->send(&command) == (int)sizeof(can_frame);
+}/*flash_dumper::send_command*/
+
+int flash_dumper::send_upload_block(void){
+  unsigned int block_size = bootloader_size-upload_offset;
+
+  if(block_size > BOOTLOADER_BLOCK_SIZE){
+    block_size = BOOTLOADER_BLOCK_SIZE;
+  }/*if*/
+
+  head_time = monotonic_microseconds();
+
+  if(!send_command(BOOTLOADER_UPLOAD_OPCODE, load_address+upload_offset, block_size)){
+    return 0;
+  }/*if*/
+
+  for(unsigned int offset = 0; offset < block_size; offset += BOOTLOADER_FRAME_PAYLOAD_SIZE){
+    can_frame data;
+
+    memset(&data, 0x0, sizeof(can_frame));
+    data.can_id   = TRIONIC5_REQUEST_FRAME_ID;
+    data.can_dlc  = 8;
+    data.data[0]  = offset;
+
+    for(unsigned int i = 0; (i < BOOTLOADER_FRAME_PAYLOAD_SIZE) && (offset+i < block_size); i++){
+      data.data[1+i] = bootloader[upload_offset+offset+i];
+    }/*for*/
+
+    /* Whatever is not sent makes the block time out and go again as a whole. */
+    if(canbus->send(&data) != (int)sizeof(can_frame)){
+      return 0;
+    }/*if*/
+  }/*for*/
+
+  return 1;
+}/*flash_dumper::send_upload_block*/
+
+int flash_dumper::start(const char* path, const unsigned int start_address, const unsigned int end_address, const bool resume){
+  if( (state == Flash_Dump_Uploading) || (state == Flash_Dump_Starting) || (state == Flash_Dump_Reading) || (start_address >= end_address) ){
+    return 0;
+  }/*if*/
+
+  /* Appending keeps the file in address order even across attempts. */
+  output_descriptor = open(path, O_WRONLY | O_CREAT | O_APPEND | (resume ? 0 : O_TRUNC), 0644);
+  if(output_descriptor == -1){
+    perror(path);
+    return 0;
+  }/*if*/
+
+  unsigned int existing_bytes = 0;
+
+  if(resume){
+    struct stat output_status;
+
+    if(fstat(output_descriptor, &output_status) == -1){
+      perror(path);
+      close(output_descriptor);
+      output_descriptor = -1;
+      return 0;
+    }/*if*/
+
+    if((unsigned long long)output_status.st_size > end_address-start_address){
+      printf("%s holds more than the requested range and can not be resumed.\n", path);
+      close(output_descriptor);
+      output_descriptor = -1;
+      return 0;
+    }/*if*/
+
+    existing_bytes = output_status.st_size;
+  }/*if*/
+
+  flash_start         = start_address;
+  flash_end           = end_address;
+  resume_address      = start_address+existing_bytes;
+  completed_address   = resume_address;
+  next_address        = resume_address;
+  in_flight_reads     = 0;
+  block_end           = resume_address;
+  block_bytes         = 0;
+  buffered_bytes      = 0;
+  settling            = false;
+  retries             = 0;
+  timeouts            = 0;
+  retransmitted_reads = 0;
+  start_time          = monotonic_microseconds();
+  end_time            = 0;
+
+  init_rtt_estimator(&rtt, FLASH_DUMPER_INITIAL_TIMEOUT, FLASH_DUMPER_MIN_TIMEOUT, FLASH_DUMPER_MAX_TIMEOUT);
+
+  if(completed_address == flash_end){
+    finish(Flash_Dump_Complete);
+    return 1;
+  }/*if*/
+
+  if(bootloader_size > 0){
+    state         = Flash_Dump_Uploading;
+    upload_offset = 0;
+    send_upload_block();
+  }/*if*/
+  else{
+    state = Flash_Dump_Reading;
+    transmit_reads();
+  }/*else*/
+
+  return 1;
+}/*flash_dumper::start*/
+
+void flash_dumper::transmit_reads(void){
+  if( (next_address == block_end) && (in_flight_reads == 0) ){
+    block_end = completed_address+window*BOOTLOADER_READ_SIZE;
+
+    if(block_end > flash_end){
+      block_end = flash_end;
+    }/*if*/
+  }/*if*/
+
+  while(next_address < block_end){
+    if(!send_command(BOOTLOADER_READ_OPCODE, next_address, 0)){
+      /* The socket buffer is full - try again on the next poll. */
+      break;
+    }/*if*/
+
+    unsigned long long now = monotonic_microseconds();
+
+    transmission_times[(next_address-completed_address)/BOOTLOADER_READ_SIZE] = now;
+
+    if(in_flight_reads == 0){
+      head_time = now;
+    }/*if*/
+
+    if(retries > 0){
+      retransmitted_reads += 1;
+    }/*if*/
+
+    in_flight_reads += 1;
+    next_address    += BOOTLOADER_READ_SIZE;
+
+    if(next_address > block_end){
+      next_address = block_end;
+    }/*if*/
+  }/*while*/
+}/*flash_dumper::transmit_reads*/
+
+void flash_dumper::handle_frame(const unsigned int can_id, const unsigned size, const unsigned char* data){
+  if( (can_id != TRIONIC5_RESPONSE_FRAME_ID) || (size < 2) ){
+    return;
+  }/*if*/
+
+  if(settling){
+    /* A late answer to a request given up on - wait for the bus to go quiet again. */
+    head_time = monotonic_microseconds();
+    return;
+  }/*if*/
+
+  switch(state){
+    case Flash_Dump_Uploading:
+    case Flash_Dump_Starting:
+      handle_acknowledge(data[0], data[1]);
+      break;
+    case Flash_Dump_Reading:
+      if(data[0] == BOOTLOADER_READ_OPCODE){
+        handle_read(size, data);
+      }/*if*/
+      break;
+    default:
+      break;
+  }/*switch*/
+}/*flash_dumper::handle_frame*/
+
+void flash_dumper::handle_acknowledge(const unsigned char opcode, const unsigned char status){
+  unsigned char expected_opcode = (state == Flash_Dump_Uploading) ? BOOTLOADER_UPLOAD_OPCODE : BOOTLOADER_START_OPCODE;
+
+  if(opcode != expected_opcode){
+    return;
+  }/*if*/
+
+  if(status != BOOTLOADER_ACKNOWLEDGE){
+    printf("The ECU refused the bootloader with status 0x%02x.\n", status);
+    finish(Flash_Dump_Failed);
+    return;
+  }/*if*/
+
+  unsigned long long now = monotonic_microseconds();
+
+  /* Answers to requests which were sent more than once could be to either transmission. */
+  if(retries == 0){
+    rtt_estimator_sample(&rtt, now-head_time);
+  }/*if*/
+
+  retries = 0;
+
+  if(state == Flash_Dump_Starting){
+    state       = Flash_Dump_Reading;
+    start_time  = now;
+    transmit_reads();
+    return;
+  }/*if*/
+
+  upload_offset += BOOTLOADER_BLOCK_SIZE;
+
+  if(upload_offset < bootloader_size){
+    send_upload_block();
+    return;
+  }/*if*/
+
+  state     = Flash_Dump_Starting;
+  head_time = now;
+  send_command(BOOTLOADER_START_OPCODE, load_address, 0);
+}/*flash_dumper::handle_acknowledge*/
+
+void flash_dumper::handle_read(const unsigned size, const unsigned char* data){
+  if(in_flight_reads == 0){
+    return;
+  }/*if*/
+
+  unsigned int read_address = completed_address+block_bytes;
+  unsigned int bytes        = block_end-read_address;
+
+  if(bytes > BOOTLOADER_READ_SIZE){
+    bytes = BOOTLOADER_READ_SIZE;
+  }/*if*/
+
+  if( (data[1] != BOOTLOADER_ACKNOWLEDGE) || (size < 2+bytes) ){
+    /* The answer carries no address, there is no telling which read a broken one belongs to. */
+    retry();
+    return;
+  }/*if*/
+
+  unsigned long long now = monotonic_microseconds();
+
+  if(retries == 0){
+    rtt_estimator_sample(&rtt, now-transmission_times[block_bytes/BOOTLOADER_READ_SIZE]);
+  }/*if*/
+
+  memcpy(block_buffer+block_bytes, data+2, bytes);
+
+  block_bytes     += bytes;
+  in_flight_reads -= 1;
+  head_time       = now;
+
+  if(read_address+bytes < block_end){
+    return;
+  }/*if*/
+
+  /* Every read of the block has been answered, so no answer went missing in between. */
+  if( (buffered_bytes+block_bytes > FLASH_DUMPER_WRITE_BUFFER_SIZE) && !flush() ){
+    finish(Flash_Dump_Failed);
+    return;
+  }/*if*/
+
+  memcpy(write_buffer+buffered_bytes, block_buffer, block_bytes);
+
+  buffered_bytes    += block_bytes;
+  completed_address = block_end;
+  block_bytes       = 0;
+  retries           = 0;
+
+  if(completed_address == flash_end){
+    finish(Flash_Dump_Complete);
+  }/*if*/
+}/*flash_dumper::handle_read*/
+
+int flash_dumper::poll(void){
+  unsigned int  can_id;
+  unsigned char data[8];
+  int           size;
+  int           handled_frames = 0;
+
+  while( (size = canbus->receive(sizeof(data), (char*)data, &can_id)) >= 0 ){
+    handle_frame(can_id, size, data);
+    handled_frames += 1;
+  }/*while*/
+
+  check_timeout(monotonic_microseconds());
+
+  if( (state == Flash_Dump_Reading) && !settling ){
+    transmit_reads();
+  }/*if*/
+
+  return handled_frames;
+}/*flash_dumper::poll*/
+
+void flash_dumper::check_timeout(const unsigned long long now){
+  if(settling){
+    if(rtt_estimator_expired(&rtt, head_time, now)){
+      settling = false;
+      resend();
+    }/*if*/
+
+    return;
+  }/*if*/
+
+  bool waiting = (state == Flash_Dump_Uploading) || (state == Flash_Dump_Starting) || ( (state == Flash_Dump_Reading) && (in_flight_reads > 0) );
+
+  if( !waiting || !rtt_estimator_expired(&rtt, head_time, now) ){
+    return;
+  }/*if*/
+
+  timeouts += 1;
+  rtt_estimator_backoff(&rtt);
+
+  retry();
+}/*flash_dumper::check_timeout*/
+
+void flash_dumper::retry(void){
+  retries += 1;
+
+  if(retries > max_retries){
+    printf("No answer from the ECU at 0x%05x after %u attempts.\n", (state == Flash_Dump_Reading) ? completed_address : load_address+upload_offset, retries);
+    finish(Flash_Dump_Failed);
+    return;
+  }/*if*/
+
+  /*
+   * Answers carry no address, so an answer to a request given up on would be taken
+   * for the answer to the next one. Nothing is sent again until the bus has been quiet
+   * for a whole timeout.
+   */
+  settling  = true;
+  head_time = monotonic_microseconds();
+
+  if(state == Flash_Dump_Reading){
+    /* Whatever the block got so far may be shifted by the lost answer, read it all again. */
+    next_address    = completed_address;
+    block_end       = completed_address;
+    block_bytes     = 0;
+    in_flight_reads = 0;
+  }/*if*/
+}/*flash_dumper::retry*/
+
+void flash_dumper::resend(void){
+  switch(state){
+    case Flash_Dump_Uploading:
+      send_upload_block();
+      break;
+    case Flash_Dump_Starting:
+      head_time = monotonic_microseconds();
+      send_command(BOOTLOADER_START_OPCODE, load_address, 0);
+      break;
+    case Flash_Dump_Reading:
+      transmit_reads();
+      break;
+    default:
+      break;
+  }/*switch*/
+}/*flash_dumper::resend*/
+
+int flash_dumper::flush(void){
+  unsigned int written_bytes = 0;
+
+  while(written_bytes < buffered_bytes){
+    ssize_t result = write(output_descriptor, write_buffer+written_bytes, buffered_bytes-written_bytes);
+
+    if(result <= 0){
+      perror("Failed to write flash dump");
+      buffered_bytes = 0;
+      return 0;
+    }/*if*/
+
+    written_bytes += result;
+  }/*while*/
+
+  buffered_bytes = 0;
+
+  return 1;
+}/*flash_dumper::flush*/
+
+void flash_dumper::finish(const Flash_Dump_State final_state){
+  state     = final_state;
+  end_time  = monotonic_microseconds();
+
+  if(output_descriptor != -1){
+    if(!flush()){
+      state = Flash_Dump_Failed;
+    }/*if*/
+
+    /* The length of the file is what a later attempt resumes from, make sure it sticks. */
+    fsync(output_descriptor);
+    close(output_descriptor);
+    output_descriptor = -1;
+  }/*if*/
+
+  in_flight_reads = 0;
+}/*flash_dumper::finish*/
+
+void flash_dumper::stop(void){
+  if( (state == Flash_Dump_Uploading) || (state == Flash_Dump_Starting) || (state == Flash_Dump_Reading) ){
+    finish(Flash_Dump_Idle);
+  }/*if*/
+}/*flash_dumper::stop*/
+
+int flash_dumper::exit_bootloader(void){
+  return send_command(BOOTLOADER_EXIT_OPCODE, 0, 0);
+}/*flash_dumper::exit_bootloader*/
+
+Flash_Dump_State flash_dumper::get_state(void) const{
+  return state;
+}/*flash_dumper::get_state*/
+
+bool flash_dumper::is_done(void) const{
+  return (state == Flash_Dump_Complete) || (state == Flash_Dump_Failed);
+}/*flash_dumper::is_done*/
+
+unsigned int flash_dumper::get_completed_bytes(void) const{
+  return completed_address-flash_start;
+}/*flash_dumper::get_completed_bytes*/
+
+unsigned int flash_dumper::get_total_bytes(void) const{
+  return flash_end-flash_start;
+}/*flash_dumper::get_total_bytes*/
+
+double flash_dumper::get_throughput(void) const{
+  unsigned long long now          = (end_time != 0) ? end_time : monotonic_microseconds();
+  unsigned long long elapsed_time = now-start_time;
+
+  if( (elapsed_time == 0) || (completed_address == resume_address) ){
+    return 0.0;
+  }/*if*/
+
+  return (completed_address-resume_address)*1000000.0/elapsed_time;
+}/*flash_dumper::get_throughput*/
+
+unsigned long long flash_dumper::get_timeout(void) const{
+  return rtt_estimator_timeout(&rtt);
+}/*flash_dumper::get_timeout*/
+
+unsigned long long flash_dumper::get_timeouts(void) const{
+  return timeouts;
+}/*flash_dumper::get_timeouts*/
+
+unsigned long long flash_dumper::get_retransmitted_reads(void) const{
+  return retransmitted_reads;
+}/*flash_dumper::get_retransmitted_reads*/
+
+}
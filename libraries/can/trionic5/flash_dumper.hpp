@@ -0,0 +1,204 @@
+/*
+ * Description:
+ *  Reads the complete flash of a Trionic 5 over CAN through its bootloader.
+ *
+ *  In normal operation Trionic only answers reads of its 16 bit SRAM. To read
+ *  the flash, a small bootloader is uploaded into SRAM and started, after which
+ *  every request is answered by the bootloader instead. The bootloader itself is
+ *  not part of this library; its binary is loaded from disk together with the
+ *  address it was linked for.
+ *
+ *  All frames go to TRIONIC5_REQUEST_FRAME_ID and are answered on
+ *  TRIONIC5_RESPONSE_FRAME_ID, each answer echoing the opcode followed by a
+ *  status byte, 0x00 meaning success:
+ *
+ *    upload   A5 a3 a2 a1 a0 nn      then nn bytes of code, seven per frame,
+ *                                    each frame led by the offset in the block
+ *                                    answered once per block: A5 00
+ *    start    C1 a3 a2 a1 a0         answered C1 00
+ *    read     C7 a3 a2 a1 a0         answered C7 00 d0 d1 d2 d3 d4 d5
+ *    exit     C2                     the ECU resets into its normal program
+ *
+ *  Reads are pipelined in blocks: up to a window of them are sent at once,
+ *  and the bootloader answers in order. The answers carry no address, so a
+ *  single lost answer would shift every byte after it without anyone noticing.
+ *  A block is therefore only taken as read once every one of its reads has
+ *  been answered. If a block sees no answer within the estimated timeout (see
+ *  timing/rtt_estimator.h), it is read again as a whole, once the bus has been
+ *  quiet long enough for any late answers to have passed.
+ *
+ *  Completed bytes are appended to the output file in address order, so the
+ *  length of the file is always the number of bytes known good. A dump which
+ *  was interrupted is resumed by opening the same file again with resume set,
+ *  and reading on from where the file ends. If the bootloader is still running
+ *  from the previous attempt, no bootloader needs to be loaded at all; the
+ *  dump then starts reading straight away.
+ *
+ *  The dumper never blocks; call poll() from the main loop.
+ */
+
+#ifndef _flash_dumper_hpp_
+#define _flash_dumper_hpp_
+
+#include "can/bus.hpp"
+#include "sram_response.hpp"
+#include "timing/rtt_estimator.h"
+
+namespace trionic5net{
+
+#define BOOTLOADER_UPLOAD_OPCODE        0xA5
+#define BOOTLOADER_START_OPCODE         0xC1
+#define BOOTLOADER_EXIT_OPCODE          0xC2
+#define BOOTLOADER_READ_OPCODE          0xC7
+#define BOOTLOADER_ACKNOWLEDGE          0x00
+
+#define BOOTLOADER_BLOCK_SIZE           0x70
+#define BOOTLOADER_FRAME_PAYLOAD_SIZE   7
+#define BOOTLOADER_READ_SIZE            6
+#define MAX_BOOTLOADER_SIZE             0x2000
+
+#define FLASH_DUMPER_MAX_WINDOW         32
+#define FLASH_DUMPER_DEFAULT_WINDOW     8
+#define FLASH_DUMPER_WRITE_BUFFER_SIZE  0x1000
+
+#define FLASH_DUMPER_DEFAULT_RETRIES    5
+#define FLASH_DUMPER_INITIAL_TIMEOUT    100000ULL
+#define FLASH_DUMPER_MIN_TIMEOUT        2000ULL
+#define FLASH_DUMPER_MAX_TIMEOUT        2000000ULL
+
+typedef enum{
+  Flash_Dump_Idle       = 0,
+  Flash_Dump_Uploading  = 1,
+  Flash_Dump_Starting   = 2,
+  Flash_Dump_Reading    = 3,
+  Flash_Dump_Complete   = 4,
+  Flash_Dump_Failed     = 5
+}Flash_Dump_State;
+
+class flash_dumper{
+  private:
+    can::bus*           canbus;
+    Flash_Dump_State    state;
+
+    unsigned char       bootloader[MAX_BOOTLOADER_SIZE];
+    unsigned int        bootloader_size;
+    unsigned int        load_address;
+    unsigned int        upload_offset;
+
+    int                 output_descriptor;
+    unsigned char       write_buffer[FLASH_DUMPER_WRITE_BUFFER_SIZE];
+    unsigned int        buffered_bytes;
+
+    unsigned int        flash_start;
+    unsigned int        flash_end;
+    unsigned int        resume_address;
+    unsigned int        completed_address;
+    unsigned int        next_address;
+    unsigned int        in_flight_reads;
+    unsigned int        window;
+
+    /*
+     * The block being read, from completed_address up to block_end, the bytes
+     * answered so far and when each of its reads was sent.
+     */
+    unsigned int        block_end;
+    unsigned int        block_bytes;
+    unsigned char       block_buffer[FLASH_DUMPER_MAX_WINDOW*BOOTLOADER_READ_SIZE];
+    unsigned long long  transmission_times[FLASH_DUMPER_MAX_WINDOW];
+
+    /*
+     * The time the oldest outstanding request was sent or last made progress,
+     * or while settling, the time the last frame arrived. Also how often in a row
+     * requests were lost without any progress in between.
+     */
+    rtt_estimator       rtt;
+    unsigned long long  head_time;
+    bool                settling;
+    unsigned int        retries;
+    unsigned int        max_retries;
+
+    unsigned long long  start_time;
+    unsigned long long  end_time;
+    unsigned long long  timeouts;
+    unsigned long long  retransmitted_reads;
+
+    int   send_command(const unsigned char opcode, const unsigned int address, const unsigned int length);
+    int   send_upload_block(void);
+    void  transmit_reads(void);
+    void  handle_frame(const unsigned int can_id, const unsigned size, const unsigned char* data);
+    void  handle_acknowledge(const unsigned char opcode, const unsigned char status);
+    void  handle_read(const unsigned size, const unsigned char* data);
+    void  check_timeout(const unsigned long long now);
+    void  retry(void);
+    void  resend(void);
+    int   flush(void);
+    void  finish(const Flash_Dump_State final_state);
+
+  public:
+    flash_dumper(can::bus* canbus);
+    ~flash_dumper();
+
+    /*
+     * Loads a raw bootloader binary, linked to run from the given SRAM address.
+     * Returns 0 on failure.
+     */
+    int load_bootloader(const char* path, const unsigned int load_address);
+
+    /*
+     * Sets the number of reads in a block, at most FLASH_DUMPER_MAX_WINDOW.
+     */
+    void set_window(const unsigned int reads);
+
+    /*
+     * Sets how often in a row a lost request is sent again before the dump fails.
+     */
+    void set_max_retries(const unsigned int retries);
+
+    /*
+     * Starts dumping the flash range [start_address, end_address) to the file at path.
+     * Without resume, the file is truncated. With resume, reading continues after the bytes
+     * already in the file.
+     * If a bootloader has been loaded, it is uploaded and started first; otherwise it is
+     * assumed to be running already.
+     * Returns 0 on failure.
+     */
+    int start(const char* path, const unsigned int start_address, const unsigned int end_address, const bool resume);
+
+    /*
+     * Drains the bus of received frames, handles timeouts and sends requests while the window allows.
+     * Returns the number of frames handled.
+     */
+    int poll(void);
+
+    /*
+     * Stops the dump, keeping the bytes read so far in the file.
+     */
+    void stop(void);
+
+    /*
+     * Tells the bootloader to reset the ECU back into its normal program.
+     * Returns 0 on failure.
+     */
+    int exit_bootloader(void);
+
+    Flash_Dump_State    get_state(void) const;
+    bool                is_done(void) const;
+
+    /*
+     * The bytes in the file, including those kept from an earlier attempt.
+     */
+    unsigned int        get_completed_bytes(void) const;
+    unsigned int        get_total_bytes(void) const;
+
+    /*
+     * Bytes read per second by this attempt, since the bootloader started answering reads.
+     */
+    double              get_throughput(void) const;
+    unsigned long long  get_timeout(void) const;
+    unsigned long long  get_timeouts(void) const;
+    unsigned long long  get_retransmitted_reads(void) const;
+};
+
+}
+
+#endif
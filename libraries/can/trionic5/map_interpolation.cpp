@@ -0,0 +1,288 @@
+/*
+ * Description:
+ *   Implementation file for calibration map interpolation.
+ */
+
+#include "map_interpolation.hpp"
+
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace trionic5net{
+
+#define CELL_STRIDE (MAX_INTERPOLATION_AXIS_POINTS+1)
+
+static int prepare_axis(float* axis, float* reciprocal, const calibration_axis* source, const float scale){
+  unsigned int count = source->count;
+
+  for(unsigned int i = 0; i < count; i++){
+    axis[i] = (source->data != 0) ? get_axis_value(source, i)*scale : 0.0f;
+  }/*for*/
+
+  axis[count] = axis[count-1];
+
+  for(unsigned int i = 0; i+1 < count; i++){
+    float width = axis[i+1]-axis[i];
+
+    if(!(width > 0.0f)){
+      return 0;
+    }/*if*/
+
+    reciprocal[i] = 1.0f/width;
+  }/*for*/
+
+  /* The last break point has no segment after it; the fraction within it is always 0. */
+  reciprocal[count-1] = 0.0f;
+  reciprocal[count]   = 0.0f;
+
+  return 1;
+}/*prepare_axis*/
+
+int prepare_interpolation(interpolation_map* interpolation, const calibration_map* map, const float x_scale, const float y_scale){
+  if( (interpolation == 0) || (map == 0) || (map->x_axis.count == 0) || (map->y_axis.count == 0) ||
+      (map->x_axis.count > MAX_INTERPOLATION_AXIS_POINTS) || (map->y_axis.count > MAX_INTERPOLATION_AXIS_POINTS) ){
+    return 0;
+  }/*if*/
+
+  memset(interpolation, 0x0, sizeof(interpolation_map));
+  interpolation->x_count = map->x_axis.count;
+  interpolation->y_count = map->y_axis.count;
+
+  if( !prepare_axis(interpolation->x_axis, interpolation->x_reciprocal, &map->x_axis, x_scale) ||
+      !prepare_axis(interpolation->y_axis, interpolation->y_reciprocal, &map->y_axis, y_scale) ){
+    return 0;
+  }/*if*/
+
+  for(unsigned int row = 0; row <= interpolation->y_count; row++){
+    unsigned int source_row = (row < interpolation->y_count) ? row : row-1;
+
+    for(unsigned int column = 0; column <= interpolation->x_count; column++){
+      unsigned int source_column = (column < interpolation->x_count) ? column : column-1;
+
+      interpolation->cells[row*CELL_STRIDE+column] = get_cell_value(map, source_column, source_row);
+    }/*for*/
+  }/*for*/
+
+  return 1;
+}/*prepare_interpolation*/
+
+/*
+ * The segment a value falls in is the number of inner break points at or below it.
+ */
+static inline unsigned int find_segment(const float* axis, const unsigned int count, const float value){
+  unsigned int segment = 0;
+
+  for(unsigned int i = 1; i+1 < count; i++){
+    segment += (value >= axis[i]);
+  }/*for*/
+
+  return segment;
+}/*find_segment*/
+
+static inline float clamp_fraction(const float fraction){
+  return fraction < 0.0f ? 0.0f : (fraction > 1.0f ? 1.0f : fraction);
+}/*clamp_fraction*/
+
+static inline void store_sample(const interpolation_map* interpolation, const unsigned int index, const unsigned int column, const unsigned int row, const float x_fraction, const float y_fraction, unsigned short* cells, unsigned long long* histogram){
+  unsigned int cell = (row+(y_fraction >= 0.5f))*interpolation->x_count+column+(x_fraction >= 0.5f);
+
+  if(cells != 0){
+    cells[index] = cell;
+  }/*if*/
+
+  if(histogram != 0){
+    histogram[cell] += 1;
+  }/*if*/
+}/*store_sample*/
+
+static inline void interpolate_sample(const interpolation_map* interpolation, const float x, const float y, const unsigned int index, float* values, unsigned short* cells, unsigned long long* histogram){
+  unsigned int  column      = find_segment(interpolation->x_axis, interpolation->x_count, x);
+  unsigned int  row         = find_segment(interpolation->y_axis, interpolation->y_count, y);
+  float         x_fraction  = clamp_fraction((x-interpolation->x_axis[column])*interpolation->x_reciprocal[column]);
+  float         y_fraction  = clamp_fraction((y-interpolation->y_axis[row])*interpolation->y_reciprocal[row]);
+
+  if(values != 0){
+    const float* cell = interpolation->cells+row*CELL_STRIDE+column;
+
+    float top     = cell[0]+(cell[1]-cell[0])*x_fraction;
+    float bottom  = cell[CELL_STRIDE]+(cell[CELL_STRIDE+1]-cell[CELL_STRIDE])*x_fraction;
+
+    values[index] = top+(bottom-top)*y_fraction;
+  }/*if*/
+
+  store_sample(interpolation, index, column, row, x_fraction, y_fraction, cells, histogram);
+}/*interpolate_sample*/
+
+void interpolate_map(const interpolation_map* interpolation, const float* x, const float* y, const unsigned int count, float* values, unsigned short* cells, unsigned long long* histogram){
+  unsigned int i = 0;
+
+#ifdef __SSE2__
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 one  = _mm_set1_ps(1.0f);
+
+  for(; i+4 <= count; i += 4){
+    __m128  x_values  = _mm_loadu_ps(x+i);
+    __m128  y_values  = _mm_loadu_ps(y+i);
+    __m128i columns   = _mm_setzero_si128();
+    __m128i rows      = _mm_setzero_si128();
+
+    /* A passed break point compares to all ones, which is -1. */
+    for(unsigned int k = 1; k+1 < interpolation->x_count; k++){
+      columns = _mm_sub_epi32(columns, _mm_castps_si128(_mm_cmpge_ps(x_values, _mm_set1_ps(interpolation->x_axis[k]))));
+    }/*for*/
+
+    for(unsigned int k = 1; k+1 < interpolation->y_count; k++){
+      rows = _mm_sub_epi32(rows, _mm_castps_si128(_mm_cmpge_ps(y_values, _mm_set1_ps(interpolation->y_axis[k]))));
+    }/*for*/
+
+    unsigned int column[4];
+    unsigned int row[4];
+    float        x_base[4], x_reciprocal[4], y_base[4], y_reciprocal[4];
+    float        top_left[4], top_right[4], bottom_left[4], bottom_right[4];
+
+    _mm_storeu_si128((__m128i*)column, columns);
+    _mm_storeu_si128((__m128i*)row, rows);
+
+    for(unsigned int lane = 0; lane < 4; lane++){
+      const float* cell = interpolation->cells+row[lane]*CELL_STRIDE+column[lane];
+
+      x_base[lane]        = interpolation->x_axis[column[lane]];
+      x_reciprocal[lane]  = interpolation->x_reciprocal[column[lane]];
+      y_base[lane]        = interpolation->y_axis[row[lane]];
+      y_reciprocal[lane]  = interpolation->y_reciprocal[row[lane]];
+      top_left[lane]      = cell[0];
+      top_right[lane]     = cell[1];
+      bottom_left[lane]   = cell[CELL_STRIDE];
+      bottom_right[lane]  = cell[CELL_STRIDE+1];
+    }/*for*/
+
+    __m128 x_fractions = _mm_mul_ps(_mm_sub_ps(x_values, _mm_loadu_ps(x_base)), _mm_loadu_ps(x_reciprocal));
+    __m128 y_fractions = _mm_mul_ps(_mm_sub_ps(y_values, _mm_loadu_ps(y_base)), _mm_loadu_ps(y_reciprocal));
+
+    x_fractions = _mm_min_ps(_mm_max_ps(x_fractions, zero), one);
+    y_fractions = _mm_min_ps(_mm_max_ps(y_fractions, zero), one);
+
+    if(values != 0){
+      __m128 left   = _mm_loadu_ps(top_left);
+      __m128 right  = _mm_loadu_ps(top_right);
+      __m128 top    = _mm_add_ps(left, _mm_mul_ps(_mm_sub_ps(right, left), x_fractions));
+
+      left          = _mm_loadu_ps(bottom_left);
+      right         = _mm_loadu_ps(bottom_right);
+      __m128 bottom = _mm_add_ps(left, _mm_mul_ps(_mm_sub_ps(right, left), x_fractions));
+
+      _mm_storeu_ps(values+i, _mm_add_ps(top, _mm_mul_ps(_mm_sub_ps(bottom, top), y_fractions)));
+    }/*if*/
+
+    if( (cells != 0) || (histogram != 0) ){
+      float x_fraction[4];
+      float y_fraction[4];
+
+      _mm_storeu_ps(x_fraction, x_fractions);
+      _mm_storeu_ps(y_fraction, y_fractions);
+
+      for(unsigned int lane = 0; lane < 4; lane++){
+        store_sample(interpolation, i+lane, column[lane], row[lane], x_fraction[lane], y_fraction[lane], cells, histogram);
+      }/*for*/
+    }/*if*/
+  }/*for*/
+#endif
+
+  for(; i < count; i++){
+    interpolate_sample(interpolation, x[i], y[i], i, values, cells, histogram);
+  }/*for*/
+}/*interpolate_map*/
+
+struct interpolation_job{
+  const interpolation_map*  interpolation;
+  const float*              x;
+  const float*              y;
+  unsigned int              count;
+  float*                    values;
+  unsigned short*           cells;
+  unsigned long long*       histogram;
+};
+
+static void* interpolation_worker(void* given_job){
+  interpolation_job* job = (interpolation_job*)given_job;
+
+  interpolate_map(job->interpolation, job->x, job->y, job->count, job->values, job->cells, job->histogram);
+
+  return NULL;
+}/*interpolation_worker*/
+
+unsigned int interpolate_map_parallel(const interpolation_map* interpolation, const float* x, const float* y, const unsigned int count, float* values, unsigned short* cells, unsigned long long* histogram, const unsigned int threads){
+  unsigned int workers = threads;
+
+  if(workers == 0){
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    workers = (processors > 0) ? processors : 1;
+  }/*if*/
+
+  if(workers > MAX_INTERPOLATION_THREADS){
+    workers = MAX_INTERPOLATION_THREADS;
+  }/*if*/
+
+  if(workers > count/MIN_SAMPLES_PER_THREAD){
+    workers = count/MIN_SAMPLES_PER_THREAD;
+  }/*if*/
+
+  if(workers <= 1){
+    interpolate_map(interpolation, x, y, count, values, cells, histogram);
+    return 1;
+  }/*if*/
+
+  unsigned int        number_of_cells = interpolation->x_count*interpolation->y_count;
+  unsigned long long* histograms      = (histogram != 0) ? new unsigned long long[workers*number_of_cells]() : 0;
+
+  interpolation_job   jobs[MAX_INTERPOLATION_THREADS];
+  pthread_t           worker_threads[MAX_INTERPOLATION_THREADS];
+  bool                started[MAX_INTERPOLATION_THREADS];
+
+  /* Whole blocks of four per thread, so only the last one has a tail outside the vector loop. */
+  unsigned int chunk = ((count/workers)+3) & ~3u;
+
+  for(unsigned int i = 0; i < workers; i++){
+    unsigned int first = i*chunk;
+    unsigned int last  = (i+1 == workers) ? count : first+chunk;
+
+    jobs[i].interpolation = interpolation;
+    jobs[i].x             = x+first;
+    jobs[i].y             = y+first;
+    jobs[i].count         = last-first;
+    jobs[i].values        = (values != 0) ? values+first : 0;
+    jobs[i].cells         = (cells != 0) ? cells+first : 0;
+    jobs[i].histogram     = (histograms != 0) ? histograms+i*number_of_cells : 0;
+
+    started[i] = pthread_create(&worker_threads[i], NULL, interpolation_worker, &jobs[i]) == 0;
+  }/*for*/
+
+  for(unsigned int i = 0; i < workers; i++){
+    if(started[i]){
+      pthread_join(worker_threads[i], NULL);
+    }/*if*/
+    else{
+      /* No thread could be started for this part, do it ourselves. */
+      interpolation_worker(&jobs[i]);
+    }/*else*/
+  }/*for*/
+
+  if(histograms != 0){
+    for(unsigned int i = 0; i < workers; i++){
+      for(unsigned int cell = 0; cell < number_of_cells; cell++){
+        histogram[cell] += histograms[i*number_of_cells+cell];
+      }/*for*/
+    }/*for*/
+
+    delete[] histograms;
+  }/*if*/
+
+  return workers;
+}/*interpolate_map_parallel*/
+
+}
@@ -0,0 +1,77 @@
+/*
+ * Description:
+ *  Bilinear interpolation of Trionic 5 calibration maps over logged operating points.
+ *
+ *  Given a stream of samples, e.g. logged load and Rpm, this works out the value
+ *  the ECU looked up in a map for every sample, and which cell it was closest to.
+ *  As in the ECU, samples outside an axis are clamped to its ends.
+ *
+ *  A map is first converted to an interpolation_map: axes and cells as floats,
+ *  the axes scaled to the units of the samples, and the width of every axis
+ *  segment stored as a reciprocal so no division is left in the kernel. The last
+ *  break point and the last row and column are repeated once, which lets a map
+ *  with a single axis run through the same code as any other.
+ *
+ *  Samples are processed four at a time with SSE2 when it is available. The
+ *  segment of every sample is found by counting the break points below it, so
+ *  the search does not branch, and the interpolation itself is done on all four
+ *  samples at once. Large batches are split over several threads, each with a
+ *  histogram of its own, which are added up once all threads are done.
+ */
+
+#ifndef _map_interpolation_hpp_
+#define _map_interpolation_hpp_
+
+#include "calibration_maps.hpp"
+
+namespace trionic5net{
+
+#define MAX_INTERPOLATION_AXIS_POINTS 32
+#define MAX_INTERPOLATION_CELLS       (MAX_INTERPOLATION_AXIS_POINTS*MAX_INTERPOLATION_AXIS_POINTS)
+#define MAX_INTERPOLATION_THREADS     64
+
+/*
+ * Batches smaller than this per thread are not worth the cost of starting one.
+ */
+#define MIN_SAMPLES_PER_THREAD        65536
+
+struct interpolation_map{
+  unsigned int  x_count;
+  unsigned int  y_count;
+  float         x_axis[MAX_INTERPOLATION_AXIS_POINTS+1];
+  float         y_axis[MAX_INTERPOLATION_AXIS_POINTS+1];
+  float         x_reciprocal[MAX_INTERPOLATION_AXIS_POINTS+1];
+  float         y_reciprocal[MAX_INTERPOLATION_AXIS_POINTS+1];
+
+  /* Row by row, MAX_INTERPOLATION_AXIS_POINTS+1 cells apart. */
+  float         cells[(MAX_INTERPOLATION_AXIS_POINTS+1)*(MAX_INTERPOLATION_AXIS_POINTS+1)];
+};
+
+/*
+ * Converts a calibration map, multiplying its axes by x_scale and y_scale to bring them
+ * to the units of the samples. Cell values are left as they are stored.
+ * Returns 0 if the map has more break points than supported or its axes do not increase.
+ */
+int prepare_interpolation(interpolation_map* interpolation, const calibration_map* map, const float x_scale, const float y_scale);
+
+/*
+ * Interpolates count samples of (x[i], y[i]).
+ *
+ * Any of the outputs may be 0:
+ *  values receives the interpolated value of every sample.
+ *  cells receives the cell closest to every sample, as row*x_count+column.
+ *  histogram, which must hold x_count*y_count counters, has the counter of that cell
+ *  incremented for every sample. It is not cleared first.
+ */
+void interpolate_map(const interpolation_map* interpolation, const float* x, const float* y, const unsigned int count, float* values, unsigned short* cells, unsigned long long* histogram);
+
+/*
+ * Same as interpolate_map(), spread over at most the given number of threads.
+ * With threads set to 0, one thread per online processor is used.
+ * Returns the number of parts the batch was split into, each done by a thread of its own.
+ */
+unsigned int interpolate_map_parallel(const interpolation_map* interpolation, const float* x, const float* y, const unsigned int count, float* values, unsigned short* cells, unsigned long long* histogram, const unsigned int threads);
+
+}
+
+#endif
@@ -0,0 +1,179 @@
+/*
+ * Description:
+ *   Implementation file for the SRAM mirror.
+ */
+
+#include "sram_mirror.hpp"
+#include <string.h>
+
+namespace trionic5net{
+
+/*
+ * sram_view
+ */
+
+sram_view::sram_view(){
+  mirror  = 0;
+  address = 0x0;
+  length  = 0x0;
+}/*sram_view::sram_view*/
+
+sram_view::sram_view(const sram_mirror* given_mirror, const unsigned int given_address, const unsigned int given_length){
+  mirror  = given_mirror;
+  address = given_address;
+  length  = given_length;
+}/*sram_view::sram_view*/
+
+bool sram_view::is_valid(void) const{
+  return mirror != 0;
+}/*sram_view::is_valid*/
+
+unsigned int sram_view::get_address(void) const{
+  return address;
+}/*sram_view::get_address*/
+
+unsigned int sram_view::get_length(void) const{
+  return length;
+}/*sram_view::get_length*/
+
+const unsigned char* sram_view::get_bytes(void) const{
+  return mirror->get_data()+address;
+}/*sram_view::get_bytes*/
+
+unsigned int sram_view::get_unsigned(void) const{
+  const unsigned char*  bytes = get_bytes();
+  unsigned int          value = 0x0;
+  unsigned int          size  = length < 4 ? length : 4;
+
+  for(unsigned int i = 0; i < size; i++){
+    value = (value << 8) | bytes[i];
+  }/*for*/
+
+  return value;
+}/*sram_view::get_unsigned*/
+
+int sram_view::get_signed(void) const{
+  unsigned int size   = length < 4 ? length : 4;
+  unsigned int shift  = 32-8*size;
+
+  if(size == 0){
+    return 0;
+  }/*if*/
+
+  /* Move the sign bit to the top, then let the arithmetic shift extend it. */
+  return ((int)(get_unsigned() << shift)) >> shift;
+}/*sram_view::get_signed*/
+
+unsigned long long sram_view::get_timestamp(void) const{
+  return mirror->get_timestamp(address, address+length);
+}/*sram_view::get_timestamp*/
+
+/*
+ * sram_mirror
+ */
+
+sram_mirror::sram_mirror(){
+  clear();
+}/*sram_mirror::sram_mirror*/
+
+sram_mirror::~sram_mirror(){
+
+}/*sram_mirror::~sram_mirror*/
+
+void sram_mirror::clear(void){
+  memset(data, 0x0, sizeof(data));
+  memset(region_timestamps, 0x0, sizeof(region_timestamps));
+}/*sram_mirror::clear*/
+
+int sram_mirror::update(const unsigned int start_address, const unsigned char* bytes, const unsigned int length, const unsigned long long timestamp){
+  if( (bytes == 0) || (length == 0) || (start_address+length > SRAM_ADDRESS_SPACE_SIZE) ){
+    return 0;
+  }/*if*/
+
+  if(bytes != data+start_address){
+    memmove(data+start_address, bytes, length);
+  }/*if*/
+
+  unsigned int first_region = start_address/SRAM_MIRROR_REGION_SIZE;
+  unsigned int last_region  = (start_address+length-1)/SRAM_MIRROR_REGION_SIZE;
+
+  for(unsigned int region = first_region; region <= last_region; region++){
+    region_timestamps[region] = timestamp;
+  }/*for*/
+
+  return 1;
+}/*sram_mirror::update*/
+
+int sram_mirror::expect(sram_response_decoder* decoder, const unsigned int start_address, const unsigned int end_address){
+  if( (decoder == 0) || (start_address >= end_address) || (end_address > SRAM_ADDRESS_SPACE_SIZE) ){
+    return 0;
+  }/*if*/
+
+  return decoder->expect(start_address, end_address, data+start_address, end_address-start_address);
+}/*sram_mirror::expect*/
+
+int sram_mirror::commit(const sram_response_decoder* decoder, const unsigned long long timestamp){
+  if( (decoder == 0) || !decoder->is_complete() ){
+    return 0;
+  }/*if*/
+
+  /* The bytes are already in place, update() only needs to stamp them. */
+  return update(decoder->get_start_address(), data+decoder->get_start_address(), decoder->get_received_bytes(), timestamp);
+}/*sram_mirror::commit*/
+
+unsigned long long sram_mirror::get_timestamp(const unsigned int start_address, const unsigned int end_address) const{
+  if( (start_address >= end_address) || (end_address > SRAM_ADDRESS_SPACE_SIZE) ){
+    return 0;
+  }/*if*/
+
+  unsigned long long  oldest        = region_timestamps[start_address/SRAM_MIRROR_REGION_SIZE];
+  unsigned int        last_region   = (end_address-1)/SRAM_MIRROR_REGION_SIZE;
+
+  for(unsigned int region = start_address/SRAM_MIRROR_REGION_SIZE+1; region <= last_region; region++){
+    if(region_timestamps[region] < oldest){
+      oldest = region_timestamps[region];
+    }/*if*/
+  }/*for*/
+
+  return oldest;
+}/*sram_mirror::get_timestamp*/
+
+bool sram_mirror::is_fresh(const unsigned int start_address, const unsigned int end_address, const unsigned long long max_age, const unsigned long long now) const{
+  unsigned long long timestamp = get_timestamp(start_address, end_address);
+
+  if(timestamp == 0){
+    return false;
+  }/*if*/
+
+  return (now < timestamp) || (now-timestamp <= max_age);
+}/*sram_mirror::is_fresh*/
+
+const unsigned char* sram_mirror::get_data(void) const{
+  return data;
+}/*sram_mirror::get_data*/
+
+sram_view sram_mirror::view(const symbol* sym) const{
+  if(sym == 0){
+    return sram_view();
+  }/*if*/
+
+  return view(sym->address, sym->length);
+}/*sram_mirror::view*/
+
+sram_view sram_mirror::view(const symbol_table* table, const char* name) const{
+  if(table == 0){
+    return sram_view();
+  }/*if*/
+
+  return view(table->find(name));
+}/*sram_mirror::view*/
+
+sram_view sram_mirror::view(const unsigned int address, const unsigned int length) const{
+  if( (length == 0) || (address+length > SRAM_ADDRESS_SPACE_SIZE) ){
+    return sram_view();
+  }/*if*/
+
+  return sram_view(this, address, length);
+}/*sram_mirror::view*/
+
+}
@@ -0,0 +1,118 @@
+/*
+ * Description:
+ *  An in-process copy of the Trionic 5 SRAM address space.
+ *
+ *  Every SRAM read, be it a single symbol or a large block, is written into the
+ *  mirror, and the time of the read is recorded for every byte it covered.
+ *  Symbols are then nothing but views into the mirror, resolved through a
+ *  symbol_table, so any consumer may read the latest value of a symbol without
+ *  issuing a bus request, and one block read refreshes every symbol inside it.
+ *
+ *  Freshness is tracked in regions of SRAM_MIRROR_REGION_SIZE bytes. Trionic
+ *  keeps plenty of one byte variables at odd addresses, so the region size is
+ *  a single byte; a coarser region would report neighbouring variables as fresh
+ *  although they were never read.
+ *
+ *  The mirror is roughly half a megabyte, so do not put it on the stack.
+ */
+
+#ifndef _sram_mirror_hpp_
+#define _sram_mirror_hpp_
+
+#include "sram_response.hpp"
+#include "symbol_table.hpp"
+
+namespace trionic5net{
+
+#define SRAM_MIRROR_REGION_SIZE   1
+#define SRAM_MIRROR_REGIONS       (SRAM_ADDRESS_SPACE_SIZE/SRAM_MIRROR_REGION_SIZE)
+
+class sram_mirror;
+
+/*
+ * A typed view of a range of the mirror.
+ * Trionic is a big-endian machine, so multi-byte values are assembled most significant byte first.
+ * Reading a view never copies more than the value itself.
+ */
+class sram_view{
+  private:
+    const sram_mirror*  mirror;
+    unsigned int        address;
+    unsigned int        length;
+
+  public:
+    sram_view();
+    sram_view(const sram_mirror* mirror, const unsigned int address, const unsigned int length);
+
+    bool                  is_valid(void) const;
+    unsigned int          get_address(void) const;
+    unsigned int          get_length(void) const;
+
+    /* The raw bytes, straight from the mirror. */
+    const unsigned char*  get_bytes(void) const;
+
+    /* Values of up to four bytes. Longer views return their first four bytes. */
+    unsigned int          get_unsigned(void) const;
+    int                   get_signed(void) const;
+
+    /* The time of the oldest read which contributed to this view, 0 if it was never read. */
+    unsigned long long    get_timestamp(void) const;
+};
+
+class sram_mirror{
+  private:
+    unsigned char       data[SRAM_ADDRESS_SPACE_SIZE];
+    unsigned long long  region_timestamps[SRAM_MIRROR_REGIONS];
+
+  public:
+    sram_mirror();
+    ~sram_mirror();
+
+    /*
+     * Forgets all contents and timestamps.
+     */
+    void clear(void);
+
+    /*
+     * Copies a completed read of [start_address, start_address+length) into the mirror.
+     * Returns 0 on failure.
+     */
+    int update(const unsigned int start_address, const unsigned char* bytes, const unsigned int length, const unsigned long long timestamp);
+
+    /*
+     * Arms a decoder to reassemble its response train directly into the mirror, so no copy is needed.
+     * Call commit() once the decoder reports Sram_Response_Complete.
+     * Returns 0 on failure.
+     */
+    int expect(sram_response_decoder* decoder, const unsigned int start_address, const unsigned int end_address);
+
+    /*
+     * Records the time of a read which the decoder completed in place.
+     * Returns 0 if the decoder did not complete a read into the mirror.
+     */
+    int commit(const sram_response_decoder* decoder, const unsigned long long timestamp);
+
+    /*
+     * Returns the time of the oldest read within [start_address, end_address), 0 if any byte was never read.
+     */
+    unsigned long long get_timestamp(const unsigned int start_address, const unsigned int end_address) const;
+
+    /*
+     * Returns true if every byte in [start_address, end_address) was read at most max_age microseconds before now.
+     */
+    bool is_fresh(const unsigned int start_address, const unsigned int end_address, const unsigned long long max_age, const unsigned long long now) const;
+
+    const unsigned char* get_data(void) const;
+
+    /*
+     * Views of a symbol or of an arbitrary range.
+     * The view is invalid if the symbol is unknown or the range lies outside SRAM.
+     */
+    sram_view view(const symbol* sym) const;
+    sram_view view(const symbol_table* table, const char* name) const;
+    sram_view view(const unsigned int address, const unsigned int length) const;
+};
+
+}
+
+#endif
@@ -0,0 +1,277 @@
+/*
+ * Description:
+ *   Implementation file for the pipelined SRAM read engine.
+ */
+
+#include "sram_reader.hpp"
+#include "timing/clock.h"
+
+namespace trionic5net{
+
+sram_reader::sram_reader(can::bus* given_canbus, sram_mirror* given_mirror){
+  canbus          = given_canbus;
+  mirror          = given_mirror;
+  queue_head      = 0;
+  queued_reads    = 0;
+  in_flight_reads = 0;
+  window          = SRAM_READER_DEFAULT_WINDOW;
+  max_retries     = SRAM_READER_DEFAULT_RETRIES;
+  head_time       = 0;
+  head_sampled    = false;
+  settling        = false;
+  received_bytes  = 0;
+  timeouts        = 0;
+
+  retransmitted_reads = 0;
+
+  memset(queue, 0x0, sizeof(queue));
+  init_rtt_estimator(&rtt, SRAM_READER_INITIAL_TIMEOUT, SRAM_READER_MIN_TIMEOUT, SRAM_READER_MAX_TIMEOUT);
+}/*sram_reader::sram_reader*/
+
+sram_reader::~sram_reader(){
+
+}/*sram_reader::~sram_reader*/
+
+void sram_reader::set_window(const unsigned int reads){
+  if(reads < 1){
+    window = 1;
+  }/*if*/
+  else if(reads > SRAM_READER_MAX_WINDOW){
+    window = SRAM_READER_MAX_WINDOW;
+  }/*else if*/
+  else{
+    window = reads;
+  }/*else*/
+}/*sram_reader::set_window*/
+
+void sram_reader::set_max_retries(const unsigned int retries){
+  max_retries = retries;
+}/*sram_reader::set_max_retries*/
+
+sram_read* sram_reader::get_read(const unsigned int position){
+  return &queue[(queue_head+position) % SRAM_READER_QUEUE_SIZE];
+}/*sram_reader::get_read*/
+
+int sram_reader::queue_read(const unsigned int start_address, const unsigned int end_address, sram_read_callback callback, void* context){
+  if( (start_address >= end_address) || (end_address > SRAM_ADDRESS_SPACE_SIZE) ){
+    return 0;
+  }/*if*/
+
+  unsigned int needed_reads = (end_address-start_address+SRAM_MAX_READ_SIZE-1)/SRAM_MAX_READ_SIZE;
+
+  if(queued_reads+needed_reads > SRAM_READER_QUEUE_SIZE){
+    return 0;
+  }/*if*/
+
+  for(unsigned int address = start_address; address < end_address; address += SRAM_MAX_READ_SIZE){
+    sram_read* read = get_read(queued_reads);
+
+    read->start_address     = address;
+    read->end_address       = (end_address-address > SRAM_MAX_READ_SIZE) ? address+SRAM_MAX_READ_SIZE : end_address;
+    read->callback          = callback;
+    read->context           = context;
+    read->transmission_time = 0;
+    read->retries           = 0;
+    read->transmitted       = false;
+
+    queued_reads += 1;
+  }/*for*/
+
+  transmit_reads();
+
+  return 1;
+}/*sram_reader::queue_read*/
+
+void sram_reader::transmit_reads(void){
+  if(settling){
+    return;
+  }/*if*/
+
+  while( (in_flight_reads < window) && (in_flight_reads < queued_reads) ){
+    sram_read*  read = get_read(in_flight_reads);
+    can_frame   request;
+
+    build_sram_read_request(&request, read->start_address, read->end_address);
+
+    if(canbus->send(&request) < (int)sizeof(can_frame)){
+      /* The socket buffer is full - try again on the next poll. */
+      break;
+    }/*if*/
+
+    read->transmitted       = true;
+    read->transmission_time = monotonic_microseconds();
+
+    if(read->retries > 0){
+      retransmitted_reads += 1;
+    }/*if*/
+
+    if(in_flight_reads == 0){
+      mirror->expect(&decoder, read->start_address, read->end_address);
+      head_time     = read->transmission_time;
+      head_sampled  = false;
+    }/*if*/
+
+    in_flight_reads += 1;
+  }/*while*/
+}/*sram_reader::transmit_reads*/
+
+void sram_reader::finish_head(const bool success){
+  sram_read finished = *get_read(0);
+
+  queue_head      = (queue_head+1) % SRAM_READER_QUEUE_SIZE;
+  queued_reads    -= 1;
+
+  decoder.reset();
+
+  if(in_flight_reads > 0){
+    in_flight_reads -= 1;
+  }/*if*/
+
+  if(in_flight_reads > 0){
+    sram_read* next = get_read(0);
+    mirror->expect(&decoder, next->start_address, next->end_address);
+
+    /* The next read has been waiting behind this one, its clock starts now. */
+    head_time     = monotonic_microseconds();
+    head_sampled  = false;
+  }/*if*/
+
+  if(finished.callback != 0){
+    finished.callback(finished.context, finished.start_address, finished.end_address, success);
+  }/*if*/
+}/*sram_reader::finish_head*/
+
+void sram_reader::handle_frame(const unsigned int can_id, const unsigned size, const unsigned char* data){
+  if( settling && (can_id == TRIONIC5_RESPONSE_FRAME_ID) ){
+    /* A late frame of a train given up on - wait for the bus to go quiet again. */
+    head_time = monotonic_microseconds();
+    return;
+  }/*if*/
+
+  if(in_flight_reads == 0){
+    return;
+  }/*if*/
+
+  Sram_Response_Status status = decoder.decode(can_id, size, data);
+
+  if( (status == Sram_Response_Incomplete) || (status == Sram_Response_Complete) ){
+    unsigned long long now = monotonic_microseconds();
+
+    /* Reads which were sent more than once are not sampled, the answer could be to either transmission. */
+    if( !head_sampled && (get_read(0)->retries == 0) ){
+      rtt_estimator_sample(&rtt, now-head_time);
+    }/*if*/
+
+    head_time     = now;
+    head_sampled  = true;
+  }/*if*/
+
+  switch(status){
+    case Sram_Response_Complete:
+      received_bytes += decoder.get_received_bytes();
+      mirror->commit(&decoder, monotonic_microseconds());
+      finish_head(true);
+      break;
+    case Sram_Response_Malformed:
+      /*
+       * Responses carry no address, so once a train is broken there is no telling
+       * which of the outstanding reads the following frames belong to.
+       */
+      requeue_in_flight();
+      break;
+    default:
+      break;
+  }/*switch*/
+}/*sram_reader::handle_frame*/
+
+int sram_reader::poll(void){
+  unsigned int  can_id;
+  unsigned char data[8];
+  int           size;
+  int           handled_frames = 0;
+
+  while( (size = canbus->receive(sizeof(data), (char*)data, &can_id)) >= 0 ){
+    handle_frame(can_id, size, data);
+    handled_frames += 1;
+  }/*while*/
+
+  check_timeout(monotonic_microseconds());
+  transmit_reads();
+
+  return handled_frames;
+}/*sram_reader::poll*/
+
+void sram_reader::check_timeout(const unsigned long long now){
+  if(settling){
+    settling = !rtt_estimator_expired(&rtt, head_time, now);
+    return;
+  }/*if*/
+
+  if( (in_flight_reads == 0) || !rtt_estimator_expired(&rtt, head_time, now) ){
+    return;
+  }/*if*/
+
+  timeouts += 1;
+  rtt_estimator_backoff(&rtt);
+
+  /* Whatever is still on its way belongs to the lost read, and there is no telling where its train ends. */
+  requeue_in_flight();
+}/*sram_reader::check_timeout*/
+
+void sram_reader::requeue_in_flight(void){
+  /*
+   * Put every outstanding read back in the queue, in order, to be sent again once
+   * the bus has settled, and give up on those which have run out of retries.
+   */
+  for(unsigned int i = 0; i < in_flight_reads; i++){
+    sram_read* read = get_read(i);
+
+    read->transmitted = false;
+    read->retries     += 1;
+  }/*for*/
+
+  in_flight_reads = 0;
+  settling        = true;
+  head_time       = monotonic_microseconds();
+  decoder.reset();
+
+  while( (queued_reads > 0) && (get_read(0)->retries > max_retries) ){
+    finish_head(false);
+  }/*while*/
+}/*sram_reader::requeue_in_flight*/
+
+void sram_reader::cancel_all(void){
+  while(queued_reads > 0){
+    finish_head(false);
+  }/*while*/
+}/*sram_reader::cancel_all*/
+
+bool sram_reader::is_idle(void) const{
+  return queued_reads == 0;
+}/*sram_reader::is_idle*/
+
+unsigned int sram_reader::get_queued_reads(void) const{
+  return queued_reads;
+}/*sram_reader::get_queued_reads*/
+
+unsigned int sram_reader::get_in_flight_reads(void) const{
+  return in_flight_reads;
+}/*sram_reader::get_in_flight_reads*/
+
+unsigned long long sram_reader::get_received_bytes(void) const{
+  return received_bytes;
+}/*sram_reader::get_received_bytes*/
+
+unsigned long long sram_reader::get_timeout(void) const{
+  return rtt_estimator_timeout(&rtt);
+}/*sram_reader::get_timeout*/
+
+unsigned long long sram_reader::get_timeouts(void) const{
+  return timeouts;
+}/*sram_reader::get_timeouts*/
+
+unsigned long long sram_reader::get_retransmitted_reads(void) const{
+  return retransmitted_reads;
+}/*sram_reader::get_retransmitted_reads*/
+
+}
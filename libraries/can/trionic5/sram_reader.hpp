@@ -0,0 +1,148 @@
+/*
+ * Description:
+ *  A pipelined SRAM read engine for Trionic 5.
+ *
+ *  Reads are queued and transmitted as 0xC7 requests, keeping up to a window of
+ *  them outstanding on the bus at once, so the ECU never sits idle waiting for
+ *  the next request. Trionic answers requests in the order they were sent and
+ *  its responses carry no address, so the response train on the bus always
+ *  belongs to the oldest outstanding read. Every completed read is reassembled
+ *  straight into an sram_mirror.
+ *
+ *  A read which sees no response for longer than the estimated timeout is
+ *  considered lost. The timeout follows the measured time to the first response
+ *  frame (see timing/rtt_estimator.h), and is measured from the last progress of
+ *  the oldest read, so large reads are not penalised for their length. Since the
+ *  responses carry no address, a lost read takes everything behind it down as
+ *  well; all outstanding reads are sent again, up to a number of retries.
+ *  The same happens when a response train turns out to be malformed. Late frames
+ *  of the abandoned trains would be taken for answers to the new requests, so
+ *  nothing is sent again until the bus has been quiet for a whole timeout.
+ *
+ *  The reader never blocks; call poll() from the main loop.
+ */
+
+#ifndef _sram_reader_hpp_
+#define _sram_reader_hpp_
+
+#include "can/bus.hpp"
+#include "sram_response.hpp"
+#include "sram_mirror.hpp"
+#include "timing/rtt_estimator.h"
+
+namespace trionic5net{
+
+#define SRAM_READER_QUEUE_SIZE      256
+#define SRAM_READER_MAX_WINDOW      16
+#define SRAM_READER_DEFAULT_WINDOW  4
+
+/*
+ * The largest range requested by a single 0xC7 frame.
+ * Larger reads are split up when they are queued.
+ */
+#define SRAM_MAX_READ_SIZE          0x800
+
+#define SRAM_READER_DEFAULT_RETRIES 3
+#define SRAM_READER_INITIAL_TIMEOUT 100000ULL
+#define SRAM_READER_MIN_TIMEOUT     2000ULL
+#define SRAM_READER_MAX_TIMEOUT     2000000ULL
+
+/*
+ * Called once a read has completed or failed. On success, the bytes are in the mirror.
+ */
+typedef void (*sram_read_callback)(void* context, const unsigned int start_address, const unsigned int end_address, const bool success);
+
+struct sram_read{
+  unsigned int        start_address;
+  unsigned int        end_address;
+  sram_read_callback  callback;
+  void*               context;
+  unsigned long long  transmission_time;
+  unsigned int        retries;
+  bool                transmitted;
+};
+
+class sram_reader{
+  private:
+    can::bus*               canbus;
+    sram_mirror*            mirror;
+    sram_response_decoder   decoder;
+
+    sram_read               queue[SRAM_READER_QUEUE_SIZE];
+    unsigned int            queue_head;
+    unsigned int            queued_reads;
+    unsigned int            in_flight_reads;
+    unsigned int            window;
+    unsigned int            max_retries;
+
+    /*
+     * The time the oldest outstanding read last made progress, or while settling,
+     * the time the last response frame arrived, and whether its round-trip time
+     * has been sampled yet.
+     */
+    rtt_estimator           rtt;
+    unsigned long long      head_time;
+    bool                    head_sampled;
+    bool                    settling;
+
+    unsigned long long      received_bytes;
+    unsigned long long      timeouts;
+    unsigned long long      retransmitted_reads;
+
+    sram_read*  get_read(const unsigned int position);
+    void        transmit_reads(void);
+    void        finish_head(const bool success);
+    void        check_timeout(const unsigned long long now);
+    void        requeue_in_flight(void);
+
+  public:
+    sram_reader(can::bus* canbus, sram_mirror* mirror);
+    ~sram_reader();
+
+    /*
+     * Sets the number of reads which may be outstanding at once, at most SRAM_READER_MAX_WINDOW.
+     */
+    void set_window(const unsigned int reads);
+
+    /*
+     * Sets how often a lost read is sent again before its callback reports failure.
+     */
+    void set_max_retries(const unsigned int retries);
+
+    /*
+     * Queues a read of [start_address, end_address).
+     * Ranges larger than SRAM_MAX_READ_SIZE are split into several requests;
+     * the callback is invoked for each of them.
+     * Returns 0 if the queue is full.
+     */
+    int queue_read(const unsigned int start_address, const unsigned int end_address, sram_read_callback callback, void* context);
+
+    /*
+     * Feeds a received frame into the engine. Frames which are not SRAM responses are ignored.
+     */
+    void handle_frame(const unsigned int can_id, const unsigned size, const unsigned char* data);
+
+    /*
+     * Drains the bus of received frames, retransmits lost reads and transmits queued reads
+     * while the window allows.
+     * Returns the number of frames handled.
+     */
+    int poll(void);
+
+    /*
+     * Gives up on every read, invoking the callbacks with success set to false.
+     */
+    void cancel_all(void);
+
+    bool                is_idle(void) const;
+    unsigned int        get_queued_reads(void) const;
+    unsigned int        get_in_flight_reads(void) const;
+    unsigned long long  get_received_bytes(void) const;
+    unsigned long long  get_timeout(void) const;
+    unsigned long long  get_timeouts(void) const;
+    unsigned long long  get_retransmitted_reads(void) const;
+};
+
+}
+
+#endif
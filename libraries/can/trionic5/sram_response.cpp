@@ -0,0 +1,145 @@
+/*
+ * Description:
+ *   Implementation file for the Trionic 5 SRAM read request/response codec.
+ */
+
+#include "sram_response.hpp"
+#include <string.h>
+
+namespace trionic5net{
+
+int build_sram_read_request(can_frame* frame, const unsigned int start_address, const unsigned int end_address){
+  if( (frame == 0) || (start_address >= end_address) || (end_address > SRAM_ADDRESS_SPACE_SIZE) ){
+    return 0;
+  }/*if*/
+
+  /*
+   * The end address is exclusive, so a read reaching the very top of SRAM
+   * wraps to 0x0000 in the 16 bit field.
+   */
+  memset(frame, 0x0, sizeof(can_frame));
+  frame->can_id   = TRIONIC5_REQUEST_FRAME_ID;
+  frame->can_dlc  = 8;
+  frame->data[0]  = SRAM_READ_REQUEST_OPCODE;
+  frame->data[1]  = (end_address >> 8) & 0xFF;
+  frame->data[2]  = end_address & 0xFF;
+  frame->data[3]  = (start_address >> 8) & 0xFF;
+  frame->data[4]  = start_address & 0xFF;
+
+  return 1;
+}/*build_sram_read_request*/
+
+int parse_sram_read_request(const can_frame* frame, unsigned int* start_address, unsigned int* end_address){
+  if( (frame == 0) || (frame->can_dlc < 5) || (frame->data[0] != SRAM_READ_REQUEST_OPCODE) ){
+    return 0;
+  }/*if*/
+
+  unsigned int start  = (frame->data[3] << 8) | frame->data[4];
+  unsigned int end    = (frame->data[1] << 8) | frame->data[2];
+
+  if(end == 0x0){
+    end = SRAM_ADDRESS_SPACE_SIZE;
+  }/*if*/
+
+  if(end <= start){
+    return 0;
+  }/*if*/
+
+  *start_address  = start;
+  *end_address    = end;
+
+  return 1;
+}/*parse_sram_read_request*/
+
+sram_response_decoder::sram_response_decoder(){
+  destination     = 0;
+  start_address   = 0x0;
+  expected_bytes  = 0x0;
+  received_bytes  = 0x0;
+}/*sram_response_decoder::sram_response_decoder*/
+
+sram_response_decoder::~sram_response_decoder(){
+
+}/*sram_response_decoder::~sram_response_decoder*/
+
+int sram_response_decoder::expect(const unsigned int start, const unsigned int end, unsigned char* buffer, const unsigned int buffer_size){
+  if( (buffer == 0) || (start >= end) || (end > SRAM_ADDRESS_SPACE_SIZE) || (buffer_size < (end-start)) ){
+    reset();
+    return 0;
+  }/*if*/
+
+  destination     = buffer;
+  start_address   = start;
+  expected_bytes  = end-start;
+  received_bytes  = 0x0;
+
+  return 1;
+}/*sram_response_decoder::expect*/
+
+Sram_Response_Status sram_response_decoder::decode(const can_frame* frame){
+  return decode(frame->can_id, frame->can_dlc, frame->data);
+}/*sram_response_decoder::decode*/
+
+Sram_Response_Status sram_response_decoder::decode(const unsigned int can_id, const unsigned size, const unsigned char* data){
+  if( (can_id & (CAN_EFF_FLAG | CAN_RTR_FLAG | CAN_ERR_FLAG)) || ((can_id & CAN_SFF_MASK) != TRIONIC5_RESPONSE_FRAME_ID) ){
+    return Sram_Response_Ignored;
+  }/*if*/
+
+  if( (size < SRAM_RESPONSE_HEADER_SIZE) || (data[0] != SRAM_READ_RESPONSE_OPCODE) ){
+    return Sram_Response_Ignored;
+  }/*if*/
+
+  if(!is_pending()){
+    return Sram_Response_Unexpected;
+  }/*if*/
+
+  unsigned int remaining_bytes  = expected_bytes-received_bytes;
+  unsigned int frame_bytes      = remaining_bytes < SRAM_RESPONSE_PAYLOAD_SIZE ? remaining_bytes : SRAM_RESPONSE_PAYLOAD_SIZE;
+
+  /*
+   * Trionic pads the last frame of a train to a full eight bytes, so only
+   * a frame which is too short to hold the outstanding bytes is rejected.
+   */
+  if( (data[1] != SRAM_READ_RESPONSE_ACKNOWLEDGE) || (size < SRAM_RESPONSE_HEADER_SIZE+frame_bytes) ){
+    reset();
+    return Sram_Response_Malformed;
+  }/*if*/
+
+  memcpy(destination+received_bytes, data+SRAM_RESPONSE_HEADER_SIZE, frame_bytes);
+  received_bytes += frame_bytes;
+
+  if(received_bytes == expected_bytes){
+    return Sram_Response_Complete;
+  }/*if*/
+
+  return Sram_Response_Incomplete;
+}/*sram_response_decoder::decode*/
+
+void sram_response_decoder::reset(void){
+  destination     = 0;
+  start_address   = 0x0;
+  expected_bytes  = 0x0;
+  received_bytes  = 0x0;
+}/*sram_response_decoder::reset*/
+
+bool sram_response_decoder::is_pending(void) const{
+  return (destination != 0) && (received_bytes < expected_bytes);
+}/*sram_response_decoder::is_pending*/
+
+bool sram_response_decoder::is_complete(void) const{
+  return (destination != 0) && (received_bytes == expected_bytes);
+}/*sram_response_decoder::is_complete*/
+
+unsigned int sram_response_decoder::get_start_address(void) const{
+  return start_address;
+}/*sram_response_decoder::get_start_address*/
+
+unsigned int sram_response_decoder::get_expected_bytes(void) const{
+  return expected_bytes;
+}/*sram_response_decoder::get_expected_bytes*/
+
+unsigned int sram_response_decoder::get_received_bytes(void) const{
+  return received_bytes;
+}/*sram_response_decoder::get_received_bytes*/
+
+}
@@ -0,0 +1,94 @@
+/*
+ * Description:
+ *  Encoding of Trionic 5 SRAM read requests and decoding of the replies.
+ *
+ *  A read request (opcode 0xC7) carries the end and start address of the wanted
+ *  SRAM range, see messages.hpp. Trionic answers with a train of response frames,
+ *  each one starting with the two byte header 0xC6 0x0C followed by up to six
+ *  bytes of SRAM contents in ascending address order. Symbols larger than six
+ *  bytes, such as AMOS_text, Adapt_ggr and Samp_area, thus span several frames.
+ *
+ *  The decoder below reassembles such a train straight into a buffer owned by
+ *  the caller. It never allocates memory and never copies the payload more than
+ *  once, so a single decoder may be reused for every read at full bus rate.
+ */
+
+#ifndef _sram_response_hpp_
+#define _sram_response_hpp_
+
+#include <linux/can.h>
+
+namespace trionic5net{
+
+#define TRIONIC5_REQUEST_FRAME_ID       0x005
+#define TRIONIC5_RESPONSE_FRAME_ID      0x00C
+
+#define SRAM_READ_REQUEST_OPCODE        0xC7
+#define SRAM_READ_RESPONSE_OPCODE       0xC6
+#define SRAM_READ_RESPONSE_ACKNOWLEDGE  0x0C
+
+#define SRAM_RESPONSE_HEADER_SIZE       2
+#define SRAM_RESPONSE_PAYLOAD_SIZE      6
+#define SRAM_ADDRESS_SPACE_SIZE         0x10000
+
+typedef enum{
+  Sram_Response_Incomplete  = 0,  /* The frame was accepted, more frames are expected.    */
+  Sram_Response_Complete    = 1,  /* The frame was accepted and completed the read.        */
+  Sram_Response_Ignored     = 2,  /* The frame was not an SRAM response - nothing was done. */
+  Sram_Response_Unexpected  = 3,  /* An SRAM response arrived while no read was pending.   */
+  Sram_Response_Malformed   = 4   /* Bad header or too short - the pending read is dropped. */
+}Sram_Response_Status;
+
+/*
+ * Fills in a read request for the SRAM range [start_address, end_address).
+ * Returns 0 on failure.
+ */
+int build_sram_read_request(can_frame* frame, const unsigned int start_address, const unsigned int end_address);
+
+/*
+ * Extracts the SRAM range from a read request, for instance one of the frames in messages.hpp.
+ * Returns 0 on failure.
+ */
+int parse_sram_read_request(const can_frame* frame, unsigned int* start_address, unsigned int* end_address);
+
+class sram_response_decoder{
+  private:
+    unsigned char*  destination;
+    unsigned int    start_address;
+    unsigned int    expected_bytes;
+    unsigned int    received_bytes;
+
+  public:
+    sram_response_decoder();
+    ~sram_response_decoder();
+
+    /*
+     * Arms the decoder for a read of [start_address, end_address).
+     * The reassembled bytes are written to buffer, which must hold the whole range
+     * and stay valid until the read completes or the decoder is reset.
+     * Returns 0 on failure.
+     */
+    int expect(const unsigned int start_address, const unsigned int end_address, unsigned char* buffer, const unsigned int buffer_size);
+
+    /*
+     * Feed every received frame through one of these.
+     * Frames with another identifier are ignored, so the decoder may sit directly on an unfiltered bus.
+     */
+    Sram_Response_Status decode(const can_frame* frame);
+    Sram_Response_Status decode(const unsigned int can_id, const unsigned size, const unsigned char* data);
+
+    /*
+     * Drops any pending read.
+     */
+    void reset(void);
+
+    bool          is_pending(void) const;
+    bool          is_complete(void) const;
+    unsigned int  get_start_address(void) const;
+    unsigned int  get_expected_bytes(void) const;
+    unsigned int  get_received_bytes(void) const;
+};
+
+}
+
+#endif
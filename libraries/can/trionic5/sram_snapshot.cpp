@@ -0,0 +1,186 @@
+/*
+ * Description:
+ *   Implementation file for SRAM snapshots.
+ */
+
+#include "sram_snapshot.hpp"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace trionic5net{
+
+int take_snapshot(sram_snapshot* snapshot, const unsigned char* sram, const unsigned int start_address, const unsigned int end_address, const unsigned long long timestamp){
+  if( (snapshot == 0) || (sram == 0) || (start_address >= end_address) || (end_address > SRAM_ADDRESS_SPACE_SIZE) ){
+    return 0;
+  }/*if*/
+
+  memset(&snapshot->header, 0x0, sizeof(sram_snapshot_header));
+  memcpy(snapshot->header.magic, SRAM_SNAPSHOT_MAGIC, sizeof(SRAM_SNAPSHOT_MAGIC));
+  snapshot->header.version        = SRAM_SNAPSHOT_VERSION;
+  snapshot->header.start_address  = start_address;
+  snapshot->header.end_address    = end_address;
+  snapshot->header.timestamp      = timestamp;
+
+  memcpy(snapshot->data, sram+start_address, end_address-start_address);
+
+  return 1;
+}/*take_snapshot*/
+
+int save_snapshot(const char* path, const sram_snapshot* snapshot){
+  FILE* snapshot_file = fopen(path, "wb");
+  if(snapshot_file == NULL){
+    perror(path);
+    return 0;
+  }/*if*/
+
+  unsigned int size = snapshot->header.end_address-snapshot->header.start_address;
+
+  int success = (fwrite(&snapshot->header, sizeof(sram_snapshot_header), 1, snapshot_file) == 1) &&
+                (fwrite(snapshot->data, 1, size, snapshot_file) == size);
+
+  if(fclose(snapshot_file) != 0){
+    success = 0;
+  }/*if*/
+
+  if(!success){
+    perror("Failed to write snapshot");
+  }/*if*/
+
+  return success;
+}/*save_snapshot*/
+
+int load_snapshot(const char* path, sram_snapshot* snapshot){
+  FILE* snapshot_file = fopen(path, "rb");
+  if(snapshot_file == NULL){
+    perror(path);
+    return 0;
+  }/*if*/
+
+  int success = fread(&snapshot->header, sizeof(sram_snapshot_header), 1, snapshot_file) == 1;
+
+  if( success && ( (memcmp(snapshot->header.magic, SRAM_SNAPSHOT_MAGIC, sizeof(SRAM_SNAPSHOT_MAGIC)) != 0) ||
+                   (snapshot->header.version != SRAM_SNAPSHOT_VERSION) ||
+                   (snapshot->header.start_address >= snapshot->header.end_address) ||
+                   (snapshot->header.end_address > SRAM_ADDRESS_SPACE_SIZE) ) ){
+    printf("%s is not an SRAM snapshot of a supported version.\n", path);
+    success = 0;
+  }/*if*/
+
+  if(success){
+    unsigned int size = snapshot->header.end_address-snapshot->header.start_address;
+    success = fread(snapshot->data, 1, size, snapshot_file) == size;
+
+    if(!success){
+      printf("SRAM snapshot %s is truncated.\n", path);
+    }/*if*/
+  }/*if*/
+
+  fclose(snapshot_file);
+
+  return success;
+}/*load_snapshot*/
+
+/*
+ * Collects changed bytes into ranges.
+ */
+struct change_list{
+  sram_change*  changes;
+  unsigned int  max_changes;
+  unsigned int  number_of_changes;
+  unsigned int  merge_distance;
+  bool          open;
+  sram_change   current;
+};
+
+static void close_change(change_list* list){
+  if(list->open){
+    if(list->number_of_changes < list->max_changes){
+      list->changes[list->number_of_changes] = list->current;
+    }/*if*/
+
+    list->number_of_changes += 1;
+    list->open = false;
+  }/*if*/
+}/*close_change*/
+
+static void add_change(change_list* list, const unsigned int address){
+  if(list->open && (address <= list->current.end_address+list->merge_distance)){
+    list->current.end_address = address+1;
+    return;
+  }/*if*/
+
+  close_change(list);
+
+  list->open                  = true;
+  list->current.start_address = address;
+  list->current.end_address   = address+1;
+}/*add_change*/
+
+unsigned int diff_snapshots(const sram_snapshot* before, const sram_snapshot* after, sram_change* changes, const unsigned int max_changes, const unsigned int merge_distance){
+  unsigned int start_address  = before->header.start_address > after->header.start_address ? before->header.start_address : after->header.start_address;
+  unsigned int end_address    = before->header.end_address < after->header.end_address ? before->header.end_address : after->header.end_address;
+
+  change_list list;
+  list.changes            = changes;
+  list.max_changes        = max_changes;
+  list.number_of_changes  = 0;
+  list.merge_distance     = merge_distance;
+  list.open               = false;
+
+  if(start_address >= end_address){
+    return 0;
+  }/*if*/
+
+  const unsigned char*  a       = before->data+(start_address-before->header.start_address);
+  const unsigned char*  b       = after->data+(start_address-after->header.start_address);
+  unsigned int          size    = end_address-start_address;
+  unsigned int          offset  = 0;
+
+#ifdef __SSE2__
+  for(; offset+16 <= size; offset += 16){
+    __m128i       block_a = _mm_loadu_si128((const __m128i*)(a+offset));
+    __m128i       block_b = _mm_loadu_si128((const __m128i*)(b+offset));
+    unsigned int  changed = ~_mm_movemask_epi8(_mm_cmpeq_epi8(block_a, block_b)) & 0xFFFF;
+
+    while(changed != 0){
+      unsigned int byte = __builtin_ctz(changed);
+      add_change(&list, start_address+offset+byte);
+      changed &= changed-1;
+    }/*while*/
+  }/*for*/
+#else
+  /* Without SSE2, skip unchanged stretches a machine word at a time. */
+  for(; offset+sizeof(unsigned long) <= size; offset += sizeof(unsigned long)){
+    unsigned long word_a;
+    unsigned long word_b;
+
+    memcpy(&word_a, a+offset, sizeof(unsigned long));
+    memcpy(&word_b, b+offset, sizeof(unsigned long));
+
+    if(word_a != word_b){
+      for(unsigned int byte = 0; byte < sizeof(unsigned long); byte++){
+        if(a[offset+byte] != b[offset+byte]){
+          add_change(&list, start_address+offset+byte);
+        }/*if*/
+      }/*for*/
+    }/*if*/
+  }/*for*/
+#endif
+
+  for(; offset < size; offset++){
+    if(a[offset] != b[offset]){
+      add_change(&list, start_address+offset);
+    }/*if*/
+  }/*for*/
+
+  close_change(&list);
+
+  return list.number_of_changes;
+}/*diff_snapshots*/
+
+}
@@ -0,0 +1,66 @@
+/*
+ * Description:
+ *  Whole-RAM snapshots of a running Trionic 5 and the differences between them.
+ *
+ *  A snapshot is a contiguous SRAM range as it was read at one point in time.
+ *  On disk it is a small header followed by the raw bytes, so a snapshot can be
+ *  inspected with any hex editor.
+ *
+ *  Comparing two snapshots yields the list of address ranges which changed in
+ *  between, which shows every variable touched during an event without knowing
+ *  its name in advance. The comparison runs sixteen bytes at a time with SSE2
+ *  when it is available, since long stretches of RAM are typically unchanged.
+ */
+
+#ifndef _sram_snapshot_hpp_
+#define _sram_snapshot_hpp_
+
+#include "sram_response.hpp"
+
+namespace trionic5net{
+
+#define SRAM_SNAPSHOT_MAGIC     "T5SRAM"
+#define SRAM_SNAPSHOT_VERSION   1
+
+struct sram_snapshot_header{
+  char                magic[8];
+  unsigned int        version;
+  unsigned int        start_address;
+  unsigned int        end_address;
+  unsigned int        reserved;
+  unsigned long long  timestamp;
+};
+
+struct sram_snapshot{
+  sram_snapshot_header  header;
+  unsigned char         data[SRAM_ADDRESS_SPACE_SIZE];
+};
+
+struct sram_change{
+  unsigned int start_address;
+  unsigned int end_address;
+};
+
+/*
+ * Fills in a snapshot of [start_address, end_address) from a block of SRAM contents,
+ * where sram holds the complete address space, e.g. sram_mirror::get_data().
+ * Returns 0 on failure.
+ */
+int take_snapshot(sram_snapshot* snapshot, const unsigned char* sram, const unsigned int start_address, const unsigned int end_address, const unsigned long long timestamp);
+
+/*
+ * Returns 0 on failure.
+ */
+int save_snapshot(const char* path, const sram_snapshot* snapshot);
+int load_snapshot(const char* path, sram_snapshot* snapshot);
+
+/*
+ * Compares the ranges two snapshots have in common and stores at most max_changes changed ranges.
+ * Changes closer than merge_distance bytes to each other are merged into one range.
+ * Returns the number of changed ranges, which may exceed max_changes if the list was truncated.
+ */
+unsigned int diff_snapshots(const sram_snapshot* before, const sram_snapshot* after, sram_change* changes, const unsigned int max_changes, const unsigned int merge_distance);
+
+}
+
+#endif
@@ -0,0 +1,248 @@
+/*
+ * Description:
+ *   Implementation file for the symbol value cache.
+ */
+
+#include "symbol_cache.hpp"
+#include "timing/clock.h"
+
+#include <string.h>
+
+namespace trionic5net{
+
+symbol_cache::symbol_cache(sram_reader* given_reader, sram_mirror* given_mirror){
+  reader              = given_reader;
+  mirror              = given_mirror;
+  hits                = 0;
+  misses              = 0;
+  coalesced_requests  = 0;
+  bus_reads           = 0;
+
+  memset(reads, 0x0, sizeof(reads));
+  memset(waiters, 0x0, sizeof(waiters));
+
+  for(unsigned int i = 0; i < MAX_CACHE_READS; i++){
+    reads[i].cache = this;
+  }/*for*/
+}/*symbol_cache::symbol_cache*/
+
+symbol_cache::~symbol_cache(){
+
+}/*symbol_cache::~symbol_cache*/
+
+int symbol_cache::find_free_read(void) const{
+  for(unsigned int i = 0; i < MAX_CACHE_READS; i++){
+    if(!reads[i].active){
+      return i;
+    }/*if*/
+  }/*for*/
+
+  return -1;
+}/*symbol_cache::find_free_read*/
+
+int symbol_cache::find_free_waiter(void) const{
+  for(unsigned int i = 0; i < MAX_CACHE_WAITERS; i++){
+    if(!waiters[i].active){
+      return i;
+    }/*if*/
+  }/*for*/
+
+  return -1;
+}/*symbol_cache::find_free_waiter*/
+
+Symbol_Cache_Status symbol_cache::request(const unsigned int start_address, const unsigned int end_address, const unsigned long long max_age, symbol_cache_callback callback, void* context){
+  if( (start_address >= end_address) || (end_address > SRAM_ADDRESS_SPACE_SIZE) ){
+    return Symbol_Cache_Invalid;
+  }/*if*/
+
+  if(mirror->is_fresh(start_address, end_address, max_age, monotonic_microseconds())){
+    hits += 1;
+    return Symbol_Cache_Fresh;
+  }/*if*/
+
+  int waiter_index = find_free_waiter();
+  if(waiter_index < 0){
+    return Symbol_Cache_Full;
+  }/*if*/
+
+  /*
+   * Wait for every outstanding read overlapping the range, then find the gaps
+   * they leave. Outstanding reads are few, so the gaps are found by walking
+   * the range and skipping over whatever an outstanding read covers.
+   */
+  uint64_t      pending_reads = 0;
+  unsigned int  gap_starts[MAX_CACHE_READS];
+  unsigned int  gap_ends[MAX_CACHE_READS];
+  unsigned int  gaps          = 0;
+  unsigned int  free_reads    = 0;
+  unsigned int  address       = start_address;
+
+  for(unsigned int i = 0; i < MAX_CACHE_READS; i++){
+    if(!reads[i].active){
+      free_reads += 1;
+    }/*if*/
+    else if( (reads[i].start_address < end_address) && (reads[i].end_address > start_address) ){
+      pending_reads |= (uint64_t)1 << i;
+    }/*else if*/
+  }/*for*/
+
+  while(address < end_address){
+    bool covered = false;
+
+    for(unsigned int i = 0; i < MAX_CACHE_READS; i++){
+      if( (pending_reads & ((uint64_t)1 << i)) && (reads[i].start_address <= address) && (reads[i].end_address > address) ){
+        address = reads[i].end_address;
+        covered = true;
+        break;
+      }/*if*/
+    }/*for*/
+
+    if(covered){
+      continue;
+    }/*if*/
+
+    /* The gap runs until the next outstanding read starts, the range ends or a single read is full. */
+    unsigned int gap_end = end_address;
+
+    for(unsigned int i = 0; i < MAX_CACHE_READS; i++){
+      if( (pending_reads & ((uint64_t)1 << i)) && (reads[i].start_address > address) && (reads[i].start_address < gap_end) ){
+        gap_end = reads[i].start_address;
+      }/*if*/
+    }/*for*/
+
+    if(gap_end-address > SRAM_MAX_READ_SIZE){
+      gap_end = address+SRAM_MAX_READ_SIZE;
+    }/*if*/
+
+    if(gaps >= free_reads){
+      return Symbol_Cache_Full;
+    }/*if*/
+
+    gap_starts[gaps]  = address;
+    gap_ends[gaps]    = gap_end;
+    gaps              += 1;
+    address           = gap_end;
+  }/*while*/
+
+  if(reader->get_queued_reads()+gaps > SRAM_READER_QUEUE_SIZE){
+    return Symbol_Cache_Full;
+  }/*if*/
+
+  misses += 1;
+
+  if(gaps == 0){
+    coalesced_requests += 1;
+  }/*if*/
+
+  cache_waiter* waiter = &waiters[waiter_index];
+  waiter->start_address = start_address;
+  waiter->end_address   = end_address;
+  waiter->callback      = callback;
+  waiter->context       = context;
+  waiter->failed        = false;
+  waiter->active        = true;
+
+  /* Register the new reads before queueing any, so a read completing at once finds its waiter. */
+  cache_read* new_reads[MAX_CACHE_READS];
+
+  for(unsigned int gap = 0; gap < gaps; gap++){
+    int read_index = find_free_read();
+
+    new_reads[gap]                = &reads[read_index];
+    new_reads[gap]->start_address = gap_starts[gap];
+    new_reads[gap]->end_address   = gap_ends[gap];
+    new_reads[gap]->active        = true;
+
+    pending_reads |= (uint64_t)1 << read_index;
+  }/*for*/
+
+  waiter->pending_reads = pending_reads;
+
+  for(unsigned int gap = 0; gap < gaps; gap++){
+    bus_reads += 1;
+
+    if(!reader->queue_read(new_reads[gap]->start_address, new_reads[gap]->end_address, read_done, new_reads[gap])){
+      finish_read(new_reads[gap], false);
+    }/*if*/
+  }/*for*/
+
+  return Symbol_Cache_Pending;
+}/*symbol_cache::request*/
+
+Symbol_Cache_Status symbol_cache::request(const symbol* sym, const unsigned long long max_age, symbol_cache_callback callback, void* context){
+  if(sym == 0){
+    return Symbol_Cache_Invalid;
+  }/*if*/
+
+  return request(sym->address, sym->address+sym->length, max_age, callback, context);
+}/*symbol_cache::request*/
+
+void symbol_cache::read_done(void* context, const unsigned int /*start_address*/, const unsigned int /*end_address*/, const bool success){
+  cache_read* read = (cache_read*)context;
+
+  read->cache->finish_read(read, success);
+}/*symbol_cache::read_done*/
+
+void symbol_cache::finish_read(cache_read* read, const bool success){
+  uint64_t read_bit = (uint64_t)1 << (read-reads);
+
+  read->active = false;
+
+  for(unsigned int i = 0; i < MAX_CACHE_WAITERS; i++){
+    cache_waiter* waiter = &waiters[i];
+
+    if( !waiter->active || !(waiter->pending_reads & read_bit) ){
+      continue;
+    }/*if*/
+
+    waiter->pending_reads &= ~read_bit;
+    waiter->failed        |= !success;
+
+    if(waiter->pending_reads == 0){
+      /* Free the slot first - the callback may well ask for the next value. */
+      waiter->active = false;
+
+      if(waiter->callback != 0){
+        waiter->callback(waiter->context, waiter->start_address, waiter->end_address, !waiter->failed);
+      }/*if*/
+    }/*if*/
+  }/*for*/
+}/*symbol_cache::finish_read*/
+
+unsigned int symbol_cache::get_outstanding_reads(void) const{
+  unsigned int outstanding_reads = 0;
+
+  for(unsigned int i = 0; i < MAX_CACHE_READS; i++){
+    outstanding_reads += reads[i].active ? 1 : 0;
+  }/*for*/
+
+  return outstanding_reads;
+}/*symbol_cache::get_outstanding_reads*/
+
+unsigned int symbol_cache::get_waiters(void) const{
+  unsigned int active_waiters = 0;
+
+  for(unsigned int i = 0; i < MAX_CACHE_WAITERS; i++){
+    active_waiters += waiters[i].active ? 1 : 0;
+  }/*for*/
+
+  return active_waiters;
+}/*symbol_cache::get_waiters*/
+
+unsigned long long symbol_cache::get_hits(void) const{
+  return hits;
+}/*symbol_cache::get_hits*/
+
+unsigned long long symbol_cache::get_misses(void) const{
+  return misses;
+}/*symbol_cache::get_misses*/
+
+unsigned long long symbol_cache::get_coalesced_requests(void) const{
+  return coalesced_requests;
+}/*symbol_cache::get_coalesced_requests*/
+
+unsigned long long symbol_cache::get_bus_reads(void) const{
+  return bus_reads;
+}/*symbol_cache::get_bus_reads*/
+
+}
@@ -0,0 +1,108 @@
+/*
+ * Description:
+ *  A value cache in front of the Trionic 5 SRAM read path.
+ *
+ *  Every consumer asks for a range together with the oldest value it will
+ *  accept. Ranges which the mirror holds fresh enough are served at once,
+ *  without touching the bus. Otherwise the consumer is put on hold until the
+ *  range has been read.
+ *
+ *  Requests are coalesced: a range which overlaps reads that are already
+ *  outstanding only waits for those, and only the parts not covered by any
+ *  outstanding read go out on the bus. When a read completes, every consumer
+ *  waiting for it is told; a consumer is called back once all reads it
+ *  depends on have completed.
+ *
+ *  The cache sits on top of an sram_reader and never blocks; keep calling
+ *  sram_reader::poll() from the main loop.
+ */
+
+#ifndef _symbol_cache_hpp_
+#define _symbol_cache_hpp_
+
+#include "sram_reader.hpp"
+#include "sram_mirror.hpp"
+#include "symbol_table.hpp"
+
+#include <stdint.h>
+
+namespace trionic5net{
+
+/*
+ * Outstanding reads are tracked in a 64 bit mask per waiter, which bounds MAX_CACHE_READS.
+ */
+#define MAX_CACHE_READS     64
+#define MAX_CACHE_WAITERS   256
+
+typedef enum{
+  Symbol_Cache_Fresh    = 0,  /* The range is in the mirror and fresh enough - no callback follows. */
+  Symbol_Cache_Pending  = 1,  /* The range is being read - the callback follows once it is done.    */
+  Symbol_Cache_Full     = 2,  /* Too many outstanding reads or waiters - try again later.           */
+  Symbol_Cache_Invalid  = 3   /* The range is empty or outside SRAM.                                */
+}Symbol_Cache_Status;
+
+/*
+ * Called once every read a request waits for has completed.
+ * On success, the range is in the mirror.
+ */
+typedef void (*symbol_cache_callback)(void* context, const unsigned int start_address, const unsigned int end_address, const bool success);
+
+class symbol_cache;
+
+struct cache_read{
+  symbol_cache* cache;
+  unsigned int  start_address;
+  unsigned int  end_address;
+  bool          active;
+};
+
+struct cache_waiter{
+  unsigned int          start_address;
+  unsigned int          end_address;
+  symbol_cache_callback callback;
+  void*                 context;
+  uint64_t              pending_reads;
+  bool                  failed;
+  bool                  active;
+};
+
+class symbol_cache{
+  private:
+    sram_reader*        reader;
+    sram_mirror*        mirror;
+
+    cache_read          reads[MAX_CACHE_READS];
+    cache_waiter        waiters[MAX_CACHE_WAITERS];
+
+    unsigned long long  hits;
+    unsigned long long  misses;
+    unsigned long long  coalesced_requests;
+    unsigned long long  bus_reads;
+
+    int   find_free_read(void) const;
+    int   find_free_waiter(void) const;
+    void  finish_read(cache_read* read, const bool success);
+
+    static void read_done(void* context, const unsigned int start_address, const unsigned int end_address, const bool success);
+
+  public:
+    symbol_cache(sram_reader* reader, sram_mirror* mirror);
+    ~symbol_cache();
+
+    /*
+     * Asks for [start_address, end_address), accepting values at most max_age microseconds old.
+     */
+    Symbol_Cache_Status request(const unsigned int start_address, const unsigned int end_address, const unsigned long long max_age, symbol_cache_callback callback, void* context);
+    Symbol_Cache_Status request(const symbol* sym, const unsigned long long max_age, symbol_cache_callback callback, void* context);
+
+    unsigned int        get_outstanding_reads(void) const;
+    unsigned int        get_waiters(void) const;
+    unsigned long long  get_hits(void) const;
+    unsigned long long  get_misses(void) const;
+    unsigned long long  get_coalesced_requests(void) const;
+    unsigned long long  get_bus_reads(void) const;
+};
+
+}
+
+#endif
@@ -0,0 +1,550 @@
+/*
+ * Description:
+ *   Implementation file for the symbol database.
+ */
+
+#include "symbol_database.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace trionic5net{
+
+#define FNV_OFFSET_BASIS  0xcbf29ce484222325ULL
+#define FNV_PRIME         0x100000001b3ULL
+#define RECORD_ALIGNMENT  8
+
+uint64_t fingerprint(const unsigned char* data, const size_t size){
+  uint64_t hash = FNV_OFFSET_BASIS;
+
+  for(size_t i = 0; i < size; i++){
+    hash ^= data[i];
+    hash *= FNV_PRIME;
+  }/*for*/
+
+  return hash;
+}/*fingerprint*/
+
+uint64_t firmware_fingerprint(const unsigned char* image, const size_t image_size){
+  size_t footer_size = image_size < FIRMWARE_FOOTER_SIZE ? image_size : FIRMWARE_FOOTER_SIZE;
+
+  return fingerprint(image+image_size-footer_size, footer_size);
+}/*firmware_fingerprint*/
+
+static int compare_names(const char* a, const unsigned int a_length, const char* b, const unsigned int b_length){
+  int result = memcmp(a, b, a_length < b_length ? a_length : b_length);
+
+  if(result != 0){
+    return result;
+  }/*if*/
+
+  return (int)a_length - (int)b_length;
+}/*compare_names*/
+
+/*
+ * Compares a name against a prefix, treating names which start with the prefix as equal.
+ */
+static int compare_prefix(const char* name, const unsigned int name_length, const char* prefix, const unsigned int prefix_length){
+  if(name_length >= prefix_length){
+    return memcmp(name, prefix, prefix_length);
+  }/*if*/
+
+  return compare_names(name, name_length, prefix, prefix_length);
+}/*compare_prefix*/
+
+/*
+ * database_symbol_table
+ */
+
+database_symbol_table::database_symbol_table(){
+  record            = 0;
+  entries           = 0;
+  address_index     = 0;
+  number_of_symbols = 0;
+}/*database_symbol_table::database_symbol_table*/
+
+database_symbol_table::database_symbol_table(const unsigned char* given_record){
+  const symbol_database_record* record_header = (const symbol_database_record*)given_record;
+
+  record            = given_record;
+  number_of_symbols = record_header->number_of_symbols;
+  entries           = (const symbol_database_entry*)(record+sizeof(symbol_database_record));
+  address_index     = (const uint32_t*)(entries+number_of_symbols);
+}/*database_symbol_table::database_symbol_table*/
+
+bool database_symbol_table::is_valid(void) const{
+  return record != 0;
+}/*database_symbol_table::is_valid*/
+
+unsigned int database_symbol_table::get_number_of_symbols(void) const{
+  return number_of_symbols;
+}/*database_symbol_table::get_number_of_symbols*/
+
+symbol database_symbol_table::to_symbol(const symbol_database_entry* entry) const{
+  symbol result;
+
+  result.name         = (const char*)(record+entry->name_offset);
+  result.name_length  = entry->name_length;
+  result.address      = entry->address;
+  result.length       = entry->length;
+
+  return result;
+}/*database_symbol_table::to_symbol*/
+
+symbol database_symbol_table::get_symbol(const unsigned int index) const{
+  return to_symbol(&entries[index]);
+}/*database_symbol_table::get_symbol*/
+
+int database_symbol_table::find_prefix(const char* prefix, unsigned int* first, unsigned int* count) const{
+  if( (record == 0) || (prefix == 0) ){
+    return 0;
+  }/*if*/
+
+  unsigned int prefix_length  = strlen(prefix);
+  unsigned int low            = 0;
+  unsigned int high           = number_of_symbols;
+
+  while(low < high){
+    unsigned int middle = low+(high-low)/2;
+    const symbol_database_entry* entry = &entries[middle];
+
+    if(compare_prefix((const char*)(record+entry->name_offset), entry->name_length, prefix, prefix_length) < 0){
+      low = middle+1;
+    }/*if*/
+    else{
+      high = middle;
+    }/*else*/
+  }/*while*/
+
+  unsigned int range_start = low;
+  high = number_of_symbols;
+
+  while(low < high){
+    unsigned int middle = low+(high-low)/2;
+    const symbol_database_entry* entry = &entries[middle];
+
+    if(compare_prefix((const char*)(record+entry->name_offset), entry->name_length, prefix, prefix_length) <= 0){
+      low = middle+1;
+    }/*if*/
+    else{
+      high = middle;
+    }/*else*/
+  }/*while*/
+
+  *first  = range_start;
+  *count  = low-range_start;
+
+  return *count > 0;
+}/*database_symbol_table::find_prefix*/
+
+int database_symbol_table::find(const char* name, symbol* result) const{
+  unsigned int first;
+  unsigned int count;
+
+  if(!find_prefix(name, &first, &count)){
+    return 0;
+  }/*if*/
+
+  /* Names are sorted, so an exact match is the first name carrying the prefix. */
+  if(entries[first].name_length != strlen(name)){
+    return 0;
+  }/*if*/
+
+  *result = to_symbol(&entries[first]);
+
+  return 1;
+}/*database_symbol_table::find*/
+
+int database_symbol_table::find_by_address(const unsigned int address, symbol* result) const{
+  if(record == 0){
+    return 0;
+  }/*if*/
+
+  unsigned int low  = 0;
+  unsigned int high = number_of_symbols;
+
+  while(low < high){
+    unsigned int middle = low+(high-low)/2;
+
+    if(entries[address_index[middle]].address <= address){
+      low = middle+1;
+    }/*if*/
+    else{
+      high = middle;
+    }/*else*/
+  }/*while*/
+
+  while(low > 0){
+    low -= 1;
+
+    const symbol_database_entry* entry = &entries[address_index[low]];
+    if(address < entry->address+entry->length){
+      *result = to_symbol(entry);
+      return 1;
+    }/*if*/
+  }/*while*/
+
+  return 0;
+}/*database_symbol_table::find_by_address*/
+
+/*
+ * symbol_database
+ */
+
+symbol_database::symbol_database(){
+  database      = 0;
+  database_size = 0;
+  header        = 0;
+  buckets       = 0;
+}/*symbol_database::symbol_database*/
+
+symbol_database::~symbol_database(){
+  close();
+}/*symbol_database::~symbol_database*/
+
+int symbol_database::open(const char* path){
+  close();
+
+  int database_descriptor = ::open(path, O_RDONLY);
+  if(database_descriptor == -1){
+    perror("Could not open symbol database");
+    return 0;
+  }/*if*/
+
+  struct stat database_status;
+  if( (fstat(database_descriptor, &database_status) == -1) || (database_status.st_size < (off_t)sizeof(symbol_database_header)) ){
+    printf("Symbol database %s is truncated.\n", path);
+    ::close(database_descriptor);
+    return 0;
+  }/*if*/
+
+  void* mapped_database = mmap(0, database_status.st_size, PROT_READ, MAP_SHARED, database_descriptor, 0);
+  ::close(database_descriptor);
+
+  if(mapped_database == MAP_FAILED){
+    perror("Could not map symbol database");
+    return 0;
+  }/*if*/
+
+  database      = (const unsigned char*)mapped_database;
+  database_size = database_status.st_size;
+  header        = (const symbol_database_header*)database;
+  buckets       = (const symbol_database_bucket*)(database+sizeof(symbol_database_header));
+
+  /* The hash table is probed with a mask, so the bucket count must be a power of two. */
+  if( (memcmp(header->magic, SYMBOL_DATABASE_MAGIC, sizeof(SYMBOL_DATABASE_MAGIC)) != 0) ||
+      (header->version != SYMBOL_DATABASE_VERSION) ||
+      (header->number_of_buckets == 0) ||
+      ((header->number_of_buckets & (header->number_of_buckets-1)) != 0) ||
+      (header->number_of_buckets > (database_size-sizeof(symbol_database_header))/sizeof(symbol_database_bucket)) ){
+    printf("%s is not a symbol database of a supported version.\n", path);
+    close();
+    return 0;
+  }/*if*/
+
+  return 1;
+}/*symbol_database::open*/
+
+void symbol_database::close(void){
+  if(database != 0){
+    munmap((void*)database, database_size);
+  }/*if*/
+
+  database      = 0;
+  database_size = 0;
+  header        = 0;
+  buckets       = 0;
+}/*symbol_database::close*/
+
+unsigned int symbol_database::get_number_of_firmwares(void) const{
+  if(header == 0){
+    return 0;
+  }/*if*/
+
+  return header->number_of_firmwares;
+}/*symbol_database::get_number_of_firmwares*/
+
+/*
+ * Checks that a record, its entries, its address index and its names all lie within the database.
+ */
+bool symbol_database::is_record_valid(const uint64_t record_offset, const uint64_t key) const{
+  size_t records_start = sizeof(symbol_database_header)+header->number_of_buckets*sizeof(symbol_database_bucket);
+
+  if( (record_offset < records_start) || (record_offset%RECORD_ALIGNMENT != 0) ||
+      (record_offset > database_size-sizeof(symbol_database_record)) ){
+    return false;
+  }/*if*/
+
+  const symbol_database_record* record_header = (const symbol_database_record*)(database+record_offset);
+  uint64_t                      record_size   = record_header->record_size;
+  uint64_t                      names_offset  = sizeof(symbol_database_record)+
+                                                (uint64_t)record_header->number_of_symbols*(sizeof(symbol_database_entry)+sizeof(uint32_t));
+
+  if( (record_header->fingerprint != key) || (record_size > database_size-record_offset) || (names_offset > record_size) ){
+    return false;
+  }/*if*/
+
+  const symbol_database_entry*  entries       = (const symbol_database_entry*)(record_header+1);
+  const uint32_t*               address_index = (const uint32_t*)(entries+record_header->number_of_symbols);
+
+  for(uint32_t i = 0; i < record_header->number_of_symbols; i++){
+    if( (entries[i].name_offset < names_offset) || ((uint64_t)entries[i].name_offset+entries[i].name_length > record_size) ||
+        (address_index[i] >= record_header->number_of_symbols) ){
+      return false;
+    }/*if*/
+  }/*for*/
+
+  return true;
+}/*symbol_database::is_record_valid*/
+
+database_symbol_table symbol_database::find(const uint64_t key) const{
+  if(header == 0){
+    return database_symbol_table();
+  }/*if*/
+
+  uint32_t bucket_mask = header->number_of_buckets-1;
+
+  for(uint32_t probe = 0; probe < header->number_of_buckets; probe++){
+    const symbol_database_bucket* bucket = &buckets[(key+probe) & bucket_mask];
+
+    if(bucket->record_offset == 0){
+      break;
+    }/*if*/
+
+    if(bucket->fingerprint == key){
+      if(!is_record_valid(bucket->record_offset, key)){
+        break;
+      }/*if*/
+
+      return database_symbol_table(database+bucket->record_offset);
+    }/*if*/
+  }/*for*/
+
+  return database_symbol_table();
+}/*symbol_database::find*/
+
+/*
+ * symbol_database_writer
+ */
+
+static int compare_symbols_by_name(const void* a, const void* b){
+  const symbol* x = *(const symbol* const*)a;
+  const symbol* y = *(const symbol* const*)b;
+
+  return compare_names(x->name, x->name_length, y->name, y->name_length);
+}/*compare_symbols_by_name*/
+
+static const symbol_database_entry* sorting_entries = 0;
+
+static int compare_entries_by_address(const void* a, const void* b){
+  const symbol_database_entry* x = &sorting_entries[*(const uint32_t*)a];
+  const symbol_database_entry* y = &sorting_entries[*(const uint32_t*)b];
+
+  if(x->address != y->address){
+    return (x->address < y->address) ? -1 : 1;
+  }/*if*/
+
+  return (*(const uint32_t*)a < *(const uint32_t*)b) ? -1 : 1;
+}/*compare_entries_by_address*/
+
+symbol_database_writer::symbol_database_writer(){
+  records             = 0;
+  records_size        = 0;
+  records_capacity    = 0;
+  number_of_firmwares = 0;
+}/*symbol_database_writer::symbol_database_writer*/
+
+symbol_database_writer::~symbol_database_writer(){
+  free(records);
+}/*symbol_database_writer::~symbol_database_writer*/
+
+int symbol_database_writer::reserve(const size_t size){
+  if(records_size+size <= records_capacity){
+    return 1;
+  }/*if*/
+
+  size_t new_capacity = records_capacity ? records_capacity : 64*1024;
+  while(new_capacity < records_size+size){
+    new_capacity *= 2;
+  }/*while*/
+
+  unsigned char* new_records = (unsigned char*)realloc(records, new_capacity);
+  if(new_records == 0){
+    perror("Could not grow symbol database");
+    return 0;
+  }/*if*/
+
+  records           = new_records;
+  records_capacity  = new_capacity;
+
+  return 1;
+}/*symbol_database_writer::reserve*/
+
+int symbol_database_writer::build_record(const uint64_t key, const symbol_table* table, unsigned char** record, size_t* record_size){
+  if( (table == 0) || (record == 0) || (record_size == 0) ){
+    return 0;
+  }/*if*/
+
+  unsigned int number_of_symbols = table->get_number_of_symbols();
+
+  size_t names_size = 0;
+  for(unsigned int i = 0; i < number_of_symbols; i++){
+    names_size += table->get_symbol(i)->name_length;
+  }/*for*/
+
+  size_t names_offset = sizeof(symbol_database_record)+number_of_symbols*(sizeof(symbol_database_entry)+sizeof(uint32_t));
+  size_t size         = (names_offset+names_size+RECORD_ALIGNMENT-1) & ~(size_t)(RECORD_ALIGNMENT-1);
+
+  const symbol** by_name = (const symbol**)malloc(number_of_symbols*sizeof(const symbol*));
+  if( (by_name == 0) && (number_of_symbols > 0) ){
+    return 0;
+  }/*if*/
+
+  unsigned char* new_record = (unsigned char*)calloc(1, size);
+  if(new_record == 0){
+    perror("Could not build symbol database record");
+    free(by_name);
+    return 0;
+  }/*if*/
+
+  for(unsigned int i = 0; i < number_of_symbols; i++){
+    by_name[i] = table->get_symbol(i);
+  }/*for*/
+
+  qsort(by_name, number_of_symbols, sizeof(const symbol*), compare_symbols_by_name);
+
+  symbol_database_record* record_header   = (symbol_database_record*)new_record;
+  symbol_database_entry*  entries         = (symbol_database_entry*)(new_record+sizeof(symbol_database_record));
+  uint32_t*               address_index   = (uint32_t*)(entries+number_of_symbols);
+  size_t                  name_offset     = names_offset;
+
+  record_header->fingerprint        = key;
+  record_header->number_of_symbols  = number_of_symbols;
+  record_header->record_size        = size;
+
+  for(unsigned int i = 0; i < number_of_symbols; i++){
+    entries[i].name_offset  = name_offset;
+    entries[i].name_length  = by_name[i]->name_length;
+    entries[i].address      = by_name[i]->address;
+    entries[i].length       = by_name[i]->length;
+    address_index[i]        = i;
+
+    memcpy(new_record+name_offset, by_name[i]->name, by_name[i]->name_length);
+    name_offset += by_name[i]->name_length;
+  }/*for*/
+
+  free(by_name);
+
+  sorting_entries = entries;
+  qsort(address_index, number_of_symbols, sizeof(uint32_t), compare_entries_by_address);
+  sorting_entries = 0;
+
+  *record       = new_record;
+  *record_size  = size;
+
+  return 1;
+}/*symbol_database_writer::build_record*/
+
+int symbol_database_writer::add_record(const unsigned char* record, const size_t record_size){
+  if( (record == 0) || (record_size < sizeof(symbol_database_record)) || (number_of_firmwares >= MAX_DATABASE_FIRMWARES) ){
+    return 0;
+  }/*if*/
+
+  uint64_t key = ((const symbol_database_record*)record)->fingerprint;
+
+  for(unsigned int i = 0; i < number_of_firmwares; i++){
+    if(fingerprints[i] == key){
+      return 1;
+    }/*if*/
+  }/*for*/
+
+  if(reserve(record_size) == 0){
+    return 0;
+  }/*if*/
+
+  memcpy(records+records_size, record, record_size);
+
+  fingerprints[number_of_firmwares]   = key;
+  record_offsets[number_of_firmwares] = records_size;
+  number_of_firmwares += 1;
+  records_size        += record_size;
+
+  return 1;
+}/*symbol_database_writer::add_record*/
+
+int symbol_database_writer::add(const uint64_t key, const symbol_table* table){
+  unsigned char*  record;
+  size_t          record_size;
+
+  if(build_record(key, table, &record, &record_size) == 0){
+    return 0;
+  }/*if*/
+
+  int success = add_record(record, record_size);
+  free(record);
+
+  return success;
+}/*symbol_database_writer::add*/
+
+int symbol_database_writer::write(const char* path){
+  uint32_t number_of_buckets = 16;
+  while(number_of_buckets < 2*number_of_firmwares){
+    number_of_buckets *= 2;
+  }/*while*/
+
+  symbol_database_bucket* buckets = (symbol_database_bucket*)calloc(number_of_buckets, sizeof(symbol_database_bucket));
+  if(buckets == 0){
+    return 0;
+  }/*if*/
+
+  size_t records_start = sizeof(symbol_database_header)+number_of_buckets*sizeof(symbol_database_bucket);
+
+  for(unsigned int i = 0; i < number_of_firmwares; i++){
+    uint32_t slot = fingerprints[i] & (number_of_buckets-1);
+
+    while(buckets[slot].record_offset != 0){
+      slot = (slot+1) & (number_of_buckets-1);
+    }/*while*/
+
+    buckets[slot].fingerprint   = fingerprints[i];
+    buckets[slot].record_offset = records_start+record_offsets[i];
+  }/*for*/
+
+  symbol_database_header header;
+  memset(&header, 0x0, sizeof(header));
+  memcpy(header.magic, SYMBOL_DATABASE_MAGIC, sizeof(SYMBOL_DATABASE_MAGIC));
+  header.version              = SYMBOL_DATABASE_VERSION;
+  header.number_of_firmwares  = number_of_firmwares;
+  header.number_of_buckets    = number_of_buckets;
+
+  int success = 0;
+  FILE* database = fopen(path, "wb");
+
+  if(database == NULL){
+    perror(path);
+  }/*if*/
+  else{
+    success = (fwrite(&header, sizeof(header), 1, database) == 1) &&
+              (fwrite(buckets, sizeof(symbol_database_bucket), number_of_buckets, database) == number_of_buckets) &&
+              (fwrite(records, 1, records_size, database) == records_size);
+
+    if(fclose(database) != 0){
+      success = 0;
+    }/*if*/
+
+    if(!success){
+      perror("Failed to write symbol database");
+    }/*if*/
+  }/*else*/
+
+  free(buckets);
+
+  return success;
+}/*symbol_database_writer::write*/
+
+}
@@ -0,0 +1,206 @@
+/*
+ * Description:
+ *  A compact on-disk collection of Trionic 5 symbol tables, keyed by firmware fingerprint.
+ *
+ *  Parsing the firmware of every car we connect to is wasteful, since the same
+ *  handful of firmware versions show up over and over again. A symbol_database
+ *  holds the symbol tables of any number of firmware images in one file, laid
+ *  out so that the file may be memory-mapped and used as is:
+ *
+ *    header
+ *    fingerprint hash table  (open addressing, one slot per bucket)
+ *    per firmware:
+ *      record header
+ *      symbol entries        (sorted by name, for prefix queries)
+ *      address index         (entry numbers sorted by address)
+ *      symbol names
+ *
+ *  Opening a database is a single mmap, finding the table of a firmware is a
+ *  hash lookup, and nothing is parsed or copied at connect time.
+ *
+ *  The fingerprint is a 64 bit FNV-1a hash of identification bytes - by default
+ *  the footer at the end of the image, which holds part number and software version.
+ *  It is computed from a firmware image; the footer is in flash, which the ECU
+ *  only hands out through the bootloader (see flash_dumper.hpp).
+ *
+ *  The file is checked against its own size as it is used, so a truncated or
+ *  corrupt database yields no tables rather than reads past the mapping.
+ *
+ *  All values are stored in host byte order; the file is a local cache, not an exchange format.
+ */
+
+#ifndef _symbol_database_hpp_
+#define _symbol_database_hpp_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "symbol_table.hpp"
+
+namespace trionic5net{
+
+#define SYMBOL_DATABASE_MAGIC         "T5SYMDB"
+#define SYMBOL_DATABASE_VERSION       1
+#define MAX_DATABASE_FIRMWARES        4096
+#define FIRMWARE_FOOTER_SIZE          0x80
+
+struct symbol_database_header{
+  char      magic[8];
+  uint32_t  version;
+  uint32_t  number_of_firmwares;
+  uint32_t  number_of_buckets;
+  uint32_t  reserved;
+};
+
+struct symbol_database_bucket{
+  uint64_t  fingerprint;
+  uint64_t  record_offset;      /* 0 marks an empty bucket. */
+};
+
+struct symbol_database_record{
+  uint64_t  fingerprint;
+  uint32_t  number_of_symbols;
+  uint32_t  record_size;
+};
+
+struct symbol_database_entry{
+  uint32_t  name_offset;        /* Relative to the start of the record. */
+  uint16_t  name_length;
+  uint16_t  reserved;
+  uint32_t  address;
+  uint32_t  length;
+};
+
+/*
+ * Hashes identification bytes into a database key.
+ */
+uint64_t fingerprint(const unsigned char* data, const size_t size);
+
+/*
+ * Computes the key of a firmware image from its footer.
+ */
+uint64_t firmware_fingerprint(const unsigned char* image, const size_t image_size);
+
+/*
+ * The symbol table of one firmware, as stored in a database.
+ * This is a view into the mapped database and is valid as long as the database stays open.
+ */
+class database_symbol_table{
+  private:
+    const unsigned char*          record;
+    const symbol_database_entry*  entries;
+    const uint32_t*               address_index;
+    unsigned int                  number_of_symbols;
+
+    symbol to_symbol(const symbol_database_entry* entry) const;
+
+  public:
+    database_symbol_table();
+    database_symbol_table(const unsigned char* record);
+
+    bool          is_valid(void) const;
+    unsigned int  get_number_of_symbols(void) const;
+
+    /*
+     * Symbols in name order. The names point into the database and are not null-terminated.
+     */
+    symbol        get_symbol(const unsigned int index) const;
+
+    /*
+     * Finds all symbols whose names start with prefix in O(log n).
+     * On return, [*first, *first+*count) is the matching range of get_symbol() indices.
+     * Returns 0 if there is no match.
+     */
+    int           find_prefix(const char* prefix, unsigned int* first, unsigned int* count) const;
+
+    /*
+     * Finds a symbol by its full name.
+     * Returns 0 if there is no such symbol.
+     */
+    int           find(const char* name, symbol* result) const;
+
+    /*
+     * Finds the symbol which holds the given SRAM address.
+     * Returns 0 if no symbol covers the address.
+     */
+    int           find_by_address(const unsigned int address, symbol* result) const;
+};
+
+class symbol_database{
+  private:
+    const unsigned char*            database;
+    size_t                          database_size;
+    const symbol_database_header*   header;
+    const symbol_database_bucket*   buckets;
+
+    bool is_record_valid(const uint64_t record_offset, const uint64_t key) const;
+
+  public:
+    symbol_database();
+    ~symbol_database();
+
+    /*
+     * Maps a database file.
+     * Returns 0 on failure.
+     */
+    int open(const char* path);
+    void close(void);
+
+    unsigned int get_number_of_firmwares(void) const;
+
+    /*
+     * Looks up the symbol table of a firmware in O(1), then checks the table's
+     * offsets against the database once, in O(number of symbols).
+     * The returned table is invalid if the fingerprint is unknown or its table is corrupt.
+     */
+    database_symbol_table find(const uint64_t fingerprint) const;
+};
+
+/*
+ * Collects symbol tables and writes them out as a database.
+ */
+class symbol_database_writer{
+  private:
+    unsigned char*  records;
+    size_t          records_size;
+    size_t          records_capacity;
+
+    uint64_t        fingerprints[MAX_DATABASE_FIRMWARES];
+    size_t          record_offsets[MAX_DATABASE_FIRMWARES];
+    unsigned int    number_of_firmwares;
+
+    int reserve(const size_t size);
+
+  public:
+    symbol_database_writer();
+    ~symbol_database_writer();
+
+    /*
+     * Adds the symbols of one firmware. Adding a fingerprint twice keeps the first table.
+     * Returns 0 on failure.
+     */
+    int add(const uint64_t fingerprint, const symbol_table* table);
+
+    /*
+     * Builds the record of one firmware into a buffer from malloc, which the caller frees,
+     * so that records built in any order can be added in a fixed one with add_record.
+     * Not reentrant. Returns 0 on failure.
+     */
+    static int build_record(const uint64_t fingerprint, const symbol_table* table, unsigned char** record, size_t* record_size);
+
+    /*
+     * Adds a record from build_record. As with add, a fingerprint added before keeps its table.
+     * Returns 0 on failure.
+     */
+    int add_record(const unsigned char* record, const size_t record_size);
+
+    /*
+     * Writes all added tables to a database file.
+     * Returns 0 on failure.
+     */
+    int write(const char* path);
+};
+
+}
+
+#endif
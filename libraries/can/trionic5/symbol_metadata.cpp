@@ -0,0 +1,132 @@
+/*
+ * Description:
+ *   Implementation file for the Trionic 5 symbol metadata.
+ */
+
+#include "symbol_metadata.hpp"
+#include "sram_response.hpp"
+
+#include <string.h>
+
+namespace trionic5net{
+
+const symbol_metadata* find_symbol_metadata(const char* name){
+  if(name == 0){
+    return 0;
+  }/*if*/
+
+  return find_symbol_metadata(name, strlen(name));
+}/*find_symbol_metadata*/
+
+const symbol_metadata* find_symbol_metadata(const char* name, const unsigned int name_length){
+  unsigned int low  = 0;
+  unsigned int high = NUMBER_OF_SYMBOL_METADATA;
+
+  if(name == 0){
+    return 0;
+  }/*if*/
+
+  while(low < high){
+    unsigned int  middle  = (low+high)/2;
+    const char*   entry   = trionic5_symbol_metadata[middle].name;
+    int           result  = strncmp(entry, name, name_length);
+
+    if( (result == 0) && (entry[name_length] != '\0') ){
+      result = 1;
+    }/*if*/
+
+    if(result == 0){
+      return &trionic5_symbol_metadata[middle];
+    }/*if*/
+
+    if(result < 0){
+      low = middle+1;
+    }/*if*/
+    else{
+      high = middle;
+    }/*else*/
+  }/*while*/
+
+  return 0;
+}/*find_symbol_metadata*/
+
+int prepare_conversion(symbol_conversion* conversion, const symbol* sym, const symbol_metadata* metadata){
+  if( (conversion == 0) || (sym == 0) ){
+    return 0;
+  }/*if*/
+
+  unsigned int  size    = sym->length;
+  bool          sign    = false;
+  bool          little  = false;
+
+  conversion->scale   = 1.0f;
+  conversion->offset  = 0.0f;
+  conversion->unit    = Counts;
+
+  if(metadata != 0){
+    size                = encapsulation_size(metadata->encapsulation);
+    sign                = encapsulation_is_signed(metadata->encapsulation);
+    little              = metadata->byte_order == Symbol_Little_Endian;
+    conversion->scale   = metadata->scale;
+    conversion->offset  = metadata->offset;
+    conversion->unit    = metadata->unit;
+
+    if(size != sym->length){
+      return 0;
+    }/*if*/
+  }/*if*/
+
+  if( (size < 1) || (size > 4) ){
+    return 0;
+  }/*if*/
+
+  conversion->address     = sym->address;
+  conversion->first_byte  = little ? size-1 : 0;
+  conversion->byte_step   = little ? -1 : 1;
+  conversion->shift       = 32-8*size;
+  conversion->sign_bit    = sign ? 1u << (8*size-1) : 0;
+
+  return 1;
+}/*prepare_conversion*/
+
+float convert_symbol(const unsigned char* sram, const symbol_conversion* conversion){
+  const unsigned int  mask    = SRAM_ADDRESS_SPACE_SIZE-1;
+  unsigned int        address = conversion->address+conversion->first_byte;
+  int                 step    = conversion->byte_step;
+
+  /*
+   * Always load four bytes and shift the surplus out; the address wraps around
+   * so the loads stay inside SRAM. Bytes past the symbol are shifted out again.
+   */
+  unsigned int raw = ((unsigned int)sram[address & mask] << 24) |
+                     ((unsigned int)sram[(address+step) & mask] << 16) |
+                     ((unsigned int)sram[(address+2*step) & mask] << 8) |
+                     ((unsigned int)sram[(address+3*step) & mask]);
+
+  raw >>= conversion->shift;
+
+  /* Sign extension without a branch: a sign_bit of 0 leaves unsigned values alone. */
+  long long value = (long long)(raw ^ conversion->sign_bit) - (long long)conversion->sign_bit;
+
+  return (float)value*conversion->scale + conversion->offset;
+}/*convert_symbol*/
+
+void convert_symbols(const unsigned char* sram, const symbol_conversion* conversions, const unsigned int number_of_conversions, float* values){
+  for(unsigned int i = 0; i < number_of_conversions; i++){
+    values[i] = convert_symbol(sram, &conversions[i]);
+  }/*for*/
+}/*convert_symbols*/
+
+float convert_raw(const symbol_metadata* metadata, const unsigned int raw){
+  if( (metadata == 0) || (encapsulation_size(metadata->encapsulation) == 0) ){
+    return 0.0f;
+  }/*if*/
+
+  unsigned int size     = encapsulation_size(metadata->encapsulation);
+  unsigned int sign_bit = encapsulation_is_signed(metadata->encapsulation) ? 1u << (8*size-1) : 0;
+  unsigned int bits     = raw & (size >= 4 ? 0xFFFFFFFFu : (1u << (8*size))-1);
+
+  return (float)((long long)(bits ^ sign_bit) - (long long)sign_bit)*metadata->scale + metadata->offset;
+}/*convert_raw*/
+
+}
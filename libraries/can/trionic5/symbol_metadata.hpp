@@ -0,0 +1,160 @@
+/*
+ * Description:
+ *  Engineering metadata for Trionic 5 symbols.
+ *
+ *  The symbol table only tells where a symbol lives and how many bytes it
+ *  spans. The table below adds what is needed to turn those bytes into a
+ *  physical value: the integer type, the byte order, a linear scale and offset
+ *  and the unit, using the data_encapsulation and data_unit enums of the data
+ *  distribution areas so the values can be published without translation.
+ *
+ *      value = raw*scale + offset
+ *
+ *  The table is compiled in and sorted by name, which is checked at compile time.
+ *
+ *  Converting is table driven as well. prepare_conversion() reduces a symbol and
+ *  its metadata to a handful of constants (where to load from, how far to shift,
+ *  how to sign extend), after which every conversion is the same sequence of
+ *  loads, shifts and multiply-adds without any branch on the type, so a whole
+ *  batch of symbols is converted in one tight loop.
+ */
+
+#ifndef _symbol_metadata_hpp_
+#define _symbol_metadata_hpp_
+
+#include "symbol_table.hpp"
+#include "data_distribution/distribution_areas.h"
+
+namespace trionic5net{
+
+typedef enum{
+  Symbol_Big_Endian     = 0,
+  Symbol_Little_Endian  = 1
+}Symbol_Byte_Order;
+
+struct symbol_metadata{
+  const char*         name;
+  data_encapsulation  encapsulation;
+  Symbol_Byte_Order   byte_order;
+  float               scale;
+  float               offset;
+  data_unit           unit;
+};
+
+/*
+ * Trionic 5 runs on a 68332, so everything is big-endian.
+ * ADC readings span 0-5 V over 8 bits; angles are in tenths of a degree.
+ */
+constexpr symbol_metadata trionic5_symbol_metadata[] = {
+  {"AD_EGR",            UInt8_Type,   Symbol_Big_Endian,  5.0f/255.0f,  0.0f, Volt},
+  {"AD_sond",           UInt8_Type,   Symbol_Big_Endian,  5.0f/255.0f,  0.0f, Volt},
+  {"AD_trot",           UInt8_Type,   Symbol_Big_Endian,  5.0f/255.0f,  0.0f, Volt},
+  {"Batt_volt",         UInt8_Type,   Symbol_Big_Endian,  0.1f,         0.0f, Volt},
+  {"Bil_hast",          UInt8_Type,   Symbol_Big_Endian,  1.0f/3.6f,    0.0f, Metres_Per_Second},
+  {"Gear",              UInt8_Type,   Symbol_Big_Endian,  1.0f,         0.0f, Counts},
+  {"Ign_angle",         Int16_Type,   Symbol_Big_Endian,  0.1f,         0.0f, Degrees},
+  {"Ign_offset",        Int16_Type,   Symbol_Big_Endian,  0.1f,         0.0f, Degrees},
+  {"Insp_tid",          UInt16_Type,  Symbol_Big_Endian,  0.001f,       0.0f, Milliseconds},
+  {"Insptid_ms10",      UInt16_Type,  Symbol_Big_Endian,  0.1f,         0.0f, Milliseconds},
+  {"Knock_average",     UInt16_Type,  Symbol_Big_Endian,  1.0f,         0.0f, Counts},
+  {"Knock_count_cyl1",  UInt16_Type,  Symbol_Big_Endian,  1.0f,         0.0f, Counts},
+  {"Knock_count_cyl2",  UInt16_Type,  Symbol_Big_Endian,  1.0f,         0.0f, Counts},
+  {"Knock_count_cyl3",  UInt16_Type,  Symbol_Big_Endian,  1.0f,         0.0f, Counts},
+  {"Knock_count_cyl4",  UInt16_Type,  Symbol_Big_Endian,  1.0f,         0.0f, Counts},
+  {"Knock_offset1",     Int16_Type,   Symbol_Big_Endian,  0.1f,         0.0f, Degrees},
+  {"Knock_offset1234",  Int16_Type,   Symbol_Big_Endian,  0.1f,         0.0f, Degrees},
+  {"Knock_offset2",     Int16_Type,   Symbol_Big_Endian,  0.1f,         0.0f, Degrees},
+  {"Knock_offset3",     Int16_Type,   Symbol_Big_Endian,  0.1f,         0.0f, Degrees},
+  {"Knock_offset4",     Int16_Type,   Symbol_Big_Endian,  0.1f,         0.0f, Degrees},
+  {"Knock_status",      UInt8_Type,   Symbol_Big_Endian,  1.0f,         0.0f, Counts},
+  {"Kyl_temp",          Int8_Type,    Symbol_Big_Endian,  1.0f,         0.0f, Centigrade},
+  {"Last",              UInt8_Type,   Symbol_Big_Endian,  1.0f,         0.0f, Counts},
+  {"Lufttemp",          Int8_Type,    Symbol_Big_Endian,  1.0f,         0.0f, Centigrade},
+  {"Max_tryck",         UInt8_Type,   Symbol_Big_Endian,  1.0f,         0.0f, Kilopascals},
+  {"Medeltrot",         UInt8_Type,   Symbol_Big_Endian,  100.0f/255.0f, 0.0f, Percent},
+  {"Mis1000_1",         UInt16_Type,  Symbol_Big_Endian,  1.0f,         0.0f, Counts},
+  {"Mis1000_2",         UInt16_Type,  Symbol_Big_Endian,  1.0f,         0.0f, Counts},
+  {"Mis1000_3",         UInt16_Type,  Symbol_Big_Endian,  1.0f,         0.0f, Counts},
+  {"Mis1000_4",         UInt16_Type,  Symbol_Big_Endian,  1.0f,         0.0f, Counts},
+  {"Mis200_1",          UInt16_Type,  Symbol_Big_Endian,  1.0f,         0.0f, Counts},
+  {"Mis200_2",          UInt16_Type,  Symbol_Big_Endian,  1.0f,         0.0f, Counts},
+  {"Mis200_3",          UInt16_Type,  Symbol_Big_Endian,  1.0f,         0.0f, Counts},
+  {"Mis200_4",          UInt16_Type,  Symbol_Big_Endian,  1.0f,         0.0f, Counts},
+  {"P_medel",           UInt8_Type,   Symbol_Big_Endian,  1.0f,         0.0f, Kilopascals},
+  {"Regl_tryck",        UInt8_Type,   Symbol_Big_Endian,  1.0f,         0.0f, Kilopascals},
+  {"Rpm",               UInt16_Type,  Symbol_Big_Endian,  1.0f,         0.0f, Revolutions_Per_Minute}
+};
+
+constexpr unsigned int NUMBER_OF_SYMBOL_METADATA = sizeof(trionic5_symbol_metadata)/sizeof(symbol_metadata);
+
+constexpr int compare_metadata_names(const char* a, const char* b){
+  return (*a != *b) ? ((unsigned char)*a < (unsigned char)*b ? -1 : 1) : (*a == '\0' ? 0 : compare_metadata_names(a+1, b+1));
+}
+
+constexpr bool metadata_is_sorted(const unsigned int i){
+  return (i+1 >= NUMBER_OF_SYMBOL_METADATA) ||
+         ( (compare_metadata_names(trionic5_symbol_metadata[i].name, trionic5_symbol_metadata[i+1].name) < 0) && metadata_is_sorted(i+1) );
+}
+
+static_assert(metadata_is_sorted(0), "trionic5_symbol_metadata must be sorted by name");
+
+/*
+ * The size in bytes and signedness of an integer encapsulation.
+ * The real types are not used for SRAM symbols and yield 0 / false.
+ */
+constexpr unsigned int encapsulation_size(const data_encapsulation encapsulation){
+  return (encapsulation == Int8_Type   || encapsulation == UInt8_Type)  ? 1 :
+         (encapsulation == Int16_Type  || encapsulation == UInt16_Type) ? 2 :
+         (encapsulation == Int32_Type  || encapsulation == UInt32_Type) ? 4 : 0;
+}
+
+constexpr bool encapsulation_is_signed(const data_encapsulation encapsulation){
+  return (encapsulation == Int8_Type) || (encapsulation == Int16_Type) || (encapsulation == Int32_Type);
+}
+
+/*
+ * Looks up the metadata of a symbol by name.
+ * Returns 0 if the symbol has none.
+ */
+const symbol_metadata* find_symbol_metadata(const char* name);
+const symbol_metadata* find_symbol_metadata(const char* name, const unsigned int name_length);
+
+/*
+ * A symbol and its metadata reduced to the constants used by the conversion.
+ * Bytes are loaded from (address+first_byte+byte_step*i) & 0xFFFF for i = 0..3 into a
+ * big-endian word, which is shifted right by shift and sign extended through sign_bit.
+ */
+struct symbol_conversion{
+  unsigned int  address;
+  int           first_byte;
+  int           byte_step;
+  unsigned int  shift;
+  unsigned int  sign_bit;
+  float         scale;
+  float         offset;
+  data_unit     unit;
+};
+
+/*
+ * Prepares the conversion of a symbol. Without metadata, the symbol is treated
+ * as an unsigned big-endian count.
+ * Returns 0 if the symbol does not match its metadata or is wider than 4 bytes.
+ */
+int prepare_conversion(symbol_conversion* conversion, const symbol* sym, const symbol_metadata* metadata);
+
+/*
+ * Converts the symbols described by conversions from a complete SRAM image,
+ * e.g. sram_mirror::get_data(), and stores the engineering values in values.
+ */
+void convert_symbols(const unsigned char* sram, const symbol_conversion* conversions, const unsigned int number_of_conversions, float* values);
+
+float convert_symbol(const unsigned char* sram, const symbol_conversion* conversion);
+
+/*
+ * Converts a raw value which has already been extracted from SRAM.
+ */
+float convert_raw(const symbol_metadata* metadata, const unsigned int raw);
+
+}
+
+#endif
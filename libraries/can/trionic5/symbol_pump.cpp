@@ -0,0 +1,168 @@
+/*
+ * Description:
+ *   Implementation file for the kernel driven symbol pump.
+ */
+
+#include "symbol_pump.hpp"
+#include "timing/clock.h"
+
+namespace trionic5net{
+
+symbol_pump::symbol_pump(sram_mirror* given_mirror){
+  mirror              = given_mirror;
+  number_of_requests  = 0;
+  pumping             = false;
+  completed_reads     = 0;
+  failed_reads        = 0;
+
+  memset(requests, 0x0, sizeof(requests));
+}/*symbol_pump::symbol_pump*/
+
+symbol_pump::~symbol_pump(){
+  stop();
+}/*symbol_pump::~symbol_pump*/
+
+int symbol_pump::add(const unsigned int start_address, const unsigned int end_address){
+  if( pumping || (number_of_requests >= MAX_PUMPED_READS) ){
+    return 0;
+  }/*if*/
+
+  if( (start_address >= end_address) || (end_address > SRAM_ADDRESS_SPACE_SIZE) ){
+    return 0;
+  }/*if*/
+
+  build_sram_read_request(&requests[number_of_requests], start_address, end_address);
+  number_of_requests += 1;
+
+  return 1;
+}/*symbol_pump::add*/
+
+int symbol_pump::add(const symbol* sym){
+  if(sym == 0){
+    return 0;
+  }/*if*/
+
+  return add(sym->address, sym->address+sym->length);
+}/*symbol_pump::add*/
+
+void symbol_pump::clear(void){
+  if(!pumping){
+    number_of_requests = 0;
+  }/*if*/
+}/*symbol_pump::clear*/
+
+int symbol_pump::start(const char* interface_name, struct timeval interval){
+  if( pumping || (interface_name == 0) || (number_of_requests == 0) ){
+    return 0;
+  }/*if*/
+
+  harvest_bus.set_name(strlen(interface_name)+1, interface_name);
+  if(harvest_bus.open() < 0){
+    return 0;
+  }/*if*/
+
+  /* Requests are harvested too - they tell which range the next response train belongs to. */
+  harvest_bus.set_receive_frame_filter(TRIONIC5_REQUEST_FRAME_ID, CAN_SFF_MASK);
+  harvest_bus.add_receive_frame_filter(TRIONIC5_RESPONSE_FRAME_ID, CAN_SFF_MASK);
+
+  cyclic_bus.set_name(strlen(interface_name)+1, interface_name);
+  if(cyclic_bus.open_cyclic() < 0){
+    harvest_bus.close();
+    return 0;
+  }/*if*/
+
+  cyclic_bus.configure_cyclic_deaf_datapump(interval);
+
+  if( !cyclic_bus.configure_cyclic_datapump_frames(number_of_requests, requests) ||
+      !cyclic_bus.start_pumping_cyclic_data() ){
+    cyclic_bus.close();
+    harvest_bus.close();
+    return 0;
+  }/*if*/
+
+  decoder.reset();
+  pumping = true;
+
+  return 1;
+}/*symbol_pump::start*/
+
+void symbol_pump::stop(void){
+  if(!pumping){
+    return;
+  }/*if*/
+
+  cyclic_bus.stop_pumping_cyclic_data();
+  cyclic_bus.close();
+  harvest_bus.close();
+
+  pumping = false;
+}/*symbol_pump::stop*/
+
+int symbol_pump::poll(void){
+  unsigned int  can_id;
+  unsigned char data[8];
+  int           size;
+  int           completed = 0;
+
+  if(!pumping){
+    return 0;
+  }/*if*/
+
+  while( (size = harvest_bus.receive(sizeof(data), (char*)data, &can_id)) >= 0 ){
+    if( (can_id & CAN_SFF_MASK) == TRIONIC5_REQUEST_FRAME_ID ){
+      can_frame     request;
+      unsigned int  start_address;
+      unsigned int  end_address;
+
+      request.can_id  = can_id;
+      request.can_dlc = size;
+      memcpy(request.data, data, size);
+
+      if(!parse_sram_read_request(&request, &start_address, &end_address)){
+        continue;
+      }/*if*/
+
+      /* A new request while a train is still pending means the rest of that train was lost. */
+      if(decoder.is_pending()){
+        failed_reads += 1;
+      }/*if*/
+
+      mirror->expect(&decoder, start_address, end_address);
+      continue;
+    }/*if*/
+
+    switch(decoder.decode(can_id, size, data)){
+      case Sram_Response_Complete:
+        mirror->commit(&decoder, monotonic_microseconds());
+        decoder.reset();
+        completed_reads += 1;
+        completed       += 1;
+        break;
+      case Sram_Response_Malformed:
+        failed_reads += 1;
+        break;
+      default:
+        break;
+    }/*switch*/
+  }/*while*/
+
+  return completed;
+}/*symbol_pump::poll*/
+
+bool symbol_pump::is_pumping(void) const{
+  return pumping;
+}/*symbol_pump::is_pumping*/
+
+unsigned int symbol_pump::get_number_of_requests(void) const{
+  return number_of_requests;
+}/*symbol_pump::get_number_of_requests*/
+
+unsigned long long symbol_pump::get_completed_reads(void) const{
+  return completed_reads;
+}/*symbol_pump::get_completed_reads*/
+
+unsigned long long symbol_pump::get_failed_reads(void) const{
+  return failed_reads;
+}/*symbol_pump::get_failed_reads*/
+
+}
@@ -0,0 +1,88 @@
+/*
+ * Description:
+ *  Kernel driven polling of Trionic 5 symbols.
+ *
+ *  The read requests for a set of SRAM ranges are handed to the broadcast
+ *  manager as one cyclic transmission sequence. The kernel then sends one
+ *  request per interval on its own, in order, and starts over once the whole
+ *  sequence has been sent. Userspace never has to wake up to transmit, so the
+ *  request rate is not subject to scheduling jitter.
+ *
+ *  The responses carry no address. To know which range a response train
+ *  belongs to, a second, raw socket listens to both the requests and the
+ *  responses: the requests transmitted by the broadcast manager are looped
+ *  back to it, and every request seen there arms the decoder for the train
+ *  which follows it. A lost frame therefore only costs the read it belongs to,
+ *  the pump resynchronises on the next request.
+ *
+ *  The interval must leave the ECU enough time to answer the largest range in
+ *  the sequence before the next request goes out.
+ */
+
+#ifndef _symbol_pump_hpp_
+#define _symbol_pump_hpp_
+
+#include "can/bus.hpp"
+#include "sram_response.hpp"
+#include "sram_mirror.hpp"
+#include "symbol_table.hpp"
+
+#include <sys/time.h>
+
+namespace trionic5net{
+
+#define MAX_PUMPED_READS  MAX_CYCLIC_TX_FRAMES
+
+class symbol_pump{
+  private:
+    can::bus                cyclic_bus;
+    can::bus                harvest_bus;
+    sram_mirror*            mirror;
+    sram_response_decoder   decoder;
+
+    can_frame               requests[MAX_PUMPED_READS];
+    unsigned int            number_of_requests;
+    bool                    pumping;
+
+    unsigned long long      completed_reads;
+    unsigned long long      failed_reads;
+
+  public:
+    symbol_pump(sram_mirror* mirror);
+    ~symbol_pump();
+
+    /*
+     * Adds a range to the sequence. Must be called before start().
+     * Returns 0 if the sequence is full or the range is invalid.
+     */
+    int add(const unsigned int start_address, const unsigned int end_address);
+    int add(const symbol* sym);
+
+    /*
+     * Clears the sequence. Must not be called while pumping.
+     */
+    void clear(void);
+
+    /*
+     * Opens both sockets on the given interface and hands the sequence to the kernel,
+     * which sends one request per interval from then on.
+     * Returns 0 on failure.
+     */
+    int start(const char* interface_name, struct timeval interval);
+    void stop(void);
+
+    /*
+     * Drains the harvest socket and reassembles the responses into the mirror.
+     * Never blocks. Returns the number of reads completed by this call.
+     */
+    int poll(void);
+
+    bool                is_pumping(void) const;
+    unsigned int        get_number_of_requests(void) const;
+    unsigned long long  get_completed_reads(void) const;
+    unsigned long long  get_failed_reads(void) const;
+};
+
+}
+
+#endif
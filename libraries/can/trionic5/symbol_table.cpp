@@ -0,0 +1,326 @@
+/*
+ * Description:
+ *   Implementation file for the symbol_table class.
+ */
+
+#include "symbol_table.hpp"
+#include "sram_response.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace trionic5net{
+
+#define SYMBOL_SEPARATOR_SIZE   2
+#define SYMBOL_HEADER_SIZE      4
+#define SYMBOL_TABLE_END_MARKER "END$"
+
+static bool is_symbol_name_character(const unsigned char c){
+  return  ((c >= 'a') && (c <= 'z')) ||
+          ((c >= 'A') && (c <= 'Z')) ||
+          ((c >= '0') && (c <= '9')) ||
+          (c == '_');
+}/*is_symbol_name_character*/
+
+unsigned int extract_symbols(const unsigned char* image, const size_t image_size, symbol* symbols, const unsigned int max_symbols){
+  unsigned int          found_symbols = 0;
+  const unsigned char*  end           = image+image_size;
+  const unsigned char*  cursor        = image;
+
+  while( (cursor < end) && (found_symbols < max_symbols) ){
+    const unsigned char* separator = (const unsigned char*)memchr(cursor, '\r', end-cursor);
+
+    if( (separator == 0) || (separator+1 >= end) ){
+      break;
+    }/*if*/
+
+    cursor = separator+1;
+
+    if(*cursor != '\n'){
+      continue;
+    }/*if*/
+
+    const unsigned char* record = separator+SYMBOL_SEPARATOR_SIZE;
+
+    if(record+SYMBOL_HEADER_SIZE >= end){
+      break;
+    }/*if*/
+
+    if(memcmp(record, SYMBOL_TABLE_END_MARKER, SYMBOL_HEADER_SIZE) == 0){
+      break;
+    }/*if*/
+
+    const unsigned char*  name        = record+SYMBOL_HEADER_SIZE;
+    unsigned int          name_length = 0;
+
+    while( (name+name_length < end) && (name_length < MAX_SYMBOL_NAME_SIZE) && is_symbol_name_character(name[name_length]) ){
+      name_length += 1;
+    }/*while*/
+
+    /*
+     * A 0x0d0a pair may just as well occur in code or calibration data.
+     * Only accept records whose name is properly terminated.
+     */
+    const unsigned char* terminator = name+name_length;
+    if( (name_length == 0) || (terminator >= end) || ((*terminator != '!') && (*terminator != '\0') && (*terminator != '\r')) ){
+      continue;
+    }/*if*/
+
+    symbols[found_symbols].name         = (const char*)name;
+    symbols[found_symbols].name_length  = name_length;
+    symbols[found_symbols].address      = (record[0] << 8) | record[1];
+    symbols[found_symbols].length       = (record[2] << 8) | record[3];
+    found_symbols += 1;
+
+    cursor = terminator;
+  }/*while*/
+
+  return found_symbols;
+}/*extract_symbols*/
+
+static int compare_symbol_names(const char* a, const unsigned int a_length, const char* b, const unsigned int b_length){
+  int result = memcmp(a, b, a_length < b_length ? a_length : b_length);
+
+  if(result != 0){
+    return result;
+  }/*if*/
+
+  return (int)a_length - (int)b_length;
+}/*compare_symbol_names*/
+
+static int compare_by_name(const void* a, const void* b){
+  const symbol* x = *(const symbol* const*)a;
+  const symbol* y = *(const symbol* const*)b;
+
+  int result = compare_symbol_names(x->name, x->name_length, y->name, y->name_length);
+
+  /* Keep the table order for duplicated names, so find() returns the first one. */
+  if(result == 0){
+    result = (x < y) ? -1 : (x > y);
+  }/*if*/
+
+  return result;
+}/*compare_by_name*/
+
+static int compare_by_address(const void* a, const void* b){
+  const symbol* x = *(const symbol* const*)a;
+  const symbol* y = *(const symbol* const*)b;
+
+  if(x->address != y->address){
+    return (x->address < y->address) ? -1 : 1;
+  }/*if*/
+
+  return (x < y) ? -1 : (x > y);
+}/*compare_by_address*/
+
+symbol_table::symbol_table(){
+  image             = 0;
+  image_size        = 0;
+  image_mapped      = false;
+  number_of_symbols = 0;
+  longest_symbol    = 0;
+
+  memset(symbols, 0x0, sizeof(symbols));
+  memset(name_index, 0x0, sizeof(name_index));
+  memset(address_index, 0x0, sizeof(address_index));
+}/*symbol_table::symbol_table*/
+
+symbol_table::~symbol_table(){
+  unload();
+}/*symbol_table::~symbol_table*/
+
+int symbol_table::load(const char* path){
+  if(path == 0){
+    return 0;
+  }/*if*/
+
+  unload();
+
+  int image_descriptor = open(path, O_RDONLY);
+  if(image_descriptor == -1){
+    perror("Could not open firmware image");
+    return 0;
+  }/*if*/
+
+  struct stat image_status;
+  if( (fstat(image_descriptor, &image_status) == -1) || (image_status.st_size == 0) ){
+    perror("Could not determine firmware image size");
+    close(image_descriptor);
+    return 0;
+  }/*if*/
+
+  void* mapped_image = mmap(0, image_status.st_size, PROT_READ, MAP_PRIVATE, image_descriptor, 0);
+
+  /* The mapping keeps the file referenced, the descriptor is not needed anymore. */
+  close(image_descriptor);
+
+  if(mapped_image == MAP_FAILED){
+    perror("Could not map firmware image");
+    return 0;
+  }/*if*/
+
+  madvise(mapped_image, image_status.st_size, MADV_SEQUENTIAL);
+
+  if(load((const unsigned char*)mapped_image, image_status.st_size) == 0){
+    munmap(mapped_image, image_status.st_size);
+    return 0;
+  }/*if*/
+
+  image_mapped = true;
+
+  return 1;
+}/*symbol_table::load*/
+
+int symbol_table::load(const unsigned char* given_image, const size_t given_image_size){
+  if( (given_image == 0) || (given_image_size == 0) ){
+    return 0;
+  }/*if*/
+
+  if(given_image != image){
+    unload();
+  }/*if*/
+
+  image             = given_image;
+  image_size        = given_image_size;
+  number_of_symbols = extract_symbols(image, image_size, symbols, MAX_SYMBOLS);
+
+  if(number_of_symbols == 0){
+    printf("No symbol table found in firmware image.\n");
+    image       = 0;
+    image_size  = 0;
+    return 0;
+  }/*if*/
+
+  build_indices();
+
+  return 1;
+}/*symbol_table::load*/
+
+void symbol_table::unload(void){
+  if(image_mapped){
+    if(munmap((void*)image, image_size) == -1){
+      perror("Failed to unmap firmware image");
+    }/*if*/
+  }/*if*/
+
+  image             = 0;
+  image_size        = 0;
+  image_mapped      = false;
+  number_of_symbols = 0;
+  longest_symbol    = 0;
+}/*symbol_table::unload*/
+
+void symbol_table::build_indices(void){
+  longest_symbol = 0;
+
+  for(unsigned int i = 0; i < number_of_symbols; i++){
+    name_index[i]     = &symbols[i];
+    address_index[i]  = &symbols[i];
+
+    if(symbols[i].length > longest_symbol){
+      longest_symbol = symbols[i].length;
+    }/*if*/
+  }/*for*/
+
+  qsort(name_index, number_of_symbols, sizeof(const symbol*), compare_by_name);
+  qsort(address_index, number_of_symbols, sizeof(const symbol*), compare_by_address);
+}/*symbol_table::build_indices*/
+
+unsigned int symbol_table::get_number_of_symbols(void) const{
+  return number_of_symbols;
+}/*symbol_table::get_number_of_symbols*/
+
+const symbol* symbol_table::get_symbol(const unsigned int index) const{
+  if(index >= number_of_symbols){
+    return 0;
+  }/*if*/
+
+  return &symbols[index];
+}/*symbol_table::get_symbol*/
+
+const unsigned char* symbol_table::get_image(void) const{
+  return image;
+}/*symbol_table::get_image*/
+
+size_t symbol_table::get_image_size(void) const{
+  return image_size;
+}/*symbol_table::get_image_size*/
+
+const symbol* symbol_table::find(const char* name) const{
+  if(name == 0){
+    return 0;
+  }/*if*/
+
+  return find(name, strlen(name));
+}/*symbol_table::find*/
+
+const symbol* symbol_table::find(const char* name, const unsigned int name_length) const{
+  unsigned int low  = 0;
+  unsigned int high = number_of_symbols;
+
+  /* Lower bound, so the first of several identically named symbols is found. */
+  while(low < high){
+    unsigned int middle = low+(high-low)/2;
+
+    if(compare_symbol_names(name_index[middle]->name, name_index[middle]->name_length, name, name_length) < 0){
+      low = middle+1;
+    }/*if*/
+    else{
+      high = middle;
+    }/*else*/
+  }/*while*/
+
+  if( (low < number_of_symbols) && (compare_symbol_names(name_index[low]->name, name_index[low]->name_length, name, name_length) == 0) ){
+    return name_index[low];
+  }/*if*/
+
+  return 0;
+}/*symbol_table::find*/
+
+const symbol* symbol_table::find_by_address(const unsigned int address) const{
+  unsigned int low  = 0;
+  unsigned int high = number_of_symbols;
+
+  /* Find the first symbol starting above the address. */
+  while(low < high){
+    unsigned int middle = low+(high-low)/2;
+
+    if(address_index[middle]->address <= address){
+      low = middle+1;
+    }/*if*/
+    else{
+      high = middle;
+    }/*else*/
+  }/*while*/
+
+  while(low > 0){
+    low -= 1;
+
+    const symbol* candidate = address_index[low];
+    if(address < candidate->address+candidate->length){
+      return candidate;
+    }/*if*/
+
+    /* No symbol further down is long enough to reach the address. */
+    if(address-candidate->address >= longest_symbol){
+      break;
+    }/*if*/
+  }/*while*/
+
+  return 0;
+}/*symbol_table::find_by_address*/
+
+int symbol_table::build_read_request(const symbol* sym, can_frame* frame) const{
+  if(sym == 0){
+    return 0;
+  }/*if*/
+
+  return build_sram_read_request(frame, sym->address, sym->address+sym->length);
+}/*symbol_table::build_read_request*/
+
+}
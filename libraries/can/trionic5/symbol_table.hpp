@@ -0,0 +1,112 @@
+/*
+ * Description:
+ *  Run-time access to the symbol table found in a Trionic 5 flash binary.
+ *
+ *  The table is a sequence of records, each one introduced by 0x0d0a
+ *  (carriage return and newline), followed by the big-endian SRAM address,
+ *  the big-endian length and the name of the variable. The name is
+ *  terminated by '!', by zero padding or by the next separator.
+ *  The table itself is terminated by the record "END$".
+ *
+ *  Different firmware versions place their variables at different addresses,
+ *  so instead of relying on the addresses frozen into messages.hpp,
+ *  a symbol_table may be loaded from the firmware of the car at hand.
+ *  Loading maps the image into memory, parses it in place and sorts two
+ *  indices - one by name and one by address. No symbol names are copied;
+ *  they point straight into the mapped image, which is why the names are
+ *  not null-terminated.
+ */
+
+#ifndef _symbol_table_hpp_
+#define _symbol_table_hpp_
+
+#include <stddef.h>
+#include <linux/can.h>
+
+namespace trionic5net{
+
+#define MAX_SYMBOLS             2048
+#define MAX_SYMBOL_NAME_SIZE    64
+
+struct symbol{
+  const char*   name;
+  unsigned int  name_length;
+  unsigned int  address;
+  unsigned int  length;
+};
+
+/*
+ * Scans a firmware image for symbol records and stores at most max_symbols of them in symbols.
+ * The names of the symbols point into the image.
+ * Returns the number of symbols found.
+ */
+unsigned int extract_symbols(const unsigned char* image, const size_t image_size, symbol* symbols, const unsigned int max_symbols);
+
+class symbol_table{
+  private:
+    const unsigned char*  image;
+    size_t                image_size;
+    bool                  image_mapped;
+
+    symbol                symbols[MAX_SYMBOLS];
+    unsigned int          number_of_symbols;
+    unsigned int          longest_symbol;
+
+    const symbol*         name_index[MAX_SYMBOLS];
+    const symbol*         address_index[MAX_SYMBOLS];
+
+    void build_indices(void);
+
+  public:
+    symbol_table();
+    ~symbol_table();
+
+    /*
+     * Maps the firmware image found at path and builds the symbol table from it.
+     * The image stays mapped until unload() is called or the table is destroyed.
+     * Returns 0 on failure.
+     */
+    int load(const char* path);
+
+    /*
+     * Builds the symbol table from an image which is already in memory.
+     * The image must outlive the table.
+     * Returns 0 on failure.
+     */
+    int load(const unsigned char* image, const size_t image_size);
+
+    void unload(void);
+
+    unsigned int  get_number_of_symbols(void) const;
+    const symbol* get_symbol(const unsigned int index) const;
+
+    /*
+     * The firmware image the symbols were parsed from.
+     */
+    const unsigned char*  get_image(void) const;
+    size_t                get_image_size(void) const;
+
+    /*
+     * Looks up a symbol by its name in O(log n).
+     * Returns 0 if there is no such symbol.
+     */
+    const symbol* find(const char* name) const;
+    const symbol* find(const char* name, const unsigned int name_length) const;
+
+    /*
+     * Looks up the symbol which holds the given SRAM address in O(log n).
+     * If several symbols overlap, the one starting closest below the address is returned.
+     * Returns 0 if no symbol covers the address.
+     */
+    const symbol* find_by_address(const unsigned int address) const;
+
+    /*
+     * Builds the SRAM read request for a symbol.
+     * Returns 0 on failure.
+     */
+    int build_read_request(const symbol* sym, can_frame* frame) const;
+};
+
+}
+
+#endif
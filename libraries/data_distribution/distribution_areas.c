@@ -47,7 +47,7 @@ void* get_port(const char* port_name, int* port_handle, unsigned int port_size){
   return port_area;
 }/*get_port*/
 
-int close_port(char* port_name, void* port_area, unsigned int port_size){
+int close_port(const char* port_name, void* port_area, unsigned int port_size){
   int result = munmap(port_area, port_size);
   if(result == -1){
     perror("close_port - munmap");
@@ -55,7 +55,17 @@ typedef enum{
   Metres_Per_Second,
   Newton_Metres,
   Revolutions_Per_Second,
-  Degrees
+  Degrees,
+  Revolutions_Per_Minute,
+  Percent,
+  Kilopascals,
+  Milliseconds,
+  Counts,
+  Kilometres,
+  Kilometres_Per_Hour,
+  Grams_Per_Second,
+  Litres_Per_Hour,
+  Minutes
 }data_unit;
 
 typedef struct{
@@ -64,12 +74,13 @@ typedef struct{
   data_unit           unit;
 }data_item_header;
 
-const char* port_ignition_angle_btdc                = "/ignition_angle";
-const char* port_engine_torque                      = "/engine_torque";
-const char* port_engine_speed                       = "/engine_speed";
-const char* port_engine_power                       = "/engine_power";
-const char* port_cylinder_head_coolant_temperature  = "/cylinder_head_coolant_temperature";
-const char* port_intake_air_flow_rate               = "/intake_mass_air_flow_rate";
-const char* port_intake_air_temperature             = "/intake_air_temperature";
+static const char* const port_ignition_angle_btdc                = "/ignition_angle";
+static const char* const port_engine_torque                      = "/engine_torque";
+static const char* const port_engine_speed                       = "/engine_speed";
+static const char* const port_engine_power                       = "/engine_power";
+static const char* const port_cylinder_head_coolant_temperature  = "/cylinder_head_coolant_temperature";
+static const char* const port_intake_air_flow_rate               = "/intake_mass_air_flow_rate";
+static const char* const port_intake_air_temperature             = "/intake_air_temperature";
+static const char* const port_combustion_statistics              = "/combustion_statistics";
 
 #endif
@@ -0,0 +1,239 @@
+#include "dtc_scan.h"
+#include "obd2modes.h"
+
+#include <ctype.h>
+#include <string.h>
+
+static const unsigned char dtc_modes[OBD2_DTC_KINDS] = {
+	SHOW_STORED_DIAGNOSTIC_TROUBLE_CODES,
+	SHOW_PENDING_DIAGNOSTIC_TROUBLE_CODES,
+	PERMANENT_DIAGNOSTIC_TROUBLE_CODES
+};
+
+unsigned char obd2_dtc_mode(Obd2_Dtc_Kind kind){
+	return dtc_modes[kind];
+}/*obd2_dtc_mode*/
+
+void init_obd2_dtc_scan(obd2_dtc_scan* scan, unsigned int ecus, unsigned int max_retries){
+	memset(scan, 0x0, sizeof(obd2_dtc_scan));
+
+	init_obd2_request_timer(&scan->broadcast_timer, max_retries);
+
+	for(unsigned int ecu = 0; ecu < OBD2_MAX_ECUS; ecu++){
+		init_obd2_request_timer(&scan->ecu_timers[ecu], max_retries);
+		scan->next_kind[ecu] = (ecus & (1u << ecu)) ? Obd2_Dtc_Stored : OBD2_DTC_KINDS;
+	}/*for*/
+
+	if(ecus != 0){
+		scan->report.ecus			= ecus & ((1u << OBD2_MAX_ECUS)-1);
+		scan->broadcast_sent	= true;
+		scan->broadcast_done	= true;
+	}/*if*/
+}/*init_obd2_dtc_scan*/
+
+static bool next_broadcast(obd2_dtc_scan* scan, unsigned long long now){
+	if(!scan->broadcast_sent){
+		scan->broadcast_sent = true;
+		return true;
+	}/*if*/
+
+	if(scan->broadcast_done){
+		return false;
+	}/*if*/
+
+	switch(obd2_request_state(&scan->broadcast_timer, now)){
+		case Obd2_Request_Retry:
+			return true;
+		case Obd2_Request_Failed:
+			/* Nobody is listening. */
+			scan->broadcast_done = true;
+			return false;
+		case Obd2_Request_Complete:
+		case Obd2_Request_Idle:
+			scan->broadcast_done = true;
+			return false;
+		default:
+			return false;
+	}/*switch*/
+}/*next_broadcast*/
+
+bool obd2_dtc_scan_next_request(obd2_dtc_scan* scan, unsigned long long now, unsigned int* request_id, unsigned char* mode){
+	if(next_broadcast(scan, now)){
+		*request_id	= CAN_OBD2_QUERY_MESSAGE_ID_BROADCAST;
+		*mode				= SHOW_STORED_DIAGNOSTIC_TROUBLE_CODES;
+		obd2_request_sent(&scan->broadcast_timer, *request_id, *mode, 0x0, now);
+		return true;
+	}/*if*/
+
+	for(unsigned int ecu = 0; ecu < OBD2_MAX_ECUS; ecu++){
+		obd2_request_timer* timer = &scan->ecu_timers[ecu];
+
+		if(scan->next_kind[ecu] >= OBD2_DTC_KINDS){
+			continue;
+		}/*if*/
+
+		switch(obd2_request_state(timer, now)){
+			case Obd2_Request_Waiting:
+				continue;
+			case Obd2_Request_Failed:
+				/* Leave this kind unanswered and go on with the next. */
+				scan->next_kind[ecu] += 1;
+				if(scan->next_kind[ecu] >= OBD2_DTC_KINDS){
+					continue;
+				}/*if*/
+				break;
+			default:
+				break;
+		}/*switch*/
+
+		*request_id	= CAN_OBD2_QUERY_MESSAGE_ID_LOW+ecu;
+		*mode				= dtc_modes[scan->next_kind[ecu]];
+		obd2_request_sent(timer, *request_id, *mode, 0x0, now);
+		return true;
+	}/*for*/
+
+	return false;
+}/*obd2_dtc_scan_next_request*/
+
+static void store_codes(obd2_dtc_report* report, unsigned int ecu, unsigned int kind, const unsigned char* payload, unsigned int length){
+	unsigned int reported = 0;
+
+	report->counts[ecu][kind]		= parse_obd2_dtc_response(payload, length, report->codes[ecu][kind], OBD2_MAX_DTCS_PER_ECU, &reported);
+	report->reported[ecu][kind]	= reported;
+	report->answered[kind]			|= 1u << ecu;
+}/*store_codes*/
+
+bool obd2_dtc_scan_response(obd2_dtc_scan* scan, unsigned int response_id, const unsigned char* payload, unsigned int length, unsigned long long now){
+	if( (response_id < CAN_OBD2_RESPONSE_MESSAGE_ID_LOW) || (response_id > CAN_OBD2_RESPONSE_MESSAGE_ID_HIGH) || (length < 2) ){
+		return false;
+	}/*if*/
+
+	unsigned int	ecu		= response_id-CAN_OBD2_RESPONSE_MESSAGE_ID_LOW;
+	unsigned int	kind	= scan->next_kind[ecu];
+
+	/* An ECU rejecting the mode it was asked for, other than to ask for more time, will not answer it. */
+	if( (payload[0] == OBD2_NEGATIVE_RESPONSE) && (length >= 3) ){
+		if( (kind >= OBD2_DTC_KINDS) || (payload[1] != dtc_modes[kind]) || (payload[2] == OBD2_RESPONSE_PENDING) ){
+			return false;
+		}/*if*/
+
+		obd2_request_cancel(&scan->ecu_timers[ecu]);
+		scan->next_kind[ecu] += 1;
+		return true;
+	}/*if*/
+
+	/* The timers only look at the mode of a response. */
+	obd2_response response;
+	memset(&response, 0x0, sizeof(response));
+	response.mode = payload[0];
+
+	if( (payload[0] == SHOW_STORED_DIAGNOSTIC_TROUBLE_CODES+MODE_RESPONSE_DELTA) && !(scan->report.ecus & (1u << ecu)) ){
+		/* An ECU answering the broadcast. The first answer completes it, slower ECUs still join in until it is done. */
+		if(scan->broadcast_done){
+			return false;
+		}/*if*/
+
+		obd2_response_received(&scan->broadcast_timer, response_id, &response, now);
+
+		store_codes(&scan->report, ecu, Obd2_Dtc_Stored, payload, length);
+		scan->report.ecus			|= 1u << ecu;
+		scan->next_kind[ecu]	= Obd2_Dtc_Pending;
+		return true;
+	}/*if*/
+
+	if( (kind >= OBD2_DTC_KINDS) || (payload[0] != dtc_modes[kind]+MODE_RESPONSE_DELTA) ){
+		/* A late answer to a retransmitted broadcast, or to a request already given up on. */
+		return false;
+	}/*if*/
+
+	obd2_response_received(&scan->ecu_timers[ecu], response_id, &response, now);
+
+	store_codes(&scan->report, ecu, kind, payload, length);
+	scan->next_kind[ecu] += 1;
+
+	return true;
+}/*obd2_dtc_scan_response*/
+
+bool obd2_dtc_scan_is_complete(const obd2_dtc_scan* scan){
+	if(!scan->broadcast_done){
+		return false;
+	}/*if*/
+
+	for(unsigned int ecu = 0; ecu < OBD2_MAX_ECUS; ecu++){
+		if(scan->next_kind[ecu] < OBD2_DTC_KINDS){
+			return false;
+		}/*if*/
+	}/*for*/
+
+	return true;
+}/*obd2_dtc_scan_is_complete*/
+
+unsigned int parse_obd2_dtc_response(const unsigned char* payload, unsigned int length, unsigned short* codes, unsigned int max_codes, unsigned int* reported){
+	*reported = 0;
+
+	if(length < 2){
+		return 0;
+	}/*if*/
+
+	/* Codes which did not make it into the payload are reported, but not stored. */
+	unsigned int available	= (length-2)/2;
+	unsigned int count			= (payload[1] < available) ? payload[1] : available;
+	unsigned int stored			= 0;
+
+	*reported = payload[1];
+
+	for(unsigned int i = 0; (i < count) && (stored < max_codes); i++){
+		unsigned short code = (payload[2+2*i] << 8) | payload[3+2*i];
+
+		/* Some ECUs fill up the last frame with empty codes. */
+		if(code != 0x0){
+			codes[stored++] = code;
+		}/*if*/
+	}/*for*/
+
+	return stored;
+}/*parse_obd2_dtc_response*/
+
+void format_obd2_dtc(unsigned short code, char* text){
+	static const char systems[4]	= {'P', 'C', 'B', 'U'};
+	static const char digits[16]	= {'0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F'};
+
+	text[0] = systems[code >> 14];
+	text[1] = digits[(code >> 12) & 0x3];
+	text[2] = digits[(code >> 8) & 0xF];
+	text[3] = digits[(code >> 4) & 0xF];
+	text[4] = digits[code & 0xF];
+	text[5] = '\0';
+}/*format_obd2_dtc*/
+
+bool parse_obd2_dtc(const char* text, unsigned short* code){
+	static const char systems[4] = {'P', 'C', 'B', 'U'};
+
+	unsigned short	value		= 0;
+	unsigned int		system	= 0;
+
+	while( (system < 4) && (toupper(text[0]) != systems[system]) ){
+		system++;
+	}/*while*/
+
+	if( (system == 4) || (text[1] < '0') || (text[1] > '3') ){
+		return false;
+	}/*if*/
+
+	value = (system << 14) | ((text[1]-'0') << 12);
+
+	for(unsigned int i = 2; i < OBD2_DTC_TEXT_SIZE-1; i++){
+		if(!isxdigit(text[i])){
+			return false;
+		}/*if*/
+
+		value |= (isdigit(text[i]) ? text[i]-'0' : toupper(text[i])-'A'+10) << (4*(OBD2_DTC_TEXT_SIZE-2-i));
+	}/*for*/
+
+	if(text[OBD2_DTC_TEXT_SIZE-1] != '\0'){
+		return false;
+	}/*if*/
+
+	*code = value;
+	return true;
+}/*parse_obd2_dtc*/
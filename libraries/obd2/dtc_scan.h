@@ -0,0 +1,79 @@
+#ifndef OBD2_DTC_SCAN_H
+#define OBD2_DTC_SCAN_H
+
+#include "obd2can.h"
+#include "request_timer.h"
+
+/* @NOTE: Reads the stored (Mode 0x03), pending (Mode 0x07) and permanent (Mode 0x0A) trouble codes of every ECU.
+ *
+ * 				On CAN, a DTC request takes no PID, and its answer holds the number of codes followed by two bytes per code:
+ *
+ * 						0x43 count A1 B1 A2 B2 ...
+ *
+ * 				An answer with more than two codes spans several frames, so the answers are expected to have been put back
+ * 				together by ISO-TP (see can/isotp.hpp) before they are fed to the scan.
+ *
+ * 				Unless the ECUs are known, the scan broadcasts the first Mode 0x03 request, which every ECU answers, even
+ * 				without any codes. From then on, every ECU is asked for the remaining modes by unicast (0x7e0-0x7e7), all
+ * 				ECUs at the same time, each with a request timer of its own, so the scan takes one round-trip per mode of
+ * 				the slowest ECU. Given the ECUs, e.g. from an earlier scan, the broadcast is skipped. An ECU which rejects a
+ * 				mode is not asked for it again.
+ *
+ * 				Like discovery, the scan never touches the bus itself: obd2_dtc_scan_next_request() hands out the requests
+ * 				to send and obd2_dtc_scan_response() takes every answer.
+ */
+
+#define OBD2_DTC_KINDS								3
+#define OBD2_MAX_DTCS_PER_ECU					32
+#define OBD2_DTC_TEXT_SIZE						6			/* "P0301" and its terminator. */
+
+typedef enum{
+	Obd2_Dtc_Stored,
+	Obd2_Dtc_Pending,
+	Obd2_Dtc_Permanent
+}Obd2_Dtc_Kind;
+
+/* The codes are kept as sent, two bytes each, and only turned into text when printed. */
+typedef struct{
+	unsigned int		ecus;																														/* Bit n set == the ECU answering with 0x7e8+n took part. */
+	unsigned char		answered[OBD2_DTC_KINDS];																				/* Bit n set == ECU n answered for this kind. */
+	unsigned char		reported[OBD2_MAX_ECUS][OBD2_DTC_KINDS];												/* As reported, which may exceed the codes stored. */
+	unsigned char		counts[OBD2_MAX_ECUS][OBD2_DTC_KINDS];													/* Codes stored. */
+	unsigned short	codes[OBD2_MAX_ECUS][OBD2_DTC_KINDS][OBD2_MAX_DTCS_PER_ECU];
+}obd2_dtc_report;
+
+typedef struct{
+	obd2_dtc_report			report;
+
+	obd2_request_timer	broadcast_timer;
+	bool								broadcast_sent;
+	bool								broadcast_done;
+
+	obd2_request_timer	ecu_timers[OBD2_MAX_ECUS];
+	unsigned char				next_kind[OBD2_MAX_ECUS];		/* The next kind to ask each ECU for, OBD2_DTC_KINDS once it is done. */
+}obd2_dtc_scan;
+
+/* ecus is a mask of the ECUs to ask as in obd2_dtc_report, or 0 to find them by broadcast. */
+void init_obd2_dtc_scan(obd2_dtc_scan* scan, unsigned int ecus, unsigned int max_retries);
+
+/* Returns true and sets request_id and mode if a request should be sent now. Call until it returns false. */
+bool obd2_dtc_scan_next_request(obd2_dtc_scan* scan, unsigned long long now, unsigned int* request_id, unsigned char* mode);
+
+/* Feeds a response payload, starting with the mode byte, into the scan. Returns true if it was a DTC answer. */
+bool obd2_dtc_scan_response(obd2_dtc_scan* scan, unsigned int response_id, const unsigned char* payload, unsigned int length, unsigned long long now);
+
+bool obd2_dtc_scan_is_complete(const obd2_dtc_scan* scan);
+
+unsigned char obd2_dtc_mode(Obd2_Dtc_Kind kind);
+
+/* Splits a DTC answer payload, starting with the mode byte, into codes. Sets reported to the number of codes the
+ * ECU reported. Returns the number of codes stored. */
+unsigned int parse_obd2_dtc_response(const unsigned char* payload, unsigned int length, unsigned short* codes, unsigned int max_codes, unsigned int* reported);
+
+/* Writes a code as text, e.g. 0x0301 as "P0301". text holds at least OBD2_DTC_TEXT_SIZE characters. */
+void format_obd2_dtc(unsigned short code, char* text);
+
+/* Reads a code written by format_obd2_dtc(). Returns false unless text is such a code. */
+bool parse_obd2_dtc(const char* text, unsigned short* code);
+
+#endif
@@ -0,0 +1,464 @@
+#include "ecu_emulator.h"
+#include "obd2modes.h"
+#include "obd2pids.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define OBD2_EMULATOR_MAX_PIDS_PER_REQUEST	6
+#define OBD2_CVN_SIZE												4
+
+void init_obd2_emulator(obd2_emulator* emulator){
+	memset(emulator, 0x0, sizeof(obd2_emulator));
+}/*init_obd2_emulator*/
+
+static obd2_emulated_ecu* find_ecu(obd2_emulator* emulator, unsigned int ecu){
+	if( (ecu >= OBD2_MAX_ECUS) || !(emulator->ecus & (1u << ecu)) ){
+		return 0;
+	}/*if*/
+
+	return &emulator->ecu[ecu];
+}/*find_ecu*/
+
+int obd2_emulator_add_ecu(obd2_emulator* emulator, unsigned int ecu, unsigned int latency){
+	if(ecu >= OBD2_MAX_ECUS){
+		return 0;
+	}/*if*/
+
+	emulator->ecus								|= 1u << ecu;
+	emulator->ecu[ecu].latency		= latency;
+
+	return 1;
+}/*obd2_emulator_add_ecu*/
+
+int obd2_emulator_support_pid(obd2_emulator* emulator, unsigned int ecu, unsigned char pid){
+	obd2_emulated_ecu* emulated = find_ecu(emulator, ecu);
+
+	/* The bitmap PIDs follow from the others. */
+	if( (emulated == 0) || (pid%32 == 0) || (find_obd2_pid_descriptor(pid)->encoding == Obd2_Pid_Unlisted) ){
+		return 0;
+	}/*if*/
+
+	emulated->pids[pid/32] |= 1u << (pid%32);
+	return 1;
+}/*obd2_emulator_support_pid*/
+
+int obd2_emulator_add_dtc(obd2_emulator* emulator, unsigned int ecu, Obd2_Dtc_Kind kind, unsigned short code){
+	obd2_emulated_ecu* emulated = find_ecu(emulator, ecu);
+
+	if( (emulated == 0) || (kind >= OBD2_DTC_KINDS) || (emulated->number_of_dtcs[kind] >= OBD2_EMULATOR_MAX_DTCS) ){
+		return 0;
+	}/*if*/
+
+	emulated->dtcs[kind][emulated->number_of_dtcs[kind]++] = code;
+	return 1;
+}/*obd2_emulator_add_dtc*/
+
+int obd2_emulator_set_vin(obd2_emulator* emulator, unsigned int ecu, const char* vin){
+	obd2_emulated_ecu* emulated = find_ecu(emulator, ecu);
+
+	if( (emulated == 0) || (strlen(vin) != OBD2_VIN_SIZE) ){
+		return 0;
+	}/*if*/
+
+	memcpy(emulated->vin, vin, OBD2_VIN_SIZE+1);
+	return 1;
+}/*obd2_emulator_set_vin*/
+
+int obd2_emulator_add_calibration(obd2_emulator* emulator, unsigned int ecu, const char* calibration_id, unsigned int cvn){
+	obd2_emulated_ecu* emulated = find_ecu(emulator, ecu);
+
+	if( (emulated == 0) || (strlen(calibration_id) > OBD2_CALIBRATION_ID_SIZE) ||
+			(emulated->number_of_calibration_ids >= OBD2_MAX_CALIBRATION_IDS) ){
+		return 0;
+	}/*if*/
+
+	unsigned int i = emulated->number_of_calibration_ids++;
+
+	strcpy(emulated->calibration_ids[i], calibration_id);
+	emulated->cvns[i] = cvn;
+	return 1;
+}/*obd2_emulator_add_calibration*/
+
+static int apply_config_line(obd2_emulator* emulator, char* line){
+	const char* delimiters	= " \t\r\n";
+	char*				keyword			= strtok(line, delimiters);
+
+	if( (keyword == 0) || (keyword[0] == '#') ){
+		return 1;
+	}/*if*/
+
+	char*					ecu_text	= strtok(0, delimiters);
+	char*					setting		= strtok(0, delimiters);
+	char*					end;
+	unsigned int	ecu				= (ecu_text != 0) ? strtoul(ecu_text, &end, 10) : OBD2_MAX_ECUS;
+
+	if( (strcmp(keyword, "ecu") != 0) || (ecu_text == 0) || (*end != '\0') || (setting == 0) ){
+		return 0;
+	}/*if*/
+
+	if( (find_ecu(emulator, ecu) == 0) && !obd2_emulator_add_ecu(emulator, ecu, 0) ){
+		return 0;
+	}/*if*/
+
+	char* value = strtok(0, delimiters);
+
+	if(strcmp(setting, "latency") == 0){
+		return (value != 0) && obd2_emulator_add_ecu(emulator, ecu, strtoul(value, 0, 10));
+	}/*if*/
+
+	if(strcmp(setting, "vin") == 0){
+		return (value != 0) && obd2_emulator_set_vin(emulator, ecu, value);
+	}/*if*/
+
+	if(strcmp(setting, "calibration") == 0){
+		char* cvn = strtok(0, delimiters);
+		return (value != 0) && (cvn != 0) && obd2_emulator_add_calibration(emulator, ecu, value, strtoul(cvn, 0, 16));
+	}/*if*/
+
+	if(strcmp(setting, "pids") == 0){
+		for(; value != 0; value = strtok(0, delimiters)){
+			unsigned long pid = strtoul(value, &end, 16);
+
+			if( (*end != '\0') || (pid > 0xFF) || !obd2_emulator_support_pid(emulator, ecu, pid) ){
+				return 0;
+			}/*if*/
+		}/*for*/
+
+		return 1;
+	}/*if*/
+
+	const char* kind_names[OBD2_DTC_KINDS] = {"stored", "pending", "permanent"};
+
+	for(unsigned int kind = 0; kind < OBD2_DTC_KINDS; kind++){
+		if(strcmp(setting, kind_names[kind]) != 0){
+			continue;
+		}/*if*/
+
+		for(; value != 0; value = strtok(0, delimiters)){
+			unsigned short code;
+
+			if(!parse_obd2_dtc(value, &code) || !obd2_emulator_add_dtc(emulator, ecu, (Obd2_Dtc_Kind)kind, code)){
+				return 0;
+			}/*if*/
+		}/*for*/
+
+		return 1;
+	}/*for*/
+
+	return 0;
+}/*apply_config_line*/
+
+int load_obd2_emulator_config(const char* path, obd2_emulator* emulator){
+	FILE* config_file = fopen(path, "r");
+	if(config_file == NULL){
+		perror(path);
+		return 0;
+	}/*if*/
+
+	char					line[OBD2_EMULATOR_MAX_CONFIG_LINE];
+	unsigned int	line_number = 0;
+	int						success			= 1;
+
+	while( success && (fgets(line, sizeof(line), config_file) != NULL) ){
+		line_number++;
+
+		if(!apply_config_line(emulator, line)){
+			printf("%s:%u: invalid setting.\n", path, line_number);
+			success = 0;
+		}/*if*/
+	}/*while*/
+
+	fclose(config_file);
+
+	return success;
+}/*load_obd2_emulator_config*/
+
+/* A frame is kept from the first stored code on, and tells that code as PID 0x02. */
+static bool has_freeze_frame(const obd2_emulated_ecu* emulated){
+	return emulated->number_of_dtcs[Obd2_Dtc_Stored] > 0;
+}/*has_freeze_frame*/
+
+static bool is_pid_supported(const obd2_emulated_ecu* emulated, unsigned int pid, bool freeze_frame){
+	if(pid%32 != 0){
+		return ( (emulated->pids[pid/32] >> (pid%32)) & 0x1 ) || (freeze_frame && (pid == FREEZE_DTC));
+	}/*if*/
+
+	/* A bitmap PID is supported as long as there are PIDs past it. */
+	if(pid == SUPPORTED_PIDS){
+		return true;
+	}/*if*/
+
+	for(unsigned int later = pid+1; later < 256; later++){
+		if( (later%32 != 0) && is_pid_supported(emulated, later, freeze_frame) ){
+			return true;
+		}/*if*/
+	}/*for*/
+
+	return false;
+}/*is_pid_supported*/
+
+/* Bit A7 stands for PID pid+1, bit D0 for PID pid+32. */
+static unsigned int pid_bitmap(const obd2_emulated_ecu* emulated, unsigned int pid, bool freeze_frame){
+	unsigned int bits = 0;
+
+	for(unsigned int i = 0; (i < 32) && (pid+1+i < 256); i++){
+		if(is_pid_supported(emulated, pid+1+i, freeze_frame)){
+			bits |= 0x80000000u >> i;
+		}/*if*/
+	}/*for*/
+
+	return bits;
+}/*pid_bitmap*/
+
+static unsigned int put_big_endian(unsigned char* data, unsigned int value, unsigned int bytes){
+	for(unsigned int i = 0; i < bytes; i++){
+		data[i] = value >> (8*(bytes-1-i));
+	}/*for*/
+
+	return bytes;
+}/*put_big_endian*/
+
+/* Writes the data bytes of a PID at the given step of the sweep. Returns the number of bytes written. */
+static unsigned int put_pid_data(const obd2_emulated_ecu* emulated, unsigned char pid, unsigned long long step, bool freeze_frame, unsigned char* data){
+	unsigned int stored_codes = emulated->number_of_dtcs[Obd2_Dtc_Stored];
+
+	if(pid%32 == 0){
+		return put_big_endian(data, pid_bitmap(emulated, pid, freeze_frame), OBD2_PID_BITMAP_BYTES);
+	}/*if*/
+
+	switch(pid){
+		case MONITOR_STATUS:
+			/* The check engine light and the number of stored codes. */
+			return put_big_endian(data, ( (stored_codes > 0) ? 0x80000000u : 0 ) | ( (stored_codes & 0x7F) << 24 ), 4);
+		case FREEZE_DTC:
+			return put_big_endian(data, (stored_codes > 0) ? emulated->dtcs[Obd2_Dtc_Stored][0] : 0, 2);
+		default:
+			break;
+	}/*switch*/
+
+	unsigned int data_bytes = find_obd2_pid_descriptor(pid)->data_bytes;
+
+	for(unsigned int i = 0; i < data_bytes; i++){
+		data[i] = step + pid + 37*i;
+	}/*for*/
+
+	return data_bytes;
+}/*put_pid_data*/
+
+static unsigned int negative_answer(unsigned char mode, unsigned char reason, unsigned char* answer){
+	answer[0] = OBD2_NEGATIVE_RESPONSE;
+	answer[1] = mode;
+	answer[2] = reason;
+	return 3;
+}/*negative_answer*/
+
+static unsigned int answer_current_data(obd2_emulated_ecu* emulated, const unsigned char* payload, unsigned int length, unsigned long long now, unsigned char* answer){
+	unsigned int size = 1;
+
+	for(unsigned int i = 1; (i < length) && (i <= OBD2_EMULATOR_MAX_PIDS_PER_REQUEST); i++){
+		unsigned char pid = payload[i];
+
+		if( !is_pid_supported(emulated, pid, false) ||
+				(size+1+find_obd2_pid_descriptor(pid)->data_bytes > OBD2_EMULATOR_MAX_ANSWER_SIZE) ){
+			continue;
+		}/*if*/
+
+		answer[size++]	= pid;
+		size						+= put_pid_data(emulated, pid, now/OBD2_EMULATOR_SWEEP_PERIOD, false, &answer[size]);
+		emulated->answered_pids++;
+	}/*for*/
+
+	return (size > 1) ? size : 0;
+}/*answer_current_data*/
+
+static unsigned int answer_freeze_frame(obd2_emulated_ecu* emulated, const unsigned char* payload, unsigned int length, unsigned char* answer){
+	unsigned int size = 1;
+
+	for(unsigned int i = 1; i+1 < length; i += 2){
+		unsigned char pid		= payload[i];
+		unsigned char frame	= payload[i+1];
+
+		if( (frame != 0) || !has_freeze_frame(emulated) || !is_pid_supported(emulated, pid, true) ||
+				(size+2+find_obd2_pid_descriptor(pid)->data_bytes > OBD2_EMULATOR_MAX_ANSWER_SIZE) ){
+			continue;
+		}/*if*/
+
+		answer[size++]	= pid;
+		answer[size++]	= frame;
+		size						+= put_pid_data(emulated, pid, 0, true, &answer[size]);
+		emulated->answered_pids++;
+	}/*for*/
+
+	return (size > 1) ? size : 0;
+}/*answer_freeze_frame*/
+
+static unsigned int answer_dtcs(const obd2_emulated_ecu* emulated, Obd2_Dtc_Kind kind, unsigned char* answer){
+	unsigned int size = 1;
+
+	answer[size++] = emulated->number_of_dtcs[kind];
+
+	for(unsigned int i = 0; i < emulated->number_of_dtcs[kind]; i++){
+		size += put_big_endian(&answer[size], emulated->dtcs[kind][i], 2);
+	}/*for*/
+
+	return size;
+}/*answer_dtcs*/
+
+static unsigned int answer_vehicle_information(const obd2_emulated_ecu* emulated, unsigned char pid, unsigned char* answer){
+	unsigned int size								= 2;
+	unsigned int calibration_ids		= emulated->number_of_calibration_ids;
+	unsigned int supported					= 0;
+
+	if(emulated->vin[0] != '\0'){
+		supported |= 0x80000000u >> (VEHICLE_IDENTIFICATION_NUMBER-1);
+	}/*if*/
+
+	if(calibration_ids > 0){
+		supported |= (0x80000000u >> (CALIBRATION_ID-1)) | (0x80000000u >> (CALIBRATION_VERIFICATION_NUMBERS-1));
+	}/*if*/
+
+	answer[1] = pid;
+
+	switch(pid){
+		case SUPPORTED_PIDS_3:
+			return size+put_big_endian(&answer[size], supported, OBD2_PID_BITMAP_BYTES);
+		case VEHICLE_IDENTIFICATION_NUMBER:
+			if(emulated->vin[0] == '\0'){
+				return 0;
+			}/*if*/
+
+			answer[size++] = 1;
+			memcpy(&answer[size], emulated->vin, OBD2_VIN_SIZE);
+			return size+OBD2_VIN_SIZE;
+		case CALIBRATION_ID:
+			if(calibration_ids == 0){
+				return 0;
+			}/*if*/
+
+			answer[size++] = calibration_ids;
+			memset(&answer[size], 0x0, calibration_ids*OBD2_CALIBRATION_ID_SIZE);
+
+			for(unsigned int i = 0; i < calibration_ids; i++){
+				memcpy(&answer[size+i*OBD2_CALIBRATION_ID_SIZE], emulated->calibration_ids[i], strlen(emulated->calibration_ids[i]));
+			}/*for*/
+
+			return size+calibration_ids*OBD2_CALIBRATION_ID_SIZE;
+		case CALIBRATION_VERIFICATION_NUMBERS:
+			if(calibration_ids == 0){
+				return 0;
+			}/*if*/
+
+			answer[size++] = calibration_ids;
+
+			for(unsigned int i = 0; i < calibration_ids; i++){
+				size += put_big_endian(&answer[size], emulated->cvns[i], OBD2_CVN_SIZE);
+			}/*for*/
+
+			return size;
+		default:
+			return 0;
+	}/*switch*/
+}/*answer_vehicle_information*/
+
+/* Returns the size of the answer of an ECU to a request, 0 if it does not answer. */
+static unsigned int answer_request(obd2_emulated_ecu* emulated, bool broadcast, const unsigned char* payload, unsigned int length, unsigned long long now, unsigned char* answer){
+	unsigned char	mode = payload[0];
+	unsigned int	size = 0;
+
+	switch(mode){
+		case SHOW_CURRENT_DATA:
+			size = answer_current_data(emulated, payload, length, now, answer);
+			break;
+		case SHOW_FREEZE_FRAME_DATA:
+			size = answer_freeze_frame(emulated, payload, length, answer);
+
+			if( (size == 0) && !broadcast ){
+				return negative_answer(mode, OBD2_REQUEST_OUT_OF_RANGE, answer);
+			}/*if*/
+			break;
+		case SHOW_STORED_DIAGNOSTIC_TROUBLE_CODES:
+			size = answer_dtcs(emulated, Obd2_Dtc_Stored, answer);
+			break;
+		case SHOW_PENDING_DIAGNOSTIC_TROUBLE_CODES:
+			size = answer_dtcs(emulated, Obd2_Dtc_Pending, answer);
+			break;
+		case PERMANENT_DIAGNOSTIC_TROUBLE_CODES:
+			size = answer_dtcs(emulated, Obd2_Dtc_Permanent, answer);
+			break;
+		case REQUEST_VEHICLE_INFORMATION:
+			size = (length >= 2) ? answer_vehicle_information(emulated, payload[1], answer) : 0;
+			break;
+		default:
+			return broadcast ? 0 : negative_answer(mode, OBD2_SERVICE_NOT_SUPPORTED, answer);
+	}/*switch*/
+
+	if(size > 0){
+		answer[0] = mode+MODE_RESPONSE_DELTA;
+	}/*if*/
+
+	return size;
+}/*answer_request*/
+
+unsigned int obd2_emulator_request(obd2_emulator* emulator, unsigned int request_id, const unsigned char* payload, unsigned int length, unsigned long long now){
+	bool					broadcast	= request_id == CAN_OBD2_QUERY_MESSAGE_ID_BROADCAST;
+	unsigned int	queued		= 0;
+
+	if( (length < 1) || (!broadcast && ((request_id < CAN_OBD2_QUERY_MESSAGE_ID_LOW) || (request_id > CAN_OBD2_QUERY_MESSAGE_ID_HIGH))) ){
+		return 0;
+	}/*if*/
+
+	for(unsigned int ecu = 0; ecu < OBD2_MAX_ECUS; ecu++){
+		obd2_emulated_ecu* emulated = find_ecu(emulator, ecu);
+
+		if( (emulated == 0) || (!broadcast && (request_id != CAN_OBD2_QUERY_MESSAGE_ID_LOW+ecu)) ){
+			continue;
+		}/*if*/
+
+		emulated->requests++;
+
+		if(emulator->number_of_answers >= OBD2_EMULATOR_MAX_ANSWERS){
+			emulator->dropped++;
+			continue;
+		}/*if*/
+
+		obd2_emulator_answer* answer = &emulator->answers[emulator->number_of_answers];
+
+		answer->length = answer_request(emulated, broadcast, payload, length, now, answer->payload);
+
+		if(answer->length > 0){
+			answer->ecu		= ecu;
+			answer->due		= now+emulated->latency;
+			emulator->number_of_answers++;
+			queued++;
+		}/*if*/
+	}/*for*/
+
+	return queued;
+}/*obd2_emulator_request*/
+
+bool obd2_emulator_next_answer(obd2_emulator* emulator, unsigned int ecu, unsigned long long now, unsigned char* payload, unsigned int* length){
+	for(unsigned int i = 0; i < emulator->number_of_answers; i++){
+		obd2_emulator_answer* answer = &emulator->answers[i];
+
+		if(answer->ecu != ecu){
+			continue;
+		}/*if*/
+
+		/* The answers of an ECU leave in order, so a later one never overtakes an earlier one. */
+		if(answer->due > now){
+			return false;
+		}/*if*/
+
+		memcpy(payload, answer->payload, answer->length);
+		*length = answer->length;
+
+		emulator->ecu[ecu].answers++;
+		emulator->number_of_answers--;
+		memmove(answer, answer+1, (emulator->number_of_answers-i)*sizeof(obd2_emulator_answer));
+		return true;
+	}/*for*/
+
+	return false;
+}/*obd2_emulator_next_answer*/
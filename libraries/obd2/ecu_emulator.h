@@ -0,0 +1,101 @@
+#ifndef OBD2_ECU_EMULATOR_H
+#define OBD2_ECU_EMULATOR_H
+
+#include "obd2can.h"
+#include "pid_descriptors.h"
+#include "pid_discovery.h"
+#include "dtc_scan.h"
+#include "vehicle_info.h"
+
+/* @NOTE: Emulates the ECUs of a car, so that the OBD-II readers can be run and load tested on a virtual CAN bus (vcan)
+ * 				without one.
+ *
+ * 				Up to eight ECUs answer on 0x7e8-0x7ef, each with its own answer latency, supported Mode 0x01 PIDs, trouble
+ * 				codes and vehicle information. They answer Mode 0x01 (up to six PIDs per request), Mode 0x02 frame 0, which
+ * 				an ECU keeps while it has stored codes, Modes 0x03, 0x07 and 0x0A, and Mode 0x09 PIDs 0x00, 0x02, 0x04 and
+ * 				0x06. Long answers, e.g. many codes or several PIDs, are left to ISO-TP to send in several frames.
+ *
+ * 				PID values sweep through their range over time, so that a poller sees them change. The values of the
+ * 				freeze frame are those of time 0.
+ *
+ * 				Like the readers, the emulator never touches the bus itself: obd2_emulator_request() takes every request
+ * 				payload, broadcast or unicast, and queues the answers, which obd2_emulator_next_answer() hands out once
+ * 				their latency has passed. Requests an ECU has no answer for go unanswered, as on a car, except for unicast
+ * 				requests for modes it does not know or for frames it does not keep, which it rejects.
+ *
+ * 				The car can be set up in code or read from a configuration file, one setting per line:
+ *
+ * 						# Comment
+ * 						ecu 0 latency 2000													Microseconds from a request to its answer
+ * 						ecu 0 pids 04 05 0c 0d 0f 11								Supported Mode 0x01 PIDs, in hex
+ * 						ecu 0 stored P0301 P0420										Also pending and permanent
+ * 						ecu 0 vin WVWZZZ1JZXW000001
+ * 						ecu 0 calibration 1037353467 4b2a96c1			Calibration ID and its CVN, in hex
+ */
+
+#define OBD2_EMULATOR_MAX_ANSWERS						32
+#define OBD2_EMULATOR_MAX_ANSWER_SIZE				128
+#define OBD2_EMULATOR_MAX_DTCS							16		/* Per ECU and kind */
+#define OBD2_EMULATOR_SWEEP_PERIOD					50000	/* Microseconds per step of the PID values. */
+#define OBD2_EMULATOR_MAX_CONFIG_LINE				256
+
+/* ISO 15765-4 reasons for rejecting a request. */
+#define OBD2_SERVICE_NOT_SUPPORTED					0x11
+#define OBD2_REQUEST_OUT_OF_RANGE						0x31
+
+typedef struct{
+	unsigned int		latency;
+	unsigned int		pids[OBD2_SUPPORTED_PID_WORDS];															/* Mode 0x01 PIDs, as in obd2_supported_pids. */
+	unsigned char		number_of_dtcs[OBD2_DTC_KINDS];
+	unsigned short	dtcs[OBD2_DTC_KINDS][OBD2_EMULATOR_MAX_DTCS];
+	char						vin[OBD2_VIN_SIZE+1];																				/* Empty if the ECU does not tell. */
+	unsigned char		number_of_calibration_ids;
+	char						calibration_ids[OBD2_MAX_CALIBRATION_IDS][OBD2_CALIBRATION_ID_SIZE+1];
+	unsigned int		cvns[OBD2_MAX_CALIBRATION_IDS];
+
+	unsigned long long	requests;
+	unsigned long long	answers;
+	unsigned long long	answered_pids;																						/* Mode 0x01 and 0x02 PIDs answered. */
+}obd2_emulated_ecu;
+
+typedef struct{
+	unsigned char				ecu;
+	unsigned long long	due;
+	unsigned int				length;
+	unsigned char				payload[OBD2_EMULATOR_MAX_ANSWER_SIZE];
+}obd2_emulator_answer;
+
+typedef struct{
+	unsigned int					ecus;		/* Bit n set == the ECU answering with 0x7e8+n is present. */
+	obd2_emulated_ecu			ecu[OBD2_MAX_ECUS];
+
+	/* Answers waiting for their latency to pass, in the order they were queued. */
+	obd2_emulator_answer	answers[OBD2_EMULATOR_MAX_ANSWERS];
+	unsigned int					number_of_answers;
+	unsigned long long		dropped;
+}obd2_emulator;
+
+/* Starts with no ECUs. */
+void init_obd2_emulator(obd2_emulator* emulator);
+
+/* Adds an ECU, given by its index 0-7, which answers after latency microseconds. Returns 0 if there is no such ECU. */
+int obd2_emulator_add_ecu(obd2_emulator* emulator, unsigned int ecu, unsigned int latency);
+
+/* These set up an ECU added before. Return 0 if the ECU is missing, the PID has no descriptor, or there is no room. */
+int obd2_emulator_support_pid(obd2_emulator* emulator, unsigned int ecu, unsigned char pid);
+int obd2_emulator_add_dtc(obd2_emulator* emulator, unsigned int ecu, Obd2_Dtc_Kind kind, unsigned short code);
+int obd2_emulator_set_vin(obd2_emulator* emulator, unsigned int ecu, const char* vin);
+int obd2_emulator_add_calibration(obd2_emulator* emulator, unsigned int ecu, const char* calibration_id, unsigned int cvn);
+
+/* Sets up the car as described by a configuration file. Returns 0 on failure, naming the offending line. */
+int load_obd2_emulator_config(const char* path, obd2_emulator* emulator);
+
+/* Feeds a request payload, starting with the mode byte, sent to request_id (0x7df or 0x7e0-0x7e7) into the emulator.
+ * Returns the number of answers queued. */
+unsigned int obd2_emulator_request(obd2_emulator* emulator, unsigned int request_id, const unsigned char* payload, unsigned int length, unsigned long long now);
+
+/* Returns true and copies the next answer of an ECU into payload, which holds OBD2_EMULATOR_MAX_ANSWER_SIZE bytes,
+ * if it is due. An ECU sends one answer at a time, so only ask for the next once the last one has been sent. */
+bool obd2_emulator_next_answer(obd2_emulator* emulator, unsigned int ecu, unsigned long long now, unsigned char* payload, unsigned int* length);
+
+#endif
@@ -0,0 +1,265 @@
+#include "freeze_frame.h"
+#include "multi_pid.h"
+#include "obd2modes.h"
+#include "obd2pids.h"
+
+#include <string.h>
+
+void init_obd2_freeze_frame_reader(obd2_freeze_frame_reader* reader, unsigned int max_retries){
+	memset(reader, 0x0, sizeof(obd2_freeze_frame_reader));
+	reader->max_retries = max_retries;
+}/*init_obd2_freeze_frame_reader*/
+
+int obd2_freeze_frame_add(obd2_freeze_frame_reader* reader, unsigned int ecu, unsigned char frame){
+	if( (reader->number_of_jobs >= OBD2_MAX_FREEZE_FRAMES) || (ecu >= OBD2_MAX_ECUS) ){
+		return 0;
+	}/*if*/
+
+	obd2_freeze_frame_job* job = &reader->jobs[reader->number_of_jobs];
+	memset(job, 0x0, sizeof(obd2_freeze_frame_job));
+
+	init_obd2_request_timer(&job->timer, reader->max_retries);
+
+	job->snapshot.ecu		= ecu;
+	job->snapshot.frame	= frame;
+	job->stage					= Obd2_Freeze_Frame_Bitmaps;
+	job->next_pid				= SUPPORTED_PIDS;
+
+	reader->number_of_jobs += 1;
+
+	return 1;
+}/*obd2_freeze_frame_add*/
+
+unsigned int obd2_freeze_frame_add_for_dtcs(obd2_freeze_frame_reader* reader, const obd2_dtc_report* report){
+	unsigned int added = 0;
+
+	for(unsigned int ecu = 0; ecu < OBD2_MAX_ECUS; ecu++){
+		if( (report->counts[ecu][Obd2_Dtc_Stored] > 0) && obd2_freeze_frame_add(reader, ecu, 0) ){
+			added += 1;
+		}/*if*/
+	}/*for*/
+
+	return added;
+}/*obd2_freeze_frame_add_for_dtcs*/
+
+static bool is_supported(const obd2_freeze_frame_job* job, unsigned int pid){
+	return (job->supported[pid/32] >> (pid%32)) & 0x1;
+}/*is_supported*/
+
+static void finish_job(obd2_freeze_frame_job* job){
+	decode_obd2_current_data(job->responses, job->number_of_responses, &job->snapshot.data);
+
+	for(unsigned int i = 0; i < job->number_of_responses; i++){
+		if((unsigned char)job->responses[i].pid == DTC_ORIGIN_FOR_FREEZE_FRAME){
+			job->snapshot.dtc = ((unsigned char)job->responses[i].A << 8) | (unsigned char)job->responses[i].B;
+		}/*if*/
+	}/*for*/
+
+	job->stage = Obd2_Freeze_Frame_Done;
+}/*finish_job*/
+
+/* Picks the next PIDs to ask for, finishing the job once there are none left. */
+static void next_batch(obd2_freeze_frame_job* job){
+	job->number_requested = 0;
+
+	if(job->stage == Obd2_Freeze_Frame_Bitmaps){
+		for(unsigned int pid = job->next_pid; (pid <= OBD2_LAST_SUPPORTED_PIDS) && (job->number_requested < OBD2_MAX_FREEZE_FRAME_PIDS_PER_REQUEST); pid += 32){
+			job->requested[job->number_requested++] = pid;
+		}/*for*/
+
+		return;
+	}/*if*/
+
+	while( (job->next_pid < 256) && (job->number_requested < OBD2_MAX_FREEZE_FRAME_PIDS_PER_REQUEST) ){
+		unsigned int pid = job->next_pid++;
+
+		/* Without a descriptor, nothing after the PID could be told apart in the answer. */
+		if( (pid%32 != 0) && is_supported(job, pid) && (find_obd2_pid_descriptor(pid)->encoding != Obd2_Pid_Unlisted) ){
+			job->requested[job->number_requested++] = pid;
+		}/*if*/
+	}/*while*/
+
+	if(job->number_requested == 0){
+		finish_job(job);
+	}/*if*/
+}/*next_batch*/
+
+static void build_request(const obd2_freeze_frame_job* job, obd2_request_freeze_frame* request){
+	memset(request, OBD2_REQUEST_PADDING, sizeof(obd2_request_freeze_frame));
+
+	request->num_extra_bytes	= 1+2*job->number_requested;
+	request->mode							= SHOW_FREEZE_FRAME_DATA;
+
+	for(unsigned int i = 0; i < job->number_requested; i++){
+		request->pids_and_frames[2*i]		= job->requested[i];
+		request->pids_and_frames[2*i+1]	= job->snapshot.frame;
+	}/*for*/
+}/*build_request*/
+
+static bool ecu_busy(const obd2_freeze_frame_reader* reader, unsigned int before, unsigned int ecu){
+	for(unsigned int i = 0; i < before; i++){
+		if( (reader->jobs[i].snapshot.ecu == ecu) && (reader->jobs[i].stage != Obd2_Freeze_Frame_Done) ){
+			return true;
+		}/*if*/
+	}/*for*/
+
+	return false;
+}/*ecu_busy*/
+
+bool obd2_freeze_frame_next_request(obd2_freeze_frame_reader* reader, unsigned long long now, unsigned int* request_id, obd2_request_freeze_frame* request){
+	for(unsigned int i = 0; i < reader->number_of_jobs; i++){
+		obd2_freeze_frame_job* job = &reader->jobs[i];
+
+		if( (job->stage == Obd2_Freeze_Frame_Done) || ecu_busy(reader, i, job->snapshot.ecu) ){
+			continue;
+		}/*if*/
+
+		switch(obd2_request_state(&job->timer, now)){
+			case Obd2_Request_Waiting:
+				continue;
+			case Obd2_Request_Retry:
+				break;
+			case Obd2_Request_Failed:
+				/* Go on without these PIDs, or with the data PIDs known so far. */
+				if(job->stage == Obd2_Freeze_Frame_Bitmaps){
+					job->stage		= Obd2_Freeze_Frame_Data;
+					job->next_pid	= 0;
+				}/*if*/
+				next_batch(job);
+				break;
+			default:
+				if(job->number_requested == 0){
+					next_batch(job);
+				}/*if*/
+				break;
+		}/*switch*/
+
+		if(job->stage == Obd2_Freeze_Frame_Done){
+			continue;
+		}/*if*/
+
+		*request_id = CAN_OBD2_QUERY_MESSAGE_ID_LOW+job->snapshot.ecu;
+		build_request(job, request);
+		obd2_request_sent(&job->timer, *request_id, SHOW_FREEZE_FRAME_DATA, job->requested[0], now);
+		return true;
+	}/*for*/
+
+	return false;
+}/*obd2_freeze_frame_next_request*/
+
+static void take_bitmaps(obd2_freeze_frame_job* job, const obd2_response* responses, unsigned int count){
+	unsigned int	last_requested	= job->requested[job->number_requested-1];
+	bool					more						= false;
+
+	for(unsigned int i = 0; i < count; i++){
+		unsigned int					pid			= (unsigned char)responses[i].pid;
+		const unsigned char*	bitmap	= (const unsigned char*)&responses[i].A;
+		unsigned int					bits		= (bitmap[0] << 24) | (bitmap[1] << 16) | (bitmap[2] << 8) | bitmap[3];
+
+		if( (pid%32 != 0) || ((unsigned char)responses[i].num_extra_bytes < 2+OBD2_PID_BITMAP_BYTES) ){
+			continue;
+		}/*if*/
+
+		/* Bit A7 stands for PID pid+1, bit D0 for PID pid+32. */
+		for(unsigned int bit = 0; bit < 32; bit++){
+			if( (bits & (0x80000000u >> bit)) && (pid+1+bit < 256) ){
+				job->supported[(pid+1+bit)/32] |= 1u << ((pid+1+bit)%32);
+			}/*if*/
+		}/*for*/
+
+		if(pid == last_requested){
+			more = (bits & 0x1) && (pid < OBD2_LAST_SUPPORTED_PIDS);
+		}/*if*/
+	}/*for*/
+
+	if(more){
+		job->next_pid = last_requested+32;
+	}/*if*/
+	else{
+		job->stage		= Obd2_Freeze_Frame_Data;
+		job->next_pid	= 0;
+	}/*else*/
+}/*take_bitmaps*/
+
+bool obd2_freeze_frame_response(obd2_freeze_frame_reader* reader, unsigned int response_id, const unsigned char* payload, unsigned int length, unsigned long long now){
+	if( (response_id < CAN_OBD2_RESPONSE_MESSAGE_ID_LOW) || (response_id > CAN_OBD2_RESPONSE_MESSAGE_ID_HIGH) || (length < 2) ){
+		return false;
+	}/*if*/
+
+	unsigned int						ecu	= response_id-CAN_OBD2_RESPONSE_MESSAGE_ID_LOW;
+	obd2_freeze_frame_job*	job	= 0;
+
+	/* Only one frame of an ECU is read at a time. */
+	for(unsigned int i = 0; (i < reader->number_of_jobs) && (job == 0); i++){
+		if( (reader->jobs[i].snapshot.ecu == ecu) && (reader->jobs[i].stage != Obd2_Freeze_Frame_Done) && (reader->jobs[i].number_requested > 0) ){
+			job = &reader->jobs[i];
+		}/*if*/
+	}/*for*/
+
+	if(job == 0){
+		return false;
+	}/*if*/
+
+	if( (payload[0] == OBD2_NEGATIVE_RESPONSE) && (length >= 3) ){
+		if( (payload[1] != SHOW_FREEZE_FRAME_DATA) || (payload[2] == OBD2_RESPONSE_PENDING) ){
+			return false;
+		}/*if*/
+
+		obd2_request_cancel(&job->timer);
+
+		if(job->stage == Obd2_Freeze_Frame_Bitmaps){
+			/* The ECU keeps no such frame. */
+			job->stage = Obd2_Freeze_Frame_Done;
+		}/*if*/
+		else{
+			job->number_requested = 0;
+		}/*else*/
+
+		return true;
+	}/*if*/
+
+	/* The timer only looks at the mode of a response. */
+	obd2_response response;
+	memset(&response, 0x0, sizeof(response));
+	response.mode = payload[0];
+
+	if( (payload[0] != SHOW_FREEZE_FRAME_DATA+MODE_RESPONSE_DELTA) || !obd2_response_received(&job->timer, response_id, &response, now) ){
+		return false;
+	}/*if*/
+
+	job->snapshot.present = true;
+
+	if(job->stage == Obd2_Freeze_Frame_Bitmaps){
+		obd2_response bitmaps[OBD2_MAX_FREEZE_FRAME_PIDS_PER_REQUEST];
+		unsigned int	count = parse_obd2_freeze_frame_response(payload, length, job->snapshot.frame, bitmaps, OBD2_MAX_FREEZE_FRAME_PIDS_PER_REQUEST);
+
+		take_bitmaps(job, bitmaps, count);
+	}/*if*/
+	else{
+		job->number_of_responses += parse_obd2_freeze_frame_response(payload, length, job->snapshot.frame, job->responses+job->number_of_responses,
+																																 OBD2_MAX_DECODED_RESPONSES-job->number_of_responses);
+	}/*else*/
+
+	job->number_requested = 0;
+
+	return true;
+}/*obd2_freeze_frame_response*/
+
+bool obd2_freeze_frame_is_complete(const obd2_freeze_frame_reader* reader){
+	for(unsigned int i = 0; i < reader->number_of_jobs; i++){
+		if(reader->jobs[i].stage != Obd2_Freeze_Frame_Done){
+			return false;
+		}/*if*/
+	}/*for*/
+
+	return true;
+}/*obd2_freeze_frame_is_complete*/
+
+unsigned int parse_obd2_freeze_frame_response(const unsigned char* payload, unsigned int length, unsigned char frame, obd2_response* responses, unsigned int max_responses){
+	if( (length < 1) || (payload[0] != SHOW_FREEZE_FRAME_DATA+MODE_RESPONSE_DELTA) ){
+		return 0;
+	}/*if*/
+
+	/* Each PID is followed by the frame number. */
+	return split_obd2_pid_response(payload, length, 1, frame, responses, max_responses);
+}/*parse_obd2_freeze_frame_response*/
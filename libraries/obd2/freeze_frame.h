@@ -0,0 +1,95 @@
+#ifndef OBD2_FREEZE_FRAME_H
+#define OBD2_FREEZE_FRAME_H
+
+#include "obd2can.h"
+#include "pid_descriptors.h"
+#include "pid_discovery.h"
+#include "dtc_scan.h"
+#include "request_timer.h"
+
+/* @NOTE: Reads freeze frames (Mode 0x02), the PID values an ECU stored when it set a trouble code.
+ *
+ * 				A freeze frame holds Mode 0x01 PIDs, encoded the same way, so they are decoded with the same descriptor table.
+ * 				Every PID in a request and in its answer is followed by the number of the frame:
+ *
+ * 						request:	0x02 PID1 frame PID2 frame PID3 frame
+ * 						answer:		0x42 PID1 frame data1... PID2 frame data2... ...
+ *
+ * 				which leaves room for three PIDs per request. PID 0x02 of a frame is the trouble code which stored it.
+ *
+ * 				The reader first walks the supported PID bitmaps of the frame, three bitmaps per request, and then asks for
+ * 				every supported PID three at a time. Answers spanning several frames are expected to have been put back
+ * 				together by ISO-TP. Frames of different ECUs are read at the same time, each with a request timer of its
+ * 				own; the frames of one ECU are read one after the other. An ECU rejecting the request has no such frame.
+ * 				Once all its PIDs have been answered, a frame is decoded into one snapshot.
+ *
+ * 				The reader never touches the bus itself: obd2_freeze_frame_next_request() hands out the requests to send
+ * 				and obd2_freeze_frame_response() takes every answer.
+ */
+
+#define OBD2_MAX_FREEZE_FRAME_PIDS_PER_REQUEST	3
+#define OBD2_MAX_FREEZE_FRAMES									8
+
+typedef struct{
+	char	num_extra_bytes;
+	char	mode;
+	char	pids_and_frames[2*OBD2_MAX_FREEZE_FRAME_PIDS_PER_REQUEST];
+}obd2_request_freeze_frame;
+
+typedef enum{
+	Obd2_Freeze_Frame_Bitmaps,
+	Obd2_Freeze_Frame_Data,
+	Obd2_Freeze_Frame_Done
+}Obd2_Freeze_Frame_Stage;
+
+/* One freeze frame, decoded. */
+typedef struct{
+	unsigned char				ecu;
+	unsigned char				frame;
+	unsigned short			dtc;				/* The code which stored the frame, 0 if the ECU did not tell. */
+	bool								present;		/* The ECU answered for this frame. */
+	obd2_current_data		data;
+}obd2_freeze_frame;
+
+typedef struct{
+	obd2_freeze_frame				snapshot;
+	Obd2_Freeze_Frame_Stage	stage;
+
+	obd2_request_timer			timer;
+	unsigned int						supported[OBD2_SUPPORTED_PID_WORDS];
+	unsigned int						next_pid;			/* The next bitmap or data PID to ask for. */
+	unsigned char						requested[OBD2_MAX_FREEZE_FRAME_PIDS_PER_REQUEST];
+	unsigned int						number_requested;
+
+	obd2_response						responses[OBD2_MAX_DECODED_RESPONSES];
+	unsigned int						number_of_responses;
+}obd2_freeze_frame_job;
+
+typedef struct{
+	obd2_freeze_frame_job		jobs[OBD2_MAX_FREEZE_FRAMES];
+	unsigned int						number_of_jobs;
+	unsigned int						max_retries;
+}obd2_freeze_frame_reader;
+
+void init_obd2_freeze_frame_reader(obd2_freeze_frame_reader* reader, unsigned int max_retries);
+
+/* Queues a frame of an ECU, given by its index 0-7. Returns 0 if the reader is full. */
+int obd2_freeze_frame_add(obd2_freeze_frame_reader* reader, unsigned int ecu, unsigned char frame);
+
+/* Queues frame 0 of every ECU with stored trouble codes, the frame OBD-II requires them to keep.
+ * Returns the number of frames queued. */
+unsigned int obd2_freeze_frame_add_for_dtcs(obd2_freeze_frame_reader* reader, const obd2_dtc_report* report);
+
+/* Returns true and fills in a request to send now. Call until it returns false. */
+bool obd2_freeze_frame_next_request(obd2_freeze_frame_reader* reader, unsigned long long now, unsigned int* request_id, obd2_request_freeze_frame* request);
+
+/* Feeds a response payload, starting with the mode byte, into the reader. Returns true if it was a freeze frame answer. */
+bool obd2_freeze_frame_response(obd2_freeze_frame_reader* reader, unsigned int response_id, const unsigned char* payload, unsigned int length, unsigned long long now);
+
+bool obd2_freeze_frame_is_complete(const obd2_freeze_frame_reader* reader);
+
+/* Splits a Mode 0x02 answer payload, starting with the mode byte, into one response per PID of the given frame.
+ * The frame numbers are dropped, so the responses decode like Mode 0x01 ones. Returns the number of responses stored. */
+unsigned int parse_obd2_freeze_frame_response(const unsigned char* payload, unsigned int length, unsigned char frame, obd2_response* responses, unsigned int max_responses);
+
+#endif
@@ -0,0 +1,80 @@
+#include "multi_pid.h"
+#include "pid_descriptors.h"
+#include "obd2modes.h"
+
+#include <string.h>
+
+unsigned int obd2_multi_pid_response_size(const unsigned char* pids, unsigned int count){
+	unsigned int size = 1;
+
+	for(unsigned int i = 0; i < count; i++){
+		size += 1+find_obd2_pid_descriptor(pids[i])->data_bytes;
+	}/*for*/
+
+	return size;
+}/*obd2_multi_pid_response_size*/
+
+unsigned int build_obd2_multi_pid_request(obd2_request_multiple_pids* request, const unsigned char* pids, unsigned int count, unsigned int max_response_payload){
+	unsigned int packed					= 0;
+	unsigned int response_size	= 1;
+
+	memset(request, OBD2_REQUEST_PADDING, sizeof(obd2_request_multiple_pids));
+
+	while( (packed < count) && (packed < OBD2_MAX_PIDS_PER_REQUEST) ){
+		unsigned int size = 1+find_obd2_pid_descriptor(pids[packed])->data_bytes;
+
+		/* A single PID is always requested, even if its answer will not fit. */
+		if( (packed > 0) && (response_size+size > max_response_payload) ){
+			break;
+		}/*if*/
+
+		request->pids[packed]	= pids[packed];
+		response_size					+= size;
+		packed								+= 1;
+	}/*while*/
+
+	request->num_extra_bytes	= 1+packed;
+	request->mode							= SHOW_CURRENT_DATA;
+
+	return packed;
+}/*build_obd2_multi_pid_request*/
+
+unsigned int split_obd2_pid_response(const unsigned char* payload, unsigned int length, unsigned int frame_bytes, unsigned char frame, obd2_response* responses, unsigned int max_responses){
+	unsigned int offset					= 1;
+	unsigned int number_of_pids	= 0;
+
+	while( (offset+frame_bytes < length) && (number_of_pids < max_responses) ){
+		const obd2_pid_descriptor*	descriptor	= find_obd2_pid_descriptor(payload[offset]);
+		unsigned int								data_bytes	= descriptor->data_bytes;
+		unsigned int								data_offset	= offset+1+frame_bytes;
+
+		if( (descriptor->encoding == Obd2_Pid_Unlisted) || (data_offset+data_bytes > length) ){
+			/* Without its length, nothing after this PID can be told apart. */
+			break;
+		}/*if*/
+
+		if( (frame_bytes == 0) || (payload[offset+1] == frame) ){
+			obd2_response* response = &responses[number_of_pids];
+			memset(response, 0x0, sizeof(obd2_response));
+
+			response->num_extra_bytes	= 2+(data_bytes < OBD2_RESPONSE_DATA_BYTES ? data_bytes : OBD2_RESPONSE_DATA_BYTES);
+			response->mode						= payload[0];
+			response->pid							= payload[offset];
+			memcpy(&response->A, payload+data_offset, data_bytes < OBD2_RESPONSE_DATA_BYTES ? data_bytes : OBD2_RESPONSE_DATA_BYTES);
+
+			number_of_pids += 1;
+		}/*if*/
+
+		offset = data_offset+data_bytes;
+	}/*while*/
+
+	return number_of_pids;
+}/*split_obd2_pid_response*/
+
+unsigned int parse_obd2_multi_pid_response(const unsigned char* payload, unsigned int length, obd2_response* responses, unsigned int max_responses){
+	if( (length < 1) || (payload[0] != SHOW_CURRENT_DATA+MODE_RESPONSE_DELTA) ){
+		return 0;
+	}/*if*/
+
+	return split_obd2_pid_response(payload, length, 0, 0, responses, max_responses);
+}/*parse_obd2_multi_pid_response*/
@@ -0,0 +1,42 @@
+#ifndef OBD2_MULTI_PID_H
+#define OBD2_MULTI_PID_H
+
+#include "obd2can.h"
+
+/* @NOTE: On CAN, a single Mode 0x01 request may ask for up to six PIDs at once. The ECU answers with one response holding
+ * 				every supported PID followed by its data bytes, in the order they were requested:
+ *
+ * 						0x41 PID1 data1... PID2 data2... ...
+ *
+ * 				The response is split up again using the data byte counts in pid_descriptors.h, into one obd2_response per PID,
+ * 				which decode like any other response. A response of more than 7 bytes spans several frames, so unless the
+ * 				transport reassembles ISO-TP messages (see can/isotp.hpp), requests are limited to what fits into a single frame.
+ */
+
+#define OBD2_MAX_PIDS_PER_REQUEST				6
+#define OBD2_SINGLE_FRAME_PAYLOAD				7
+#define OBD2_MAX_RESPONSE_PAYLOAD				4095
+
+typedef struct{
+	char	num_extra_bytes;
+	char	mode;
+	char	pids[OBD2_MAX_PIDS_PER_REQUEST];
+}obd2_request_multiple_pids;
+
+/* Packs the PIDs from the start of pids into a request, as many as fit in a request and whose answers fit into
+ * max_response_payload bytes. Returns the number of PIDs packed - at least one unless count is 0. */
+unsigned int build_obd2_multi_pid_request(obd2_request_multiple_pids* request, const unsigned char* pids, unsigned int count, unsigned int max_response_payload);
+
+/* The size of the response to a set of PIDs, counting the mode byte. */
+unsigned int obd2_multi_pid_response_size(const unsigned char* pids, unsigned int count);
+
+/* Splits a Mode 0x01 response payload, starting with the mode byte, into one response per PID.
+ * Stops at a PID of unknown length. Returns the number of responses stored. */
+unsigned int parse_obd2_multi_pid_response(const unsigned char* payload, unsigned int length, obd2_response* responses, unsigned int max_responses);
+
+/* Splits any response payload of PIDs, each followed by frame_bytes bytes and its data bytes, e.g. the frame number of
+ * Mode 0x02. With a frame byte, only the PIDs of the given frame are stored. Stops at a PID of unknown length.
+ * Returns the number of responses stored. */
+unsigned int split_obd2_pid_response(const unsigned char* payload, unsigned int length, unsigned int frame_bytes, unsigned char frame, obd2_response* responses, unsigned int max_responses);
+
+#endif
@@ -19,6 +19,14 @@
 #define CAN_OBD2_RESPONSE_MESSAGE_ID_HIGH				0x7ef
 #define CAN_OBD2_QUERY_SAE_STANDARD_DATA_LENGTH	0x2
 
+/* An ECU rejecting a request answers 0x7f, the mode and a reason, which may be a plea for more time. */
+#define OBD2_NEGATIVE_RESPONSE									0x7f
+#define OBD2_RESPONSE_PENDING										0x78
+
+#define OBD2_RESPONSE_DATA_BYTES								5				/* A-D and Extra of a single frame response. */
+#define OBD2_REQUEST_PADDING										0x55		/* Fills the unused bytes of a request frame. */
+#define OBD2_PID_BITMAP_BYTES										4				/* A supported PID bitmap, one bit for each of the next 32 PIDs. */
+
 typedef struct{
 	char	num_extra_bytes = CAN_OBD2_QUERY_SAE_STANDARD_DATA_LENGTH;
 	char	mode						= SHOW_CURRENT_DATA;
@@ -31,9 +39,9 @@ typedef struct{
 }obd2_request_current_data;
 
 typedef struct{
-  char  num_extra_bytes = CAN_OBD2_QUERY_SAE_STANDARD_DATA_LENGTH;
+  char  num_extra_bytes = 1;		/* On CAN, Mode 0x03, 0x07 and 0x0A take no PID. */
   char  mode            = SHOW_STORED_DIAGNOSTIC_TROUBLE_CODES;
-  char  pid             = REQUEST_TROUBLE_CODES;
+  char  padding         = 0x55;
   char  A               = 0x55;
   char  B               = 0x55;
   char  C               = 0x55;
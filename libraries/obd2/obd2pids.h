@@ -59,6 +59,8 @@ typedef enum{
 	EVAPORATIVE_SYSTEM_VAPOR_PRESSURE	= 0x32,	/* Min: -8192	Max: 8192			Unit:	Pa				Formula: ((A*256)+B/4		Note: A and B are 2's complement signed		*/
 	BAROMETRIC_PRESSURE								= 0x33, /* Min: 0			Max: 255			Unit: kPa				Formula: A									*/
 
+	SUPPORTED_PIDS_41_60							= 0x40, /* Bit encoded [A7..D0] == [PID $41.. PID $60] */
+
 	CONTROL_MODULE_VOLTAGE						= 0x42, /* Min: 0			Max: 65.535		Unit: Volts			Formula: ((A*256)+B)/1000		*/
 	ABSOLUTE_LOAD_VALUE								= 0x43,	/* Min: 0			Max: 25700		Unit: %					Formula: ((A*256)+B)*100/255	*/
 	FUEL_AIR_COMMANDED_EQUIVALENCE_RATIO	= 0x44, /* Min: 0	Max: 2				Unit: N/A				Formula: ((A*256)+B)/32768	*/
@@ -0,0 +1,45 @@
+#include "pid_descriptors.h"
+#include "obd2modes.h"
+
+static inline bool decode_response(const obd2_response* response, unsigned int* raw, float* value, data_unit* unit){
+	const obd2_pid_descriptor*	descriptor	= find_obd2_pid_descriptor((unsigned char)response->pid);
+	const unsigned char*				bytes				= (const unsigned char*)&response->A;
+
+	unsigned long long word = ((unsigned long long)bytes[0] << 32) | ((unsigned long long)bytes[1] << 24) |
+														((unsigned long long)bytes[2] << 16) | ((unsigned long long)bytes[3] << 8) | bytes[4];
+
+	/* Unlisted PIDs have no value bytes, which leaves an empty mask. */
+	unsigned int				shift	= 8*(OBD2_RESPONSE_DATA_BYTES-descriptor->first_byte-descriptor->value_bytes);
+	unsigned long long	mask	= (1ULL << (8*descriptor->value_bytes))-1;
+	unsigned long long	sign	= mask & ~(mask >> 1) & (0ULL-descriptor->is_signed);
+	unsigned long long	bits	= (word >> shift) & mask;
+
+	*raw		= (unsigned int)bits;
+	*value	= (float)((long long)(bits ^ sign)-(long long)sign)*descriptor->scale+descriptor->offset;
+	*unit		= descriptor->unit;
+
+	/* Freeze frames hold the same PIDs, encoded the same way. */
+	return (((unsigned char)response->mode == SHOW_CURRENT_DATA+MODE_RESPONSE_DELTA) | ((unsigned char)response->mode == SHOW_FREEZE_FRAME_DATA+MODE_RESPONSE_DELTA)) &
+				 ((unsigned char)response->num_extra_bytes >= 2+descriptor->first_byte+descriptor->value_bytes) &
+				 (descriptor->encoding != Obd2_Pid_Unlisted);
+}/*decode_response*/
+
+unsigned int decode_obd2_current_data(const obd2_response* responses, unsigned int count, obd2_current_data* data){
+	if(count > OBD2_MAX_DECODED_RESPONSES){
+		count = OBD2_MAX_DECODED_RESPONSES;
+	}
+
+	for(unsigned int i = 0; i < count; i++){
+		data->pid[i]		= (unsigned char)responses[i].pid;
+		data->valid[i]	= decode_response(&responses[i], &data->raw[i], &data->value[i], &data->unit[i]);
+	}/*for*/
+
+	data->count = count;
+
+	return count;
+}/*decode_obd2_current_data*/
+
+bool decode_obd2_pid(const obd2_response* response, unsigned int* raw, float* value){
+	data_unit unit;
+	return decode_response(response, raw, value, &unit);
+}/*decode_obd2_pid*/
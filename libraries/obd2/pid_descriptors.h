@@ -0,0 +1,201 @@
+#ifndef OBD2_PID_DESCRIPTORS_H
+#define OBD2_PID_DESCRIPTORS_H
+
+#include "obd2can.h"
+#include "data_distribution/distribution_areas.h"
+
+/* @NOTE: Describes how every Mode 0x01 PID is decoded, in a table indexed by the PID.
+ *
+ * 				The value of a PID is an unsigned big-endian number of value_bytes bytes, starting first_byte bytes
+ * 				after the PID (0 == A), optionally two's complement signed, and converted as
+ *
+ * 						value = raw*scale + offset
+ *
+ * 				Bit encoded and enumerated PIDs are described the same way with a scale of 1, so raw holds the bits.
+ * 				PIDs which report more than one quantity, e.g. the oxygen sensors, are described by their first one;
+ * 				the others can be taken from the response bytes.
+ * 				PIDs which are not part of MODE_ONE_PIDS are listed as Obd2_Pid_Unlisted and decode to 0.
+ * 				The supported PID bitmaps, every 0x20th PID, are all described, also those past the table, so that their
+ * 				length is known wherever PIDs are split up.
+ *
+ * 				Since every PID is described by the same handful of numbers, decode_obd2_current_data() decodes a batch
+ * 				of responses in one loop of loads, shifts and multiply-adds without branching on the PID.
+ */
+
+#define OBD2_MODE_ONE_PIDS				0x78
+#define OBD2_MAX_DECODED_RESPONSES	64
+
+typedef enum{
+	Obd2_Pid_Unlisted,
+	Obd2_Pid_Linear,
+	Obd2_Pid_Bit_Encoded,
+	Obd2_Pid_Enumerated
+}Obd2_Pid_Encoding;
+
+typedef struct{
+	unsigned char				pid;
+	const char*					name;
+	unsigned char				data_bytes;		/* Bytes following the PID in the response. */
+	unsigned char				first_byte;
+	unsigned char				value_bytes;
+	Obd2_Pid_Encoding		encoding;
+	bool								is_signed;
+	float								scale;
+	float								offset;
+	data_unit						unit;
+}obd2_pid_descriptor;
+
+constexpr obd2_pid_descriptor obd2_mode_one_pids[] = {
+	{SUPPORTED_PIDS,                           "SUPPORTED_PIDS",                           4,  0, 4, Obd2_Pid_Bit_Encoded, false, 1.0f,          0.0f,    Counts},
+	{MONITOR_STATUS,                           "MONITOR_STATUS",                           4,  0, 4, Obd2_Pid_Bit_Encoded, false, 1.0f,          0.0f,    Counts},
+	{FREEZE_DTC,                               "FREEZE_DTC",                               2,  0, 2, Obd2_Pid_Bit_Encoded, false, 1.0f,          0.0f,    Counts},
+	{FUEL_SYSTEM_STATUS,                       "FUEL_SYSTEM_STATUS",                       2,  0, 2, Obd2_Pid_Bit_Encoded, false, 1.0f,          0.0f,    Counts},
+	{ENGINE_LOAD,                              "ENGINE_LOAD",                              1,  0, 1, Obd2_Pid_Linear,      false, 100.0f/255.0f, 0.0f,    Percent},
+	{ENGINE_COOLANT_TEMP,                      "ENGINE_COOLANT_TEMP",                      1,  0, 1, Obd2_Pid_Linear,      false, 1.0f,          -40.0f,  Centigrade},
+	{SHORT_TERM_FUEL_PERC_TRIM_BANK_1,         "SHORT_TERM_FUEL_PERC_TRIM_BANK_1",         1,  0, 1, Obd2_Pid_Linear,      false, 100.0f/128.0f, -100.0f, Percent},
+	{SHORT_TERM_FUEL_PERC_TRIM_BANK_11,        "SHORT_TERM_FUEL_PERC_TRIM_BANK_11",        1,  0, 1, Obd2_Pid_Linear,      false, 100.0f/128.0f, -100.0f, Percent},
+	{SHORT_TERM_FUEL_PERC_TRIM_BANK_2,         "SHORT_TERM_FUEL_PERC_TRIM_BANK_2",         1,  0, 1, Obd2_Pid_Linear,      false, 100.0f/128.0f, -100.0f, Percent},
+	{SHORT_TERM_FUEL_PERC_TRIM_BANK_22,        "SHORT_TERM_FUEL_PERC_TRIM_BANK_22",        1,  0, 1, Obd2_Pid_Linear,      false, 100.0f/128.0f, -100.0f, Percent},
+	{FUEL_PRESSURE,                            "FUEL_PRESSURE",                            1,  0, 1, Obd2_Pid_Linear,      false, 3.0f,          0.0f,    Kilopascals},
+	{INTAKE_MANIFOLD_PRESSURE,                 "INTAKE_MANIFOLD_PRESSURE",                 1,  0, 1, Obd2_Pid_Linear,      false, 1.0f,          0.0f,    Kilopascals},
+	{ENGINE_RPM,                               "ENGINE_RPM",                               2,  0, 2, Obd2_Pid_Linear,      false, 0.25f,         0.0f,    Revolutions_Per_Minute},
+	{VEHICLE_SPEED,                            "VEHICLE_SPEED",                            1,  0, 1, Obd2_Pid_Linear,      false, 1.0f,          0.0f,    Kilometres_Per_Hour},
+	{TIMING_ADVANCE,                           "TIMING_ADVANCE",                           1,  0, 1, Obd2_Pid_Linear,      false, 0.5f,          -64.0f,  Degrees},
+	{INTAKE_AIR_TEMPERATURE,                   "INTAKE_AIR_TEMPERATURE",                   1,  0, 1, Obd2_Pid_Linear,      false, 1.0f,          -40.0f,  Centigrade},
+	{MAF_AIR_FLOW_RATE,                        "MAF_AIR_FLOW_RATE",                        2,  0, 2, Obd2_Pid_Linear,      false, 0.01f,         0.0f,    Grams_Per_Second},
+	{THROTTLE_POSITION,                        "THROTTLE_POSITION",                        1,  0, 1, Obd2_Pid_Linear,      false, 100.0f/255.0f, 0.0f,    Percent},
+	{COMMANDED_SECONDARY_AIR_STATUS,           "COMMANDED_SECONDARY_AIR_STATUS",           1,  0, 1, Obd2_Pid_Bit_Encoded, false, 1.0f,          0.0f,    Counts},
+	{OXYGEN_SENSORS_PRESENT,                   "OXYGEN_SENSORS_PRESENT",                   1,  0, 1, Obd2_Pid_Bit_Encoded, false, 1.0f,          0.0f,    Counts},
+	{OXYGEN_SENSOR_VOLTAGE_BANK_1_SENSOR_1,    "OXYGEN_SENSOR_VOLTAGE_BANK_1_SENSOR_1",    2,  0, 1, Obd2_Pid_Linear,      false, 0.005f,        0.0f,    Volt},
+	{OXYGEN_SENSOR_VOLTAGE_BANK_1_SENSOR_2,    "OXYGEN_SENSOR_VOLTAGE_BANK_1_SENSOR_2",    2,  0, 1, Obd2_Pid_Linear,      false, 0.005f,        0.0f,    Volt},
+	{OXYGEN_SENSOR_VOLTAGE_BANK_1_SENSOR_3,    "OXYGEN_SENSOR_VOLTAGE_BANK_1_SENSOR_3",    2,  0, 1, Obd2_Pid_Linear,      false, 0.005f,        0.0f,    Volt},
+	{OXYGEN_SENSOR_VOLTAGE_BANK_1_SENSOR_4,    "OXYGEN_SENSOR_VOLTAGE_BANK_1_SENSOR_4",    2,  0, 1, Obd2_Pid_Linear,      false, 0.005f,        0.0f,    Volt},
+	{OXYGEN_SENSOR_VOLTAGE_BANK_2_SENSOR_1,    "OXYGEN_SENSOR_VOLTAGE_BANK_2_SENSOR_1",    2,  0, 1, Obd2_Pid_Linear,      false, 0.005f,        0.0f,    Volt},
+	{OXYGEN_SENSOR_VOLTAGE_BANK_2_SENSOR_2,    "OXYGEN_SENSOR_VOLTAGE_BANK_2_SENSOR_2",    2,  0, 1, Obd2_Pid_Linear,      false, 0.005f,        0.0f,    Volt},
+	{OXYGEN_SENSOR_VOLTAGE_BANK_2_SENSOR_3,    "OXYGEN_SENSOR_VOLTAGE_BANK_2_SENSOR_3",    2,  0, 1, Obd2_Pid_Linear,      false, 0.005f,        0.0f,    Volt},
+	{OXYGEN_SENSOR_VOLTAGE_BANK_2_SENSOR_4,    "OXYGEN_SENSOR_VOLTAGE_BANK_2_SENSOR_4",    2,  0, 1, Obd2_Pid_Linear,      false, 0.005f,        0.0f,    Volt},
+	{CONFORMED_OBD_STANDARDS,                  "CONFORMED_OBD_STANDARDS",                  1,  0, 1, Obd2_Pid_Enumerated,  false, 1.0f,          0.0f,    Counts},
+	{OXYGEN_SENSORS_PRESENT_2,                 "OXYGEN_SENSORS_PRESENT_2",                 1,  0, 1, Obd2_Pid_Bit_Encoded, false, 1.0f,          0.0f,    Counts},
+	{AUXILIARY_INPUT_STATUS,                   "AUXILIARY_INPUT_STATUS",                   1,  0, 1, Obd2_Pid_Bit_Encoded, false, 1.0f,          0.0f,    Counts},
+	{RUNTIME_SINCE_ENGINE_START,               "RUNTIME_SINCE_ENGINE_START",               2,  0, 2, Obd2_Pid_Linear,      false, 1.0f,          0.0f,    Seconds},
+	{SUPPORTED_PIDS_2,                         "SUPPORTED_PIDS_2",                         4,  0, 4, Obd2_Pid_Bit_Encoded, false, 1.0f,          0.0f,    Counts},
+	{DISTANCE_TRAVELED_WITH_CEL,               "DISTANCE_TRAVELED_WITH_CEL",               2,  0, 2, Obd2_Pid_Linear,      false, 1.0f,          0.0f,    Kilometres},
+	{FUEL_RAIL_PRESSURE,                       "FUEL_RAIL_PRESSURE",                       2,  0, 2, Obd2_Pid_Linear,      false, 0.079f,        0.0f,    Kilopascals},
+	{FUEL_RAIL_PRESSURE_DIRECT_INJECT,         "FUEL_RAIL_PRESSURE_DIRECT_INJECT",         2,  0, 2, Obd2_Pid_Linear,      false, 10.0f,         0.0f,    Kilopascals},
+	{0x24,                                     "",                                         0,  0, 0, Obd2_Pid_Unlisted,    false, 0.0f,          0.0f,    Counts},
+	{0x25,                                     "",                                         0,  0, 0, Obd2_Pid_Unlisted,    false, 0.0f,          0.0f,    Counts},
+	{0x26,                                     "",                                         0,  0, 0, Obd2_Pid_Unlisted,    false, 0.0f,          0.0f,    Counts},
+	{0x27,                                     "",                                         0,  0, 0, Obd2_Pid_Unlisted,    false, 0.0f,          0.0f,    Counts},
+	{0x28,                                     "",                                         0,  0, 0, Obd2_Pid_Unlisted,    false, 0.0f,          0.0f,    Counts},
+	{0x29,                                     "",                                         0,  0, 0, Obd2_Pid_Unlisted,    false, 0.0f,          0.0f,    Counts},
+	{0x2A,                                     "",                                         0,  0, 0, Obd2_Pid_Unlisted,    false, 0.0f,          0.0f,    Counts},
+	{0x2B,                                     "",                                         0,  0, 0, Obd2_Pid_Unlisted,    false, 0.0f,          0.0f,    Counts},
+	{COMMANDED_EXHAUST_GAS_RECIRCULATION,      "COMMANDED_EXHAUST_GAS_RECIRCULATION",      1,  0, 1, Obd2_Pid_Linear,      false, 100.0f/255.0f, 0.0f,    Percent},
+	{EXHAUST_GAS_RECIRCULATION_ERROR,          "EXHAUST_GAS_RECIRCULATION_ERROR",          1,  0, 1, Obd2_Pid_Linear,      false, 100.0f/128.0f, -100.0f, Percent},
+	{COMMANDED_EVAPORATIVE_PURGE,              "COMMANDED_EVAPORATIVE_PURGE",              1,  0, 1, Obd2_Pid_Linear,      false, 100.0f/255.0f, 0.0f,    Percent},
+	{FUEL_LEVEL_INPUT,                         "FUEL_LEVEL_INPUT",                         1,  0, 1, Obd2_Pid_Linear,      false, 100.0f/255.0f, 0.0f,    Percent},
+	{NUMBER_OF_WARMUPS_SINCE_CODES_CLEARED,    "NUMBER_OF_WARMUPS_SINCE_CODES_CLEARED",    1,  0, 1, Obd2_Pid_Linear,      false, 1.0f,          0.0f,    Counts},
+	{DISTANCE_TRAVELED_SINCE_CODES_CLEARED,    "DISTANCE_TRAVELED_SINCE_CODES_CLEARED",    2,  0, 2, Obd2_Pid_Linear,      false, 1.0f,          0.0f,    Kilometres},
+	{EVAPORATIVE_SYSTEM_VAPOR_PRESSURE,        "EVAPORATIVE_SYSTEM_VAPOR_PRESSURE",        2,  0, 2, Obd2_Pid_Linear,      true,  0.25f,         0.0f,    Pascal},
+	{BAROMETRIC_PRESSURE,                      "BAROMETRIC_PRESSURE",                      1,  0, 1, Obd2_Pid_Linear,      false, 1.0f,          0.0f,    Kilopascals},
+	{0x34,                                     "",                                         0,  0, 0, Obd2_Pid_Unlisted,    false, 0.0f,          0.0f,    Counts},
+	{0x35,                                     "",                                         0,  0, 0, Obd2_Pid_Unlisted,    false, 0.0f,          0.0f,    Counts},
+	{0x36,                                     "",                                         0,  0, 0, Obd2_Pid_Unlisted,    false, 0.0f,          0.0f,    Counts},
+	{0x37,                                     "",                                         0,  0, 0, Obd2_Pid_Unlisted,    false, 0.0f,          0.0f,    Counts},
+	{0x38,                                     "",                                         0,  0, 0, Obd2_Pid_Unlisted,    false, 0.0f,          0.0f,    Counts},
+	{0x39,                                     "",                                         0,  0, 0, Obd2_Pid_Unlisted,    false, 0.0f,          0.0f,    Counts},
+	{0x3A,                                     "",                                         0,  0, 0, Obd2_Pid_Unlisted,    false, 0.0f,          0.0f,    Counts},
+	{0x3B,                                     "",                                         0,  0, 0, Obd2_Pid_Unlisted,    false, 0.0f,          0.0f,    Counts},
+	{0x3C,                                     "",                                         0,  0, 0, Obd2_Pid_Unlisted,    false, 0.0f,          0.0f,    Counts},
+	{0x3D,                                     "",                                         0,  0, 0, Obd2_Pid_Unlisted,    false, 0.0f,          0.0f,    Counts},
+	{0x3E,                                     "",                                         0,  0, 0, Obd2_Pid_Unlisted,    false, 0.0f,          0.0f,    Counts},
+	{0x3F,                                     "",                                         0,  0, 0, Obd2_Pid_Unlisted,    false, 0.0f,          0.0f,    Counts},
+	{SUPPORTED_PIDS_41_60,                     "SUPPORTED_PIDS_41_60",                     4,  0, 4, Obd2_Pid_Bit_Encoded, false, 1.0f,          0.0f,    Counts},
+	{0x41,                                     "",                                         0,  0, 0, Obd2_Pid_Unlisted,    false, 0.0f,          0.0f,    Counts},
+	{CONTROL_MODULE_VOLTAGE,                   "CONTROL_MODULE_VOLTAGE",                   2,  0, 2, Obd2_Pid_Linear,      false, 0.001f,        0.0f,    Volt},
+	{ABSOLUTE_LOAD_VALUE,                      "ABSOLUTE_LOAD_VALUE",                      2,  0, 2, Obd2_Pid_Linear,      false, 100.0f/255.0f, 0.0f,    Percent},
+	{FUEL_AIR_COMMANDED_EQUIVALENCE_RATIO,     "FUEL_AIR_COMMANDED_EQUIVALENCE_RATIO",     2,  0, 2, Obd2_Pid_Linear,      false, 1.0f/32768.0f, 0.0f,    Fraction},
+	{RELATIVE_THROTTLE_POSITION,               "RELATIVE_THROTTLE_POSITION",               1,  0, 1, Obd2_Pid_Linear,      false, 100.0f/255.0f, 0.0f,    Percent},
+	{AMBIENT_AIR_TEMPERATURE,                  "AMBIENT_AIR_TEMPERATURE",                  1,  0, 1, Obd2_Pid_Linear,      false, 1.0f,          -40.0f,  Centigrade},
+	{ABSOLUTE_THROTTLE_POSITION_B,             "ABSOLUTE_THROTTLE_POSITION_B",             1,  0, 1, Obd2_Pid_Linear,      false, 100.0f/255.0f, 0.0f,    Percent},
+	{ABSOLUTE_THROTTLE_POSITION_C,             "ABSOLUTE_THROTTLE_POSITION_C",             1,  0, 1, Obd2_Pid_Linear,      false, 100.0f/255.0f, 0.0f,    Percent},
+	{ACCELERATOR_PEDAL_POSITION_D,             "ACCELERATOR_PEDAL_POSITION_D",             1,  0, 1, Obd2_Pid_Linear,      false, 100.0f/255.0f, 0.0f,    Percent},
+	{ACCELERATOR_PEDAL_POSITION_E,             "ACCELERATOR_PEDAL_POSITION_E",             1,  0, 1, Obd2_Pid_Linear,      false, 100.0f/255.0f, 0.0f,    Percent},
+	{ACCELERATOR_PEDAL_POSITION_F,             "ACCELERATOR_PEDAL_POSITION_F",             1,  0, 1, Obd2_Pid_Linear,      false, 100.0f/255.0f, 0.0f,    Percent},
+	{COMMANDED_THROTTLE_ACTUATOR,              "COMMANDED_THROTTLE_ACTUATOR",              1,  0, 1, Obd2_Pid_Linear,      false, 100.0f/255.0f, 0.0f,    Percent},
+	{TIME_RUN_WITH_ERROR_LAMP,                 "TIME_RUN_WITH_ERROR_LAMP",                 2,  0, 2, Obd2_Pid_Linear,      false, 1.0f,          0.0f,    Minutes},
+	{TIME_SINCE_CODES_CLEARED,                 "TIME_SINCE_CODES_CLEARED",                 2,  0, 2, Obd2_Pid_Linear,      false, 1.0f,          0.0f,    Minutes},
+	{0x4F,                                     "",                                         0,  0, 0, Obd2_Pid_Unlisted,    false, 0.0f,          0.0f,    Counts},
+	{MAXIMUM_MASS_AIRFLOW_SENSOR_FLOW,         "MAXIMUM_MASS_AIRFLOW_SENSOR_FLOW",         4,  0, 1, Obd2_Pid_Linear,      false, 10.0f,         0.0f,    Grams_Per_Second},
+	{FUEL_TYPE,                                "FUEL_TYPE",                                1,  0, 1, Obd2_Pid_Enumerated,  false, 1.0f,          0.0f,    Counts},
+	{ETHANOL_FUEL_PERCENTAGE,                  "ETHANOL_FUEL_PERCENTAGE",                  1,  0, 1, Obd2_Pid_Linear,      false, 100.0f/255.0f, 0.0f,    Percent},
+	{0x53,                                     "",                                         0,  0, 0, Obd2_Pid_Unlisted,    false, 0.0f,          0.0f,    Counts},
+	{0x54,                                     "",                                         0,  0, 0, Obd2_Pid_Unlisted,    false, 0.0f,          0.0f,    Counts},
+	{0x55,                                     "",                                         0,  0, 0, Obd2_Pid_Unlisted,    false, 0.0f,          0.0f,    Counts},
+	{0x56,                                     "",                                         0,  0, 0, Obd2_Pid_Unlisted,    false, 0.0f,          0.0f,    Counts},
+	{0x57,                                     "",                                         0,  0, 0, Obd2_Pid_Unlisted,    false, 0.0f,          0.0f,    Counts},
+	{0x58,                                     "",                                         0,  0, 0, Obd2_Pid_Unlisted,    false, 0.0f,          0.0f,    Counts},
+	{0x59,                                     "",                                         0,  0, 0, Obd2_Pid_Unlisted,    false, 0.0f,          0.0f,    Counts},
+	{0x5A,                                     "",                                         0,  0, 0, Obd2_Pid_Unlisted,    false, 0.0f,          0.0f,    Counts},
+	{0x5B,                                     "",                                         0,  0, 0, Obd2_Pid_Unlisted,    false, 0.0f,          0.0f,    Counts},
+	{ENGINE_OIL_TEMPERATURE,                   "ENGINE_OIL_TEMPERATURE",                   1,  0, 1, Obd2_Pid_Linear,      false, 1.0f,          -40.0f,  Centigrade},
+	{FUEL_INJECTION_TIMING,                    "FUEL_INJECTION_TIMING",                    2,  0, 2, Obd2_Pid_Linear,      false, 1.0f/128.0f,   -210.0f, Degrees},
+	{ENGINE_FUEL_RATE,                         "ENGINE_FUEL_RATE",                         2,  0, 2, Obd2_Pid_Linear,      false, 0.05f,         0.0f,    Litres_Per_Hour},
+	{EMISSION_REQUIREMENTS_DESIGNED,           "EMISSION_REQUIREMENTS_DESIGNED",           1,  0, 1, Obd2_Pid_Enumerated,  false, 1.0f,          0.0f,    Counts},
+	{PIDS_SUPPORTED_3,                         "PIDS_SUPPORTED_3",                         4,  0, 4, Obd2_Pid_Bit_Encoded, false, 1.0f,          0.0f,    Counts},
+	{DRIVER_DEMAND_ENGINE_TORQUE,              "DRIVER_DEMAND_ENGINE_TORQUE",              1,  0, 1, Obd2_Pid_Linear,      false, 1.0f,          -125.0f, Percent},
+	{ACTUAL_ENGINE_TORQUE,                     "ACTUAL_ENGINE_TORQUE",                     1,  0, 1, Obd2_Pid_Linear,      false, 1.0f,          -125.0f, Percent},
+	{ENGINE_REFERENCE_TORQUE,                  "ENGINE_REFERENCE_TORQUE",                  2,  0, 2, Obd2_Pid_Linear,      false, 1.0f,          0.0f,    Newton_Metres},
+	{ENGINE_PERCENT_TORQUE_DATA,               "ENGINE_PERCENT_TORQUE_DATA",               5,  0, 1, Obd2_Pid_Linear,      false, 1.0f,          -125.0f, Percent},
+	{AUXILLIARY_INPUT_OUTPUT_SUPPORTED,        "AUXILLIARY_INPUT_OUTPUT_SUPPORTED",        2,  0, 2, Obd2_Pid_Bit_Encoded, false, 1.0f,          0.0f,    Counts},
+	{MASS_AIR_FLOW_SENSOR,                     "MASS_AIR_FLOW_SENSOR",                     5,  1, 2, Obd2_Pid_Linear,      false, 1.0f/32.0f,    0.0f,    Grams_Per_Second},
+	{ENGINE_COOLANT_TEMPERATURE,               "ENGINE_COOLANT_TEMPERATURE",               3,  1, 1, Obd2_Pid_Linear,      false, 1.0f,          -40.0f,  Centigrade},
+	{INTAKE_AIR_TEMPERATURE_SENSOR,            "INTAKE_AIR_TEMPERATURE_SENSOR",            7,  1, 1, Obd2_Pid_Linear,      false, 1.0f,          -40.0f,  Centigrade},
+	{COMMANDED_EGR_AND_EGR_ERROR,              "COMMANDED_EGR_AND_EGR_ERROR",              7,  1, 1, Obd2_Pid_Linear,      false, 100.0f/255.0f, 0.0f,    Percent},
+	{COMMANDED_DIESEL_INTAKE_AIR_FLOW_CONTROL, "COMMANDED_DIESEL_INTAKE_AIR_FLOW_CONTROL", 5,  1, 1, Obd2_Pid_Linear,      false, 100.0f/255.0f, 0.0f,    Percent},
+	{EXHAUST_GAS_RECIRCULATION_TEMPERATURE,    "EXHAUST_GAS_RECIRCULATION_TEMPERATURE",    5,  1, 1, Obd2_Pid_Linear,      false, 1.0f,          -40.0f,  Centigrade},
+	{COMMANDED_THROTTLE_ACTUATOR_CONTROL,      "COMMANDED_THROTTLE_ACTUATOR_CONTROL",      5,  1, 1, Obd2_Pid_Linear,      false, 100.0f/255.0f, 0.0f,    Percent},
+	{FUEL_PRESSURE_CONTROL_SYSTEM,             "FUEL_PRESSURE_CONTROL_SYSTEM",             11, 1, 2, Obd2_Pid_Linear,      false, 10.0f,         0.0f,    Kilopascals},
+	{INJECTION_PRESSURE_CONTROL_SYSTEM,        "INJECTION_PRESSURE_CONTROL_SYSTEM",        9,  1, 2, Obd2_Pid_Linear,      false, 10.0f,         0.0f,    Kilopascals},
+	{TURBOCHARGER_COMPRESSOR_INLET_PRESSURE,   "TURBOCHARGER_COMPRESSOR_INLET_PRESSURE",   3,  1, 1, Obd2_Pid_Linear,      false, 1.0f,          0.0f,    Kilopascals},
+	{BOOST_PRESSURE_CONTROL,                   "BOOST_PRESSURE_CONTROL",                   9,  1, 2, Obd2_Pid_Linear,      false, 0.03125f,      0.0f,    Kilopascals},
+	{0x71,                                     "",                                         0,  0, 0, Obd2_Pid_Unlisted,    false, 0.0f,          0.0f,    Counts},
+	{WASTEGATE_CONTROL,                        "WASTEGATE_CONTROL",                        5,  1, 1, Obd2_Pid_Linear,      false, 100.0f/255.0f, 0.0f,    Percent},
+	{EXHAUST_PRESSURE,                         "EXHAUST_PRESSURE",                         5,  1, 2, Obd2_Pid_Linear,      false, 0.01f,         0.0f,    Kilopascals},
+	{TURBOCHARGER_RPM,                         "TURBOCHARGER_RPM",                         5,  1, 2, Obd2_Pid_Linear,      false, 1.0f,          0.0f,    Revolutions_Per_Minute},
+	{TURBOCHARGER_TEMPERATURE_1,               "TURBOCHARGER_TEMPERATURE_1",               7,  1, 1, Obd2_Pid_Linear,      false, 1.0f,          -40.0f,  Centigrade},
+	{TURBOCHARGER_TEMPERATURE_2,               "TURBOCHARGER_TEMPERATURE_2",               7,  1, 1, Obd2_Pid_Linear,      false, 1.0f,          -40.0f,  Centigrade},
+	{CHARGE_AIR_COOLER_TEMPERATURE,            "CHARGE_AIR_COOLER_TEMPERATURE",            5,  1, 1, Obd2_Pid_Linear,      false, 1.0f,          -40.0f,  Centigrade},
+	{0x80,                                     "SUPPORTED_PIDS",                           4,  0, 4, Obd2_Pid_Bit_Encoded, false, 1.0f,          0.0f,    Counts},	/* Any bitmap PID past the table. */
+	{0xFF,                                     "",                                         0,  0, 0, Obd2_Pid_Unlisted,    false, 0.0f,          0.0f,    Counts}	/* Any other PID past the table. */
+};
+
+static_assert(sizeof(obd2_mode_one_pids)/sizeof(obd2_pid_descriptor) == OBD2_MODE_ONE_PIDS+2, "obd2_mode_one_pids must list every PID up to OBD2_MODE_ONE_PIDS");
+
+constexpr bool pid_descriptors_are_indexed(const unsigned int i){
+	return (i >= OBD2_MODE_ONE_PIDS) || ( (obd2_mode_one_pids[i].pid == i) && pid_descriptors_are_indexed(i+1) );
+}
+
+static_assert(pid_descriptors_are_indexed(0), "obd2_mode_one_pids must be indexed by PID");
+
+constexpr const obd2_pid_descriptor* find_obd2_pid_descriptor(const unsigned char pid){
+	return &obd2_mode_one_pids[pid < OBD2_MODE_ONE_PIDS ? pid : OBD2_MODE_ONE_PIDS+(pid%32 != 0)];
+}
+
+/* Mode 0x01 responses decoded into one array per field. */
+typedef struct{
+	unsigned int		count;
+	unsigned char		pid[OBD2_MAX_DECODED_RESPONSES];
+	unsigned int		raw[OBD2_MAX_DECODED_RESPONSES];
+	float						value[OBD2_MAX_DECODED_RESPONSES];
+	data_unit				unit[OBD2_MAX_DECODED_RESPONSES];
+	bool						valid[OBD2_MAX_DECODED_RESPONSES];	/* A Mode 0x01 or 0x02 response long enough for the value of its PID. */
+}obd2_current_data;
+
+/* Decodes at most OBD2_MAX_DECODED_RESPONSES responses and returns the number decoded. */
+unsigned int decode_obd2_current_data(const obd2_response* responses, unsigned int count, obd2_current_data* data);
+
+/* Decodes a single Mode 0x01 or 0x02 response. Returns false if it is not valid. */
+bool decode_obd2_pid(const obd2_response* response, unsigned int* raw, float* value);
+
+#endif
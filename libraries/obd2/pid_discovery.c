@@ -0,0 +1,248 @@
+#include "pid_discovery.h"
+#include "obd2modes.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+
+typedef struct{
+	char					magic[8];
+	unsigned int	version;
+	unsigned int	reserved;
+}obd2_pid_cache_header;
+
+static void set_supported(obd2_supported_pids* pids, unsigned int ecu, unsigned int pid){
+	pids->pids[ecu][pid/32] |= 1u << (pid%32);
+}/*set_supported*/
+
+void init_obd2_pid_discovery(obd2_pid_discovery* discovery, unsigned int max_retries){
+	memset(discovery, 0x0, sizeof(obd2_pid_discovery));
+
+	init_obd2_request_timer(&discovery->broadcast_timer, max_retries);
+
+	for(unsigned int ecu = 0; ecu < OBD2_MAX_ECUS; ecu++){
+		init_obd2_request_timer(&discovery->ecu_timers[ecu], max_retries);
+	}/*for*/
+}/*init_obd2_pid_discovery*/
+
+static bool next_broadcast(obd2_pid_discovery* discovery, unsigned long long now){
+	if(!discovery->broadcast_sent){
+		discovery->broadcast_sent = true;
+		return true;
+	}/*if*/
+
+	if(discovery->broadcast_done){
+		return false;
+	}/*if*/
+
+	switch(obd2_request_state(&discovery->broadcast_timer, now)){
+		case Obd2_Request_Retry:
+			return true;
+		case Obd2_Request_Failed:
+			/* Nobody is listening. */
+			discovery->broadcast_done = true;
+			return false;
+		case Obd2_Request_Complete:
+		case Obd2_Request_Idle:
+			discovery->broadcast_done = true;
+			return false;
+		default:
+			return false;
+	}/*switch*/
+}/*next_broadcast*/
+
+bool obd2_pid_discovery_next_request(obd2_pid_discovery* discovery, unsigned long long now, unsigned int* request_id, unsigned char* pid){
+	if(next_broadcast(discovery, now)){
+		*request_id	= CAN_OBD2_QUERY_MESSAGE_ID_BROADCAST;
+		*pid				= SUPPORTED_PIDS;
+		obd2_request_sent(&discovery->broadcast_timer, *request_id, SHOW_CURRENT_DATA, *pid, now);
+		return true;
+	}/*if*/
+
+	for(unsigned int ecu = 0; ecu < OBD2_MAX_ECUS; ecu++){
+		obd2_request_timer* timer = &discovery->ecu_timers[ecu];
+
+		if(discovery->next_pid[ecu] == 0){
+			continue;
+		}/*if*/
+
+		switch(obd2_request_state(timer, now)){
+			case Obd2_Request_Waiting:
+				continue;
+			case Obd2_Request_Failed:
+				/* Keep what this ECU told so far. */
+				discovery->next_pid[ecu] = 0;
+				continue;
+			default:
+				break;
+		}/*switch*/
+
+		*request_id	= CAN_OBD2_QUERY_MESSAGE_ID_LOW+ecu;
+		*pid				= discovery->next_pid[ecu];
+		obd2_request_sent(timer, *request_id, SHOW_CURRENT_DATA, *pid, now);
+		return true;
+	}/*for*/
+
+	return false;
+}/*obd2_pid_discovery_next_request*/
+
+bool obd2_pid_discovery_response(obd2_pid_discovery* discovery, unsigned int response_id, const obd2_response* response, unsigned long long now){
+	unsigned char pid = (unsigned char)response->pid;
+
+	if( (response_id < CAN_OBD2_RESPONSE_MESSAGE_ID_LOW) || (response_id > CAN_OBD2_RESPONSE_MESSAGE_ID_HIGH) ||
+			((unsigned char)response->mode != SHOW_CURRENT_DATA+MODE_RESPONSE_DELTA) || (pid%32 != 0) ||
+			((unsigned char)response->num_extra_bytes < 2+OBD2_PID_BITMAP_BYTES) ){
+		return false;
+	}/*if*/
+
+	unsigned int ecu = response_id-CAN_OBD2_RESPONSE_MESSAGE_ID_LOW;
+
+	if(pid == SUPPORTED_PIDS){
+		obd2_response_received(&discovery->broadcast_timer, response_id, response, now);
+
+		if(discovery->supported.ecus & (1u << ecu)){
+			/* A retransmitted broadcast - this ECU is already known. */
+			return true;
+		}/*if*/
+
+		discovery->supported.ecus |= 1u << ecu;
+	}/*if*/
+	else if(pid == discovery->next_pid[ecu]){
+		obd2_response_received(&discovery->ecu_timers[ecu], response_id, response, now);
+	}/*else if*/
+	else{
+		return false;
+	}/*else*/
+
+	/* Bit A7 stands for PID pid+1, bit D0 for PID pid+32. */
+	const unsigned char*	bitmap	= (const unsigned char*)&response->A;
+	unsigned int					bits		= (bitmap[0] << 24) | (bitmap[1] << 16) | (bitmap[2] << 8) | bitmap[3];
+
+	set_supported(&discovery->supported, ecu, pid);
+
+	for(unsigned int i = 0; i < 32; i++){
+		if( (bits & (0x80000000u >> i)) && (pid+1+i < 256) ){
+			set_supported(&discovery->supported, ecu, pid+1+i);
+		}/*if*/
+	}/*for*/
+
+	bool more = (bits & 0x1) && (pid < OBD2_LAST_SUPPORTED_PIDS);
+	discovery->next_pid[ecu] = more ? pid+32 : 0;
+
+	return true;
+}/*obd2_pid_discovery_response*/
+
+bool obd2_pid_discovery_is_complete(const obd2_pid_discovery* discovery){
+	if(!discovery->broadcast_done){
+		return false;
+	}/*if*/
+
+	for(unsigned int ecu = 0; ecu < OBD2_MAX_ECUS; ecu++){
+		if(discovery->next_pid[ecu] != 0){
+			return false;
+		}/*if*/
+	}/*for*/
+
+	return true;
+}/*obd2_pid_discovery_is_complete*/
+
+bool is_obd2_pid_supported(const obd2_supported_pids* pids, unsigned int ecu, unsigned char pid){
+	if(ecu >= OBD2_MAX_ECUS){
+		return false;
+	}/*if*/
+
+	return (pids->pids[ecu][pid/32] >> (pid%32)) & 0x1;
+}/*is_obd2_pid_supported*/
+
+bool is_obd2_pid_supported_by_any(const obd2_supported_pids* pids, unsigned char pid){
+	unsigned int any = 0;
+
+	for(unsigned int ecu = 0; ecu < OBD2_MAX_ECUS; ecu++){
+		any |= pids->pids[ecu][pid/32];
+	}/*for*/
+
+	return (any >> (pid%32)) & 0x1;
+}/*is_obd2_pid_supported_by_any*/
+
+bool obd2_vin_cache_path(char* path, unsigned int path_size, const char* directory, const char* vin, const char* extension){
+	unsigned int vin_length = strlen(vin);
+
+	if( (vin_length == 0) || (vin_length > OBD2_MAX_VIN_SIZE) ){
+		return false;
+	}/*if*/
+
+	/* The VIN becomes part of a path, so only letters and digits are accepted. */
+	for(unsigned int i = 0; i < vin_length; i++){
+		if(!isalnum((unsigned char)vin[i])){
+			return false;
+		}/*if*/
+	}/*for*/
+
+	return snprintf(path, path_size, "%s/%s.%s", directory, vin, extension) < (int)path_size;
+}/*obd2_vin_cache_path*/
+
+int save_obd2_supported_pids(const char* directory, const char* vin, const obd2_supported_pids* pids){
+	char path[4096];
+
+	if(!obd2_vin_cache_path(path, sizeof(path), directory, vin, "pids")){
+		printf("Invalid VIN for the PID cache: %s\n", vin);
+		return 0;
+	}/*if*/
+
+	FILE* cache_file = fopen(path, "wb");
+	if(cache_file == NULL){
+		perror(path);
+		return 0;
+	}/*if*/
+
+	obd2_pid_cache_header header;
+	memset(&header, 0x0, sizeof(header));
+	memcpy(header.magic, OBD2_PID_CACHE_MAGIC, sizeof(OBD2_PID_CACHE_MAGIC));
+	header.version = OBD2_PID_CACHE_VERSION;
+
+	int success = (fwrite(&header, sizeof(header), 1, cache_file) == 1) &&
+								(fwrite(pids, sizeof(obd2_supported_pids), 1, cache_file) == 1);
+
+	if(fclose(cache_file) != 0){
+		success = 0;
+	}/*if*/
+
+	if(!success){
+		perror("Failed to write the PID cache");
+	}/*if*/
+
+	return success;
+}/*save_obd2_supported_pids*/
+
+int load_obd2_supported_pids(const char* directory, const char* vin, obd2_supported_pids* pids){
+	char path[4096];
+
+	if(!obd2_vin_cache_path(path, sizeof(path), directory, vin, "pids")){
+		return 0;
+	}/*if*/
+
+	FILE* cache_file = fopen(path, "rb");
+	if(cache_file == NULL){
+		/* Not having seen the car before is no error. */
+		if(errno != ENOENT){
+			perror(path);
+		}/*if*/
+		return 0;
+	}/*if*/
+
+	obd2_pid_cache_header header;
+
+	int success = (fread(&header, sizeof(header), 1, cache_file) == 1) &&
+								(memcmp(header.magic, OBD2_PID_CACHE_MAGIC, sizeof(OBD2_PID_CACHE_MAGIC)) == 0) &&
+								(header.version == OBD2_PID_CACHE_VERSION) &&
+								(fread(pids, sizeof(obd2_supported_pids), 1, cache_file) == 1);
+
+	if(!success){
+		printf("%s is not a PID cache of a supported version.\n", path);
+	}/*if*/
+
+	fclose(cache_file);
+
+	return success;
+}/*load_obd2_supported_pids*/
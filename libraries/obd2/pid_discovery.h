@@ -0,0 +1,67 @@
+#ifndef OBD2_PID_DISCOVERY_H
+#define OBD2_PID_DISCOVERY_H
+
+#include "obd2can.h"
+#include "request_timer.h"
+
+/* @NOTE: Finds out which Mode 0x01 PIDs every ECU on the bus supports.
+ *
+ * 				PIDs 0x00, 0x20, 0x40 ... 0xE0 answer with a bitmap of the 32 PIDs following them, the last of which is the
+ * 				next bitmap PID. Discovery broadcasts PID 0x00 once, which every ECU answers, and then walks the chain of each
+ * 				ECU which answered with unicast requests (0x7e0-0x7e7), all ECUs at the same time, each with a request timer
+ * 				of its own. ECUs answering the broadcast late still join in.
+ *
+ * 				Discovery never touches the bus itself: obd2_pid_discovery_next_request() hands out the requests to send and
+ * 				obd2_pid_discovery_response() takes every Mode 0x01 answer.
+ *
+ * 				The result is a bitset of 256 PIDs per ECU. It only depends on the car, so it can be saved under the VIN
+ * 				and loaded on the next connection instead of discovering again.
+ */
+
+#define OBD2_SUPPORTED_PID_WORDS		8		/* 32 PIDs per word */
+#define OBD2_LAST_SUPPORTED_PIDS		0xE0
+#define OBD2_PID_CACHE_MAGIC				"OBD2PID"
+#define OBD2_PID_CACHE_VERSION			1
+#define OBD2_MAX_VIN_SIZE						20
+
+typedef struct{
+	unsigned int	ecus;		/* Bit n set == the ECU answering with 0x7e8+n is present. */
+	unsigned int	pids[OBD2_MAX_ECUS][OBD2_SUPPORTED_PID_WORDS];
+}obd2_supported_pids;
+
+typedef struct{
+	obd2_supported_pids	supported;
+
+	obd2_request_timer	broadcast_timer;
+	bool								broadcast_sent;
+	bool								broadcast_done;
+
+	obd2_request_timer	ecu_timers[OBD2_MAX_ECUS];
+	unsigned char				next_pid[OBD2_MAX_ECUS];		/* The next bitmap PID to ask each ECU for, 0 once its chain ends. */
+}obd2_pid_discovery;
+
+void init_obd2_pid_discovery(obd2_pid_discovery* discovery, unsigned int max_retries);
+
+/* Returns true and sets request_id and pid if a request should be sent now. Call until it returns false. */
+bool obd2_pid_discovery_next_request(obd2_pid_discovery* discovery, unsigned long long now, unsigned int* request_id, unsigned char* pid);
+
+/* Feeds a received response into discovery. Returns true if it was a bitmap answer. */
+bool obd2_pid_discovery_response(obd2_pid_discovery* discovery, unsigned int response_id, const obd2_response* response, unsigned long long now);
+
+bool obd2_pid_discovery_is_complete(const obd2_pid_discovery* discovery);
+
+/* Whether an ECU, given by its index 0-7, supports a PID. */
+bool is_obd2_pid_supported(const obd2_supported_pids* pids, unsigned int ecu, unsigned char pid);
+
+/* Whether any ECU supports a PID. */
+bool is_obd2_pid_supported_by_any(const obd2_supported_pids* pids, unsigned char pid);
+
+/* Builds the path <directory>/<vin>.<extension> of a file cached per car. Returns false if the VIN is not plain
+ * letters and digits, or the path does not fit. */
+bool obd2_vin_cache_path(char* path, unsigned int path_size, const char* directory, const char* vin, const char* extension);
+
+/* Saves and loads the supported PIDs of a car as <directory>/<vin>.pids. Return 0 on failure. */
+int save_obd2_supported_pids(const char* directory, const char* vin, const obd2_supported_pids* pids);
+int load_obd2_supported_pids(const char* directory, const char* vin, obd2_supported_pids* pids);
+
+#endif
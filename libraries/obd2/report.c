@@ -0,0 +1,71 @@
+#include "report.h"
+#include "obd2modes.h"
+
+#include <stdio.h>
+
+const char* obd2_unit_symbol(data_unit unit){
+	switch(unit){
+		case Centigrade:							return "Celsius";
+		case Percent:									return "%";
+		case Kilopascals:							return "kPa";
+		case Pascal:									return "Pa";
+		case Revolutions_Per_Minute:	return "rpm";
+		case Kilometres_Per_Hour:			return "km/h";
+		case Kilometres:							return "km";
+		case Degrees:									return "degrees";
+		case Grams_Per_Second:				return "g/s";
+		case Litres_Per_Hour:					return "l/h";
+		case Volt:										return "V";
+		case Seconds:									return "s";
+		case Minutes:									return "min";
+		case Newton_Metres:						return "Nm";
+		default:											return "";
+	}/*switch*/
+}/*obd2_unit_symbol*/
+
+void print_obd2_current_data(const obd2_current_data* data){
+	for(unsigned int i = 0; i < data->count; i++){
+		const obd2_pid_descriptor* descriptor = find_obd2_pid_descriptor(data->pid[i]);
+
+		if(!data->valid[i]){
+			printf("  Unknown or truncated PID 0x%02x\n", data->pid[i]);
+		}
+		else if(descriptor->encoding == Obd2_Pid_Linear){
+			printf("  %s: %g %s\n", descriptor->name, data->value[i], obd2_unit_symbol(data->unit[i]));
+		}
+		else{
+			printf("  %s: 0x%x\n", descriptor->name, data->raw[i]);
+		}
+	}/*for*/
+}/*print_obd2_current_data*/
+
+void print_obd2_unpacked_response(unsigned int response_id, const obd2_unpacked_response* result){
+	char text[OBD2_DTC_TEXT_SIZE];
+
+	printf("ECU 0x%x ", response_id);
+
+	switch(result->kind){
+		case Obd2_Unpacked_Current_Data:
+			printf("current data:\n");
+			print_obd2_current_data(&result->data);
+			break;
+		case Obd2_Unpacked_Freeze_Frame:
+			printf("freeze frame %u:\n", result->frame);
+			print_obd2_current_data(&result->data);
+			break;
+		case Obd2_Unpacked_Trouble_Codes:
+			printf("%u trouble codes of mode 0x%x:", result->reported, result->mode);
+			for(unsigned int i = 0; i < result->number_of_codes; i++){
+				format_obd2_dtc(result->codes[i], text);
+				printf(" %s", text);
+			}/*for*/
+			printf("\n");
+			break;
+		case Obd2_Unpacked_Rejected:
+			printf("rejected mode 0x%x, reason 0x%x\n", result->mode, result->reason);
+			break;
+		default:
+			printf("answered mode 0x%x\n", result->mode);
+			break;
+	}/*switch*/
+}/*print_obd2_unpacked_response*/
@@ -0,0 +1,16 @@
+#ifndef OBD2_REPORT_H
+#define OBD2_REPORT_H
+
+#include "unpack.h"
+
+/* @NOTE: Prints answers decoded by unpack.h to stdout. Kept apart from decoding, so that only programs which print pay
+ * 				for it, and they may print as seldom as they like.
+ */
+
+void print_obd2_unpacked_response(unsigned int response_id, const obd2_unpacked_response* result);
+void print_obd2_current_data(const obd2_current_data* data);
+
+/* The symbol a value of the unit is printed with, empty for plain numbers. */
+const char* obd2_unit_symbol(data_unit unit);
+
+#endif
@@ -0,0 +1,376 @@
+#include "request_scheduler.h"
+#include "obd2modes.h"
+
+#include <string.h>
+
+void init_obd2_scheduler(obd2_scheduler* scheduler, const obd2_supported_pids* supported_pids, unsigned int max_retries){
+	memset(scheduler, 0x0, sizeof(obd2_scheduler));
+
+	for(unsigned int ecu = 0; ecu < OBD2_MAX_ECUS; ecu++){
+		init_rtt_estimator(&scheduler->ecus[ecu].rtt, OBD2_INITIAL_TIMEOUT, OBD2_MIN_TIMEOUT, OBD2_MAX_TIMEOUT);
+		scheduler->ecus[ecu].window = 1;
+	}/*for*/
+
+	scheduler->max_window						= OBD2_MAX_ECU_WINDOW;
+	scheduler->max_retries					= max_retries;
+	scheduler->max_response_payload	= OBD2_SINGLE_FRAME_PAYLOAD;
+
+	if(supported_pids != 0){
+		scheduler->supported_pids			= *supported_pids;
+		scheduler->has_supported_pids	= true;
+	}/*if*/
+}/*init_obd2_scheduler*/
+
+void obd2_scheduler_set_limits(obd2_scheduler* scheduler, unsigned int max_window, unsigned int max_response_payload){
+	scheduler->max_window						= (max_window < 1) ? 1 : (max_window > OBD2_MAX_ECU_WINDOW ? OBD2_MAX_ECU_WINDOW : max_window);
+	scheduler->max_response_payload	= (max_response_payload > OBD2_MAX_RESPONSE_PAYLOAD) ? OBD2_MAX_RESPONSE_PAYLOAD : max_response_payload;
+
+	for(unsigned int ecu = 0; ecu < OBD2_MAX_ECUS; ecu++){
+		if(scheduler->ecus[ecu].window > scheduler->max_window){
+			scheduler->ecus[ecu].window = scheduler->max_window;
+		}/*if*/
+	}/*for*/
+}/*obd2_scheduler_set_limits*/
+
+int obd2_scheduler_add(obd2_scheduler* scheduler, unsigned char pid, unsigned long long period){
+	if(scheduler->number_of_pids >= OBD2_MAX_SCHEDULED_PIDS){
+		return 0;
+	}/*if*/
+
+	unsigned char ecu = OBD2_UNKNOWN_ECU;
+
+	if(scheduler->has_supported_pids){
+		/* The lowest response ID belongs to the engine ECU, which is preferred for PIDs served by several. */
+		for(unsigned int candidate = OBD2_MAX_ECUS; candidate > 0; candidate--){
+			if(is_obd2_pid_supported(&scheduler->supported_pids, candidate-1, pid)){
+				ecu = candidate-1;
+			}/*if*/
+		}/*for*/
+
+		if(ecu == OBD2_UNKNOWN_ECU){
+			return 0;
+		}/*if*/
+	}/*if*/
+
+	obd2_scheduled_pid* scheduled = &scheduler->pids[scheduler->number_of_pids];
+	memset(scheduled, 0x0, sizeof(obd2_scheduled_pid));
+
+	scheduled->pid		= pid;
+	scheduled->ecu		= ecu;
+	scheduled->period	= period;
+
+	scheduler->number_of_pids += 1;
+
+	return 1;
+}/*obd2_scheduler_add*/
+
+static void fill_request(const obd2_scheduler* scheduler, const obd2_scheduled_request* scheduled, obd2_request_multiple_pids* request){
+	unsigned char pids[OBD2_MAX_PIDS_PER_REQUEST];
+
+	for(unsigned int i = 0; i < scheduled->number_of_pids; i++){
+		pids[i] = scheduler->pids[scheduled->pids[i]].pid;
+	}/*for*/
+
+	build_obd2_multi_pid_request(request, pids, scheduled->number_of_pids, OBD2_MAX_RESPONSE_PAYLOAD);
+}/*fill_request*/
+
+static void finish_request(obd2_scheduler* scheduler, obd2_scheduled_request* scheduled){
+	for(unsigned int i = 0; i < scheduled->number_of_pids; i++){
+		obd2_scheduled_pid* pid = &scheduler->pids[scheduled->pids[i]];
+
+		if(pid->in_flight){
+			/* Not in the answer - the ECU does not serve it after all, or the answer got lost. */
+			pid->misses			+= 1;
+			pid->in_flight	= false;
+		}/*if*/
+	}/*for*/
+
+	scheduled->used = false;
+}/*finish_request*/
+
+/*
+ * Collects the due PIDs of an ECU, the most overdue first, as many as fit into one request.
+ * Returns the number of PIDs collected.
+ */
+static unsigned int collect_due_pids(obd2_scheduler* scheduler, unsigned char ecu, unsigned long long now, obd2_scheduled_request* scheduled){
+	unsigned int response_size = 1;
+
+	scheduled->number_of_pids = 0;
+
+	while(scheduled->number_of_pids < OBD2_MAX_PIDS_PER_REQUEST){
+		int most_overdue = -1;
+
+		for(unsigned int i = 0; i < scheduler->number_of_pids; i++){
+			obd2_scheduled_pid* pid = &scheduler->pids[i];
+
+			if( (pid->ecu != ecu) || pid->in_flight || (pid->due > now) ){
+				continue;
+			}/*if*/
+
+			if( (most_overdue < 0) || (pid->due < scheduler->pids[most_overdue].due) ){
+				most_overdue = i;
+			}/*if*/
+		}/*for*/
+
+		if(most_overdue < 0){
+			break;
+		}/*if*/
+
+		obd2_scheduled_pid*	pid		= &scheduler->pids[most_overdue];
+		unsigned int				size	= obd2_multi_pid_response_size(&pid->pid, 1)-1;
+
+		if( (scheduled->number_of_pids > 0) && (response_size+size > scheduler->max_response_payload) ){
+			break;
+		}/*if*/
+
+		/* Keep to the period, but do not try to make up for lost time with a burst. */
+		pid->due				= (pid->due+pid->period > now) ? pid->due+pid->period : now+pid->period;
+		pid->in_flight	= true;
+
+		scheduled->pids[scheduled->number_of_pids] = most_overdue;
+		scheduled->number_of_pids	+= 1;
+		response_size							+= size;
+	}/*while*/
+
+	return scheduled->number_of_pids;
+}/*collect_due_pids*/
+
+/* The oldest outstanding request of an ECU, which is answered next. Requests which were skipped come first. */
+static obd2_scheduled_request* oldest_request(obd2_ecu_schedule* schedule){
+	obd2_scheduled_request* oldest = 0;
+
+	for(unsigned int slot = 0; slot < OBD2_MAX_ECU_WINDOW; slot++){
+		obd2_scheduled_request* scheduled = &schedule->requests[slot];
+
+		if(!scheduled->used){
+			continue;
+		}/*if*/
+
+		if(scheduled->skipped){
+			return scheduled;
+		}/*if*/
+
+		if( (oldest == 0) || (scheduled->transmission_time < oldest->transmission_time) ){
+			oldest = scheduled;
+		}/*if*/
+	}/*for*/
+
+	return oldest;
+}/*oldest_request*/
+
+static unsigned long long request_start(const obd2_ecu_schedule* schedule, const obd2_scheduled_request* scheduled){
+	return (schedule->progress_time > scheduled->transmission_time) ? schedule->progress_time : scheduled->transmission_time;
+}/*request_start*/
+
+static bool check_timeouts(obd2_scheduler* scheduler, unsigned long long now, unsigned int* request_id, obd2_request_multiple_pids* request){
+	for(unsigned int ecu = 0; ecu < OBD2_MAX_ECUS; ecu++){
+		obd2_ecu_schedule*			schedule	= &scheduler->ecus[ecu];
+		obd2_scheduled_request*	scheduled	= oldest_request(schedule);
+
+		if( (scheduled == 0) || (!scheduled->skipped && !rtt_estimator_expired(&schedule->rtt, request_start(schedule, scheduled), now)) ){
+			continue;
+		}/*if*/
+
+		scheduler->timeouts += 1;
+		rtt_estimator_backoff(&schedule->rtt);
+
+		/* Multiplicative decrease - the ECU cannot keep up with this many requests. */
+		schedule->window							= (schedule->window > 1) ? schedule->window/2 : 1;
+		schedule->answered_in_window	= 0;
+
+		if(scheduled->retries >= scheduler->max_retries){
+			finish_request(scheduler, scheduled);
+			schedule->outstanding -= 1;
+			continue;
+		}/*if*/
+
+		/* Sent again, it queues up behind everything else outstanding. */
+		scheduled->skipped						= false;
+		scheduled->retries						+= 1;
+		scheduled->transmission_time	= now;
+		schedule->progress_time				= now;
+
+		*request_id = CAN_OBD2_QUERY_MESSAGE_ID_LOW+ecu;
+		fill_request(scheduler, scheduled, request);
+		return true;
+	}/*for*/
+
+	obd2_scheduled_request* broadcast = &scheduler->broadcast;
+
+	if( broadcast->used && (now-broadcast->transmission_time > OBD2_INITIAL_TIMEOUT) ){
+		if(broadcast->answered || (broadcast->retries >= scheduler->max_retries)){
+			finish_request(scheduler, broadcast);
+			return false;
+		}/*if*/
+
+		broadcast->retries						+= 1;
+		broadcast->transmission_time	= now;
+
+		*request_id = CAN_OBD2_QUERY_MESSAGE_ID_BROADCAST;
+		fill_request(scheduler, broadcast, request);
+		return true;
+	}/*if*/
+
+	return false;
+}/*check_timeouts*/
+
+bool obd2_scheduler_next_request(obd2_scheduler* scheduler, unsigned long long now, unsigned int* request_id, obd2_request_multiple_pids* request){
+	if(check_timeouts(scheduler, now, request_id, request)){
+		scheduler->requests += 1;
+		return true;
+	}/*if*/
+
+	/* Take turns between the ECUs, so a fast one cannot starve the others. */
+	for(unsigned int i = 0; i < OBD2_MAX_ECUS; i++){
+		unsigned int				ecu				= (scheduler->next_ecu+i) % OBD2_MAX_ECUS;
+		obd2_ecu_schedule*	schedule	= &scheduler->ecus[ecu];
+
+		if(schedule->outstanding >= schedule->window){
+			continue;
+		}/*if*/
+
+		obd2_scheduled_request* scheduled = 0;
+		for(unsigned int slot = 0; slot < OBD2_MAX_ECU_WINDOW; slot++){
+			if(!schedule->requests[slot].used){
+				scheduled = &schedule->requests[slot];
+				break;
+			}/*if*/
+		}/*for*/
+
+		if( (scheduled == 0) || (collect_due_pids(scheduler, ecu, now, scheduled) == 0) ){
+			continue;
+		}/*if*/
+
+		scheduled->used								= true;
+		scheduled->answered						= false;
+		scheduled->skipped						= false;
+		scheduled->retries						= 0;
+		scheduled->transmission_time	= now;
+		schedule->outstanding					+= 1;
+		scheduler->next_ecu						= (ecu+1) % OBD2_MAX_ECUS;
+		scheduler->requests						+= 1;
+
+		*request_id = CAN_OBD2_QUERY_MESSAGE_ID_LOW+ecu;
+		fill_request(scheduler, scheduled, request);
+		return true;
+	}/*for*/
+
+	/* PIDs whose ECU is not known yet are asked for by broadcast, one request at a time. */
+	obd2_scheduled_request* broadcast = &scheduler->broadcast;
+
+	if( !broadcast->used && (collect_due_pids(scheduler, OBD2_UNKNOWN_ECU, now, broadcast) > 0) ){
+		broadcast->used								= true;
+		broadcast->answered						= false;
+		broadcast->retries						= 0;
+		broadcast->transmission_time	= now;
+		scheduler->requests						+= 1;
+
+		*request_id = CAN_OBD2_QUERY_MESSAGE_ID_BROADCAST;
+		fill_request(scheduler, broadcast, request);
+		return true;
+	}/*if*/
+
+	return false;
+}/*obd2_scheduler_next_request*/
+
+static obd2_scheduled_request* find_request(obd2_scheduler* scheduler, unsigned int ecu, unsigned char pid){
+	obd2_ecu_schedule* schedule = &scheduler->ecus[ecu];
+
+	for(unsigned int slot = 0; slot < OBD2_MAX_ECU_WINDOW; slot++){
+		obd2_scheduled_request* scheduled = &schedule->requests[slot];
+
+		for(unsigned int i = 0; scheduled->used && (i < scheduled->number_of_pids); i++){
+			if(scheduler->pids[scheduled->pids[i]].pid == pid){
+				return scheduled;
+			}/*if*/
+		}/*for*/
+	}/*for*/
+
+	for(unsigned int i = 0; scheduler->broadcast.used && (i < scheduler->broadcast.number_of_pids); i++){
+		if(scheduler->pids[scheduler->broadcast.pids[i]].pid == pid){
+			return &scheduler->broadcast;
+		}/*if*/
+	}/*for*/
+
+	return 0;
+}/*find_request*/
+
+unsigned int obd2_scheduler_response(obd2_scheduler* scheduler, unsigned int response_id, const unsigned char* payload, unsigned int length, unsigned long long now, obd2_response* responses, unsigned int max_responses){
+	unsigned int number_of_responses = parse_obd2_multi_pid_response(payload, length, responses, max_responses);
+
+	if( (number_of_responses == 0) || (response_id < CAN_OBD2_RESPONSE_MESSAGE_ID_LOW) || (response_id > CAN_OBD2_RESPONSE_MESSAGE_ID_HIGH) ){
+		return number_of_responses;
+	}/*if*/
+
+	unsigned int						ecu				= response_id-CAN_OBD2_RESPONSE_MESSAGE_ID_LOW;
+	obd2_ecu_schedule*			schedule	= &scheduler->ecus[ecu];
+	obd2_scheduled_request*	scheduled	= find_request(scheduler, ecu, (unsigned char)responses[0].pid);
+
+	if(scheduled == 0){
+		/* A late answer to a request which has been given up on. */
+		return number_of_responses;
+	}/*if*/
+
+	for(unsigned int i = 0; i < number_of_responses; i++){
+		for(unsigned int j = 0; j < scheduled->number_of_pids; j++){
+			obd2_scheduled_pid* pid = &scheduler->pids[scheduled->pids[j]];
+
+			if(pid->pid != (unsigned char)responses[i].pid){
+				continue;
+			}/*if*/
+
+			/* The first ECU answering a broadcast serves the PID from now on. */
+			if(pid->ecu == OBD2_UNKNOWN_ECU){
+				pid->ecu = ecu;
+			}/*if*/
+
+			pid->answers		+= 1;
+			pid->in_flight	= false;
+		}/*for*/
+	}/*for*/
+
+	if(scheduled == &scheduler->broadcast){
+		/* Other ECUs may still answer, the broadcast ends once it times out. */
+		scheduled->answered = true;
+		return number_of_responses;
+	}/*if*/
+
+	/* Karn's algorithm - an answer to a retransmitted request may belong to either transmission. */
+	if(scheduled->retries == 0){
+		rtt_estimator_sample(&schedule->rtt, now-request_start(schedule, scheduled));
+	}/*if*/
+
+	schedule->progress_time = now;
+
+	/* Answers come in order, so whatever was sent before this request and is still outstanding got lost. */
+	for(unsigned int slot = 0; slot < OBD2_MAX_ECU_WINDOW; slot++){
+		obd2_scheduled_request* earlier = &schedule->requests[slot];
+
+		if( earlier->used && (earlier != scheduled) && (earlier->transmission_time < scheduled->transmission_time) ){
+			earlier->skipped = true;
+		}/*if*/
+	}/*for*/
+
+	finish_request(scheduler, scheduled);
+	schedule->outstanding -= 1;
+
+	/* Additive increase - one more outstanding request after a whole window was answered. */
+	schedule->answered_in_window += 1;
+	if(schedule->answered_in_window >= schedule->window){
+		schedule->answered_in_window = 0;
+
+		if(schedule->window < scheduler->max_window){
+			schedule->window += 1;
+		}/*if*/
+	}/*if*/
+
+	return number_of_responses;
+}/*obd2_scheduler_response*/
+
+unsigned int obd2_scheduler_window(const obd2_scheduler* scheduler, unsigned int ecu){
+	if(ecu >= OBD2_MAX_ECUS){
+		return 0;
+	}/*if*/
+
+	return scheduler->ecus[ecu].window;
+}/*obd2_scheduler_window*/
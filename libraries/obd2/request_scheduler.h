@@ -0,0 +1,98 @@
+#ifndef OBD2_REQUEST_SCHEDULER_H
+#define OBD2_REQUEST_SCHEDULER_H
+
+#include "obd2can.h"
+#include "multi_pid.h"
+#include "pid_discovery.h"
+#include "request_timer.h"
+#include "timing/rtt_estimator.h"
+
+/* @NOTE: Schedules Mode 0x01 requests for a set of PIDs, each polled at its own target period.
+ *
+ * 				Every PID is requested from the ECU serving it, by unicast (0x7e0-0x7e7), so no other ECU has to answer.
+ * 				Which ECU serves a PID is taken from the discovered supported PIDs when they are given, and otherwise
+ * 				learnt from the first answer to a broadcast request for it.
+ *
+ * 				Due PIDs of the same ECU are packed into one request, the most overdue first. Each ECU has a window of
+ * 				requests which may be outstanding at once. The window grows by one after a window's worth of answered
+ * 				requests and halves on every timeout, so fast ECUs are kept busy while slow ones are not overrun.
+ * 				Timeouts follow the measured round-trip times of each ECU (see timing/rtt_estimator.h). An ECU answers its
+ * 				requests one after the other, so only the oldest outstanding request is timed, from the later of its
+ * 				transmission and the last answer, and requests queued behind it are not penalised for waiting.
+ *
+ * 				The scheduler never touches the bus itself: obd2_scheduler_next_request() hands out the requests to send
+ * 				and obd2_scheduler_response() takes every answer.
+ */
+
+#define OBD2_MAX_SCHEDULED_PIDS				64
+#define OBD2_MAX_ECU_WINDOW						4
+#define OBD2_UNKNOWN_ECU							0xFF
+
+typedef struct{
+	unsigned char				pid;
+	unsigned char				ecu;				/* Index 0-7 of the ECU serving the PID, or OBD2_UNKNOWN_ECU. */
+	unsigned long long	period;
+	unsigned long long	due;
+	bool								in_flight;
+	unsigned long long	answers;
+	unsigned long long	misses;
+}obd2_scheduled_pid;
+
+typedef struct{
+	unsigned char				pids[OBD2_MAX_PIDS_PER_REQUEST];		/* Indices into the scheduled PIDs. */
+	unsigned int				number_of_pids;
+	unsigned long long	transmission_time;
+	unsigned int				retries;
+	bool								answered;
+	bool								skipped;		/* A later request was answered first, so this one got lost. */
+	bool								used;
+}obd2_scheduled_request;
+
+typedef struct{
+	rtt_estimator						rtt;
+	obd2_scheduled_request	requests[OBD2_MAX_ECU_WINDOW];
+	unsigned int						outstanding;
+	unsigned int						window;
+	unsigned int						answered_in_window;
+	unsigned long long			progress_time;			/* When the ECU last answered. */
+}obd2_ecu_schedule;
+
+typedef struct{
+	obd2_scheduled_pid			pids[OBD2_MAX_SCHEDULED_PIDS];
+	unsigned int						number_of_pids;
+
+	obd2_supported_pids			supported_pids;
+	bool										has_supported_pids;
+
+	obd2_ecu_schedule				ecus[OBD2_MAX_ECUS];
+	obd2_scheduled_request	broadcast;
+	unsigned int						next_ecu;
+
+	unsigned int						max_window;
+	unsigned int						max_retries;
+	unsigned int						max_response_payload;
+
+	unsigned long long			requests;
+	unsigned long long			timeouts;
+}obd2_scheduler;
+
+/* supported_pids may be 0, in which case the ECU of every PID is learnt by broadcast. */
+void init_obd2_scheduler(obd2_scheduler* scheduler, const obd2_supported_pids* supported_pids, unsigned int max_retries);
+
+/* Sets the largest window per ECU, at most OBD2_MAX_ECU_WINDOW, and the largest response which may be requested. */
+void obd2_scheduler_set_limits(obd2_scheduler* scheduler, unsigned int max_window, unsigned int max_response_payload);
+
+/* Polls a PID every period microseconds, or as often as possible with a period of 0.
+ * Returns 0 if no more PIDs fit, or if the supported PIDs are known and no ECU supports it. */
+int obd2_scheduler_add(obd2_scheduler* scheduler, unsigned char pid, unsigned long long period);
+
+/* Returns true and fills in a request to send now. Call until it returns false. */
+bool obd2_scheduler_next_request(obd2_scheduler* scheduler, unsigned long long now, unsigned int* request_id, obd2_request_multiple_pids* request);
+
+/* Feeds a Mode 0x01 response payload, starting with the mode byte, into the scheduler, and splits it into one
+ * response per PID. Returns the number of responses stored. */
+unsigned int obd2_scheduler_response(obd2_scheduler* scheduler, unsigned int response_id, const unsigned char* payload, unsigned int length, unsigned long long now, obd2_response* responses, unsigned int max_responses);
+
+unsigned int obd2_scheduler_window(const obd2_scheduler* scheduler, unsigned int ecu);
+
+#endif
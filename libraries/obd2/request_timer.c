@@ -0,0 +1,140 @@
+#include "request_timer.h"
+
+#include <string.h>
+
+static unsigned long long request_timeout(const obd2_request_timer* timer){
+	if( (timer->request_id >= CAN_OBD2_QUERY_MESSAGE_ID_LOW) && (timer->request_id <= CAN_OBD2_QUERY_MESSAGE_ID_HIGH) ){
+		return rtt_estimator_timeout(&timer->ecu_rtt[timer->request_id-CAN_OBD2_QUERY_MESSAGE_ID_LOW]);
+	}/*if*/
+
+	if(timer->discovering){
+		return OBD2_INITIAL_TIMEOUT;
+	}/*if*/
+
+	/* Broadcast - wait for the slowest ECU known to answer. */
+	unsigned long long timeout = 0;
+	for(unsigned int ecu = 0; ecu < OBD2_MAX_ECUS; ecu++){
+		if(timer->ecu_known[ecu] && (rtt_estimator_timeout(&timer->ecu_rtt[ecu]) > timeout)){
+			timeout = rtt_estimator_timeout(&timer->ecu_rtt[ecu]);
+		}/*if*/
+	}/*for*/
+
+	return timeout > 0 ? timeout : OBD2_INITIAL_TIMEOUT;
+}/*request_timeout*/
+
+void init_obd2_request_timer(obd2_request_timer* timer, unsigned int max_retries){
+	memset(timer, 0x0, sizeof(obd2_request_timer));
+
+	for(unsigned int ecu = 0; ecu < OBD2_MAX_ECUS; ecu++){
+		init_rtt_estimator(&timer->ecu_rtt[ecu], OBD2_INITIAL_TIMEOUT, OBD2_MIN_TIMEOUT, OBD2_MAX_TIMEOUT);
+	}/*for*/
+
+	timer->max_retries = max_retries;
+}/*init_obd2_request_timer*/
+
+void obd2_request_sent(obd2_request_timer* timer, unsigned int request_id, unsigned char mode, unsigned char pid, unsigned long long now){
+	bool retransmission = timer->outstanding && (timer->request_id == request_id) && (timer->mode == mode) && (timer->pid == pid);
+
+	timer->retries						= retransmission ? timer->retries+1 : 0;
+	timer->request_id					= request_id;
+	timer->mode								= mode;
+	timer->pid								= pid;
+	timer->transmission_time	= now;
+	timer->outstanding				= true;
+	timer->discovering				= (request_id == CAN_OBD2_QUERY_MESSAGE_ID_BROADCAST);
+
+	for(unsigned int ecu = 0; ecu < OBD2_MAX_ECUS; ecu++){
+		timer->discovering = timer->discovering && !timer->ecu_known[ecu];
+	}/*for*/
+
+	memset(timer->answered, 0x0, sizeof(timer->answered));
+}/*obd2_request_sent*/
+
+bool obd2_response_received(obd2_request_timer* timer, unsigned int response_id, const obd2_response* response, unsigned long long now){
+	if( !timer->outstanding || (response_id < CAN_OBD2_RESPONSE_MESSAGE_ID_LOW) || (response_id > CAN_OBD2_RESPONSE_MESSAGE_ID_HIGH) ){
+		return false;
+	}/*if*/
+
+	if( ((unsigned char)response->mode != timer->mode+MODE_RESPONSE_DELTA) ){
+		return false;
+	}/*if*/
+
+	unsigned int ecu = response_id-CAN_OBD2_RESPONSE_MESSAGE_ID_LOW;
+
+	/* A unicast request is only answered by the ECU it was sent to. */
+	if( (timer->request_id != CAN_OBD2_QUERY_MESSAGE_ID_BROADCAST) && (timer->request_id-CAN_OBD2_QUERY_MESSAGE_ID_LOW != ecu) ){
+		return false;
+	}/*if*/
+
+	/* Karn's algorithm - an answer to a retransmitted request may belong to either transmission. */
+	if( !timer->answered[ecu] && (timer->retries == 0) ){
+		rtt_estimator_sample(&timer->ecu_rtt[ecu], now-timer->transmission_time);
+	}/*if*/
+
+	timer->answered[ecu]	= true;
+	timer->ecu_known[ecu]	= true;
+
+	return true;
+}/*obd2_response_received*/
+
+Obd2_Request_State obd2_request_state(obd2_request_timer* timer, unsigned long long now){
+	if(!timer->outstanding){
+		return Obd2_Request_Idle;
+	}/*if*/
+
+	bool					all_answered	= true;
+	unsigned int	answers				= 0;
+
+	for(unsigned int ecu = 0; ecu < OBD2_MAX_ECUS; ecu++){
+		answers += timer->answered[ecu] ? 1 : 0;
+		if(timer->ecu_known[ecu] && !timer->answered[ecu]){
+			all_answered = false;
+		}/*if*/
+	}/*for*/
+
+	/* Any number of ECUs may yet answer a discovering broadcast. */
+	if( (answers > 0) && all_answered && !timer->discovering ){
+		timer->outstanding = false;
+		return Obd2_Request_Complete;
+	}/*if*/
+
+	unsigned long long timeout = request_timeout(timer);
+
+	if( (now <= timer->transmission_time) || (now-timer->transmission_time <= timeout) ){
+		return Obd2_Request_Waiting;
+	}/*if*/
+
+	if(answers > 0){
+		/* Some ECU known from before did not answer this time - do not hold up the others. */
+		timer->outstanding = false;
+		return Obd2_Request_Complete;
+	}/*if*/
+
+	timer->timeouts += 1;
+
+	for(unsigned int ecu = 0; ecu < OBD2_MAX_ECUS; ecu++){
+		bool addressed = (timer->request_id == CAN_OBD2_QUERY_MESSAGE_ID_BROADCAST) || (timer->request_id-CAN_OBD2_QUERY_MESSAGE_ID_LOW == ecu);
+		if(addressed){
+			rtt_estimator_backoff(&timer->ecu_rtt[ecu]);
+		}/*if*/
+	}/*for*/
+
+	if(timer->retries >= timer->max_retries){
+		timer->outstanding = false;
+		return Obd2_Request_Failed;
+	}/*if*/
+
+	return Obd2_Request_Retry;
+}/*obd2_request_state*/
+
+void obd2_request_cancel(obd2_request_timer* timer){
+	timer->outstanding = false;
+}/*obd2_request_cancel*/
+
+unsigned long long obd2_ecu_timeout(const obd2_request_timer* timer, unsigned int ecu){
+	if(ecu >= OBD2_MAX_ECUS){
+		return OBD2_INITIAL_TIMEOUT;
+	}/*if*/
+
+	return rtt_estimator_timeout(&timer->ecu_rtt[ecu]);
+}/*obd2_ecu_timeout*/
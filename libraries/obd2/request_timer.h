@@ -0,0 +1,64 @@
+#ifndef OBD2_REQUEST_TIMER_H
+#define OBD2_REQUEST_TIMER_H
+
+#include "obd2can.h"
+#include "timing/rtt_estimator.h"
+
+/* @NOTE: Keeps track of one outstanding OBD-II request and decides when it is answered, overdue or lost.
+ *
+ * 				Every ECU answers with its own response ID (0x7e8-0x7ef), so a round-trip time estimator is kept per ECU.
+ * 				A unicast request is overdue once the estimated timeout of its ECU has passed.
+ * 				A broadcast request is answered by an unknown number of ECUs. It is complete once every ECU which has
+ * 				answered before has answered again, or once the longest timeout of those ECUs has passed and at least one
+ * 				answer arrived. Without any answer it is overdue and should be sent again.
+ * 				While no ECU is known, a broadcast waits the whole initial timeout, so that every ECU present gets to answer.
+ */
+
+#define OBD2_MAX_ECUS									8
+#define OBD2_DEFAULT_RETRIES					3
+#define OBD2_INITIAL_TIMEOUT					100000ULL	/* The 50 ms P2 limit of ISO 15765-4, with some slack. */
+#define OBD2_MIN_TIMEOUT							5000ULL
+#define OBD2_MAX_TIMEOUT							1000000ULL
+
+typedef enum{
+	Obd2_Request_Idle,			/* No request is outstanding.                                         */
+	Obd2_Request_Waiting,		/* The request is outstanding and not yet overdue.                    */
+	Obd2_Request_Complete,	/* All expected answers arrived - the next request may be sent.       */
+	Obd2_Request_Retry,			/* The request is overdue - send it again and call obd2_request_sent. */
+	Obd2_Request_Failed			/* The request ran out of retries and was dropped.                    */
+}Obd2_Request_State;
+
+typedef struct{
+	rtt_estimator				ecu_rtt[OBD2_MAX_ECUS];
+	bool								ecu_known[OBD2_MAX_ECUS];
+
+	unsigned int				request_id;
+	unsigned char				mode;
+	unsigned char				pid;
+	unsigned long long	transmission_time;
+	unsigned int				retries;
+	unsigned int				max_retries;
+	bool								outstanding;
+	bool								discovering;						/* A broadcast sent while no ECU was known. */
+	bool								answered[OBD2_MAX_ECUS];
+
+	unsigned long long	timeouts;
+}obd2_request_timer;
+
+void init_obd2_request_timer(obd2_request_timer* timer, unsigned int max_retries);
+
+/* Call after every transmission of a request, including retransmissions. */
+void obd2_request_sent(obd2_request_timer* timer, unsigned int request_id, unsigned char mode, unsigned char pid, unsigned long long now);
+
+/* Returns true if the response answers the outstanding request. */
+bool obd2_response_received(obd2_request_timer* timer, unsigned int response_id, const obd2_response* response, unsigned long long now);
+
+Obd2_Request_State obd2_request_state(obd2_request_timer* timer, unsigned long long now);
+
+/* Drops the outstanding request without waiting for it, e.g. once the ECU rejected it. */
+void obd2_request_cancel(obd2_request_timer* timer);
+
+/* The timeout currently used for an ECU, given by its index 0-7. */
+unsigned long long obd2_ecu_timeout(const obd2_request_timer* timer, unsigned int ecu);
+
+#endif
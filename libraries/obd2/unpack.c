@@ -1,112 +1,85 @@
 #include "unpack.h"
+#include "multi_pid.h"
+#include "freeze_frame.h"
 #include "obd2pids.h"
 #include "obd2modes.h"
 
-#include <stdio.h>
+#include <stddef.h>
 
 bool is_obd2_response(unsigned int message_id){
-	if( (message_id <= CAN_OBD2_RESPONSE_MESSAGE_ID_HIGH) &&
-			(message_id >= CAN_OBD2_RESPONSE_MESSAGE_ID_LOW))
-	{
-    printf("Found OBD-II response with ID 0x%x!\n", message_id);
-		return true;
-	}
-
-	return false;
+	return (message_id <= CAN_OBD2_RESPONSE_MESSAGE_ID_HIGH) && (message_id >= CAN_OBD2_RESPONSE_MESSAGE_ID_LOW);
 }/*is_obd2_response*/
 
-void unpack_obd2_response(obd2_response* response){
-  char  response_mode = response->mode-MODE_RESPONSE_DELTA;
-  switch(response_mode){
-    case SHOW_CURRENT_DATA:
-      printf("Found SHOW_CURRENT_DATA!\n");
-      unpack_obd2_show_current_data(response);
-      break;
-    case SHOW_FREEZE_FRAME_DATA:
-      break;
-    case SHOW_STORED_DIAGNOSTIC_TROUBLE_CODES:
-      unpack_obd2_show_stored_diagnostic_trouble_codes(response);
-      break;
-    case CLEAR_DIAGNOSTIC_TROUBLE_CODES:
-      break;
-    case TEST_RESULTS_NON_CAN:
-      break;
-    case TEST_RESULTS_CAN:
-      break;
-    case SHOW_PENDING_DIAGNOSTIC_TROUBLE_CODES:
-      break;
-    case CONTROL_OPERATION_OF_ONBOARD_SYSTEM:
-      printf("Found CONTROL_OPERATION_OF_ONBOARD_SYSTEM\n");
-      break;
-    case REQUEST_VEHICLE_INFORMATION:
-      printf("Found REQUEST_VEHICLE_INFORMATION\n");
-      break;
-    case PERMANENT_DIAGNOSTIC_TROUBLE_CODES:
-      printf("Found PERMANENT_DIAGNOSTIC_TROUBLE_CODES\n");
-      break;
-    default:
-      printf("Found mode 0x%x\n", response_mode);
-      break;
-  }/*switch*/
+void unpack_obd2_current_data(const obd2_response* responses, unsigned int count, obd2_unpacked_response* result){
+	result->kind	= Obd2_Unpacked_Current_Data;
+	result->mode	= SHOW_CURRENT_DATA;
 
-}/*unpack_obd2_response*/
+	decode_obd2_current_data(responses, count, &result->data);
+}/*unpack_obd2_current_data*/
+
+bool unpack_obd2_payload(const unsigned char* payload, unsigned int length, obd2_unpacked_response* result){
+	obd2_response responses[OBD2_MAX_DECODED_RESPONSES];
+	unsigned int	count;
+
+	result->kind = Obd2_Unpacked_Nothing;
+
+	if(length < 1){
+		return false;
+	}/*if*/
 
-void unpack_obd2_show_current_data(obd2_response* data){
-	switch(data->pid){
-		case ENGINE_COOLANT_TEMP:
-			printf("Engine coolant: %i Celsius\n", unpack_engine_coolant(data->A));
-			break;
-		case ENGINE_RPM:
-			printf("Engine rpm: %u\n" , unpack_engine_rpm(data->A, data->B));
+	if(payload[0] == OBD2_NEGATIVE_RESPONSE){
+		if(length < 3){
+			return false;
+		}/*if*/
+
+		result->kind		= Obd2_Unpacked_Rejected;
+		result->mode		= payload[1];
+		result->reason	= payload[2];
+		return true;
+	}/*if*/
+
+	result->mode = payload[0]-MODE_RESPONSE_DELTA;
+
+	switch(result->mode){
+		case SHOW_CURRENT_DATA:
+			count = parse_obd2_multi_pid_response(payload, length, responses, OBD2_MAX_DECODED_RESPONSES);
+			unpack_obd2_current_data(responses, count, result);
+			return count > 0;
+		case SHOW_FREEZE_FRAME_DATA:
+			if(length < 3){
+				return false;
+			}/*if*/
+
+			/* The frame number follows the first PID. */
+			result->kind	= Obd2_Unpacked_Freeze_Frame;
+			result->frame	= payload[2];
+			count					= parse_obd2_freeze_frame_response(payload, length, result->frame, responses, OBD2_MAX_DECODED_RESPONSES);
+
+			decode_obd2_current_data(responses, count, &result->data);
+			return count > 0;
+		case SHOW_STORED_DIAGNOSTIC_TROUBLE_CODES:
+		case SHOW_PENDING_DIAGNOSTIC_TROUBLE_CODES:
+		case PERMANENT_DIAGNOSTIC_TROUBLE_CODES:
+			if(length < 2){
+				return false;
+			}/*if*/
+
+			result->kind						= Obd2_Unpacked_Trouble_Codes;
+			result->number_of_codes	= parse_obd2_dtc_response(payload, length, result->codes, OBD2_MAX_DTCS_PER_ECU, &result->reported);
+			return true;
 		default:
-			break;
+			return false;
 	}/*switch*/
-}/*unpack_obd2_show_current_data*/
-
-void unpack_obd2_show_stored_diagnostic_trouble_codes(obd2_response* data){
-
-}/*unpack_obd2_show_stored_diagnostic_trouble_codes*/
-
-int unpack_engine_coolant(char A){
-	int engine_coolant_temperature_centigrade = A-40;
-	return engine_coolant_temperature_centigrade;
-}/*unpack_engine_coolant*/
-
-unsigned int unpack_engine_rpm(char A, char B){
-	unsigned int engine_rpm = (A*256 + B)/4;
-	return engine_rpm;
-}/*unpack_engine_rpm*/
-
-unsigned int unpack_intake_manifold_pressure(char A){
-	unsigned int intake_manifold_pressure = A;
-	return intake_manifold_pressure;
-}/*unpack_intake_manifold_pressure*/
-
-double unpack_mass_airflow_rate(char A, char B){
-	double mass_airflow_rate = (A*256+B)/100;
-	return mass_airflow_rate;
-}/*unpack_mass_airflow_rate*/
-
-double unpack_throttle_position(char A){
-	double throttle_position = A*100/255;
-	return throttle_position;
-}/*unpack_throttle_position*/
-
-int unpack_intake_air_temperature(char A){
-	int intake_air_temperature = A-40;
-	return intake_air_temperature;
-}/*unpack_intake_air_temperature*/
-
-unsigned int unpack_vehicle_speed(char A){
-	unsigned int vehicle_speed = A;
-	return vehicle_speed;
-}/*unpack_vehicle_speed*/
-
-double unpack_ethanol_fuel_percentage(char A){
-	double ethanol_fuel_percentage = A*100/255;
-	return ethanol_fuel_percentage;
-}/*unpack_ethanol_fuel_percentage*/
-
-double unpack_timing_advance(char A){
-	double timing_advance = (A-128)/2;
-}/*unpack_timing_advance*/
+}/*unpack_obd2_payload*/
+
+/* The length is as sent by the ECU, and is not trusted to stay within the frame. */
+bool unpack_obd2_response(const obd2_response* response, obd2_unpacked_response* result){
+	const unsigned int	frame_bytes	= sizeof(obd2_response)-offsetof(obd2_response, mode);
+	unsigned int				length			= (unsigned char)response->num_extra_bytes;
+
+	if(length > frame_bytes){
+		length = frame_bytes;
+	}/*if*/
+
+	return unpack_obd2_payload((const unsigned char*)&response->mode, length, result);
+}/*unpack_obd2_response*/
@@ -2,31 +2,49 @@
 #define UNPACK_OBD2_H
 
 #include "obd2can.h"
-
-/* @NOTE: For information regarding units and ranges, see obd2pids.h */
+#include "pid_descriptors.h"
+#include "dtc_scan.h"
+
+/* @NOTE: Decodes OBD-II answers into a record owned by the caller, without any I/O or allocation, so that decoding keeps
+ * 				up with a busy bus and the values can be used by the program. Printing the record is left to report.h.
+ *
+ * 				Only the fields of the kind of answer decoded are set.
+ *
+ * 				For information regarding units and ranges, see obd2pids.h and pid_descriptors.h
+ */
+
+typedef enum{
+	Obd2_Unpacked_Nothing,				/* A mode which is not decoded. */
+	Obd2_Unpacked_Current_Data,
+	Obd2_Unpacked_Freeze_Frame,
+	Obd2_Unpacked_Trouble_Codes,
+	Obd2_Unpacked_Rejected
+}Obd2_Unpacked_Kind;
+
+typedef struct{
+	Obd2_Unpacked_Kind	kind;
+	unsigned char				mode;																				/* The mode of the request answered. */
+
+	obd2_current_data		data;																				/* Current data and freeze frames. */
+	unsigned char				frame;																			/* Freeze frames. */
+
+	unsigned int				reported;																		/* Trouble codes, as reported, which may exceed the codes stored. */
+	unsigned int				number_of_codes;
+	unsigned short			codes[OBD2_MAX_DTCS_PER_ECU];
+
+	unsigned char				reason;																			/* Rejected requests. */
+}obd2_unpacked_response;
 
 bool is_obd2_response(unsigned int message_id);
 
-void unpack_obd2_response(obd2_response* response);
-void unpack_obd2_show_current_data(obd2_response* data);
-void unpack_obd2_show_stored_diagnostic_trouble_codes(obd2_response* data);
-
-int unpack_engine_coolant(char A);
-
-unsigned int unpack_engine_rpm(char A, char B);
-
-unsigned int unpack_intake_manifold_pressure(char A);
-
-double unpack_mass_airflow_rate(char A, char B);
-
-double unpack_throttle_position(char A);
-
-int unpack_intake_air_temperature(char A);
-
-double unpack_ethanol_fuel_percentage(char A);
+/* Decodes an answer payload, starting with the mode byte, e.g. as put back together by ISO-TP.
+ * Returns false if there was nothing to decode. */
+bool unpack_obd2_payload(const unsigned char* payload, unsigned int length, obd2_unpacked_response* result);
 
-double unpack_timing_advance(char A);
+/* Decodes a single frame response. */
+bool unpack_obd2_response(const obd2_response* response, obd2_unpacked_response* result);
 
-unsigned int unpack_vehicle_speed(char A);
+/* Decodes Mode 0x01 responses already split up by PID, e.g. by the scheduler. */
+void unpack_obd2_current_data(const obd2_response* responses, unsigned int count, obd2_unpacked_response* result);
 
 #endif
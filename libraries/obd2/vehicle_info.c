@@ -0,0 +1,343 @@
+#include "vehicle_info.h"
+#include "pid_discovery.h"
+#include "obd2modes.h"
+#include "obd2pids.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#define OBD2_VEHICLE_INFO_HEADER_SIZE		3		/* Mode, PID and the number of data items. */
+#define OBD2_CVN_SIZE										4
+
+typedef struct{
+	char					magic[8];
+	unsigned int	version;
+	unsigned int	reserved;
+}obd2_vehicle_info_cache_header;
+
+void init_obd2_vehicle_info_reader(obd2_vehicle_info_reader* reader, unsigned int max_retries){
+	memset(reader, 0x0, sizeof(obd2_vehicle_info_reader));
+
+	init_obd2_request_timer(&reader->broadcast_timer, max_retries);
+
+	for(unsigned int ecu = 0; ecu < OBD2_MAX_ECUS; ecu++){
+		init_obd2_request_timer(&reader->ecu_timers[ecu], max_retries);
+	}/*for*/
+
+	reader->broadcast_pid = VEHICLE_IDENTIFICATION_NUMBER;
+}/*init_obd2_vehicle_info_reader*/
+
+void obd2_vehicle_info_read_calibration(obd2_vehicle_info_reader* reader, unsigned int ecus){
+	ecus &= (1u << OBD2_MAX_ECUS)-1;
+
+	reader->broadcast_pid		= (ecus == 0) ? CALIBRATION_ID : 0;
+	reader->broadcast_sent	= false;
+
+	/* Which ECUs sent the VIN tells nothing about which have calibration IDs, so the broadcast starts over knowing none. */
+	init_obd2_request_timer(&reader->broadcast_timer, reader->broadcast_timer.max_retries);
+
+	for(unsigned int ecu = 0; ecu < OBD2_MAX_ECUS; ecu++){
+		if(ecus & (1u << ecu)){
+			reader->next_pid[ecu] = CALIBRATION_ID;
+		}/*if*/
+	}/*for*/
+
+	reader->info.ecus |= ecus;
+}/*obd2_vehicle_info_read_calibration*/
+
+static bool next_broadcast(obd2_vehicle_info_reader* reader, unsigned long long now){
+	if(reader->broadcast_pid == 0){
+		return false;
+	}/*if*/
+
+	if(!reader->broadcast_sent){
+		reader->broadcast_sent = true;
+		return true;
+	}/*if*/
+
+	switch(obd2_request_state(&reader->broadcast_timer, now)){
+		case Obd2_Request_Retry:
+			return true;
+		case Obd2_Request_Failed:
+			/* Nobody is listening. */
+			reader->broadcast_pid = 0;
+			return false;
+		case Obd2_Request_Complete:
+		case Obd2_Request_Idle:
+			reader->broadcast_pid = 0;
+			return false;
+		default:
+			return false;
+	}/*switch*/
+}/*next_broadcast*/
+
+bool obd2_vehicle_info_next_request(obd2_vehicle_info_reader* reader, unsigned long long now, unsigned int* request_id, unsigned char* pid){
+	if(next_broadcast(reader, now)){
+		*request_id	= CAN_OBD2_QUERY_MESSAGE_ID_BROADCAST;
+		*pid				= reader->broadcast_pid;
+		obd2_request_sent(&reader->broadcast_timer, *request_id, REQUEST_VEHICLE_INFORMATION, *pid, now);
+		return true;
+	}/*if*/
+
+	for(unsigned int ecu = 0; ecu < OBD2_MAX_ECUS; ecu++){
+		obd2_request_timer* timer = &reader->ecu_timers[ecu];
+
+		if(reader->next_pid[ecu] == 0){
+			continue;
+		}/*if*/
+
+		switch(obd2_request_state(timer, now)){
+			case Obd2_Request_Waiting:
+				continue;
+			case Obd2_Request_Failed:
+				/* Keep what this ECU told so far. */
+				reader->next_pid[ecu] = 0;
+				continue;
+			default:
+				break;
+		}/*switch*/
+
+		*request_id	= CAN_OBD2_QUERY_MESSAGE_ID_LOW+ecu;
+		*pid				= reader->next_pid[ecu];
+		obd2_request_sent(timer, *request_id, REQUEST_VEHICLE_INFORMATION, *pid, now);
+		return true;
+	}/*for*/
+
+	return false;
+}/*obd2_vehicle_info_next_request*/
+
+static void store_calibration_ids(obd2_vehicle_info_reader* reader, unsigned int ecu, const unsigned char* payload, unsigned int length){
+	reader->info.number_of_calibration_ids[ecu] = parse_obd2_calibration_ids(payload, length, reader->info.calibration_ids[ecu], OBD2_MAX_CALIBRATION_IDS);
+	reader->info.ecus				|= 1u << ecu;
+	reader->calibration_ecus	|= 1u << ecu;
+	reader->next_pid[ecu]			= CALIBRATION_VERIFICATION_NUMBERS;
+}/*store_calibration_ids*/
+
+bool obd2_vehicle_info_response(obd2_vehicle_info_reader* reader, unsigned int response_id, const unsigned char* payload, unsigned int length, unsigned long long now){
+	if( (response_id < CAN_OBD2_RESPONSE_MESSAGE_ID_LOW) || (response_id > CAN_OBD2_RESPONSE_MESSAGE_ID_HIGH) || (length < 2) ){
+		return false;
+	}/*if*/
+
+	unsigned int ecu = response_id-CAN_OBD2_RESPONSE_MESSAGE_ID_LOW;
+
+	/* An ECU rejecting what it was asked for, other than to ask for more time, will not tell. */
+	if( (payload[0] == OBD2_NEGATIVE_RESPONSE) && (length >= 3) ){
+		if( (payload[1] != REQUEST_VEHICLE_INFORMATION) || (payload[2] == OBD2_RESPONSE_PENDING) || (reader->next_pid[ecu] == 0) ){
+			return false;
+		}/*if*/
+
+		obd2_request_cancel(&reader->ecu_timers[ecu]);
+		reader->next_pid[ecu] = (reader->next_pid[ecu] == CALIBRATION_ID) ? CALIBRATION_VERIFICATION_NUMBERS : 0;
+		return true;
+	}/*if*/
+
+	if(payload[0] != REQUEST_VEHICLE_INFORMATION+MODE_RESPONSE_DELTA){
+		return false;
+	}/*if*/
+
+	/* The timers only look at the mode of a response. */
+	obd2_response response;
+	memset(&response, 0x0, sizeof(response));
+	response.mode = payload[0];
+
+	unsigned char pid = payload[1];
+
+	if( (pid == reader->broadcast_pid) && (pid == VEHICLE_IDENTIFICATION_NUMBER) ){
+		obd2_response_received(&reader->broadcast_timer, response_id, &response, now);
+
+		if(reader->info.vin[0] == '\0'){
+			parse_obd2_vin(payload, length, reader->info.vin);
+		}/*if*/
+
+		/* One VIN is all it takes. */
+		obd2_request_cancel(&reader->broadcast_timer);
+
+		reader->info.ecus |= 1u << ecu;
+		return true;
+	}/*if*/
+
+	if( (pid == reader->broadcast_pid) && (pid == CALIBRATION_ID) && (reader->next_pid[ecu] == 0) && !(reader->calibration_ecus & (1u << ecu)) ){
+		obd2_response_received(&reader->broadcast_timer, response_id, &response, now);
+		store_calibration_ids(reader, ecu, payload, length);
+		return true;
+	}/*if*/
+
+	if( (reader->next_pid[ecu] == 0) || (pid != reader->next_pid[ecu]) ){
+		/* A late answer to a retransmitted broadcast, or to a request already given up on. */
+		return false;
+	}/*if*/
+
+	obd2_response_received(&reader->ecu_timers[ecu], response_id, &response, now);
+
+	if(pid == CALIBRATION_ID){
+		store_calibration_ids(reader, ecu, payload, length);
+	}/*if*/
+	else{
+		reader->info.number_of_cvns[ecu]	= parse_obd2_cvns(payload, length, reader->info.cvns[ecu], OBD2_MAX_CALIBRATION_IDS);
+		reader->next_pid[ecu]							= 0;
+	}/*else*/
+
+	return true;
+}/*obd2_vehicle_info_response*/
+
+bool obd2_vehicle_info_is_complete(const obd2_vehicle_info_reader* reader){
+	if(reader->broadcast_pid != 0){
+		return false;
+	}/*if*/
+
+	for(unsigned int ecu = 0; ecu < OBD2_MAX_ECUS; ecu++){
+		if(reader->next_pid[ecu] != 0){
+			return false;
+		}/*if*/
+	}/*for*/
+
+	return true;
+}/*obd2_vehicle_info_is_complete*/
+
+bool parse_obd2_vin(const unsigned char* payload, unsigned int length, char* vin){
+	if( (length < OBD2_VEHICLE_INFO_HEADER_SIZE+OBD2_VIN_SIZE) || (payload[0] != REQUEST_VEHICLE_INFORMATION+MODE_RESPONSE_DELTA) ||
+			(payload[1] != VEHICLE_IDENTIFICATION_NUMBER) ){
+		return false;
+	}/*if*/
+
+	/* Some ECUs pad the VIN with 0x00 in front, so it is taken from the end. */
+	const unsigned char* characters = payload+length-OBD2_VIN_SIZE;
+
+	for(unsigned int i = 0; i < OBD2_VIN_SIZE; i++){
+		if( (characters[i] < 0x20) || (characters[i] > 0x7E) ){
+			return false;
+		}/*if*/
+	}/*for*/
+
+	memcpy(vin, characters, OBD2_VIN_SIZE);
+	vin[OBD2_VIN_SIZE] = '\0';
+
+	return true;
+}/*parse_obd2_vin*/
+
+unsigned int parse_obd2_calibration_ids(const unsigned char* payload, unsigned int length, char ids[][OBD2_CALIBRATION_ID_SIZE+1], unsigned int max_ids){
+	if( (length < OBD2_VEHICLE_INFO_HEADER_SIZE) || (payload[0] != REQUEST_VEHICLE_INFORMATION+MODE_RESPONSE_DELTA) || (payload[1] != CALIBRATION_ID) ){
+		return 0;
+	}/*if*/
+
+	unsigned int available	= (length-OBD2_VEHICLE_INFO_HEADER_SIZE)/OBD2_CALIBRATION_ID_SIZE;
+	unsigned int count			= (payload[2] < available) ? payload[2] : available;
+
+	if(count > max_ids){
+		count = max_ids;
+	}/*if*/
+
+	for(unsigned int i = 0; i < count; i++){
+		/* Unused characters are sent as 0x00, which terminates the string. */
+		memcpy(ids[i], payload+OBD2_VEHICLE_INFO_HEADER_SIZE+i*OBD2_CALIBRATION_ID_SIZE, OBD2_CALIBRATION_ID_SIZE);
+		ids[i][OBD2_CALIBRATION_ID_SIZE] = '\0';
+	}/*for*/
+
+	return count;
+}/*parse_obd2_calibration_ids*/
+
+unsigned int parse_obd2_cvns(const unsigned char* payload, unsigned int length, unsigned int* cvns, unsigned int max_cvns){
+	if( (length < OBD2_VEHICLE_INFO_HEADER_SIZE) || (payload[0] != REQUEST_VEHICLE_INFORMATION+MODE_RESPONSE_DELTA) ||
+			(payload[1] != CALIBRATION_VERIFICATION_NUMBERS) ){
+		return 0;
+	}/*if*/
+
+	unsigned int available	= (length-OBD2_VEHICLE_INFO_HEADER_SIZE)/OBD2_CVN_SIZE;
+	unsigned int count			= (payload[2] < available) ? payload[2] : available;
+
+	if(count > max_cvns){
+		count = max_cvns;
+	}/*if*/
+
+	for(unsigned int i = 0; i < count; i++){
+		const unsigned char* cvn = payload+OBD2_VEHICLE_INFO_HEADER_SIZE+i*OBD2_CVN_SIZE;
+		cvns[i] = (cvn[0] << 24) | (cvn[1] << 16) | (cvn[2] << 8) | cvn[3];
+	}/*for*/
+
+	return count;
+}/*parse_obd2_cvns*/
+
+int save_obd2_vehicle_info(const char* directory, const obd2_vehicle_info* info){
+	char path[4096];
+
+	if(!obd2_vin_cache_path(path, sizeof(path), directory, info->vin, "info")){
+		printf("Invalid VIN for the vehicle information cache: %s\n", info->vin);
+		return 0;
+	}/*if*/
+
+	FILE* cache_file = fopen(path, "wb");
+	if(cache_file == NULL){
+		perror(path);
+		return 0;
+	}/*if*/
+
+	obd2_vehicle_info_cache_header header;
+	memset(&header, 0x0, sizeof(header));
+	memcpy(header.magic, OBD2_VEHICLE_INFO_CACHE_MAGIC, sizeof(OBD2_VEHICLE_INFO_CACHE_MAGIC));
+	header.version = OBD2_VEHICLE_INFO_CACHE_VERSION;
+
+	int success = (fwrite(&header, sizeof(header), 1, cache_file) == 1) &&
+								(fwrite(info, sizeof(obd2_vehicle_info), 1, cache_file) == 1);
+
+	if(fclose(cache_file) != 0){
+		success = 0;
+	}/*if*/
+
+	if(!success){
+		perror("Failed to write the vehicle information cache");
+	}/*if*/
+
+	return success;
+}/*save_obd2_vehicle_info*/
+
+/* A cache file may be stale or corrupt: its counts must be in range, and its strings are terminated here. */
+static bool check_loaded_vehicle_info(obd2_vehicle_info* info){
+	info->vin[OBD2_VIN_SIZE] = '\0';
+
+	for(unsigned int ecu = 0; ecu < OBD2_MAX_ECUS; ecu++){
+		if( (info->number_of_calibration_ids[ecu] > OBD2_MAX_CALIBRATION_IDS) || (info->number_of_cvns[ecu] > OBD2_MAX_CALIBRATION_IDS) ){
+			return false;
+		}/*if*/
+
+		for(unsigned int i = 0; i < OBD2_MAX_CALIBRATION_IDS; i++){
+			info->calibration_ids[ecu][i][OBD2_CALIBRATION_ID_SIZE] = '\0';
+		}/*for*/
+	}/*for*/
+
+	return true;
+}/*check_loaded_vehicle_info*/
+
+int load_obd2_vehicle_info(const char* directory, const char* vin, obd2_vehicle_info* info){
+	char path[4096];
+
+	if(!obd2_vin_cache_path(path, sizeof(path), directory, vin, "info")){
+		return 0;
+	}/*if*/
+
+	FILE* cache_file = fopen(path, "rb");
+	if(cache_file == NULL){
+		/* Not having seen the car before is no error. */
+		if(errno != ENOENT){
+			perror(path);
+		}/*if*/
+		return 0;
+	}/*if*/
+
+	obd2_vehicle_info_cache_header header;
+
+	int success = (fread(&header, sizeof(header), 1, cache_file) == 1) &&
+								(memcmp(header.magic, OBD2_VEHICLE_INFO_CACHE_MAGIC, sizeof(OBD2_VEHICLE_INFO_CACHE_MAGIC)) == 0) &&
+								(header.version == OBD2_VEHICLE_INFO_CACHE_VERSION) &&
+								(fread(info, sizeof(obd2_vehicle_info), 1, cache_file) == 1) &&
+								check_loaded_vehicle_info(info) &&
+								(strncmp(info->vin, vin, sizeof(info->vin)) == 0);
+
+	if(!success){
+		printf("%s is not a vehicle information cache of a supported version.\n", path);
+	}/*if*/
+
+	fclose(cache_file);
+
+	return success;
+}/*load_obd2_vehicle_info*/
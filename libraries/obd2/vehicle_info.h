@@ -0,0 +1,81 @@
+#ifndef OBD2_VEHICLE_INFO_H
+#define OBD2_VEHICLE_INFO_H
+
+#include "obd2can.h"
+#include "request_timer.h"
+
+/* @NOTE: Reads the vehicle information (Mode 0x09) which identifies a car and its software: the VIN, and the
+ * 				calibration IDs and calibration verification numbers (CVN) of every ECU.
+ *
+ * 				On CAN, every answer holds the number of data items after the PID, and then the items themselves:
+ *
+ * 						0x49 0x02 0x01 <17 characters of VIN>
+ * 						0x49 0x04 count <16 characters per calibration ID, padded with 0x00>
+ * 						0x49 0x06 count <4 bytes per CVN>
+ *
+ * 				Each of these spans several frames, so the answers are expected to have been put back together by ISO-TP
+ * 				(see can/isotp.hpp) before they are fed to the reader.
+ *
+ * 				The reader first broadcasts the VIN request, and is complete once it is answered. The information only changes
+ * 				when an ECU is reprogrammed, so the caller looks for the VIN in the cache, and only on a miss goes on with
+ * 				obd2_vehicle_info_read_calibration(). This broadcasts the calibration ID request, which every emission
+ * 				related ECU answers, and asks each ECU which answered for its CVNs by unicast, all at the same time. Given
+ * 				the ECUs, the calibration IDs are asked for by unicast as well.
+ *
+ * 				The reader never touches the bus itself: obd2_vehicle_info_next_request() hands out the requests to send and
+ * 				obd2_vehicle_info_response() takes every answer.
+ */
+
+#define OBD2_VIN_SIZE										17
+#define OBD2_CALIBRATION_ID_SIZE				16
+#define OBD2_MAX_CALIBRATION_IDS				4			/* Per ECU */
+#define OBD2_VEHICLE_INFO_CACHE_MAGIC		"OBD2INF"
+#define OBD2_VEHICLE_INFO_CACHE_VERSION	1
+
+typedef struct{
+	char					vin[OBD2_VIN_SIZE+1];																																/* Empty if no ECU told. */
+	unsigned int	ecus;																																								/* Bit n set == the ECU answering with 0x7e8+n answered. */
+	unsigned char	number_of_calibration_ids[OBD2_MAX_ECUS];
+	char					calibration_ids[OBD2_MAX_ECUS][OBD2_MAX_CALIBRATION_IDS][OBD2_CALIBRATION_ID_SIZE+1];
+	unsigned char	number_of_cvns[OBD2_MAX_ECUS];
+	unsigned int	cvns[OBD2_MAX_ECUS][OBD2_MAX_CALIBRATION_IDS];
+}obd2_vehicle_info;
+
+typedef struct{
+	obd2_vehicle_info		info;
+
+	obd2_request_timer	broadcast_timer;
+	unsigned char				broadcast_pid;						/* The PID being broadcast, 0 once the broadcasts are done. */
+	bool								broadcast_sent;
+
+	obd2_request_timer	ecu_timers[OBD2_MAX_ECUS];
+	unsigned char				next_pid[OBD2_MAX_ECUS];	/* The next PID to ask each ECU for, 0 once it is done. */
+	unsigned int				calibration_ecus;					/* Bit n set == ECU n has sent its calibration IDs. */
+}obd2_vehicle_info_reader;
+
+/* Starts by reading the VIN. */
+void init_obd2_vehicle_info_reader(obd2_vehicle_info_reader* reader, unsigned int max_retries);
+
+/* Goes on to read the calibration IDs and CVNs. ecus is a mask of the ECUs to ask as in obd2_vehicle_info, or 0 to find
+ * them by broadcast. */
+void obd2_vehicle_info_read_calibration(obd2_vehicle_info_reader* reader, unsigned int ecus);
+
+/* Returns true and sets request_id and pid if a Mode 0x09 request should be sent now. Call until it returns false. */
+bool obd2_vehicle_info_next_request(obd2_vehicle_info_reader* reader, unsigned long long now, unsigned int* request_id, unsigned char* pid);
+
+/* Feeds a response payload, starting with the mode byte, into the reader. Returns true if it was a Mode 0x09 answer. */
+bool obd2_vehicle_info_response(obd2_vehicle_info_reader* reader, unsigned int response_id, const unsigned char* payload, unsigned int length, unsigned long long now);
+
+bool obd2_vehicle_info_is_complete(const obd2_vehicle_info_reader* reader);
+
+/* Parsers for answer payloads, starting with the mode byte. The VIN parser returns false unless the payload holds one,
+ * the others return the number of items stored. */
+bool parse_obd2_vin(const unsigned char* payload, unsigned int length, char* vin);
+unsigned int parse_obd2_calibration_ids(const unsigned char* payload, unsigned int length, char ids[][OBD2_CALIBRATION_ID_SIZE+1], unsigned int max_ids);
+unsigned int parse_obd2_cvns(const unsigned char* payload, unsigned int length, unsigned int* cvns, unsigned int max_cvns);
+
+/* Saves and loads the vehicle information of a car as <directory>/<vin>.info. Return 0 on failure. */
+int save_obd2_vehicle_info(const char* directory, const obd2_vehicle_info* info);
+int load_obd2_vehicle_info(const char* directory, const char* vin, obd2_vehicle_info* info);
+
+#endif
@@ -0,0 +1,9 @@
+#include "clock.h"
+#include <time.h>
+
+unsigned long long monotonic_microseconds(void){
+	struct timespec current_time;
+	clock_gettime(CLOCK_MONOTONIC, &current_time);
+
+	return (unsigned long long)current_time.tv_sec*1000000ULL + current_time.tv_nsec/1000;
+}/*monotonic_microseconds*/
@@ -0,0 +1,10 @@
+#ifndef MONOTONIC_CLOCK_H
+#define MONOTONIC_CLOCK_H
+
+/* @NOTE: All timestamps in the libraries are taken from CLOCK_MONOTONIC, so they are unaffected by
+ *        changes to the wall clock. They are only meaningful relative to each other.
+ */
+
+unsigned long long monotonic_microseconds(void);
+
+#endif
@@ -0,0 +1,58 @@
+#include "rtt_estimator.h"
+
+static unsigned long long clamp_timeout(const rtt_estimator* estimator, unsigned long long timeout){
+	if(timeout < estimator->min_timeout){
+		return estimator->min_timeout;
+	}/*if*/
+
+	if(timeout > estimator->max_timeout){
+		return estimator->max_timeout;
+	}/*if*/
+
+	return timeout;
+}/*clamp_timeout*/
+
+void init_rtt_estimator(rtt_estimator* estimator, unsigned long long initial_timeout, unsigned long long min_timeout, unsigned long long max_timeout){
+	estimator->smoothed_rtt	= 0;
+	estimator->rtt_variance	= 0;
+	estimator->min_timeout	= min_timeout;
+	estimator->max_timeout	= max_timeout;
+	estimator->backoffs			= 0;
+	estimator->samples			= 0;
+	estimator->timeout			= clamp_timeout(estimator, initial_timeout);
+}/*init_rtt_estimator*/
+
+void rtt_estimator_sample(rtt_estimator* estimator, unsigned long long rtt){
+	if(estimator->samples == 0){
+		estimator->smoothed_rtt	= rtt;
+		estimator->rtt_variance	= rtt/2;
+	}/*if*/
+	else{
+		unsigned long long deviation = rtt > estimator->smoothed_rtt ? rtt-estimator->smoothed_rtt : estimator->smoothed_rtt-rtt;
+
+		estimator->rtt_variance	= (3*estimator->rtt_variance + deviation)/4;
+		estimator->smoothed_rtt	= (7*estimator->smoothed_rtt + rtt)/8;
+	}/*else*/
+
+	unsigned long long variance_term = 4*estimator->rtt_variance;
+	if(variance_term < RTT_ESTIMATOR_GRANULARITY){
+		variance_term = RTT_ESTIMATOR_GRANULARITY;
+	}/*if*/
+
+	estimator->samples	+= 1;
+	estimator->backoffs	= 0;
+	estimator->timeout	= clamp_timeout(estimator, estimator->smoothed_rtt + variance_term);
+}/*rtt_estimator_sample*/
+
+void rtt_estimator_backoff(rtt_estimator* estimator){
+	estimator->backoffs	+= 1;
+	estimator->timeout	= clamp_timeout(estimator, 2*estimator->timeout);
+}/*rtt_estimator_backoff*/
+
+unsigned long long rtt_estimator_timeout(const rtt_estimator* estimator){
+	return estimator->timeout;
+}/*rtt_estimator_timeout*/
+
+bool rtt_estimator_expired(const rtt_estimator* estimator, unsigned long long transmission_time, unsigned long long now){
+	return (now > transmission_time) && (now-transmission_time > estimator->timeout);
+}/*rtt_estimator_expired*/
@@ -0,0 +1,39 @@
+#ifndef RTT_ESTIMATOR_H
+#define RTT_ESTIMATOR_H
+
+/* @NOTE: Estimates how long to wait for the answer to a request from measured round-trip times,
+ *        the same way TCP computes its retransmission timeout (RFC 6298):
+ *
+ *          SRTT   = 7/8 SRTT + 1/8 R
+ *          RTTVAR = 3/4 RTTVAR + 1/4 |SRTT - R|
+ *          RTO    = SRTT + max(granularity, 4 RTTVAR)
+ *
+ *        Every timeout doubles the RTO up to max_timeout, the next sample restores it.
+ *        Only answers to requests which were transmitted once may be sampled (Karn's algorithm):
+ *        the answer to a retransmitted request cannot be told apart from a late answer to the
+ *        first transmission. All times are in microseconds.
+ */
+
+#define RTT_ESTIMATOR_GRANULARITY	1000ULL
+
+typedef struct{
+	unsigned long long	smoothed_rtt;
+	unsigned long long	rtt_variance;
+	unsigned long long	timeout;
+	unsigned long long	min_timeout;
+	unsigned long long	max_timeout;
+	unsigned int				backoffs;
+	unsigned int				samples;
+}rtt_estimator;
+
+void init_rtt_estimator(rtt_estimator* estimator, unsigned long long initial_timeout, unsigned long long min_timeout, unsigned long long max_timeout);
+
+void rtt_estimator_sample(rtt_estimator* estimator, unsigned long long rtt);
+void rtt_estimator_backoff(rtt_estimator* estimator);
+
+unsigned long long rtt_estimator_timeout(const rtt_estimator* estimator);
+
+/* Returns true once a request transmitted at transmission_time is overdue. */
+bool rtt_estimator_expired(const rtt_estimator* estimator, unsigned long long transmission_time, unsigned long long now);
+
+#endif
@@ -1,38 +1,114 @@
+/*
+ * Description: Polls a set of Trionic 5 symbols with the kernel's broadcast manager.
+ *
+ *              dump_all <interface|auto> <trionic5_binary> <interval_ms> <symbol> [symbol ...]
+ *                The read requests for all symbols are handed to the kernel once, which then sends
+ *                one of them every interval_ms. This program only harvests the responses and prints
+ *                the symbol values once a second, in engineering units where the metadata is known.
+ */
+
 #include "can/bus.hpp"
-#include "can/trionic5/messages.hpp"
+#include "can/trionic5/symbol_pump.hpp"
+#include "can/trionic5/symbol_table.hpp"
+#include "can/trionic5/symbol_metadata.hpp"
 #include "adapters/lawicel-canusb.hpp"
+#include "timing/clock.h"
 
 #include <time.h>
 
-int main(){
-  unsigned int incoming_frame_id;
-  char receive_data[20];
-  memset(receive_data, 0x0, 20);
+int main(int argc, char** argv){
+  if(argc < 5){
+    printf("Usage: %s <interface|auto> <trionic5_binary> <interval_ms> <symbol> [symbol ...]\n", argv[0]);
+    return 1;
+  }/*if*/
+
+  const char*                     interface_name = argv[1];
+  canusb_devices::lawicel_canusb  adapter;
+
+  if(strcmp(interface_name, "auto") == 0){
+    if(!adapter.auto_setup()){
+      return 1;
+    }/*if*/
+
+    interface_name = adapter.get_interface_name();
+  }/*if*/
+
+  static trionic5net::symbol_table  table;
+  static trionic5net::sram_mirror   mirror;
+  static trionic5net::symbol_pump   pump(&mirror);
+
+  if(!table.load(argv[2])){
+    return 1;
+  }/*if*/
+
+  const trionic5net::symbol*      symbols[MAX_PUMPED_READS];
+  trionic5net::symbol_conversion  conversions[MAX_PUMPED_READS];
+  float                           values[MAX_PUMPED_READS];
+  unsigned int                    number_of_symbols = 0;
+
+  for(int i = 4; i < argc; i++){
+    const trionic5net::symbol* sym = table.find(argv[i]);
+
+    if(sym == 0){
+      printf("%s is not in the symbol table, skipping it.\n", argv[i]);
+      continue;
+    }/*if*/
+
+    if(!trionic5net::prepare_conversion(&conversions[number_of_symbols], sym, trionic5net::find_symbol_metadata(sym->name, sym->name_length))){
+      printf("%s does not match its metadata, skipping it.\n", argv[i]);
+      continue;
+    }/*if*/
 
-  canusb_devices::lawicel_canusb adapter;
-  adapter.auto_setup();
+    if(!pump.add(sym)){
+      printf("Cannot pump %s, too many symbols.\n", argv[i]);
+      continue;
+    }/*if*/
 
-  can::bus canbus;
-  canbus.set_name(IFNAMSIZ, adapter.get_interface_name());
+    symbols[number_of_symbols] = sym;
+    number_of_symbols += 1;
+  }/*for*/
 
-  canbus.open();
+  unsigned long   interval_ms = strtoul(argv[3], NULL, 0);
+  struct timeval  interval;
+  interval.tv_sec   = interval_ms/1000;
+  interval.tv_usec  = (interval_ms%1000)*1000;
 
-	struct timespec sleep_time;
-	sleep_time.tv_sec = 1;
-	sleep_time.tv_nsec = 16700;
+  if(!pump.start(interface_name, interval)){
+    printf("Could not start pumping requests on %s\n", interface_name);
+    return 1;
+  }/*if*/
+
+  struct timespec sleep_time;
+  sleep_time.tv_sec  = 0;
+  sleep_time.tv_nsec = 10000000;
+
+  unsigned long long last_print = monotonic_microseconds();
 
   do{
-		printf("Requesting AD_trot\n");
-		canbus.send(&trionic5net::AD_trot);
-		nanosleep(&sleep_time, NULL);
-  	//canbus.receive(19, receive_data, &incoming_frame_id);
-  	//printf("I read the following from Trionic: %s\n", receive_data);
-		
-		printf("Requesting Rpm\n");
-		canbus.send(&trionic5net::Rpm);
-		nanosleep(&sleep_time, NULL);
-	//	canbus.receive(19, receive_data, &incoming_frame_id);
-  	//printf("I read the following from Trionic: %s\n", receive_data);
+    pump.poll();
+    nanosleep(&sleep_time, NULL);
+
+    unsigned long long now = monotonic_microseconds();
+    if(now-last_print < 1000000){
+      continue;
+    }/*if*/
+
+    last_print = now;
+
+    trionic5net::convert_symbols(mirror.get_data(), conversions, number_of_symbols, values);
+
+    for(unsigned int i = 0; i < number_of_symbols; i++){
+      trionic5net::sram_view symbol_view = mirror.view(symbols[i]);
+
+      if(symbol_view.get_timestamp() == 0){
+        printf("%.*s: -\n", symbols[i]->name_length, symbols[i]->name);
+        continue;
+      }/*if*/
+
+      printf("%.*s: %g (%llu ms old)\n", symbols[i]->name_length, symbols[i]->name, values[i], (now-symbol_view.get_timestamp())/1000);
+    }/*for*/
+
+    printf("%llu reads completed, %llu lost\n", pump.get_completed_reads(), pump.get_failed_reads());
   }while(1);
 
   return 0;
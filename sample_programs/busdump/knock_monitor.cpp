@@ -0,0 +1,161 @@
+/*
+ * Description: Watches knock and misfires of a running Trionic 5 per cylinder and operating point.
+ *
+ *              knock_monitor <interface|auto> <trionic5_binary> <interval_ms> [load_symbol] [bin_map]
+ *                Pumps Rpm, the load symbol (P_medel by default), Knock_status and the per cylinder
+ *                knock offsets and misfire counters, and feeds every fresh value into a combustion
+ *                monitor. The statistics are published in the combustion statistics port, and every
+ *                rpm/load cell with samples is printed once a second. With bin_map, the cells
+ *                follow the break points of that calibration map instead of the default grid.
+ */
+
+#include "can/bus.hpp"
+#include "can/trionic5/symbol_pump.hpp"
+#include "can/trionic5/symbol_table.hpp"
+#include "can/trionic5/symbol_metadata.hpp"
+#include "can/trionic5/calibration_maps.hpp"
+#include "can/trionic5/combustion_monitor.hpp"
+#include "adapters/lawicel-canusb.hpp"
+#include "timing/clock.h"
+
+#include <time.h>
+
+int main(int argc, char** argv){
+  if(argc < 4){
+    printf("Usage: %s <interface|auto> <trionic5_binary> <interval_ms> [load_symbol] [bin_map]\n", argv[0]);
+    return 1;
+  }/*if*/
+
+  const char*                     interface_name  = argv[1];
+  const char*                     load_name       = (argc > 4) ? argv[4] : "P_medel";
+  canusb_devices::lawicel_canusb  adapter;
+
+  if(strcmp(interface_name, "auto") == 0){
+    if(!adapter.auto_setup()){
+      return 1;
+    }/*if*/
+
+    interface_name = adapter.get_interface_name();
+  }/*if*/
+
+  static trionic5net::symbol_table        table;
+  static trionic5net::sram_mirror         mirror;
+  static trionic5net::symbol_pump         pump(&mirror);
+  static trionic5net::calibration_maps    maps;
+  static trionic5net::combustion_monitor  monitor;
+
+  if(!table.load(argv[2])){
+    return 1;
+  }/*if*/
+
+  if(!monitor.bind(&table, load_name)){
+    printf("The symbol table lacks Rpm or %s.\n", load_name);
+    return 1;
+  }/*if*/
+
+  if(argc > 5){
+    if( !maps.load(&table) || !monitor.set_bins(maps.find(argv[5]), 1.0f, 1.0f) ){
+      printf("Cannot use %s for the rpm/load cells.\n", argv[5]);
+      return 1;
+    }/*if*/
+  }/*if*/
+
+  /* Pump every symbol the monitor knows a role for. */
+  const trionic5net::symbol*      symbols[MAX_PUMPED_READS];
+  trionic5net::symbol_conversion  conversions[MAX_PUMPED_READS];
+  unsigned long long              timestamps[MAX_PUMPED_READS];
+  unsigned int                    number_of_symbols = 0;
+
+  const char* names[] = {"Rpm", load_name, "Knock_status",
+                         "Knock_offset1", "Knock_offset2", "Knock_offset3", "Knock_offset4",
+                         "Mis200_1", "Mis200_2", "Mis200_3", "Mis200_4",
+                         "Mis1000_1", "Mis1000_2", "Mis1000_3", "Mis1000_4"};
+
+  for(unsigned int i = 0; i < sizeof(names)/sizeof(names[0]); i++){
+    const trionic5net::symbol* sym = table.find(names[i]);
+
+    if(sym == 0){
+      printf("%s is not in the symbol table, skipping it.\n", names[i]);
+      continue;
+    }/*if*/
+
+    if(!trionic5net::prepare_conversion(&conversions[number_of_symbols], sym, trionic5net::find_symbol_metadata(sym->name, sym->name_length))){
+      printf("%s does not match its metadata, skipping it.\n", names[i]);
+      continue;
+    }/*if*/
+
+    if(!pump.add(sym)){
+      printf("Cannot pump %s, too many symbols.\n", names[i]);
+      continue;
+    }/*if*/
+
+    symbols[number_of_symbols]    = sym;
+    timestamps[number_of_symbols] = 0;
+    number_of_symbols += 1;
+  }/*for*/
+
+  if(!monitor.publish(port_combustion_statistics)){
+    printf("Could not publish the statistics, keeping them private.\n");
+  }/*if*/
+
+  unsigned long   interval_ms = strtoul(argv[3], NULL, 0);
+  struct timeval  interval;
+  interval.tv_sec   = interval_ms/1000;
+  interval.tv_usec  = (interval_ms%1000)*1000;
+
+  if(!pump.start(interface_name, interval)){
+    printf("Could not start pumping requests on %s\n", interface_name);
+    return 1;
+  }/*if*/
+
+  struct timespec sleep_time;
+  sleep_time.tv_sec   = 0;
+  sleep_time.tv_nsec  = 10000000;
+
+  unsigned long long last_print = monotonic_microseconds();
+
+  do{
+    pump.poll();
+    nanosleep(&sleep_time, NULL);
+
+    for(unsigned int i = 0; i < number_of_symbols; i++){
+      unsigned long long timestamp = mirror.view(symbols[i]).get_timestamp();
+
+      if(timestamp > timestamps[i]){
+        timestamps[i] = timestamp;
+        monitor.update(symbols[i], trionic5net::convert_symbol(mirror.get_data(), &conversions[i]), timestamp);
+      }/*if*/
+    }/*for*/
+
+    unsigned long long now = monotonic_microseconds();
+    if(now-last_print < 1000000){
+      continue;
+    }/*if*/
+
+    last_print = now;
+
+    const trionic5net::combustion_statistics* statistics = monitor.get_statistics();
+
+    for(unsigned int rpm_bin = 0; rpm_bin < statistics->rpm_bins; rpm_bin++){
+      for(unsigned int load_bin = 0; load_bin < statistics->load_bins; load_bin++){
+        trionic5net::combustion_cell cell;
+
+        if( !trionic5net::read_combustion_cell(statistics, rpm_bin, load_bin, &cell) || (cell.samples == 0) ){
+          continue;
+        }/*if*/
+
+        printf("%5.0f rpm %5.0f: knock %3.0f%%", statistics->rpm_axis[rpm_bin], statistics->load_axis[load_bin], 100.0f*cell.knock_activity);
+
+        for(unsigned int cylinder = 0; cylinder < COMBUSTION_MONITOR_CYLINDERS; cylinder++){
+          printf(" | %u: %3.0f%% %4.1f deg %5.1f/1000", cylinder+1, 100.0f*cell.knock_rate[cylinder], cell.knock_retard[cylinder], cell.misfire_rate[cylinder]);
+        }/*for*/
+
+        printf("\n");
+      }/*for*/
+    }/*for*/
+
+    printf("%llu updates, %llu reads completed, %llu lost\n", (unsigned long long)statistics->updates, pump.get_completed_reads(), pump.get_failed_reads());
+  }while(1);
+
+  return 0;
+}/*main*/
@@ -1,5 +1,4 @@
 #include "can/bus.hpp"
-#include "can/trionic5/messages.hpp"
 #include "adapters/lawicel-canusb.hpp"
 
 int main(){
@@ -15,7 +14,7 @@ int main(){
 
   canbus.configure_cyclic_deaf_datapump(pump_rate);
 
-  char data[8] = {0xC4,0x73,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF};
+  unsigned char data[8] = {0xC4,0x73,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF};
   
   struct can_frame cyclic_frame;
   cyclic_frame.can_id = 0x005;
@@ -28,8 +27,10 @@ int main(){
 
   canbus.configure_cyclic_datapump_frames(1, fnode);
 
-  canbus.open_cyclic();
-  canbus.start_pumping_cyclic_data();
+  if( (canbus.open_cyclic() != 1) || !canbus.start_pumping_cyclic_data() ){
+    printf("Could not pump frames on %s\n", adapter.get_interface_name());
+    return 1;
+  }/*if*/
 
   unsigned int incoming_frame_id;
   char receive_data[20];
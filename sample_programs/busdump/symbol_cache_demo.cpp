@@ -0,0 +1,157 @@
+/*
+ * Description: Reads Trionic 5 symbols on behalf of several consumers through the symbol cache.
+ *
+ *              symbol_cache <interface|auto> <trionic5_binary> <symbol> [symbol ...]
+ *                A fast consumer wants the symbols at most 100 ms old, a slow one at most 1 s old.
+ *                Both ask for every symbol in every cycle; the cache serves whatever is fresh enough
+ *                from the mirror and coalesces the rest into as few bus reads as possible.
+ */
+
+#include "can/bus.hpp"
+#include "can/trionic5/sram_reader.hpp"
+#include "can/trionic5/symbol_cache.hpp"
+#include "can/trionic5/symbol_table.hpp"
+#include "timing/clock.h"
+#include "adapters/lawicel-canusb.hpp"
+
+#include <time.h>
+
+#define MAX_DUMPED_SYMBOLS 64
+
+struct consumer{
+  const char*         name;
+  unsigned long long  max_age;
+  bool                waiting[MAX_DUMPED_SYMBOLS];
+  unsigned long long  updates;
+};
+
+struct consumer_request{
+  consumer*     owner;
+  unsigned int  symbol_index;
+};
+
+void value_ready(void* context, const unsigned int start_address, const unsigned int end_address, const bool success);
+
+trionic5net::symbol_table table;
+trionic5net::sram_mirror  mirror;
+
+int main(int argc, char** argv){
+  if(argc < 4){
+    printf("Usage: %s <interface|auto> <trionic5_binary> <symbol> [symbol ...]\n", argv[0]);
+    return 1;
+  }/*if*/
+
+  const char*                     interface_name = argv[1];
+  canusb_devices::lawicel_canusb  adapter;
+
+  if(strcmp(interface_name, "auto") == 0){
+    if(!adapter.auto_setup()){
+      return 1;
+    }/*if*/
+
+    interface_name = adapter.get_interface_name();
+  }/*if*/
+
+  if(!table.load(argv[2])){
+    return 1;
+  }/*if*/
+
+  const trionic5net::symbol*  symbols[MAX_DUMPED_SYMBOLS];
+  unsigned int                number_of_symbols = 0;
+
+  for(int i = 3; (i < argc) && (number_of_symbols < MAX_DUMPED_SYMBOLS); i++){
+    symbols[number_of_symbols] = table.find(argv[i]);
+
+    if(symbols[number_of_symbols] == 0){
+      printf("%s is not in the symbol table, skipping it.\n", argv[i]);
+      continue;
+    }/*if*/
+
+    number_of_symbols += 1;
+  }/*for*/
+
+  can::bus canbus;
+  canbus.set_name(IFNAMSIZ, interface_name);
+
+  if(canbus.open() != 1){
+    printf("Could not open %s\n", interface_name);
+    return 1;
+  }/*if*/
+
+  canbus.set_receive_frame_filter(TRIONIC5_RESPONSE_FRAME_ID, CAN_SFF_MASK);
+
+  trionic5net::sram_reader  reader(&canbus, &mirror);
+  trionic5net::symbol_cache cache(&reader, &mirror);
+
+  consumer consumers[2];
+  memset(consumers, 0x0, sizeof(consumers));
+  consumers[0].name     = "fast";
+  consumers[0].max_age  = 100000;
+  consumers[1].name     = "slow";
+  consumers[1].max_age  = 1000000;
+
+  consumer_request requests[2][MAX_DUMPED_SYMBOLS];
+
+  struct timespec sleep_time;
+  sleep_time.tv_sec = 0;
+  sleep_time.tv_nsec = 1000000;
+
+  unsigned long long last_print = monotonic_microseconds();
+
+  do{
+    for(unsigned int c = 0; c < 2; c++){
+      for(unsigned int i = 0; i < number_of_symbols; i++){
+        if(consumers[c].waiting[i]){
+          continue;
+        }/*if*/
+
+        requests[c][i].owner        = &consumers[c];
+        requests[c][i].symbol_index = i;
+
+        switch(cache.request(symbols[i], consumers[c].max_age, value_ready, &requests[c][i])){
+          case trionic5net::Symbol_Cache_Fresh:
+            consumers[c].updates += 1;
+            break;
+          case trionic5net::Symbol_Cache_Pending:
+            consumers[c].waiting[i] = true;
+            break;
+          default:
+            break;
+        }/*switch*/
+      }/*for*/
+    }/*for*/
+
+    reader.poll();
+    nanosleep(&sleep_time, NULL);
+
+    unsigned long long now = monotonic_microseconds();
+    if(now-last_print < 1000000){
+      continue;
+    }/*if*/
+
+    last_print = now;
+
+    for(unsigned int i = 0; i < number_of_symbols; i++){
+      trionic5net::sram_view symbol_view = mirror.view(symbols[i]);
+      printf("%.*s: %u\n", symbols[i]->name_length, symbols[i]->name, symbol_view.get_unsigned());
+    }/*for*/
+
+    printf("Cache: %llu hits, %llu misses, %llu coalesced, %llu bus reads\n",
+           cache.get_hits(), cache.get_misses(), cache.get_coalesced_requests(), cache.get_bus_reads());
+  }while(1);
+
+  return 0;
+}/*main*/
+
+void value_ready(void* context, const unsigned int start_address, const unsigned int end_address, const bool success){
+  consumer_request* request = (consumer_request*)context;
+
+  request->owner->waiting[request->symbol_index] = false;
+
+  if(success){
+    request->owner->updates += 1;
+  }/*if*/
+  else{
+    printf("%s consumer: failed to read 0x%04x-0x%04x\n", request->owner->name, start_address, end_address);
+  }/*else*/
+}/*value_ready*/
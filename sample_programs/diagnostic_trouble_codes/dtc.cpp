@@ -1,71 +1,219 @@
 #include "adapters/lawicel-canusb.hpp"
 #include "can/bus.hpp"
+#include "can/isotp.hpp"
 #include "obd2/obd2can.h"
 #include "obd2/unpack.h"
+#include "obd2/dtc_scan.h"
+#include "obd2/freeze_frame.h"
+#include "timing/clock.h"
 
 #include <stdio.h>
+#include <time.h>
 
-can::bus  canbus;
+can::bus            canbus;
+can::isotp_channel  ecu_channels[OBD2_MAX_ECUS];
+obd2_dtc_scan       scan;
+obd2_dtc_report     previous_report;
 
-void initialize();
+obd2_freeze_frame_reader  freeze_frames;
+
+void initialize(const char* interface_name);
 void harvest_can_frames();
 void request_dtcs();
-void look_for_dtc_response(unsigned int incoming_frame_id, char* data, unsigned int data_size);
+void request_freeze_frames();
+void read_freeze_frames(const obd2_dtc_report* report, const obd2_dtc_report* previous);
+void print_report(const obd2_dtc_report* report);
+void print_freeze_frame(const obd2_freeze_frame* snapshot);
 
-void initialize(){
+void initialize(const char* interface_name){
   canusb_devices::lawicel_canusb  adapter;
-  adapter.auto_setup();
-  canbus.set_name(IFNAMSIZ, adapter.get_interface_name());
+
+  if(interface_name == 0){
+    adapter.auto_setup();
+    interface_name = adapter.get_interface_name();
+  }/*if*/
+
+  canbus.set_name(IFNAMSIZ, interface_name);
   canbus.open();
+
+  /* Long lists of codes span several frames, each ECU's answers are put together on a channel of its own. */
+  for(unsigned int ecu = 0; ecu < OBD2_MAX_ECUS; ecu++){
+    ecu_channels[ecu].set_flow_control(0, 0);
+    ecu_channels[ecu].open(interface_name, CAN_OBD2_QUERY_MESSAGE_ID_LOW+ecu, CAN_OBD2_RESPONSE_MESSAGE_ID_LOW+ecu, &canbus);
+  }/*for*/
 }/*initialize*/
 
-int main(){
-  initialize();
+/*
+ * dtc [interface]
+ *   Reads the stored, pending and permanent trouble codes of every ECU each time enter is pressed.
+ *   The first scan finds the ECUs by broadcast, later scans ask the ECUs found by unicast straight away.
+ *   Whenever an ECU has stored a new code, its freeze frame is read as well.
+ *   Given an interface, e.g. vcan0 with obd2_emulator running on it, no adapter is looked for.
+ */
+int main(int argc, char** argv){
+  unsigned int ecus = 0;
+
+  initialize( (argc > 1) ? argv[1] : 0 );
 
   do{
     printf("Press enter to request DTC.\n");
     int c = getchar();
-    request_dtcs();
-    printf("Transmitted DTC request.\n");
-    int i = 0;
-    for(; i < 1000; i++){
+
+    init_obd2_dtc_scan(&scan, ecus, OBD2_DEFAULT_RETRIES);
+
+    const struct timespec poll_period = {0, 1000000};
+
+    while(!obd2_dtc_scan_is_complete(&scan)){
+      request_dtcs();
+      nanosleep(&poll_period, NULL);
       harvest_can_frames();
-    }
+    }/*while*/
+
+    if(scan.report.ecus == 0){
+      printf("No ECU answered the DTC request.\n");
+    }/*if*/
+
+    print_report(&scan.report);
+    read_freeze_frames(&scan.report, &previous_report);
+
+    previous_report = scan.report;
+    ecus            = scan.report.ecus;
   }while(1);
 }/*main*/
 
 void request_dtcs(){
-  struct can_frame  obd2_dtc_request;
-  obd2_dtc_request.can_id   = CAN_OBD2_QUERY_MESSAGE_ID_BROADCAST;
-  obd2_dtc_request.can_dlc  = 8;
+  unsigned int  request_id;
+  unsigned char mode;
 
-  obd2_request_dtc  dtc_request_data;
+  while(obd2_dtc_scan_next_request(&scan, monotonic_microseconds(), &request_id, &mode)){
+    struct can_frame  obd2_dtc_request;
+    obd2_dtc_request.can_id   = request_id;
+    obd2_dtc_request.can_dlc  = 8;
 
-  memcpy(obd2_dtc_request.data, &dtc_request_data, obd2_dtc_request.can_dlc);
+    obd2_request_dtc  dtc_request_data;
+    dtc_request_data.mode = mode;
 
-  canbus.send(&obd2_dtc_request);
+    memcpy(obd2_dtc_request.data, &dtc_request_data, obd2_dtc_request.can_dlc);
 
+    canbus.send(&obd2_dtc_request);
+  }/*while*/
 }/*request_dtcs*/
 
+void request_freeze_frames(){
+  unsigned int              request_id;
+  obd2_request_freeze_frame request;
+
+  while(obd2_freeze_frame_next_request(&freeze_frames, monotonic_microseconds(), &request_id, &request)){
+    struct can_frame obd2_frame;
+    obd2_frame.can_id   = request_id;
+    obd2_frame.can_dlc  = 8;
+
+    memcpy(obd2_frame.data, &request, obd2_frame.can_dlc);
+    canbus.send(&obd2_frame);
+  }/*while*/
+}/*request_freeze_frames*/
+
+static bool has_new_stored_codes(const obd2_dtc_report* report, const obd2_dtc_report* previous, unsigned int ecu){
+  for(unsigned int i = 0; i < report->counts[ecu][Obd2_Dtc_Stored]; i++){
+    bool known = false;
+
+    for(unsigned int j = 0; j < previous->counts[ecu][Obd2_Dtc_Stored]; j++){
+      known |= previous->codes[ecu][Obd2_Dtc_Stored][j] == report->codes[ecu][Obd2_Dtc_Stored][i];
+    }/*for*/
+
+    if(!known){
+      return true;
+    }/*if*/
+  }/*for*/
+
+  return false;
+}/*has_new_stored_codes*/
+
+void read_freeze_frames(const obd2_dtc_report* report, const obd2_dtc_report* previous){
+  init_obd2_freeze_frame_reader(&freeze_frames, OBD2_DEFAULT_RETRIES);
+
+  for(unsigned int ecu = 0; ecu < OBD2_MAX_ECUS; ecu++){
+    if(has_new_stored_codes(report, previous, ecu)){
+      obd2_freeze_frame_add(&freeze_frames, ecu, 0);
+    }/*if*/
+  }/*for*/
+
+  const struct timespec poll_period = {0, 1000000};
+
+  while(!obd2_freeze_frame_is_complete(&freeze_frames)){
+    request_freeze_frames();
+    nanosleep(&poll_period, NULL);
+    harvest_can_frames();
+  }/*while*/
+
+  for(unsigned int i = 0; i < freeze_frames.number_of_jobs; i++){
+    print_freeze_frame(&freeze_frames.jobs[i].snapshot);
+  }/*for*/
+}/*read_freeze_frames*/
+
 void harvest_can_frames(){
   unsigned int  incoming_frame_id;
   int           incoming_data_size = -1;
-  char          receive_data[20];
+  unsigned char receive_data[ISOTP_MAX_PAYLOAD];
 
-  memset(receive_data, 0, 20);
-  incoming_data_size = canbus.receive(20, receive_data, &incoming_frame_id);
+  while( (incoming_data_size = canbus.receive(8, (char*)receive_data, &incoming_frame_id)) >= 0 ){
+    if( (incoming_data_size > 0) && is_obd2_response(incoming_frame_id) ){
+      ecu_channels[incoming_frame_id-CAN_OBD2_RESPONSE_MESSAGE_ID_LOW].handle_frame(incoming_frame_id, incoming_data_size, receive_data);
+    }/*if*/
+  }/*while*/
 
-  if(incoming_data_size > 0){
-    look_for_dtc_response(incoming_frame_id, receive_data, incoming_data_size);
-  }/*if*/
+  for(unsigned int ecu = 0; ecu < OBD2_MAX_ECUS; ecu++){
+    ecu_channels[ecu].poll();
+
+    while( (incoming_data_size = ecu_channels[ecu].receive(receive_data, sizeof(receive_data))) > 0 ){
+      obd2_dtc_scan_response(&scan, CAN_OBD2_RESPONSE_MESSAGE_ID_LOW+ecu, receive_data, incoming_data_size, monotonic_microseconds());
+      obd2_freeze_frame_response(&freeze_frames, CAN_OBD2_RESPONSE_MESSAGE_ID_LOW+ecu, receive_data, incoming_data_size, monotonic_microseconds());
+    }/*while*/
+  }/*for*/
 
 }/*harvest_can_frames*/
 
-void look_for_dtc_response(unsigned int incoming_frame_id, char* data, unsigned int data_size){
-  if(is_obd2_response(incoming_frame_id)){
-    unpack_obd2_response( (obd2_response*) data);
-  }/*if*/
-  else{
+void print_report(const obd2_dtc_report* report){
+  const char* kind_names[OBD2_DTC_KINDS] = {"stored", "pending", "permanent"};
+  char        text[OBD2_DTC_TEXT_SIZE];
+
+  for(unsigned int ecu = 0; ecu < OBD2_MAX_ECUS; ecu++){
+    if(!(report->ecus & (1u << ecu))){
+      continue;
+    }/*if*/
+
+    printf("ECU 0x%x:\n", CAN_OBD2_RESPONSE_MESSAGE_ID_LOW+ecu);
+
+    for(unsigned int kind = 0; kind < OBD2_DTC_KINDS; kind++){
+      if(!(report->answered[kind] & (1u << ecu))){
+        printf("  %s: no answer\n", kind_names[kind]);
+        continue;
+      }/*if*/
+
+      printf("  %s: %u", kind_names[kind], report->reported[ecu][kind]);
+      for(unsigned int i = 0; i < report->counts[ecu][kind]; i++){
+        format_obd2_dtc(report->codes[ecu][kind][i], text);
+        printf(" %s", text);
+      }/*for*/
+      printf("\n");
+    }/*for*/
+  }/*for*/
+}/*print_report*/
+
+void print_freeze_frame(const obd2_freeze_frame* snapshot){
+  char text[OBD2_DTC_TEXT_SIZE];
+
+  if(!snapshot->present){
+    printf("ECU 0x%x keeps no freeze frame %u\n", CAN_OBD2_RESPONSE_MESSAGE_ID_LOW+snapshot->ecu, snapshot->frame);
     return;
-  }/*else*/
-}/*look_for_dtc_response*/
+  }/*if*/
+
+  format_obd2_dtc(snapshot->dtc, text);
+  printf("ECU 0x%x freeze frame %u, stored by %s:\n", CAN_OBD2_RESPONSE_MESSAGE_ID_LOW+snapshot->ecu, snapshot->frame, text);
+
+  for(unsigned int i = 0; i < snapshot->data.count; i++){
+    if(snapshot->data.valid[i]){
+      printf("  %s: %g (raw 0x%x)\n", find_obd2_pid_descriptor(snapshot->data.pid[i])->name, snapshot->data.value[i], snapshot->data.raw[i]);
+    }/*if*/
+  }/*for*/
+}/*print_freeze_frame*/
@@ -0,0 +1,115 @@
+/*
+ * Description: Reads the complete flash of a Trionic 5 through its bootloader and verifies the result.
+ *
+ *              flashdump [-r] <interface|auto> <output> <bootloader|-> <load_address> [start_address end_address]
+ *                Uploads and starts the bootloader, unless it is given as '-' because it is still running
+ *                from an earlier attempt, then reads the flash range (all of a Trionic 5.5 by default)
+ *                into the output file, reporting progress and throughput along the way.
+ *                With -r, a dump which was interrupted is resumed where the output file ends.
+ */
+
+#include "can/bus.hpp"
+#include "can/trionic5/flash_dumper.hpp"
+#include "can/trionic5/firmware_image.hpp"
+#include "adapters/lawicel-canusb.hpp"
+#include "timing/clock.h"
+
+#define FLASH_START_ADDRESS       0x40000
+#define PROGRESS_INTERVAL         1000000ULL
+
+int dump(const char* interface_name, const char* output_path, const char* bootloader_path, const unsigned int load_address, const unsigned int start_address, const unsigned int end_address, const bool resume);
+void print_usage(void);
+
+trionic5net::firmware_info info;
+
+int main(int argc, char** argv){
+  bool resume = (argc > 1) && (strcmp(argv[1], "-r") == 0);
+
+  if(resume){
+    argc -= 1;
+    argv += 1;
+  }/*if*/
+
+  if(argc == 5){
+    return dump(argv[1], argv[2], argv[3], strtoul(argv[4], NULL, 0), FLASH_START_ADDRESS, FLASH_START_ADDRESS+TRIONIC55_FLASH_SIZE, resume) ? 0 : 1;
+  }/*if*/
+
+  if(argc == 7){
+    return dump(argv[1], argv[2], argv[3], strtoul(argv[4], NULL, 0), strtoul(argv[5], NULL, 0), strtoul(argv[6], NULL, 0), resume) ? 0 : 1;
+  }/*if*/
+
+  print_usage();
+  return 1;
+}/*main*/
+
+int dump(const char* interface_name, const char* output_path, const char* bootloader_path, const unsigned int load_address, const unsigned int start_address, const unsigned int end_address, const bool resume){
+  canusb_devices::lawicel_canusb  adapter;
+  can::bus                        canbus;
+
+  if(strcmp(interface_name, "auto") == 0){
+    if(!adapter.auto_setup()){
+      return 0;
+    }/*if*/
+
+    interface_name = adapter.get_interface_name();
+  }/*if*/
+
+  canbus.set_name(IFNAMSIZ, interface_name);
+  canbus.open();
+  canbus.set_receive_frame_filter(TRIONIC5_RESPONSE_FRAME_ID, CAN_SFF_MASK);
+
+  static trionic5net::flash_dumper dumper(&canbus);
+  dumper.set_window(FLASH_DUMPER_MAX_WINDOW);
+
+  if( (strcmp(bootloader_path, "-") != 0) && !dumper.load_bootloader(bootloader_path, load_address) ){
+    return 0;
+  }/*if*/
+
+  if(!dumper.start(output_path, start_address, end_address, resume)){
+    return 0;
+  }/*if*/
+
+  if(resume && (dumper.get_completed_bytes() > 0)){
+    printf("Resuming at 0x%05x.\n", start_address+dumper.get_completed_bytes());
+  }/*if*/
+
+  unsigned long long last_progress = monotonic_microseconds();
+
+  while(!dumper.is_done()){
+    dumper.poll();
+
+    unsigned long long now = monotonic_microseconds();
+
+    if(now-last_progress >= PROGRESS_INTERVAL){
+      printf("%u of %u bytes, %.0f bytes per second.\n", dumper.get_completed_bytes(), dumper.get_total_bytes(), dumper.get_throughput());
+      last_progress = now;
+    }/*if*/
+  }/*while*/
+
+  printf("Read %u of %u bytes, %.0f bytes per second.\n", dumper.get_completed_bytes(), dumper.get_total_bytes(), dumper.get_throughput());
+
+  printf("%llu timeouts, %llu reads sent again, final timeout %llu us.\n",
+         dumper.get_timeouts(),
+         dumper.get_retransmitted_reads(),
+         dumper.get_timeout());
+
+  if(dumper.get_state() != trionic5net::Flash_Dump_Complete){
+    printf("The dump is incomplete, run again with -r to resume.\n");
+    return 0;
+  }/*if*/
+
+  dumper.exit_bootloader();
+
+  if(!trionic5net::analyse_firmware(output_path, &info)){
+    printf("%s is not a Trionic 5 image.\n", output_path);
+    return 0;
+  }/*if*/
+
+  printf("%s, checksum %s.\n", trionic5net::get_variant_name(info.variant), info.checksum_valid ? "valid" : "INVALID");
+
+  return info.checksum_valid;
+}/*dump*/
+
+void print_usage(void){
+  printf("Usage: flashdump [-r] <interface|auto> <output> <bootloader|-> <load_address> [start_address end_address]\n");
+}/*print_usage*/
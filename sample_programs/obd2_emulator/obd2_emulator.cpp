@@ -0,0 +1,195 @@
+#include "can/bus.hpp"
+#include "can/isotp.hpp"
+#include "obd2/obd2can.h"
+#include "obd2/ecu_emulator.h"
+#include "timing/clock.h"
+
+#include <stdio.h>
+#include <time.h>
+
+#define STATISTICS_PERIOD 1000000ULL
+
+can::bus            canbus;
+can::isotp_channel  ecu_channels[OBD2_MAX_ECUS];
+obd2_emulator       emulator;
+
+/* The answer each ECU is sending, until its channel takes it. */
+unsigned char       outgoing_answers[OBD2_MAX_ECUS][OBD2_EMULATOR_MAX_ANSWER_SIZE];
+unsigned int        outgoing_lengths[OBD2_MAX_ECUS];
+
+void initialize(const char* interface_name);
+void set_up_default_car();
+void receive_requests();
+void send_answers();
+void print_statistics(unsigned long long period);
+
+/*
+ * obd2_emulator [interface] [configuration]
+ *   Answers OBD-II requests on the interface (default vcan0) as the ECUs of a car would, so that the
+ *   obd2 and dtc samples can be run without one. The car is read from the configuration file (see
+ *   obd2/ecu_emulator.h), or is an engine and a gearbox ECU with a few trouble codes. Every second, the
+ *   requests, answers and PIDs answered per second are printed, which gives the end-to-end rate of a
+ *   poller running against it.
+ *
+ *   A virtual interface is set up with
+ *     ip link add dev vcan0 type vcan
+ *     ip link set up vcan0
+ */
+int main(int argc, char** argv){
+  const char* interface_name  = (argc > 1) ? argv[1] : "vcan0";
+  const char* configuration   = (argc > 2) ? argv[2] : 0;
+
+  init_obd2_emulator(&emulator);
+
+  if(configuration == 0){
+    set_up_default_car();
+  }/*if*/
+  else if(!load_obd2_emulator_config(configuration, &emulator)){
+    return 1;
+  }/*else if*/
+
+  initialize(interface_name);
+
+  const struct timespec poll_period     = {0, 100000};
+  unsigned long long    statistics_time = monotonic_microseconds();
+
+  do{
+    receive_requests();
+    send_answers();
+
+    unsigned long long now = monotonic_microseconds();
+
+    if(now-statistics_time >= STATISTICS_PERIOD){
+      print_statistics(now-statistics_time);
+      statistics_time = now;
+    }/*if*/
+
+    nanosleep(&poll_period, NULL);
+  }while(1);
+
+  return 0;
+}/*main*/
+
+/*
+ * Each ECU answers on its own ISO-TP channel, which takes unicast requests and flow control on 0x7e0+n.
+ * Broadcast requests always fit a single frame, so they are read straight off the bus.
+ */
+void initialize(const char* interface_name){
+  canbus.set_name(IFNAMSIZ, interface_name);
+
+  if(canbus.open() != 1){
+    printf("Could not open %s\n", interface_name);
+    exit(1);
+  }/*if*/
+
+  for(unsigned int ecu = 0; ecu < OBD2_MAX_ECUS; ecu++){
+    if(emulator.ecus & (1u << ecu)){
+      if(!ecu_channels[ecu].open(interface_name, CAN_OBD2_RESPONSE_MESSAGE_ID_LOW+ecu, CAN_OBD2_QUERY_MESSAGE_ID_LOW+ecu, &canbus)){
+        printf("Could not open the ISO-TP channel of ECU 0x%x\n", CAN_OBD2_RESPONSE_MESSAGE_ID_LOW+ecu);
+        exit(1);
+      }/*if*/
+
+      printf("ECU 0x%x answers after %u us\n", CAN_OBD2_RESPONSE_MESSAGE_ID_LOW+ecu, emulator.ecu[ecu].latency);
+    }/*if*/
+  }/*for*/
+}/*initialize*/
+
+void set_up_default_car(){
+  const unsigned char engine_pids[] = {
+    MONITOR_STATUS, FREEZE_DTC, ENGINE_LOAD, ENGINE_COOLANT_TEMP, INTAKE_MANIFOLD_PRESSURE, ENGINE_RPM, VEHICLE_SPEED,
+    TIMING_ADVANCE, INTAKE_AIR_TEMPERATURE, MAF_AIR_FLOW_RATE, THROTTLE_POSITION, RUNTIME_SINCE_ENGINE_START,
+    FUEL_LEVEL_INPUT, BAROMETRIC_PRESSURE, CONTROL_MODULE_VOLTAGE, AMBIENT_AIR_TEMPERATURE, ENGINE_OIL_TEMPERATURE
+  };
+  const unsigned char gearbox_pids[] = {MONITOR_STATUS, VEHICLE_SPEED, CONTROL_MODULE_VOLTAGE};
+
+  obd2_emulator_add_ecu(&emulator, 0, 2000);
+  obd2_emulator_add_ecu(&emulator, 1, 8000);
+
+  for(unsigned int i = 0; i < sizeof(engine_pids); i++){
+    obd2_emulator_support_pid(&emulator, 0, engine_pids[i]);
+  }/*for*/
+
+  for(unsigned int i = 0; i < sizeof(gearbox_pids); i++){
+    obd2_emulator_support_pid(&emulator, 1, gearbox_pids[i]);
+  }/*for*/
+
+  /* Three codes take two frames. */
+  obd2_emulator_add_dtc(&emulator, 0, Obd2_Dtc_Stored, 0x0301);
+  obd2_emulator_add_dtc(&emulator, 0, Obd2_Dtc_Stored, 0x0420);
+  obd2_emulator_add_dtc(&emulator, 0, Obd2_Dtc_Stored, 0x0171);
+  obd2_emulator_add_dtc(&emulator, 0, Obd2_Dtc_Permanent, 0x0420);
+  obd2_emulator_add_dtc(&emulator, 1, Obd2_Dtc_Pending, 0x0700);
+
+  obd2_emulator_set_vin(&emulator, 0, "WVWZZZ1JZXW000001");
+  obd2_emulator_add_calibration(&emulator, 0, "1037353467", 0x4b2a96c1);
+  obd2_emulator_add_calibration(&emulator, 1, "0AM927769D", 0x1f03ac22);
+}/*set_up_default_car*/
+
+void receive_requests(){
+  unsigned int  incoming_frame_id;
+  int           incoming_data_size;
+  unsigned char receive_data[ISOTP_MAX_PAYLOAD];
+
+  while( (incoming_data_size = canbus.receive(8, (char*)receive_data, &incoming_frame_id)) >= 0 ){
+    unsigned int length = receive_data[0] & 0xF;
+
+    if(incoming_frame_id == CAN_OBD2_QUERY_MESSAGE_ID_BROADCAST){
+      if( ((receive_data[0] >> 4) == 0) && (length > 0) && ((int)length < incoming_data_size) ){
+        obd2_emulator_request(&emulator, incoming_frame_id, receive_data+1, length, monotonic_microseconds());
+      }/*if*/
+    }/*if*/
+    else if( (incoming_frame_id >= CAN_OBD2_QUERY_MESSAGE_ID_LOW) && (incoming_frame_id <= CAN_OBD2_QUERY_MESSAGE_ID_HIGH) ){
+      ecu_channels[incoming_frame_id-CAN_OBD2_QUERY_MESSAGE_ID_LOW].handle_frame(incoming_frame_id, incoming_data_size, receive_data);
+    }/*else if*/
+  }/*while*/
+
+  for(unsigned int ecu = 0; ecu < OBD2_MAX_ECUS; ecu++){
+    ecu_channels[ecu].poll();
+
+    while( (incoming_data_size = ecu_channels[ecu].receive(receive_data, sizeof(receive_data))) > 0 ){
+      obd2_emulator_request(&emulator, CAN_OBD2_QUERY_MESSAGE_ID_LOW+ecu, receive_data, incoming_data_size, monotonic_microseconds());
+    }/*while*/
+  }/*for*/
+}/*receive_requests*/
+
+/* A channel takes no answer while it is sending the last one, which is then tried again on the next round. */
+void send_answers(){
+  unsigned long long now = monotonic_microseconds();
+
+  for(unsigned int ecu = 0; ecu < OBD2_MAX_ECUS; ecu++){
+    if(outgoing_lengths[ecu] == 0){
+      obd2_emulator_next_answer(&emulator, ecu, now, outgoing_answers[ecu], &outgoing_lengths[ecu]);
+    }/*if*/
+
+    if( (outgoing_lengths[ecu] > 0) && ecu_channels[ecu].send(outgoing_answers[ecu], outgoing_lengths[ecu]) ){
+      outgoing_lengths[ecu] = 0;
+    }/*if*/
+  }/*for*/
+}/*send_answers*/
+
+void print_statistics(unsigned long long period){
+  static obd2_emulated_ecu  previous[OBD2_MAX_ECUS];
+  static unsigned long long previous_dropped;
+
+  double seconds = period/1000000.0;
+
+  for(unsigned int ecu = 0; ecu < OBD2_MAX_ECUS; ecu++){
+    const obd2_emulated_ecu* emulated = &emulator.ecu[ecu];
+
+    if( (emulated->requests == previous[ecu].requests) && (emulated->answers == previous[ecu].answers) ){
+      continue;
+    }/*if*/
+
+    printf("ECU 0x%x: %.0f requests/s, %.0f answers/s, %.0f PIDs/s\n", CAN_OBD2_RESPONSE_MESSAGE_ID_LOW+ecu,
+           (emulated->requests-previous[ecu].requests)/seconds,
+           (emulated->answers-previous[ecu].answers)/seconds,
+           (emulated->answered_pids-previous[ecu].answered_pids)/seconds);
+
+    previous[ecu] = *emulated;
+  }/*for*/
+
+  if(emulator.dropped != previous_dropped){
+    printf("%llu requests dropped, the answer queue is full\n", emulator.dropped-previous_dropped);
+    previous_dropped = emulator.dropped;
+  }/*if*/
+}/*print_statistics*/
@@ -1,96 +1,319 @@
 #include "can/bus.hpp"
-#include "can/trionic5/messages.hpp"
+#include "can/isotp.hpp"
 #include "adapters/lawicel-canusb.hpp"
 #include "obd2/obd2pids.h"
 #include "obd2/obd2modes.h"
 #include "obd2/obd2can.h"
 #include "obd2/unpack.h"
+#include "obd2/report.h"
+#include "obd2/request_scheduler.h"
+#include "obd2/pid_discovery.h"
+#include "obd2/multi_pid.h"
+#include "obd2/vehicle_info.h"
+#include "timing/clock.h"
 
 #include <time.h>
 
-can::bus canbus;
+#define STATISTICS_PERIOD 1000000ULL
 
-void initialize();
+can::bus            canbus;
+can::isotp_channel  ecu_channels[OBD2_MAX_ECUS];
+obd2_scheduler      scheduler;
+obd2_pid_discovery  discovery;
+obd2_supported_pids supported_pids;
+obd2_vehicle_info   vehicle_info;
 
-void receive_data();
+obd2_vehicle_info_reader  vehicle_info_reader;
+obd2_unpacked_response    unpacked;
+bool                      print_answers;
+unsigned long long        decoded_answers;
+
+/* Every request in an ECU's window may be answered before its channel is read again. */
+static_assert(ISOTP_MESSAGE_QUEUE_SIZE >= OBD2_MAX_ECU_WINDOW, "the ECU channels must hold an answer to every request in the window");
+
+/* A dashboard's worth of PIDs and how often to poll them, in microseconds. */
+const struct{
+  unsigned char       pid;
+  unsigned long long  period;
+}dashboard_pids[] = {
+  {ENGINE_RPM,                        50000},
+  {VEHICLE_SPEED,                     100000},
+  {THROTTLE_POSITION,                 50000},
+  {INTAKE_MANIFOLD_PRESSURE,          50000},
+  {ENGINE_LOAD,                       100000},
+  {TIMING_ADVANCE,                    100000},
+  {MAF_AIR_FLOW_RATE,                 100000},
+  {SHORT_TERM_FUEL_PERC_TRIM_BANK_1,  250000},
+  {SHORT_TERM_FUEL_PERC_TRIM_BANK_11, 250000},
+  {INTAKE_AIR_TEMPERATURE,            1000000},
+  {ENGINE_COOLANT_TEMP,               1000000},
+  {CONTROL_MODULE_VOLTAGE,            1000000}
+};
+
+typedef void (*payload_handler)(unsigned int response_id, const unsigned char* payload, unsigned int length);
+
+void initialize(const char* interface_name);
+void open_ecu_channels(const char* interface_name);
+void read_vehicle_info(const char* cache_directory);
+void discover_pids();
+
+void receive_data(payload_handler handle_payload);
 void send_data();
-void unpack_data(unsigned int message_id, char* data, unsigned int data_size);
+void unpack_data(unsigned int message_id, const unsigned char* payload, unsigned int length);
+void print_statistics(unsigned long long period);
+
+/*
+ * obd2 [-p] [cache_directory] [interface]
+ *   Identifies the car by its VIN and polls a dashboard of PIDs, each at its own rate from the
+ *   ECU serving it, skipping those which no ECU supports. The calibration of the car and its
+ *   supported PIDs are stored in the cache directory (default .) under the VIN, and read from
+ *   there on the next connection instead of asking the ECUs again.
+ *   Given an interface, e.g. vcan0 with obd2_emulator running on it, no adapter is looked for.
+ *   Every answer is decoded, but only printed with -p; otherwise the answers decoded per second
+ *   are printed every second.
+ */
+int main(int argc, char** argv){
+  print_answers = (argc > 1) && (strcmp(argv[1], "-p") == 0);
+
+  if(print_answers){
+    argc -= 1;
+    argv += 1;
+  }/*if*/
+
+  const char* cache_directory = (argc > 1) ? argv[1] : ".";
+  const char* interface_name  = (argc > 2) ? argv[2] : 0;
 
-int main(){
-  initialize();
+  canusb_devices::lawicel_canusb adapter;
+
+  if(interface_name == 0){
+    adapter.auto_setup();
+    interface_name = adapter.get_interface_name();
+  }/*if*/
+
+  initialize(interface_name);
+  open_ecu_channels(interface_name);
+
+  read_vehicle_info(cache_directory);
+
+  const char* vin = (vehicle_info.vin[0] != '\0') ? vehicle_info.vin : 0;
+
+  if( (vin == 0) || !load_obd2_supported_pids(cache_directory, vin, &supported_pids) ){
+    discover_pids();
+
+    if(vin != 0){
+      save_obd2_supported_pids(cache_directory, vin, &supported_pids);
+    }/*if*/
+  }/*if*/
+
+  init_obd2_scheduler(&scheduler, &supported_pids, OBD2_DEFAULT_RETRIES);
+
+  /* Responses are reassembled, so a request may ask for as many PIDs as there is room for. */
+  obd2_scheduler_set_limits(&scheduler, OBD2_MAX_ECU_WINDOW, OBD2_MAX_RESPONSE_PAYLOAD);
+
+  for(unsigned int i = 0; i < sizeof(dashboard_pids)/sizeof(dashboard_pids[0]); i++){
+    obd2_scheduler_add(&scheduler, dashboard_pids[i].pid, dashboard_pids[i].period);
+  }/*for*/
+
+  unsigned long long statistics_time = monotonic_microseconds();
 
   do{
-    receive_data();
+    receive_data(unpack_data);
     send_data();
+
+    unsigned long long now = monotonic_microseconds();
+
+    if(now-statistics_time >= STATISTICS_PERIOD){
+      print_statistics(now-statistics_time);
+      statistics_time = now;
+    }/*if*/
   }while(1);
 
   return 0;
 }/*main*/
 
-void initialize(){
-  canusb_devices::lawicel_canusb adapter;
-  adapter.auto_setup();
-  canbus.set_name(IFNAMSIZ, adapter.get_interface_name());
+void initialize(const char* interface_name){
+  canbus.set_name(IFNAMSIZ, interface_name);
 	canbus.open();
 }/*initialize*/
 
-void receive_data(){
-  unsigned int incoming_frame_id;
-  unsigned int incoming_data_size;
-  char receive_data[20];
+/*
+ * Each ECU answers on its own ISO-TP channel, which takes flow control on its unicast request ID.
+ * No block size and no separation time are asked for, so long answers arrive at full speed.
+ */
+void open_ecu_channels(const char* interface_name){
+  for(unsigned int ecu = 0; ecu < OBD2_MAX_ECUS; ecu++){
+    ecu_channels[ecu].set_flow_control(0, 0);
+    ecu_channels[ecu].open(interface_name, CAN_OBD2_QUERY_MESSAGE_ID_LOW+ecu, CAN_OBD2_RESPONSE_MESSAGE_ID_LOW+ecu, &canbus);
+  }/*for*/
 
-  const unsigned int receive_tries = 200;
+  printf("ISO-TP is handled %s\n", (ecu_channels[0].get_mode() == can::Isotp_Kernel) ? "by the kernel" : "in userspace");
+}/*open_ecu_channels*/
 
-  for(unsigned int i = 0; i < receive_tries; i++){
-    memset(receive_data, 0x0, 20);
-    incoming_data_size = canbus.receive(19, receive_data, &incoming_frame_id);
-    unpack_data(incoming_frame_id, receive_data, incoming_data_size);
-  }/*for*/
+/* Turns the single frame part of a payload back into the response it came in. */
+static void payload_to_response(const unsigned char* payload, unsigned int length, obd2_response* response){
+  unsigned int copied_bytes = (length < sizeof(obd2_response)-1) ? length : sizeof(obd2_response)-1;
 
-}/*receive_data*/
+  memset(response, 0x0, sizeof(obd2_response));
+  response->num_extra_bytes = copied_bytes;
+  memcpy(&response->mode, payload, copied_bytes);
+}/*payload_to_response*/
 
-void send_data(){
-  /* Set a message transmission rate of approximately 30Hz */
-  const struct timespec transmission_period = {0, 33333333};
+void vehicle_info_payload(unsigned int response_id, const unsigned char* payload, unsigned int length){
+  obd2_vehicle_info_response(&vehicle_info_reader, response_id, payload, length, monotonic_microseconds());
+}/*vehicle_info_payload*/
+
+static void run_vehicle_info_reader(){
+  do{
+    unsigned int  request_id;
+    unsigned char pid;
+
+    while(obd2_vehicle_info_next_request(&vehicle_info_reader, monotonic_microseconds(), &request_id, &pid)){
+      struct can_frame obd2_frame;
+      obd2_frame.can_id   = request_id;
+      obd2_frame.can_dlc  = 8;
 
-  struct timespec current_time;
-  clock_gettime(CLOCK_REALTIME, &current_time);
+      obd2_request_current_data request;
+      request.mode  = REQUEST_VEHICLE_INFORMATION;
+      request.pid   = pid;
 
-  static struct timespec transmission_time = {0,0};
+      memcpy(obd2_frame.data, &request, obd2_frame.can_dlc);
+      canbus.send(&obd2_frame);
+    }/*while*/
 
-  bool transmit = false;
+    receive_data(vehicle_info_payload);
+  }while(!obd2_vehicle_info_is_complete(&vehicle_info_reader));
+}/*run_vehicle_info_reader*/
 
-  /* This should also check tv_sec... */
-  if(current_time.tv_nsec - transmission_time.tv_nsec >= transmission_period.tv_nsec){
-    transmit = true;
+/*
+ * Only the VIN is asked for on every connection. The calibration IDs and CVNs take a multi-frame
+ * exchange with every ECU, which is skipped for cars seen before.
+ */
+void read_vehicle_info(const char* cache_directory){
+  init_obd2_vehicle_info_reader(&vehicle_info_reader, OBD2_DEFAULT_RETRIES);
+  run_vehicle_info_reader();
+
+  if(vehicle_info_reader.info.vin[0] == '\0'){
+    printf("No ECU told the VIN\n");
+    return;
   }/*if*/
 
-  if(transmit){
-    struct can_frame obd2_frame;
-    obd2_frame.can_id = CAN_OBD2_QUERY_MESSAGE_ID_BROADCAST;
-    obd2_frame.can_dlc = 8;
+  if(!load_obd2_vehicle_info(cache_directory, vehicle_info_reader.info.vin, &vehicle_info)){
+    obd2_vehicle_info_read_calibration(&vehicle_info_reader, 0);
+    run_vehicle_info_reader();
 
-    obd2_request_current_data	engine_coolant_temp_request;
-    obd2_request_current_data	rpm_request;
+    vehicle_info = vehicle_info_reader.info;
+    save_obd2_vehicle_info(cache_directory, &vehicle_info);
+  }/*if*/
 
-    engine_coolant_temp_request.pid	= ENGINE_COOLANT_TEMP;
-    rpm_request.pid = ENGINE_RPM;
+  printf("VIN %s\n", vehicle_info.vin);
 
-    memcpy(obd2_frame.data, &rpm_request, obd2_frame.can_dlc);
-    canbus.send(&obd2_frame);
+  for(unsigned int ecu = 0; ecu < OBD2_MAX_ECUS; ecu++){
+    for(unsigned int i = 0; i < vehicle_info.number_of_calibration_ids[ecu]; i++){
+      printf("ECU 0x%x calibration %s", CAN_OBD2_RESPONSE_MESSAGE_ID_LOW+ecu, vehicle_info.calibration_ids[ecu][i]);
+
+      if(i < vehicle_info.number_of_cvns[ecu]){
+        printf(", CVN %08X", vehicle_info.cvns[ecu][i]);
+      }/*if*/
+      printf("\n");
+    }/*for*/
+  }/*for*/
+}/*read_vehicle_info*/
+
+void discovery_payload(unsigned int response_id, const unsigned char* payload, unsigned int length){
+  obd2_response response;
+
+  payload_to_response(payload, length, &response);
+  obd2_pid_discovery_response(&discovery, response_id, &response, monotonic_microseconds());
+}/*discovery_payload*/
+
+void discover_pids(){
+  init_obd2_pid_discovery(&discovery, OBD2_DEFAULT_RETRIES);
+
+  do{
+    unsigned long long  now = monotonic_microseconds();
+    unsigned int        request_id;
+    unsigned char       pid;
+
+    while(obd2_pid_discovery_next_request(&discovery, now, &request_id, &pid)){
+      struct can_frame obd2_frame;
+      obd2_frame.can_id   = request_id;
+      obd2_frame.can_dlc  = 8;
+
+      obd2_request_current_data request;
+      request.pid = pid;
+
+      memcpy(obd2_frame.data, &request, obd2_frame.can_dlc);
+      canbus.send(&obd2_frame);
+    }/*while*/
+
+    receive_data(discovery_payload);
+  }while(!obd2_pid_discovery_is_complete(&discovery));
+
+  supported_pids = discovery.supported;
+  printf("Discovered the PIDs of %u ECUs\n", __builtin_popcount(supported_pids.ecus));
+}/*discover_pids*/
+
+void receive_data(payload_handler handle_payload){
+  unsigned int  incoming_frame_id;
+  int           incoming_data_size;
+  unsigned char receive_data[OBD2_MAX_RESPONSE_PAYLOAD];
+
+  /* Responses go through the ECU channels, which reassemble those spanning several frames. */
+  while( (incoming_data_size = canbus.receive(8, (char*)receive_data, &incoming_frame_id)) >= 0 ){
+    if(is_obd2_response(incoming_frame_id)){
+      ecu_channels[incoming_frame_id-CAN_OBD2_RESPONSE_MESSAGE_ID_LOW].handle_frame(incoming_frame_id, incoming_data_size, receive_data);
+    }/*if*/
+  }/*while*/
 
-    memcpy(obd2_frame.data, &engine_coolant_temp_request, obd2_frame.can_dlc);
+  for(unsigned int ecu = 0; ecu < OBD2_MAX_ECUS; ecu++){
+    ecu_channels[ecu].poll();
+
+    while( (incoming_data_size = ecu_channels[ecu].receive(receive_data, sizeof(receive_data))) > 0 ){
+      handle_payload(CAN_OBD2_RESPONSE_MESSAGE_ID_LOW+ecu, receive_data, incoming_data_size);
+    }/*while*/
+  }/*for*/
+
+}/*receive_data*/
+
+void send_data(){
+  unsigned int                request_id;
+  obd2_request_multiple_pids  request;
+
+  while(obd2_scheduler_next_request(&scheduler, monotonic_microseconds(), &request_id, &request)){
+    struct can_frame obd2_frame;
+    obd2_frame.can_id = request_id;
+    obd2_frame.can_dlc = 8;
+
+    memcpy(obd2_frame.data, &request, obd2_frame.can_dlc);
     canbus.send(&obd2_frame);
+  }/*while*/
+}/*send_data*/
 
-    transmission_time.tv_sec  = current_time.tv_sec;
-    transmission_time.tv_nsec = current_time.tv_nsec;
+void unpack_data(unsigned int message_id, const unsigned char* payload, unsigned int length){
+  if(payload[0] != SHOW_CURRENT_DATA+MODE_RESPONSE_DELTA){
+    unpack_obd2_payload(payload, length, &unpacked);
   }/*if*/
+  else{
+    /* One response may answer several PIDs. */
+    obd2_response responses[OBD2_MAX_PIDS_PER_REQUEST];
+    unsigned int  number_of_responses = obd2_scheduler_response(&scheduler, message_id, payload, length, monotonic_microseconds(), responses, OBD2_MAX_PIDS_PER_REQUEST);
 
-}/*send_data*/
+    unpack_obd2_current_data(responses, number_of_responses, &unpacked);
+  }/*else*/
+
+  decoded_answers += 1;
 
-void unpack_data(unsigned int message_id, char* data, unsigned int data_size){
-	if(is_obd2_response(message_id)){
-		unpack_obd2_response( (obd2_response*) data);
-	}/*if*/
+  if(print_answers){
+    print_obd2_unpacked_response(message_id, &unpacked);
+  }/*if*/
 }/*unpack_data*/
 
+void print_statistics(unsigned long long period){
+  static unsigned long long previous_answers;
+
+  if(!print_answers){
+    printf("%.0f answers/s decoded\n", (decoded_answers-previous_answers)/(period/1000000.0));
+  }/*if*/
+
+  previous_answers = decoded_answers;
+}/*print_statistics*/
@@ -0,0 +1,183 @@
+/*
+ * Description: Takes whole-RAM snapshots of a running Trionic 5 and shows what changed between two of them.
+ *
+ *              sramdump <interface|auto> <snapshot> [start_address end_address]
+ *                Sweeps the SRAM range (all of SRAM by default) with pipelined maximum-size reads,
+ *                reports the achieved throughput and saves the result as a snapshot.
+ *
+ *              sramdump -d <before> <after> [trionic5_binary]
+ *                Lists every address range which differs between two snapshots. If the firmware
+ *                is given, the symbols covering each range are named as well.
+ */
+
+#include "can/bus.hpp"
+#include "can/trionic5/sram_reader.hpp"
+#include "can/trionic5/sram_snapshot.hpp"
+#include "can/trionic5/symbol_table.hpp"
+#include "adapters/lawicel-canusb.hpp"
+#include "timing/clock.h"
+
+#include <time.h>
+
+#define MAX_LISTED_CHANGES  4096
+
+int dump(const char* interface_name, const char* snapshot_path, const unsigned int start_address, const unsigned int end_address);
+int diff(const char* before_path, const char* after_path, const char* binary_path);
+void read_done(void* context, const unsigned int start_address, const unsigned int end_address, const bool success);
+void print_usage(void);
+
+trionic5net::sram_mirror    mirror;
+trionic5net::sram_snapshot  before;
+trionic5net::sram_snapshot  after;
+trionic5net::symbol_table   table;
+trionic5net::sram_change    changes[MAX_LISTED_CHANGES];
+
+int main(int argc, char** argv){
+  if( (argc >= 4) && (argc <= 5) && (strcmp(argv[1], "-d") == 0) ){
+    return diff(argv[2], argv[3], argc == 5 ? argv[4] : NULL) ? 0 : 1;
+  }/*if*/
+
+  if(argc == 3){
+    return dump(argv[1], argv[2], 0x0, SRAM_ADDRESS_SPACE_SIZE) ? 0 : 1;
+  }/*if*/
+
+  if(argc == 5){
+    unsigned long start_address = strtoul(argv[3], NULL, 0);
+    unsigned long end_address   = strtoul(argv[4], NULL, 0);
+
+    if( (start_address >= end_address) || (end_address > SRAM_ADDRESS_SPACE_SIZE) ){
+      printf("The range must satisfy start < end <= 0x%x.\n", SRAM_ADDRESS_SPACE_SIZE);
+      return 1;
+    }/*if*/
+
+    return dump(argv[1], argv[2], start_address, end_address) ? 0 : 1;
+  }/*if*/
+
+  print_usage();
+  return 1;
+}/*main*/
+
+int dump(const char* interface_name, const char* snapshot_path, const unsigned int start_address, const unsigned int end_address){
+  canusb_devices::lawicel_canusb  adapter;
+  can::bus                        canbus;
+
+  if(strcmp(interface_name, "auto") == 0){
+    if(!adapter.auto_setup()){
+      return 0;
+    }/*if*/
+
+    interface_name = adapter.get_interface_name();
+  }/*if*/
+
+  canbus.set_name(IFNAMSIZ, interface_name);
+
+  if(canbus.open() != 1){
+    printf("Could not open %s\n", interface_name);
+    return 0;
+  }/*if*/
+
+  canbus.set_receive_frame_filter(TRIONIC5_RESPONSE_FRAME_ID, CAN_SFF_MASK);
+
+  trionic5net::sram_reader reader(&canbus, &mirror);
+  reader.set_window(SRAM_READER_MAX_WINDOW);
+
+  unsigned int failed_reads = 0;
+
+  /* Sleep only while the bus is quiet, so that a busy sweep is not slowed down. */
+  struct timespec sleep_time;
+  sleep_time.tv_sec   = 0;
+  sleep_time.tv_nsec  = 100000;
+
+  /* Queue as much of the sweep as fits, topping up the queue as reads complete. */
+  unsigned int next_address = start_address;
+  unsigned long long start_time = monotonic_microseconds();
+
+  while( (next_address < end_address) || !reader.is_idle() ){
+    while( (next_address < end_address) && (reader.get_queued_reads() < SRAM_READER_QUEUE_SIZE) ){
+      unsigned int read_end = (end_address-next_address > SRAM_MAX_READ_SIZE) ? next_address+SRAM_MAX_READ_SIZE : end_address;
+
+      if(!reader.queue_read(next_address, read_end, read_done, &failed_reads)){
+        break;
+      }/*if*/
+
+      next_address = read_end;
+    }/*while*/
+
+    if(reader.poll() == 0){
+      nanosleep(&sleep_time, NULL);
+    }/*if*/
+  }/*while*/
+
+  unsigned long long elapsed_time = monotonic_microseconds()-start_time;
+
+  printf("Read %llu bytes in %llu ms, %.0f bytes per second.\n",
+         reader.get_received_bytes(),
+         elapsed_time/1000,
+         elapsed_time ? reader.get_received_bytes()*1000000.0/elapsed_time : 0.0);
+
+  printf("%llu timeouts, %llu reads sent again, final timeout %llu us.\n",
+         reader.get_timeouts(),
+         reader.get_retransmitted_reads(),
+         reader.get_timeout());
+
+  /* The unread ranges would show up as changes in every diff against this snapshot. */
+  if(failed_reads > 0){
+    printf("%u reads failed, the snapshot is not saved.\n", failed_reads);
+    return 0;
+  }/*if*/
+
+  if(!trionic5net::take_snapshot(&after, mirror.get_data(), start_address, end_address, start_time)){
+    return 0;
+  }/*if*/
+
+  return trionic5net::save_snapshot(snapshot_path, &after);
+}/*dump*/
+
+void read_done(void* context, const unsigned int start_address, const unsigned int end_address, const bool success){
+  if(!success){
+    *(unsigned int*)context += 1;
+    printf("Failed to read 0x%04x-0x%04x\n", start_address, end_address);
+  }/*if*/
+}/*read_done*/
+
+int diff(const char* before_path, const char* after_path, const char* binary_path){
+  if( !trionic5net::load_snapshot(before_path, &before) || !trionic5net::load_snapshot(after_path, &after) ){
+    return 0;
+  }/*if*/
+
+  if( (binary_path != NULL) && !table.load(binary_path) ){
+    return 0;
+  }/*if*/
+
+  unsigned int number_of_changes = trionic5net::diff_snapshots(&before, &after, changes, MAX_LISTED_CHANGES, 0);
+  unsigned int listed_changes    = number_of_changes < MAX_LISTED_CHANGES ? number_of_changes : MAX_LISTED_CHANGES;
+
+  for(unsigned int i = 0; i < listed_changes; i++){
+    printf("0x%04x-0x%04x", changes[i].start_address, changes[i].end_address);
+
+    /* Name every symbol overlapping the changed range. */
+    const trionic5net::symbol* previous = NULL;
+
+    for(unsigned int address = changes[i].start_address; (binary_path != NULL) && (address < changes[i].end_address); address++){
+      const trionic5net::symbol* sym = table.find_by_address(address);
+
+      if( (sym != NULL) && (sym != previous) ){
+        printf(" %.*s", sym->name_length, sym->name);
+        previous = sym;
+      }/*if*/
+    }/*for*/
+
+    printf("\n");
+  }/*for*/
+
+  if(number_of_changes > listed_changes){
+    printf("... and %u more changed ranges.\n", number_of_changes-listed_changes);
+  }/*if*/
+
+  return 1;
+}/*diff*/
+
+void print_usage(void){
+  printf("Usage: sramdump <interface|auto> <snapshot> [start_address end_address]\n");
+  printf("       sramdump -d <before> <after> [trionic5_binary]\n");
+}/*print_usage*/
@@ -0,0 +1,217 @@
+/*
+ * Explanation:
+ * Before a firmware image is flashed, or its symbol table trusted, it should be known to be
+ * intact and of the expected variant. This tool identifies Trionic 5 images from their footer
+ * and verifies their checksums. See can/trionic5/firmware_image.hpp.
+ *
+ * In batch mode, every image in a directory is verified, spread out over all available
+ * processors, with one line per image.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <limits.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "can/trionic5/firmware_image.hpp"
+#include "timing/clock.h"
+
+struct firmware_job{
+	char												path[PATH_MAX];
+	int													success;
+	trionic5net::firmware_info	info;
+};
+
+struct batch_context{
+	firmware_job*		jobs;
+	unsigned int		number_of_jobs;
+	unsigned int		next_job;
+	pthread_mutex_t	next_job_lock;
+};
+
+int check_image(const char* binary_path);
+int check_directory(const char* directory_path);
+void* check_worker(void* context);
+int compare_jobs(const void* a, const void* b);
+void print_field(const trionic5net::firmware_info* info, const unsigned char id, const char* description);
+void print_usage(void);
+
+int main(int argc, char** argv){
+	if( (argc == 3) && (strcmp(argv[1], "-d") == 0) ){
+		return check_directory(argv[2]) ? 0 : 1;
+	}
+
+	if(argc != 2){
+		print_usage();
+		return 1;
+	}
+
+	return check_image(argv[1]) ? 0 : 1;
+}
+
+int check_image(const char* binary_path){
+	static trionic5net::firmware_info info;
+
+	if(trionic5net::analyse_firmware(binary_path, &info) == 0){
+		printf("%s is not a Trionic 5 image.\n", binary_path);
+		return 0;
+	}
+
+	printf("Variant:          %s\n", trionic5net::get_variant_name(info.variant));
+	printf("ROM:              0x%05x-0x%05x\n", info.rom_start, info.rom_end);
+	print_field(&info, trionic5net::Footer_Partnumber, "Part number:");
+	print_field(&info, trionic5net::Footer_Software_Id, "Software id:");
+	print_field(&info, trionic5net::Footer_Software_Version, "Software version:");
+	print_field(&info, trionic5net::Footer_Engine_Type, "Engine type:");
+	print_field(&info, trionic5net::Footer_Immobilizer_Code, "Immobilizer code:");
+	printf("Checksum:         0x%08x over 0x%05x-0x%05x, calculated 0x%08x, %s\n", info.stored_checksum, info.rom_start, info.checksum_end, info.calculated_checksum, info.checksum_valid ? "valid" : "INVALID");
+
+	return info.checksum_valid;
+}
+
+int check_directory(const char* directory_path){
+	DIR* directory = opendir(directory_path);
+	if(directory == NULL){
+		perror(directory_path);
+		return 0;
+	}
+
+	batch_context context;
+	memset(&context, 0, sizeof(context));
+	pthread_mutex_init(&context.next_job_lock, NULL);
+
+	unsigned int job_capacity = 0;
+	struct dirent* entry;
+
+	while( (entry = readdir(directory)) != NULL ){
+		char path[PATH_MAX];
+		snprintf(path, PATH_MAX, "%s/%s", directory_path, entry->d_name);
+
+		struct stat path_status;
+		if( (stat(path, &path_status) != 0) || !S_ISREG(path_status.st_mode) ){
+			continue;
+		}
+
+		if(context.number_of_jobs == job_capacity){
+			unsigned int	new_capacity	= job_capacity ? job_capacity*2 : 64;
+			firmware_job*	new_jobs			= (firmware_job*)realloc(context.jobs, new_capacity*sizeof(firmware_job));
+
+			if(new_jobs == NULL){
+				perror("Could not list the images");
+				closedir(directory);
+				free(context.jobs);
+				pthread_mutex_destroy(&context.next_job_lock);
+				return 0;
+			}
+
+			context.jobs	= new_jobs;
+			job_capacity	= new_capacity;
+		}
+
+		firmware_job* job = &context.jobs[context.number_of_jobs];
+		memset(job, 0, sizeof(firmware_job));
+		memcpy(job->path, path, PATH_MAX);
+		context.number_of_jobs += 1;
+	}
+
+	closedir(directory);
+
+	qsort(context.jobs, context.number_of_jobs, sizeof(firmware_job), compare_jobs);
+
+	long processors = sysconf(_SC_NPROCESSORS_ONLN);
+	unsigned int workers = (processors > 0) ? processors : 1;
+	if(workers > context.number_of_jobs){
+		workers = context.number_of_jobs;
+	}
+
+	unsigned long long start_time = monotonic_microseconds();
+
+	pthread_t* threads = (pthread_t*)malloc(workers*sizeof(pthread_t));
+	unsigned int started_workers = 0;
+
+	for(unsigned int i = 0; i < workers; i++){
+		if(pthread_create(&threads[started_workers], NULL, check_worker, &context) == 0){
+			started_workers += 1;
+		}
+	}
+
+	/* If no thread could be started, do the work ourselves. */
+	if( (started_workers == 0) && (context.number_of_jobs > 0) ){
+		check_worker(&context);
+	}
+
+	for(unsigned int i = 0; i < started_workers; i++){
+		pthread_join(threads[i], NULL);
+	}
+
+	unsigned long long run_time = monotonic_microseconds()-start_time;
+
+	unsigned int valid_images = 0;
+
+	for(unsigned int i = 0; i < context.number_of_jobs; i++){
+		firmware_job* job = &context.jobs[i];
+
+		if(!job->success){
+			printf("%-40s not a Trionic 5 image\n", job->path);
+			continue;
+		}
+
+		const trionic5net::firmware_footer_field* version = trionic5net::find_footer_field(&job->info, trionic5net::Footer_Software_Version);
+
+		printf("%-40s %-12s %-16s %s\n", job->path, trionic5net::get_variant_name(job->info.variant), version ? version->value : "", job->info.checksum_valid ? "valid" : "INVALID");
+
+		if(job->info.checksum_valid){
+			valid_images += 1;
+		}
+	}
+
+	printf("%u of %u images valid, verified in %llu.%03llu ms.\n", valid_images, context.number_of_jobs, run_time/1000, run_time%1000);
+
+	free(threads);
+	free(context.jobs);
+	pthread_mutex_destroy(&context.next_job_lock);
+
+	return valid_images == context.number_of_jobs;
+}
+
+void* check_worker(void* given_context){
+	batch_context* context = (batch_context*)given_context;
+
+	do{
+		pthread_mutex_lock(&context->next_job_lock);
+		unsigned int job_index = context->next_job;
+		context->next_job += 1;
+		pthread_mutex_unlock(&context->next_job_lock);
+
+		if(job_index >= context->number_of_jobs){
+			break;
+		}
+
+		firmware_job* job = &context->jobs[job_index];
+		job->success = trionic5net::analyse_firmware(job->path, &job->info);
+	}while(1);
+
+	return NULL;
+}
+
+int compare_jobs(const void* a, const void* b){
+	return strcmp(((const firmware_job*)a)->path, ((const firmware_job*)b)->path);
+}
+
+void print_field(const trionic5net::firmware_info* info, const unsigned char id, const char* description){
+	const trionic5net::firmware_footer_field* field = trionic5net::find_footer_field(info, id);
+
+	if(field != 0){
+		printf("%-17s %s\n", description, field->value);
+	}
+}
+
+void print_usage(void){
+	printf("This tool identifies Trionic 5 firmware images and verifies their checksums.\n");
+	printf("Usage: firmwarecheck <trionic5_binary>\n");
+	printf("       firmwarecheck -d <directory_of_binaries>\n");
+}
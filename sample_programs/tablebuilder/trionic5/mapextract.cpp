@@ -0,0 +1,205 @@
+/*
+ * Explanation:
+ * The calibration maps of a Trionic 5 (fuel, ignition, boost and so on) are stored in the flash
+ * binary next to the symbol table which names them. This tool finds them and writes them out as
+ * semicolon separated text, one table per map with the x axis on the first line and every
+ * following line starting with its y axis value, ready for a spreadsheet.
+ *
+ * How the maps are found is explained in can/trionic5/calibration_maps.hpp.
+ *
+ * With a map name, only that map is written and the output file is optional.
+ *
+ * In replay mode, a file of logged operating points is run through a map: every line holds
+ * the x and y value of one sample, e.g. load and Rpm, whitespace separated. The axes of the
+ * map are multiplied by the given scales to bring them to the units of the log. The number of
+ * samples closest to every cell is printed as a table laid out like the map itself.
+ * See can/trionic5/map_interpolation.hpp.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "can/trionic5/symbol_table.hpp"
+#include "can/trionic5/calibration_maps.hpp"
+#include "can/trionic5/map_interpolation.hpp"
+#include "timing/clock.h"
+
+int extract_maps(const char* binary_path, const char* output_path);
+int extract_map(const char* binary_path, const char* map_name, const char* output_path);
+int replay_samples(const char* binary_path, const char* map_name, const char* samples_path, const float x_scale, const float y_scale);
+int load_maps(const char* binary_path, trionic5net::symbol_table* table, trionic5net::calibration_maps* maps);
+void print_usage(void);
+
+int main(int argc, char** argv){
+	if( (argc == 4) && (strcmp(argv[1], "-m") == 0) ){
+		return extract_map(argv[2], argv[3], 0) ? 0 : 1;
+	}
+
+	if( (argc == 5) && (strcmp(argv[1], "-m") == 0) ){
+		return extract_map(argv[2], argv[3], argv[4]) ? 0 : 1;
+	}
+
+	if( (argc == 7) && (strcmp(argv[1], "-r") == 0) ){
+		return replay_samples(argv[2], argv[3], argv[4], atof(argv[5]), atof(argv[6])) ? 0 : 1;
+	}
+
+	if(argc != 3){
+		print_usage();
+		return 1;
+	}
+
+	return extract_maps(argv[1], argv[2]) ? 0 : 1;
+}
+
+int load_maps(const char* binary_path, trionic5net::symbol_table* table, trionic5net::calibration_maps* maps){
+	if(table->load(binary_path) == 0){
+		return 0;
+	}
+
+	unsigned long long start_time = monotonic_microseconds();
+
+	if(maps->load(table) == 0){
+		printf("No calibration found in %s\n", binary_path);
+		return 0;
+	}
+
+	unsigned long long load_time = monotonic_microseconds()-start_time;
+
+	printf("Calibration at 0x%05x-0x%05x, %u maps located in %llu.%03llu ms.\n", maps->get_calibration_start(), maps->get_calibration_start()+maps->get_calibration_size(), maps->get_number_of_maps(), load_time/1000, load_time%1000);
+
+	return 1;
+}
+
+int extract_maps(const char* binary_path, const char* output_path){
+	static trionic5net::symbol_table			table;
+	static trionic5net::calibration_maps	maps;
+
+	if(load_maps(binary_path, &table, &maps) == 0){
+		return 0;
+	}
+
+	for(unsigned int i = 0; i < maps.get_number_of_maps(); i++){
+		const trionic5net::calibration_map* map = maps.get_map(i);
+		printf("  %-20.*s 0x%05x %2ux%-2u\n", map->sym->name_length, map->sym->name, maps.get_flash_offset(map->sym), map->x_axis.count, map->y_axis.count);
+	}
+
+	return trionic5net::export_maps(output_path, &maps);
+}
+
+int extract_map(const char* binary_path, const char* map_name, const char* output_path){
+	static trionic5net::symbol_table			table;
+	static trionic5net::calibration_maps	maps;
+
+	if(load_maps(binary_path, &table, &maps) == 0){
+		return 0;
+	}
+
+	const trionic5net::calibration_map* map = maps.find(map_name);
+	if(map == 0){
+		printf("No map named %s in %s\n", map_name, binary_path);
+		return 0;
+	}
+
+	if(output_path == 0){
+		return trionic5net::export_map(stdout, map);
+	}
+
+	FILE* fp = fopen(output_path, "w");
+	if(fp == NULL){
+		perror(output_path);
+		return 0;
+	}
+
+	int success = trionic5net::export_map(fp, map);
+	fclose(fp);
+
+	return success;
+}
+
+int replay_samples(const char* binary_path, const char* map_name, const char* samples_path, const float x_scale, const float y_scale){
+	static trionic5net::symbol_table				table;
+	static trionic5net::calibration_maps		maps;
+	static trionic5net::interpolation_map		interpolation;
+
+	if(load_maps(binary_path, &table, &maps) == 0){
+		return 0;
+	}
+
+	const trionic5net::calibration_map* map = maps.find(map_name);
+	if(map == 0){
+		printf("No map named %s in %s\n", map_name, binary_path);
+		return 0;
+	}
+
+	if(trionic5net::prepare_interpolation(&interpolation, map, x_scale, y_scale) == 0){
+		printf("%s can not be interpolated.\n", map_name);
+		return 0;
+	}
+
+	FILE* fp = fopen(samples_path, "r");
+	if(fp == NULL){
+		perror(samples_path);
+		return 0;
+	}
+
+	unsigned int	number_of_samples	= 0;
+	unsigned int	sample_capacity		= 0;
+	float*				x									= 0;
+	float*				y									= 0;
+	float					sample_x;
+	float					sample_y;
+
+	while(fscanf(fp, "%f %f", &sample_x, &sample_y) == 2){
+		if(number_of_samples == sample_capacity){
+			sample_capacity	= sample_capacity ? sample_capacity*2 : 65536;
+			x								= (float*)realloc(x, sample_capacity*sizeof(float));
+			y								= (float*)realloc(y, sample_capacity*sizeof(float));
+		}
+
+		x[number_of_samples] = sample_x;
+		y[number_of_samples] = sample_y;
+		number_of_samples += 1;
+	}
+
+	fclose(fp);
+
+	float*							values		= (float*)malloc((number_of_samples+1)*sizeof(float));
+	unsigned long long	histogram[MAX_INTERPOLATION_CELLS];
+	memset(histogram, 0, sizeof(histogram));
+
+	unsigned long long start_time	= monotonic_microseconds();
+	unsigned int threads					= trionic5net::interpolate_map_parallel(&interpolation, x, y, number_of_samples, values, 0, histogram, 0);
+	unsigned long long run_time		= monotonic_microseconds()-start_time;
+
+	printf("Interpolated %u samples on %u threads in %llu.%03llu ms.\n", number_of_samples, threads, run_time/1000, run_time%1000);
+
+	for(unsigned int column = 0; column < map->x_axis.count; column++){
+		printf(";%d", trionic5net::get_axis_value(&map->x_axis, column));
+	}
+	printf("\n");
+
+	for(unsigned int row = 0; row < map->y_axis.count; row++){
+		if(map->y_axis.data != 0){
+			printf("%d", trionic5net::get_axis_value(&map->y_axis, row));
+		}
+
+		for(unsigned int column = 0; column < map->x_axis.count; column++){
+			printf(";%llu", histogram[row*map->x_axis.count+column]);
+		}
+		printf("\n");
+	}
+
+	free(values);
+	free(x);
+	free(y);
+
+	return 1;
+}
+
+void print_usage(void){
+	printf("This tool extracts the calibration maps in Trionic 5 as semicolon separated text.\n");
+	printf("Usage: mapextract <trionic5_binary> <output_file>\n");
+	printf("       mapextract -m <trionic5_binary> <map_name> [output_file]\n");
+	printf("       mapextract -r <trionic5_binary> <map_name> <samples_file> <x_axis_scale> <y_axis_scale>\n");
+}
@@ -0,0 +1,349 @@
+/*
+ * Author: Alexander Rajula
+ * E-mail: superrajula@gmail.com
+ *
+ * Kudos to: The T5Suite guys and gals
+ *
+ * Explanation:
+ * The Trionic 5 flash binary contains a lookup table.
+ * This lookup table points to where in the SRAM in Trionic a certain kind of variable resides in RAM.
+ * The binary identifier in the lookup table which separates symbols is 0x0d0a (carriage return and newline).
+ * The following two bytes tells us where we may find the data in SRAM, and the following two bytes gives us the length of the variable.
+ * The following bytes is a null-terminated string giving a textual name of the data variable.
+ *
+ * struct{
+ *   char 	separator[2];		// 0x0d0a
+ *   char 	address[2];
+ *   char 	length[2];
+ *   char*	variable_name;
+ * };
+ *
+ * The actual parsing is done by trionic5net::extract_symbols, see can/trionic5/symbol_table.hpp.
+ *
+ * In batch mode, every firmware image in a directory is parsed, spread out over all available
+ * processors, and the symbols of all images are written to one combined symbol database,
+ * keyed by firmware fingerprint. See can/trionic5/symbol_database.hpp.
+ *
+ * In query mode, the symbols of a firmware whose names start with a given prefix are looked up
+ * in such a database. The firmware is given either as an image, or by its fingerprint in hex,
+ * so that the database can be queried without the image at hand.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <limits.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "can/trionic5/symbol_table.hpp"
+#include "can/trionic5/symbol_database.hpp"
+#include "can/trionic5/sram_response.hpp"
+
+struct firmware_job{
+	char						path[PATH_MAX];
+	int							success;
+	unsigned char*	record;
+	size_t					record_size;
+};
+
+struct batch_context{
+	firmware_job*										jobs;
+	unsigned int										number_of_jobs;
+	unsigned int										next_job;
+	pthread_mutex_t									next_job_lock;
+	pthread_mutex_t									record_lock;
+};
+
+int extract_code(const char* binary_path, const char* code_path);
+int extract_directory(const char* directory_path, const char* database_path);
+int query_database(const char* database_path, const char* firmware, const char* prefix);
+void* extract_worker(void* context);
+int compare_jobs(const void* a, const void* b);
+void print_usage(void);
+
+void write_code_header(FILE* fp);
+void write_code_footer(FILE* fp);
+void write_generic_sram_response(FILE* fp);
+int write_symbol(FILE* fp, const trionic5net::symbol* sym);
+
+int main(int argc, char** argv){
+	if( (argc == 4) && (strcmp(argv[1], "-d") == 0) ){
+		return extract_directory(argv[2], argv[3]) ? 0 : 1;
+	}
+
+	if( (argc == 5) && (strcmp(argv[1], "-q") == 0) ){
+		return query_database(argv[2], argv[3], argv[4]) ? 0 : 1;
+	}
+
+	if(argc != 3){
+		print_usage();
+		return 1;
+	}
+
+	return extract_code(argv[1], argv[2]) ? 0 : 1;
+}
+
+int extract_code(const char* binary_path, const char* code_path){
+	static trionic5net::symbol_table table;
+
+	if(table.load(binary_path) == 0){
+		return 0;
+	}
+
+	FILE* code_file	=	fopen(code_path, "w");
+	if(code_file == NULL){
+		perror(code_path);
+		return 0;
+	}
+
+	write_code_header(code_file);
+
+	for(unsigned int i = 0; i < table.get_number_of_symbols(); i++){
+		const trionic5net::symbol* sym = table.get_symbol(i);
+
+		if(write_symbol(code_file, sym) == 0){
+			printf("Skipping %.*s, 0x%04x+%u is outside SRAM\n", sym->name_length, sym->name, sym->address, sym->length);
+		}
+	}
+
+	write_generic_sram_response(code_file);
+	write_code_footer(code_file);
+
+	fclose(code_file);
+
+	return 1;
+}
+
+int extract_directory(const char* directory_path, const char* database_path){
+	DIR* directory = opendir(directory_path);
+	if(directory == NULL){
+		perror(directory_path);
+		return 0;
+	}
+
+	batch_context context;
+	memset(&context, 0, sizeof(context));
+	pthread_mutex_init(&context.next_job_lock, NULL);
+	pthread_mutex_init(&context.record_lock, NULL);
+
+	unsigned int job_capacity = 0;
+	struct dirent* entry;
+
+	while( (entry = readdir(directory)) != NULL ){
+		char path[PATH_MAX];
+		snprintf(path, PATH_MAX, "%s/%s", directory_path, entry->d_name);
+
+		struct stat path_status;
+		if( (stat(path, &path_status) != 0) || !S_ISREG(path_status.st_mode) ){
+			continue;
+		}
+
+		if(context.number_of_jobs == job_capacity){
+			unsigned int	new_capacity	= job_capacity ? job_capacity*2 : 64;
+			firmware_job*	new_jobs			= (firmware_job*)realloc(context.jobs, new_capacity*sizeof(firmware_job));
+
+			if(new_jobs == NULL){
+				perror("Could not list the images");
+				closedir(directory);
+				free(context.jobs);
+				pthread_mutex_destroy(&context.next_job_lock);
+				pthread_mutex_destroy(&context.record_lock);
+				return 0;
+			}
+
+			context.jobs	= new_jobs;
+			job_capacity	= new_capacity;
+		}
+
+		firmware_job* job = &context.jobs[context.number_of_jobs];
+		memset(job, 0, sizeof(firmware_job));
+		memcpy(job->path, path, PATH_MAX);
+		context.number_of_jobs += 1;
+	}
+
+	closedir(directory);
+
+	qsort(context.jobs, context.number_of_jobs, sizeof(firmware_job), compare_jobs);
+
+	long processors = sysconf(_SC_NPROCESSORS_ONLN);
+	unsigned int workers = (processors > 0) ? processors : 1;
+	if(workers > context.number_of_jobs){
+		workers = context.number_of_jobs;
+	}
+
+	pthread_t* threads = (pthread_t*)malloc(workers*sizeof(pthread_t));
+	unsigned int started_workers = 0;
+
+	for(unsigned int i = 0; i < workers; i++){
+		if(pthread_create(&threads[started_workers], NULL, extract_worker, &context) == 0){
+			started_workers += 1;
+		}
+	}
+
+	/* If no thread could be started, do the work ourselves. */
+	if( (started_workers == 0) && (context.number_of_jobs > 0) ){
+		extract_worker(&context);
+	}
+
+	for(unsigned int i = 0; i < started_workers; i++){
+		pthread_join(threads[i], NULL);
+	}
+
+	/*
+	 * Records are added in the order of the paths, not as the workers finished them, so that every run
+	 * writes the same database, and of two images with the same fingerprint the first path is kept.
+	 */
+	trionic5net::symbol_database_writer*	database					= new trionic5net::symbol_database_writer;
+	unsigned int													extracted_images	= 0;
+
+	for(unsigned int i = 0; i < context.number_of_jobs; i++){
+		firmware_job* job = &context.jobs[i];
+
+		if(job->success){
+			job->success = database->add_record(job->record, job->record_size);
+			free(job->record);
+		}
+
+		if(job->success){
+			extracted_images += 1;
+		}
+		else{
+			printf("No symbol table found in %s\n", job->path);
+		}
+	}
+
+	int success = database->write(database_path);
+	if(success){
+		printf("Extracted symbols from %u of %u images.\n", extracted_images, context.number_of_jobs);
+	}
+
+	delete database;
+	free(threads);
+	free(context.jobs);
+	pthread_mutex_destroy(&context.next_job_lock);
+	pthread_mutex_destroy(&context.record_lock);
+
+	return success;
+}
+
+void* extract_worker(void* given_context){
+	batch_context* context = (batch_context*)given_context;
+
+	/* The table is far too large for a thread stack. */
+	trionic5net::symbol_table* table = new trionic5net::symbol_table;
+
+	do{
+		pthread_mutex_lock(&context->next_job_lock);
+		unsigned int job_index = context->next_job;
+		context->next_job += 1;
+		pthread_mutex_unlock(&context->next_job_lock);
+
+		if(job_index >= context->number_of_jobs){
+			break;
+		}
+
+		firmware_job* job = &context->jobs[job_index];
+
+		if(table->load(job->path) == 0){
+			continue;
+		}
+
+		uint64_t key = trionic5net::firmware_fingerprint(table->get_image(), table->get_image_size());
+
+		/* Building a record sorts with a shared comparator. */
+		pthread_mutex_lock(&context->record_lock);
+		job->success = trionic5net::symbol_database_writer::build_record(key, table, &job->record, &job->record_size);
+		pthread_mutex_unlock(&context->record_lock);
+
+		table->unload();
+	}while(1);
+
+	delete table;
+
+	return NULL;
+}
+
+int query_database(const char* database_path, const char* firmware, const char* prefix){
+	trionic5net::symbol_database database;
+
+	if(database.open(database_path) == 0){
+		return 0;
+	}
+
+	char*			end;
+	uint64_t	key = strtoull(firmware, &end, 16);
+
+	/* Anything but a fingerprint is taken to be an image. */
+	if( (strncmp(firmware, "0x", 2) != 0) || (*end != '\0') ){
+		static trionic5net::symbol_table table;
+		if(table.load(firmware) == 0){
+			return 0;
+		}
+
+		key = trionic5net::firmware_fingerprint(table.get_image(), table.get_image_size());
+	}
+
+	trionic5net::database_symbol_table symbols = database.find(key);
+
+	if(!symbols.is_valid()){
+		printf("Firmware %s (fingerprint 0x%016llx) is not in the database.\n", firmware, (unsigned long long)key);
+		return 0;
+	}
+
+	unsigned int first;
+	unsigned int count;
+
+	if(symbols.find_prefix(prefix, &first, &count)){
+		for(unsigned int i = first; i < first+count; i++){
+			trionic5net::symbol sym = symbols.get_symbol(i);
+			printf("%.*s 0x%04x %u\n", sym.name_length, sym.name, sym.address, sym.length);
+		}
+	}
+
+	return 1;
+}
+
+int compare_jobs(const void* a, const void* b){
+	return strcmp(((const firmware_job*)a)->path, ((const firmware_job*)b)->path);
+}
+
+void write_code_header(FILE* fp){
+	fprintf(fp, "#ifndef _messages_hpp_\n");
+	fprintf(fp, "#define _messages_hpp_\n");
+	fprintf(fp, "\n");
+	fprintf(fp, "#include <linux/can.h>\n");
+	fprintf(fp, "\n");
+	fprintf(fp, "namespace trionic5net{\n");
+}
+
+void write_code_footer(FILE* fp){
+	fprintf(fp, "}\n");
+	fprintf(fp, "\n");
+	fprintf(fp, "#endif\n");
+}
+
+void write_generic_sram_response(FILE* fp){
+	fprintf(fp, "  struct can_frame generic_sram_response = {0x%03x, 8, {0x%02X, 0x%02X, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00} };\n", TRIONIC5_RESPONSE_FRAME_ID, SRAM_READ_RESPONSE_OPCODE, SRAM_READ_RESPONSE_ACKNOWLEDGE);
+}
+
+int write_symbol(FILE* fp, const trionic5net::symbol* sym){
+	struct can_frame request;
+
+	if(trionic5net::build_sram_read_request(&request, sym->address, sym->address+sym->length) == 0){
+		return 0;
+	}
+
+	fprintf(fp, "  struct can_frame %.*s = {0x%03x, 8, {0x%X, 0x%x, 0x%x, 0x%x, 0x%x, 0x00, 0x00, 0x00} };\n", sym->name_length, sym->name, request.can_id, request.data[0], request.data[1], request.data[2], request.data[3], request.data[4]);
+
+	return 1;
+}
+
+void print_usage(void){
+	printf("This tool extracts the symbol table in Trionic 5 and outputs code.\n");
+	printf("Usage: symbolextract <trionic5_binary> <output_file>\n");
+	printf("       symbolextract -d <directory_of_binaries> <symbol_database>\n");
+	printf("       symbolextract -q <symbol_database> <trionic5_binary | 0xfingerprint> <symbol_prefix>\n");
+}